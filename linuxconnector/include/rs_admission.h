@@ -0,0 +1,128 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Admission control for calls sent over the serial link
+ * @file    rs_admission.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * Every call waits up to a second for its answer, so a burst of clients would pile up on the slow serial link. A
+ * call is only sent if the number of unanswered calls of its lambda and of the whole device are below their limits
+ * and a token bucket refilled with the byte budget of the link holds the bytes of the call and its answer. Rejected
+ * calls fail immediately, so the latency of admitted calls stays bounded under overload.
+ */
+
+#ifndef RIOTSENSORS_RS_ADMISSION_H
+#define RIOTSENSORS_RS_ADMISSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <rs_packets.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Default maximum number of unanswered calls of one lambda */
+#define RS_ADMISSION_DEFAULT_LAMBDA_CALLS 4
+/** @brief Default maximum number of unanswered calls of the device */
+#define RS_ADMISSION_DEFAULT_DEVICE_CALLS 32
+/** @brief Bytes assumed for the result of a string lambda */
+#define RS_ADMISSION_STRING_BYTES 32
+
+/** @brief The call may be sent */
+#define RS_ADMISSION_ADMITTED 0
+/** @brief The lambda has too many unanswered calls */
+#define RS_ADMISSION_LAMBDA_LIMIT 1
+/** @brief The device has too many unanswered calls */
+#define RS_ADMISSION_DEVICE_LIMIT 2
+/** @brief The byte budget of the link is used up */
+#define RS_ADMISSION_RATE_LIMIT 3
+/** @brief Number of RS_ADMISSION_* outcomes */
+#define RS_ADMISSION_OUTCOMES 4
+
+/**
+ * @brief Limits of the admission control, 0 disables a limit
+ */
+typedef struct {
+    /** @brief Maximum number of unanswered calls of one lambda */
+    uint32_t lambda_calls;
+    /** @brief Maximum number of unanswered calls of the device */
+    uint32_t device_calls;
+    /** @brief Bytes per second the link transfers, refill rate of the token bucket */
+    uint32_t bytes_per_second;
+    /** @brief Capacity of the token bucket in bytes, the burst sent at once after an idle period */
+    uint32_t burst_bytes;
+} rs_admission_limits;
+
+/**
+ * @brief Replace the limits, the token bucket starts full
+ *
+ * @param limits New limits
+ */
+void rs_admission_set_limits(const rs_admission_limits *limits);
+
+/**
+ * @brief Get the current limits
+ *
+ * @param limits Where to store the limits
+ */
+void rs_admission_get_limits(rs_admission_limits *limits);
+
+/**
+ * @brief Get the bytes a call and its answer occupy on the link
+ *
+ * @param type Type of the lambda
+ * @param by_name If the lambda is called by name
+ * @return Estimated bytes
+ */
+size_t rs_admission_call_bytes(rs_lambda_type_t type, bool by_name);
+
+/**
+ * @brief Admit a call to be sent, an admitted call has to be finished with rs_admission_release()
+ *
+ * @param id ID of the lambda
+ * @param bytes Bytes of the call and its answer (see rs_admission_call_bytes())
+ * @return RS_ADMISSION_ADMITTED or the limit that rejected the call
+ */
+uint8_t rs_admission_acquire(lambda_id_t id, size_t bytes);
+
+/**
+ * @brief Finish an admitted call after it was answered or timed out
+ *
+ * @param id ID of the lambda
+ */
+void rs_admission_release(lambda_id_t id);
+
+/**
+ * @brief Get the seconds after which a rejected call is likely to be admitted
+ *
+ * @return Seconds, at least 1
+ */
+uint32_t rs_admission_retry_after(void);
+
+/**
+ * @brief Get the number of unanswered calls of a lambda
+ *
+ * @param id ID of the lambda, MAX_LAMBDAS for the whole device
+ * @return Number of admitted calls not released yet
+ */
+uint32_t rs_admission_in_flight(lambda_id_t id);
+
+/**
+ * @brief Get the number of admission decisions with an outcome
+ *
+ * @param outcome RS_ADMISSION_* outcome
+ * @return Number of decisions, 0 for unknown outcomes
+ */
+uint64_t rs_admission_count(uint8_t outcome);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RIOTSENSORS_RS_ADMISSION_H
@@ -19,19 +19,60 @@
 #include <spt.h>
 #include <rs_packets.h>
 #include <lambda_registry.h>
+#include <rs_history.h>
+#include <rs_memory.h>
+#include <rs_metrics.h>
+#include <rs_admission.h>
+#include <rs_shm.h>
+#include <rs_stream.h>
+#include <rs_expression.h>
+#include <rs_trigger.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** @brief Maximum length of a chain of derived lambdas that is updated after a result changed */
+#define RS_DERIVED_MAX_DEPTH 16
+/** @brief Maximum number of triggers */
+#define RS_MAX_TRIGGERS 64
+/** @brief Maximum number of open push streams */
+#define RS_MAX_STREAMS 64
+
+/**
+ * @brief Definition of a derived lambda, computed on the server from the cached results of other lambdas
+ */
+typedef struct {
+    /** @brief Compiled expression */
+    rs_expr expr;
+    /** @brief Registry IDs of the inputs (index aligned with expr.inputs), -1 if not registered */
+    int16_t input_ids[RS_EXPR_MAX_INPUTS];
+} rs_linux_derived_lambda;
+
 /**
  * @brief Additional data to store with a lambda in the registry
  */
 typedef struct {
     pthread_cond_t wait_result;
+    /** @brief Number of result and error packets received, lets waiting callers detect spurious wake ups */
+    uint32_t received;
     bool data_cached;
     int8_t last_call_error;
     generic_lambda_return ret;
+    /** @brief Past numeric results (int and double lambdas only) */
+    rs_history history;
+    /** @brief Version of the cached result, incremented whenever the cached value changes */
+    uint32_t version;
+    /** @brief ID of the lambda on the device, differs from the registry ID once derived lambdas are registered */
+    lambda_id_t device_id;
+    /** @brief Definition of a derived lambda, NULL for lambdas of the device */
+    rs_linux_derived_lambda *derived;
+    /** @brief Bit set of the registry IDs of the derived lambdas using this lambda as an input */
+    uint8_t dependents[(MAX_LAMBDAS + 7) / 8];
+    /** @brief Triggers evaluated on every numeric result of this lambda */
+    rs_trigger *triggers;
+    /** @brief rs_metrics_now() when the oldest unanswered call packet was sent, 0 if no call is pending */
+    uint64_t call_sent;
 } rs_linux_registered_lambda;
 
 /**
@@ -49,26 +90,275 @@ int rs_linux_start(const char *serial_file);
  */
 int rs_linux_stop(void);
 
+/**
+ * @brief Lock the registry, required to walk the registry or to access registered lambdas from other threads
+ */
+void rs_linux_lock_registry(void);
+
+/**
+ * @brief Unlock the registry locked by rs_linux_lock_registry()
+ */
+void rs_linux_unlock_registry(void);
+
+/**
+ * @brief Copy the registry entry of a lambda identified by it's ID
+ *
+ * The copy stays valid if the lambda is unregistered concurrently.
+ *
+ * @param id ID of the lambda
+ * @param copy Where to store the copy
+ * @return If the lambda was found
+ */
+bool copy_registered_lambda_by_id(lambda_id_t id, rs_registered_lambda *copy);
+
+/**
+ * @brief Copy the registry entry of a lambda identified by it's name
+ *
+ * The copy stays valid if the lambda is unregistered concurrently.
+ *
+ * @param name Name of the lambda
+ * @param copy Where to store the copy
+ * @return If the lambda was found
+ */
+bool copy_registered_lambda_by_name(const char *name, rs_registered_lambda *copy);
+
 /**
  * @brief Send a packet to call a lambda by it's
  *
  * @param id ID of the packet
  * @param expected_type expected return type
- * @param result Where to store the result
+ * @param result Where to store the result, a string result is a copy that has to be freed by the caller
  * @return A RS_CALL_* constant
  */
 int8_t call_lambda_by_id(lambda_id_t id, rs_lambda_type_t expected_type, generic_lambda_return *result);
 
+/**
+ * @brief Send a packet to call a lambda by it's ID and report the version of the returned result
+ *
+ * @param id ID of the packet
+ * @param expected_type expected return type
+ * @param result Where to store the result, a string result is a copy that has to be freed by the caller
+ * @param version Where to store the version of the result (see rs_linux_registered_lambda), may be NULL
+ * @return A RS_CALL_* constant
+ */
+int8_t call_lambda_by_id_versioned(lambda_id_t id, rs_lambda_type_t expected_type, generic_lambda_return *result,
+                                   uint32_t *version);
+
+/**
+ * @brief Call several lambdas by their IDs at once and report the versions of the returned results
+ *
+ * Results the cache policies allow are taken from the cache immediately. The call packets of all other lambdas are
+ * sent before waiting for any answer and all calls share one timeout, so the calls run concurrently on the device
+ * and the time taken is bounded by the slowest lambda instead of the sum.
+ *
+ * @param count Number of lambdas
+ * @param ids IDs of the lambdas, must not contain duplicates
+ * @param expected_types Expected return type of each lambda, 0 to accept the registered type
+ * @param results Where to store the results, string results are copies that have to be freed by the caller
+ * @param versions Where to store the versions of the results (see rs_linux_registered_lambda), may be NULL
+ * @param codes Where to store the RS_CALL_* constant of each call
+ */
+void call_lambdas_by_id_versioned(size_t count, const lambda_id_t *ids, const rs_lambda_type_t *expected_types,
+                                  generic_lambda_return *results, uint32_t *versions, int8_t *codes);
+
+/**
+ * @brief Receives the outcome of an asynchronous call
+ *
+ * @param res A RS_CALL_* constant
+ * @param result Result of the call, a string result is a copy that has to be freed by the callback
+ * @param version Version of the result (see rs_linux_registered_lambda)
+ * @param ctx Context given to the call
+ */
+typedef void (*rs_call_callback)(int8_t res, generic_lambda_return *result, uint32_t version, void *ctx);
+
+/**
+ * @brief Call a lambda by it's ID without waiting for the answer
+ *
+ * The callback is called exactly once without the registry lock held: by the calling thread if the call is answered
+ * from the cache or fails immediately, by the serial thread when the answer arrives or by the expiry thread of the
+ * connector after the timeout of one second. It should return quickly, as it delays the processing of other packets.
+ *
+ * @param id ID of the lambda
+ * @param expected_type Expected return type
+ * @param callback Receives the outcome
+ * @param ctx Passed to the callback
+ */
+void call_lambda_by_id_async(lambda_id_t id, rs_lambda_type_t expected_type, rs_call_callback callback, void *ctx);
+
+/**
+ * @brief Call a lambda by it's name without waiting for the answer (see call_lambda_by_id_async())
+ *
+ * @param name Name of the lambda
+ * @param expected_type Expected return type
+ * @param callback Receives the outcome
+ * @param ctx Passed to the callback
+ */
+void call_lambda_by_name_async(const char *name, rs_lambda_type_t expected_type, rs_call_callback callback,
+                               void *ctx);
+
 /**
  * @brief Send a packet to call a lambda by it's name
  *
  * @param name Name of the packet
  * @param expected_type Expected return type
- * @param result Where to store the result
+ * @param result Where to store the result, a string result is a copy that has to be freed by the caller
  * @return A RS_CALL_* constant
  */
 int8_t call_lambda_by_name(const char *name, rs_lambda_type_t expected_type, generic_lambda_return *result);
 
+/**
+ * @brief Send a packet to call a lambda by it's name and report the version of the returned result
+ *
+ * @param name Name of the packet
+ * @param expected_type Expected return type
+ * @param result Where to store the result, a string result is a copy that has to be freed by the caller
+ * @param version Where to store the version of the result (see rs_linux_registered_lambda), may be NULL
+ * @return A RS_CALL_* constant
+ */
+int8_t call_lambda_by_name_versioned(const char *name, rs_lambda_type_t expected_type, generic_lambda_return *result,
+                                     uint32_t *version);
+
+/**
+ * @brief Get the version of the registry, incremented whenever a lambda is registered or unregistered
+ *
+ * @return Registry version
+ */
+uint32_t rs_linux_get_registry_version(void);
+
+/**
+ * @brief Get the version of all cached results, incremented whenever the cached result of any lambda changes
+ *
+ * @return Results version
+ */
+uint32_t rs_linux_get_values_version(void);
+
+/**
+ * @brief Run a range query over the stored result history of a lambda identified by it's ID
+ *
+ * @param id ID of the lambda
+ * @param op RS_QUERY_* operation
+ * @param from Lower time bound in milliseconds since the epoch (inclusive)
+ * @param to Upper time bound in milliseconds since the epoch (inclusive)
+ * @param quantile Quantile in [0, 1] for RS_QUERY_QUANTILE, ignored otherwise
+ * @param result Where to store the result
+ * @param count Where to store the number of samples in the range (may be NULL)
+ * @return A RS_QUERY_* result constant
+ */
+int8_t query_lambda_history_by_id(lambda_id_t id, rs_query_op_t op, uint64_t from, uint64_t to, double quantile,
+                                  double *result, size_t *count);
+
+/**
+ * @brief Run a range query over the stored result history of a lambda identified by it's name
+ *
+ * @param name Name of the lambda
+ * @param op RS_QUERY_* operation
+ * @param from Lower time bound in milliseconds since the epoch (inclusive)
+ * @param to Upper time bound in milliseconds since the epoch (inclusive)
+ * @param quantile Quantile in [0, 1] for RS_QUERY_QUANTILE, ignored otherwise
+ * @param result Where to store the result
+ * @param count Where to store the number of samples in the range (may be NULL)
+ * @return A RS_QUERY_* result constant
+ */
+int8_t query_lambda_history_by_name(const char *name, rs_query_op_t op, uint64_t from, uint64_t to, double quantile,
+                                    double *result, size_t *count);
+
+/**
+ * @brief Register a derived lambda whose result is computed from the cached results of other lambdas
+ *
+ * The lambda has the type RS_LAMBDA_DOUBLE and the cache policy RS_CACHE_ONLY. It is evaluated whenever the cached
+ * result of one of its inputs changes and all inputs have a cached int or double result. Inputs may be registered
+ * later and may be derived lambdas themselves.
+ *
+ * @param name Name of the derived lambda
+ * @param expression Expression over the names of other lambdas (see rs_expression.h)
+ * @return A value greater/equals to zero containing the new ID on success, a negative RS_REGISTER_* value on failure
+ */
+int8_t rs_linux_register_derived(const char *name, const char *expression);
+
+/**
+ * @brief Add a trigger evaluated on every int or double result the lambda it refers to stores
+ *
+ * The lambda may be registered later, fired triggers are added to the event queue.
+ *
+ * @param definition Trigger definition (see rs_trigger_parse())
+ * @return A RS_TRIGGER_* result constant
+ */
+int8_t rs_linux_add_trigger(const char *definition);
+
+/**
+ * @brief Remove all triggers
+ */
+void rs_linux_clear_triggers(void);
+
+/**
+ * @brief Read fired trigger events from the event queue
+ *
+ * @param after Sequence number of the last event the reader has seen, 0 to read all available events
+ * @param events Where to store the events
+ * @param max Maximum number of events to read
+ * @param wait_ms Milliseconds to wait for a new event if there are none, 0 to return immediately
+ * @return Number of events read
+ */
+size_t rs_linux_read_events(uint64_t after, rs_trigger_event *events, size_t max, uint32_t wait_ms);
+
+/**
+ * @brief Get a file descriptor to wait for fired trigger events with epoll (see rs_event_queue_fd())
+ *
+ * @return Non-blocking eventfd, -1 if it could not be created
+ */
+int rs_linux_events_fd(void);
+
+/**
+ * @brief Reset the file descriptor returned by rs_linux_events_fd()
+ */
+void rs_linux_clear_events_fd(void);
+
+/**
+ * @brief Get the number of events that were dropped because the event queue was full
+ *
+ * @return Number of dropped events
+ */
+uint64_t rs_linux_get_dropped_events(void);
+
+/**
+ * @brief Publish the latest result of every lambda to a shared memory table (see rs_shm.h) from now on
+ *
+ * The table is removed again by rs_linux_stop().
+ *
+ * @param name Name of the shared memory object, eg. RS_SHM_DEFAULT_NAME
+ * @return 0 on success, -1 if the shared memory object could not be created
+ */
+int rs_linux_enable_shm(const char *name);
+
+/**
+ * @brief Open a push stream that receives every result stored from now on for the subscribed lambdas
+ *
+ * rs_linux_stop() closes all streams, they still have to be released with rs_linux_close_stream().
+ *
+ * @param ids Bit set of the subscribed lambda IDs, NULL to subscribe to all lambdas
+ * @param type Type of the subscribed lambdas, 0 for all types
+ * @return The stream or NULL if RS_MAX_STREAMS streams are open or out of memory
+ */
+rs_stream *rs_linux_open_stream(const uint8_t *ids, rs_lambda_type_t type);
+
+/**
+ * @brief Change the lambdas a stream opened with rs_linux_open_stream() is subscribed to
+ *
+ * Updates already queued are kept.
+ *
+ * @param s Stream
+ * @param ids Bit set of the subscribed lambda IDs, NULL to subscribe to all lambdas
+ * @param type Type of the subscribed lambdas, 0 for all types
+ */
+void rs_linux_update_stream(rs_stream *s, const uint8_t *ids, rs_lambda_type_t type);
+
+/**
+ * @brief Unsubscribe and free a stream opened with rs_linux_open_stream()
+ *
+ * @param s Stream
+ */
+void rs_linux_close_stream(rs_stream *s);
+
 /**
  * @brief Handle an incoming binary data packet
  * Should not be used in user programs, internal use only
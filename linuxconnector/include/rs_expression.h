@@ -0,0 +1,125 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Arithmetic expressions over lambda results, used by derived lambdas
+ * @file    rs_expression.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * Grammar (whitespace is ignored):
+ *
+ *     expr    := term (('+' | '-') term)*
+ *     term    := unary (('*' | '/') unary)*
+ *     unary   := '-' unary | power
+ *     power   := primary ('^' unary)?
+ *     primary := number | name | function '(' expr (',' expr)* ')' | '(' expr ')'
+ *
+ * A name refers to the cached result of the lambda with this name. Available functions are abs, sqrt, exp, log
+ * (natural logarithm), log10, min, max and pow.
+ */
+
+#ifndef RIOTSENSORS_RS_EXPRESSION_H
+#define RIOTSENSORS_RS_EXPRESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <rs_constants.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Maximum number of instructions of a compiled expression */
+#define RS_EXPR_MAX_CODE 64
+/** @brief Maximum number of distinct lambdas an expression refers to */
+#define RS_EXPR_MAX_INPUTS 8
+/** @brief Maximum evaluation stack depth of an expression */
+#define RS_EXPR_MAX_STACK 16
+/** @brief Maximum nesting of parentheses, function arguments and operands of unary minus and ^ */
+#define RS_EXPR_MAX_NESTING 32
+
+/** @brief The expression was compiled/evaluated successfully */
+#define RS_EXPR_SUCCESS 0
+/** @brief The expression is not well formed */
+#define RS_EXPR_SYNTAX -1
+/** @brief The expression uses an unknown function or a wrong number of function arguments */
+#define RS_EXPR_UNKNOWN_FUNCTION -2
+/** @brief The expression exceeds RS_EXPR_MAX_CODE, RS_EXPR_MAX_INPUTS, RS_EXPR_MAX_STACK or RS_EXPR_MAX_NESTING */
+#define RS_EXPR_TOO_COMPLEX -3
+/** @brief Could not allocate the required memory */
+#define RS_EXPR_NOMEM -4
+/** @brief The evaluation did not result in a finite number */
+#define RS_EXPR_NOT_FINITE -5
+
+/**
+ * @brief One instruction of a compiled expression (evaluated on a stack machine)
+ */
+typedef struct {
+    /** @brief Operation code */
+    uint8_t op;
+    /** @brief Input index for input loads */
+    uint8_t input;
+    /** @brief Constant for constant loads */
+    double value;
+} rs_expr_instruction;
+
+/**
+ * @brief A compiled expression
+ */
+typedef struct {
+    /** @brief Source text of the expression */
+    char *source;
+    /** @brief Instructions in reverse polish notation */
+    rs_expr_instruction code[RS_EXPR_MAX_CODE];
+    /** @brief Number of instructions */
+    uint8_t code_length;
+    /** @brief Names of the referenced lambdas, the index is used by input loads */
+    char inputs[RS_EXPR_MAX_INPUTS][MAX_LAMBDA_NAME_LENGTH + 1];
+    /** @brief Number of referenced lambdas */
+    uint8_t input_count;
+} rs_expr;
+
+/**
+ * @brief Compile an expression
+ *
+ * @param expr Where to store the compiled expression, has to be freed with rs_expr_free() on success
+ * @param source Source text
+ * @param error_pos Where to store the offset of a syntax error in the source, may be NULL
+ * @return A RS_EXPR_* constant
+ */
+int8_t rs_expr_compile(rs_expr *expr, const char *source, size_t *error_pos);
+
+/**
+ * @brief Evaluate a compiled expression
+ *
+ * @param expr Compiled expression
+ * @param inputs Values of the referenced lambdas, index aligned with expr->inputs
+ * @param result Where to store the result
+ * @return RS_EXPR_SUCCESS or RS_EXPR_NOT_FINITE
+ */
+int8_t rs_expr_eval(const rs_expr *expr, const double *inputs, double *result);
+
+/**
+ * @brief Free the resources of a compiled expression
+ *
+ * @param expr Compiled expression
+ */
+void rs_expr_free(rs_expr *expr);
+
+/**
+ * @brief Convert a RS_EXPR_* constant to a string representation
+ *
+ * @param c RS_EXPR_* constant
+ * @return String representation, NULL if not found
+ */
+const char *stringify_rs_expr_result(int8_t c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RIOTSENSORS_RS_EXPRESSION_H
@@ -0,0 +1,236 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Time series history of lambda results and range queries over it
+ * @file    rs_history.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#ifndef RIOTSENSORS_RS_HISTORY_H
+#define RIOTSENSORS_RS_HISTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Default number of samples kept per lambda */
+#define RS_HISTORY_DEFAULT_CAPACITY 4096
+
+/** @brief Number of samples in the given range */
+#define RS_QUERY_COUNT 1
+/** @brief Sum of the samples in the given range */
+#define RS_QUERY_SUM 2
+/** @brief Minimum of the samples in the given range */
+#define RS_QUERY_MIN 3
+/** @brief Maximum of the samples in the given range */
+#define RS_QUERY_MAX 4
+/** @brief Arithmetic mean of the samples in the given range */
+#define RS_QUERY_MEAN 5
+/** @brief Quantile of the samples in the given range (linear interpolation between closest ranks) */
+#define RS_QUERY_QUANTILE 6
+
+/**
+ * @brief Identifier of a range query operation (RS_QUERY_* operation constants)
+ */
+typedef uint8_t rs_query_op_t;
+
+/** @brief The query was successful */
+#define RS_QUERY_SUCCESS 0
+/** @brief Lambda with the given ID or name was not found */
+#define RS_QUERY_NOTFOUND -1
+/** @brief The lambda does not keep a numeric history */
+#define RS_QUERY_WRONGTYPE -2
+/** @brief No samples within the given range */
+#define RS_QUERY_EMPTY -3
+/** @brief A parameter/a combination of parameters is invalid */
+#define RS_QUERY_INVALPARAM -4
+/** @brief Could not allocate the required memory */
+#define RS_QUERY_NOMEM -5
+
+/**
+ * @brief Ring buffer of timestamped samples of one lambda
+ *
+ * Timestamps and values are stored in two separate contiguous arrays so that range queries run over plain arrays
+ * of doubles. Timestamps are kept in ascending order.
+ */
+typedef struct {
+    /** @brief Sample timestamps in milliseconds since the epoch */
+    uint64_t *timestamps;
+    /** @brief Sample values, index aligned with timestamps */
+    double *values;
+    /** @brief Maximum number of samples, 0 disables the history */
+    size_t capacity;
+    /** @brief Physical index of the oldest sample */
+    size_t head;
+    /** @brief Number of stored samples */
+    size_t count;
+    /** @brief rs_memory_tick() when the buffers were allocated */
+    uint64_t allocated_at;
+    /** @brief rs_memory_tick() when the buffers were allocated or the history was last queried */
+    uint64_t last_used;
+    /** @brief The buffers were evicted, appends are ignored until the history is queried again */
+    bool suspended;
+} rs_history;
+
+/**
+ * @brief Set the capacity used for histories initialized from now on
+ *
+ * @param capacity Number of samples per lambda, 0 disables the history
+ */
+void rs_history_set_default_capacity(size_t capacity);
+
+/**
+ * @brief Get the capacity used for newly initialized histories
+ *
+ * @return Number of samples per lambda
+ */
+size_t rs_history_get_default_capacity(void);
+
+/**
+ * @brief Initialize an empty history with the default capacity
+ *
+ * The buffers are allocated lazily on the first append.
+ *
+ * @param h History
+ */
+void rs_history_init(rs_history *h);
+
+/**
+ * @brief Free the buffers of a history
+ *
+ * @param h History
+ */
+void rs_history_free(rs_history *h);
+
+/**
+ * @brief Get the number of bytes allocated for the buffers of a history
+ *
+ * @param h History
+ * @return Number of bytes, 0 if the buffers are not allocated
+ */
+size_t rs_history_bytes(const rs_history *h);
+
+/**
+ * @brief Free the buffers of a history to save memory, appends are ignored until the next rs_history_touch()
+ *
+ * @param h History
+ * @return Number of freed bytes
+ */
+size_t rs_history_evict(rs_history *h);
+
+/**
+ * @brief Mark a history as used by a reader, resuming a history that was evicted
+ *
+ * @param h History
+ */
+void rs_history_touch(rs_history *h);
+
+/**
+ * @brief Append a sample, overwriting the oldest one if the history is full
+ *
+ * Timestamps older than the newest sample are clamped to keep the history sorted. The buffers are accounted as
+ * RS_MEMORY_HISTORY and not allocated if they do not fit into the memory budget.
+ *
+ * @param h History
+ * @param timestamp Timestamp in milliseconds since the epoch
+ * @param value Sample value
+ * @return 0 on success, RS_QUERY_NOMEM if the buffers could not be allocated or exceed the memory budget
+ */
+int8_t rs_history_append(rs_history *h, uint64_t timestamp, double value);
+
+/**
+ * @brief Run a range query over all samples with from <= timestamp <= to
+ *
+ * @param h History
+ * @param op RS_QUERY_* operation
+ * @param from Lower time bound (inclusive)
+ * @param to Upper time bound (inclusive)
+ * @param quantile Quantile in [0, 1] for RS_QUERY_QUANTILE, ignored otherwise
+ * @param result Where to store the result
+ * @param count Where to store the number of samples in the range (may be NULL)
+ * @return A RS_QUERY_* result constant
+ */
+int8_t rs_history_query(const rs_history *h, rs_query_op_t op, uint64_t from, uint64_t to, double quantile,
+                        double *result, size_t *count);
+
+/**
+ * @brief Get the current time in milliseconds since the epoch
+ *
+ * @return Current timestamp
+ */
+uint64_t rs_history_now(void);
+
+/**
+ * @brief Sum of a contiguous array
+ *
+ * @param values Array
+ * @param n Number of elements
+ * @return Sum
+ */
+double rs_kernel_sum(const double *values, size_t n);
+
+/**
+ * @brief Minimum of a contiguous non-empty array
+ *
+ * @param values Array
+ * @param n Number of elements (> 0)
+ * @return Minimum
+ */
+double rs_kernel_min(const double *values, size_t n);
+
+/**
+ * @brief Maximum of a contiguous non-empty array
+ *
+ * @param values Array
+ * @param n Number of elements (> 0)
+ * @return Maximum
+ */
+double rs_kernel_max(const double *values, size_t n);
+
+/**
+ * @brief Quantile of a contiguous non-empty array, reordering the array in place
+ *
+ * @param values Array
+ * @param n Number of elements (> 0)
+ * @param quantile Quantile in [0, 1]
+ * @return Quantile
+ */
+double rs_kernel_quantile(double *values, size_t n, double quantile);
+
+/**
+ * @brief Get the query operation from its name (count, sum, min, max, mean, quantile)
+ *
+ * @param str Name of the operation
+ * @return RS_QUERY_* operation constant on success, (rs_query_op_t) -1 otherwise
+ */
+rs_query_op_t get_query_op_from_string(const char *str);
+
+/**
+ * @brief Get a human readable string for a query operation
+ *
+ * @param c RS_QUERY_* operation constant
+ * @return A string or NULL
+ */
+const char *stringify_rs_query_op_t(rs_query_op_t c);
+
+/**
+ * @brief Get a human readable string for a query result
+ *
+ * @param c RS_QUERY_* result constant
+ * @return A string or NULL
+ */
+const char *stringify_rs_query_result(int8_t c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RIOTSENSORS_RS_HISTORY_H
@@ -0,0 +1,202 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Memory budget and accounting of cached data
+ * @file    rs_memory.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * Every category of cached data reports its allocations here. When a reservation would exceed the budget, the
+ * registered reclaimers evict data of the reserving category and of all categories before it, so data that is
+ * cheap to rebuild (serialized responses) is evicted before data that is lost on eviction (history).
+ */
+
+#ifndef RIOTSENSORS_RS_MEMORY_H
+#define RIOTSENSORS_RS_MEMORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Serialized REST responses */
+#define RS_MEMORY_RESPONSES 0
+/** @brief Result history buffers */
+#define RS_MEMORY_HISTORY 1
+/** @brief Cached string results, accounted but never evicted because only the latest result is kept */
+#define RS_MEMORY_STRINGS 2
+/** @brief Number of memory categories */
+#define RS_MEMORY_CATEGORIES 3
+
+/**
+ * @brief Category of accounted memory (RS_MEMORY_* category constants)
+ */
+typedef uint8_t rs_memory_category_t;
+
+/** @brief Evict the data that was used least recently */
+#define RS_EVICT_LRU 1
+/** @brief Evict the data that was allocated first */
+#define RS_EVICT_OLDEST 2
+
+/**
+ * @brief Eviction policy (RS_EVICT_* constants)
+ */
+typedef uint8_t rs_evict_policy_t;
+
+/**
+ * @brief Function that evicts data of one category
+ *
+ * @param bytes Number of bytes that should be freed
+ * @return Number of bytes actually freed (released with rs_memory_release())
+ */
+typedef size_t (*rs_memory_reclaimer)(size_t bytes);
+
+/**
+ * @brief Usage of one memory category
+ */
+typedef struct {
+    /** @brief Bytes currently in use */
+    size_t bytes;
+    /** @brief Number of evicted entries */
+    uint64_t evictions;
+    /** @brief Number of evicted bytes */
+    uint64_t evicted_bytes;
+    /** @brief Number of reservations refused because the budget was exhausted */
+    uint64_t refused;
+} rs_memory_usage;
+
+/**
+ * @brief Set the memory budget
+ *
+ * @param bytes Maximum number of bytes of all categories, 0 for no limit
+ */
+void rs_memory_set_budget(size_t bytes);
+
+/**
+ * @brief Get the memory budget
+ *
+ * @return Maximum number of bytes of all categories, 0 for no limit
+ */
+size_t rs_memory_get_budget(void);
+
+/**
+ * @brief Set the eviction policy used by all reclaimers
+ *
+ * @param policy RS_EVICT_* constant
+ */
+void rs_memory_set_policy(rs_evict_policy_t policy);
+
+/**
+ * @brief Get the eviction policy
+ *
+ * @return RS_EVICT_* constant
+ */
+rs_evict_policy_t rs_memory_get_policy(void);
+
+/**
+ * @brief Set the reclaimer of a category
+ *
+ * @param category RS_MEMORY_* category
+ * @param reclaimer Reclaimer or NULL
+ */
+void rs_memory_set_reclaimer(rs_memory_category_t category, rs_memory_reclaimer reclaimer);
+
+/**
+ * @brief Account memory only if it fits into the budget, without evicting anything
+ *
+ * @param category RS_MEMORY_* category
+ * @param bytes Number of bytes
+ * @return If the memory was accounted
+ */
+bool rs_memory_try_reserve(rs_memory_category_t category, size_t bytes);
+
+/**
+ * @brief Account memory, evicting data of this and all preceding categories to make it fit into the budget
+ *
+ * @param category RS_MEMORY_* category
+ * @param bytes Number of bytes
+ * @return If the memory was accounted, the caller must not allocate it otherwise
+ */
+bool rs_memory_reserve(rs_memory_category_t category, size_t bytes);
+
+/**
+ * @brief Account memory that has to be kept, evicting data of this and all preceding categories if possible
+ *
+ * @param category RS_MEMORY_* category
+ * @param bytes Number of bytes
+ */
+void rs_memory_account(rs_memory_category_t category, size_t bytes);
+
+/**
+ * @brief Release accounted memory
+ *
+ * @param category RS_MEMORY_* category
+ * @param bytes Number of bytes
+ */
+void rs_memory_release(rs_memory_category_t category, size_t bytes);
+
+/**
+ * @brief Count an eviction, the memory itself has to be released with rs_memory_release()
+ *
+ * @param category RS_MEMORY_* category
+ * @param bytes Number of evicted bytes
+ */
+void rs_memory_count_eviction(rs_memory_category_t category, size_t bytes);
+
+/**
+ * @brief Get the usage of a category
+ *
+ * @param category RS_MEMORY_* category
+ * @param usage Where to store the usage
+ */
+void rs_memory_get_usage(rs_memory_category_t category, rs_memory_usage *usage);
+
+/**
+ * @brief Get the number of bytes used by all categories
+ *
+ * @return Number of bytes
+ */
+size_t rs_memory_get_used(void);
+
+/**
+ * @brief Get a monotonically increasing counter used to order uses and allocations for eviction
+ *
+ * @return Next counter value
+ */
+uint64_t rs_memory_tick(void);
+
+/**
+ * @brief Get the eviction policy from its name (lru, oldest)
+ *
+ * @param str Name of the policy
+ * @return RS_EVICT_* constant on success, (rs_evict_policy_t) -1 otherwise
+ */
+rs_evict_policy_t get_evict_policy_from_string(const char *str);
+
+/**
+ * @brief Get a human readable string for an eviction policy
+ *
+ * @param c RS_EVICT_* constant
+ * @return A string or NULL
+ */
+const char *stringify_rs_evict_policy_t(rs_evict_policy_t c);
+
+/**
+ * @brief Get a human readable string for a memory category
+ *
+ * @param c RS_MEMORY_* category constant
+ * @return A string or NULL
+ */
+const char *stringify_rs_memory_category_t(rs_memory_category_t c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RIOTSENSORS_RS_MEMORY_H
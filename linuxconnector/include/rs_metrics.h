@@ -0,0 +1,195 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Counters and latency histograms of lambda calls
+ * @file    rs_metrics.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * All counters are relaxed atomics. The counters of a lambda share one cache line that no other lambda uses, so
+ * threads calling different lambdas do not contend. Serial round-trip times are recorded into a histogram with
+ * logarithmic buckets that are each divided into RS_METRICS_RTT_SUB_BUCKETS linear buckets (like HdrHistogram),
+ * so every recorded value is known with a relative error below 1 / RS_METRICS_RTT_SUB_BUCKETS.
+ */
+
+#ifndef RIOTSENSORS_RS_METRICS_H
+#define RIOTSENSORS_RS_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <rs_constants.h>
+#include <rs_packets.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Size of a cache line, counters written by different threads are aligned to it */
+#define RS_CACHE_LINE 64
+
+/** @brief Number of bits of a round-trip time kept exactly */
+#define RS_METRICS_RTT_SUB_BITS 4
+/** @brief Number of linear buckets every power of two is divided into */
+#define RS_METRICS_RTT_SUB_BUCKETS (1 << RS_METRICS_RTT_SUB_BITS)
+/** @brief Round-trip times from 2^RS_METRICS_RTT_MAX_BITS microseconds (about 67 seconds) share the last bucket */
+#define RS_METRICS_RTT_MAX_BITS 26
+/** @brief Number of buckets of a round-trip time histogram */
+#define RS_METRICS_RTT_BUCKETS ((RS_METRICS_RTT_MAX_BITS - RS_METRICS_RTT_SUB_BITS + 1) * RS_METRICS_RTT_SUB_BUCKETS)
+
+/** @brief Number of RS_CALL_* constants, counted per lambda */
+#define RS_METRICS_CALL_RESULTS (RS_CALL_CACHE_TIMEOUT - RS_CALL_OVERLOAD + 1)
+
+/** @brief The result was taken from the cache */
+#define RS_METRICS_CACHE_HIT 0
+/** @brief The cache policy required a call to the device */
+#define RS_METRICS_CACHE_MISS 1
+/** @brief The cache policy only allowed a cached result, but none was available */
+#define RS_METRICS_CACHE_EMPTY 2
+/** @brief Number of cache lookup outcomes */
+#define RS_METRICS_CACHE_OUTCOMES 3
+
+/**
+ * @brief Counters of one lambda
+ */
+typedef struct {
+    /** @brief Number of calls of the lambda */
+    uint64_t calls;
+    /** @brief Number of call packets sent to the device */
+    uint64_t sent;
+    /** @brief Number of result and error packets received from the device */
+    uint64_t received;
+    /** @brief Number of calls that were not answered in time */
+    uint64_t timeouts;
+    /** @brief Number of recorded round-trip times */
+    uint64_t rtt_count;
+    /** @brief Sum of the recorded round-trip times in microseconds */
+    uint64_t rtt_sum;
+    /** @brief Number of calls per RS_CALL_* constant, indexed by the constant minus RS_CALL_OVERLOAD */
+    uint64_t results[RS_METRICS_CALL_RESULTS];
+} rs_lambda_metrics;
+
+/**
+ * @brief Get the current time for round-trip measurements
+ *
+ * @return Microseconds of a monotonic clock, never 0
+ */
+uint64_t rs_metrics_now(void);
+
+/**
+ * @brief Reset the counters and the histogram of a lambda, called when the ID is assigned to a new lambda
+ *
+ * @param id ID of the lambda
+ */
+void rs_metrics_reset_lambda(lambda_id_t id);
+
+/**
+ * @brief Count a finished call
+ *
+ * @param id ID of the lambda, MAX_LAMBDAS if the lambda was not found
+ * @param code RS_CALL_* constant or error code of the device the call finished with
+ */
+void rs_metrics_count_call(lambda_id_t id, int8_t code);
+
+/**
+ * @brief Count a call packet sent to the device
+ *
+ * @param id ID of the lambda
+ */
+void rs_metrics_count_sent(lambda_id_t id);
+
+/**
+ * @brief Count a result or error packet received from the device
+ *
+ * @param id ID of the lambda
+ */
+void rs_metrics_count_received(lambda_id_t id);
+
+/**
+ * @brief Count a call that was not answered in time
+ *
+ * @param id ID of the lambda
+ */
+void rs_metrics_count_timeout(lambda_id_t id);
+
+/**
+ * @brief Count a cache lookup
+ *
+ * @param policy Cache policy of the lambda
+ * @param outcome RS_METRICS_CACHE_* outcome
+ */
+void rs_metrics_count_cache(rs_cache_type_t policy, uint8_t outcome);
+
+/**
+ * @brief Record the time between sending a call packet and receiving its answer
+ *
+ * @param id ID of the lambda
+ * @param micros Round-trip time in microseconds
+ */
+void rs_metrics_record_rtt(lambda_id_t id, uint64_t micros);
+
+/**
+ * @brief Get the counters of a lambda
+ *
+ * @param id ID of the lambda
+ * @param metrics Where to store the counters
+ */
+void rs_metrics_get_lambda(lambda_id_t id, rs_lambda_metrics *metrics);
+
+/**
+ * @brief Get the round-trip time histogram of a lambda
+ *
+ * @param id ID of the lambda
+ * @param buckets Where to store the RS_METRICS_RTT_BUCKETS bucket counts
+ */
+void rs_metrics_get_rtt_histogram(lambda_id_t id, uint64_t *buckets);
+
+/**
+ * @brief Get the number of cache lookups with an outcome
+ *
+ * @param policy Cache policy
+ * @param outcome RS_METRICS_CACHE_* outcome
+ * @return Number of lookups
+ */
+uint64_t rs_metrics_get_cache(rs_cache_type_t policy, uint8_t outcome);
+
+/**
+ * @brief Get the number of calls of all lambdas that finished with a code
+ *
+ * @param code RS_CALL_* constant or error code of the device
+ * @return Number of calls
+ */
+uint64_t rs_metrics_get_code(int8_t code);
+
+/**
+ * @brief Get the histogram bucket of a round-trip time
+ *
+ * @param micros Round-trip time in microseconds
+ * @return Index of the bucket
+ */
+size_t rs_metrics_rtt_bucket(uint64_t micros);
+
+/**
+ * @brief Get the largest round-trip time counted in a bucket
+ *
+ * @param bucket Index of the bucket
+ * @return Inclusive upper bound in microseconds
+ */
+uint64_t rs_metrics_rtt_bucket_limit(size_t bucket);
+
+/**
+ * @brief Estimate a quantile of a round-trip time histogram
+ *
+ * @param buckets RS_METRICS_RTT_BUCKETS bucket counts
+ * @param quantile Quantile in [0, 1]
+ * @return Upper bound of the bucket containing the quantile in microseconds, 0 if the histogram is empty
+ */
+uint64_t rs_metrics_rtt_quantile(const uint64_t *buckets, double quantile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RIOTSENSORS_RS_METRICS_H
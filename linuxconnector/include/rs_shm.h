@@ -0,0 +1,245 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Shared memory table with the latest result of every lambda
+ * @file    rs_shm.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * The server publishes every stored result into a POSIX shared memory object. The table has one fixed-size slot
+ * per lambda ID, every slot is protected by its own sequence lock: the writer makes the sequence number odd before
+ * it changes a slot and even again afterwards, readers retry until they copied a slot with the same even sequence
+ * number before and after the copy. Reading a value therefore takes no system call and never blocks the server.
+ *
+ * This header only depends on the C standard library and POSIX, local readers can copy it into their project:
+ *
+ *     rs_shm_table *table = rs_shm_attach(RS_SHM_DEFAULT_NAME);
+ *     int id = rs_shm_find(table, "temp");
+ *     rs_shm_slot slot;
+ *     if (id >= 0 && rs_shm_read(table, (uint8_t) id, &slot)) {
+ *         printf("%f\n", slot.value.d);
+ *     }
+ *     rs_shm_detach(table);
+ *
+ * Readers may need to link with -lrt on older C libraries.
+ */
+
+#ifndef RIOTSENSORS_RS_SHM_H
+#define RIOTSENSORS_RS_SHM_H
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Name of the shared memory object used by the server if no other name is given */
+#define RS_SHM_DEFAULT_NAME "/riotsensors"
+/** @brief Magic number at the start of the table ("RSLV") */
+#define RS_SHM_MAGIC 0x524c5356
+/** @brief Version of the table layout, increased on incompatible changes */
+#define RS_SHM_LAYOUT_VERSION 1
+/** @brief Number of slots, one for every possible lambda ID (MAX_LAMBDAS) */
+#define RS_SHM_SLOTS 255
+/** @brief Maximum length of a lambda name (MAX_LAMBDA_NAME_LENGTH) */
+#define RS_SHM_NAME_LENGTH 12
+/** @brief Maximum length of a string result, longer results are truncated */
+#define RS_SHM_STRING_LENGTH 87
+
+/** @brief No lambda with this ID is registered */
+#define RS_SHM_EMPTY 0
+/** @brief The lambda is registered but has no result yet */
+#define RS_SHM_REGISTERED 1
+/** @brief The slot holds the latest result of the lambda */
+#define RS_SHM_VALUE 2
+
+/**
+ * @brief Latest result of one lambda, 128 bytes (two cache lines)
+ */
+typedef struct {
+    /** @brief Sequence lock, odd while the slot is written */
+    uint32_t seq;
+    /** @brief RS_SHM_EMPTY, RS_SHM_REGISTERED or RS_SHM_VALUE */
+    uint8_t state;
+    /** @brief Lambda type (RS_LAMBDA_INT 1, RS_LAMBDA_DOUBLE 2, RS_LAMBDA_STRING 3) */
+    uint8_t type;
+    /** @brief Cache policy of the lambda (RS_CACHE_* constant) */
+    uint8_t cache;
+    /** @brief 1 if a string result was longer than RS_SHM_STRING_LENGTH and was truncated */
+    uint8_t truncated;
+    /** @brief Incremented whenever the value changes */
+    uint32_t version;
+    uint32_t reserved;
+    /** @brief Time the result was stored in milliseconds since the epoch */
+    uint64_t timestamp;
+    /** @brief Name of the lambda */
+    char name[RS_SHM_NAME_LENGTH + 1];
+    uint8_t padding[3];
+    /** @brief Result, the member is selected by type */
+    union {
+        int32_t i;
+        double d;
+        char s[RS_SHM_STRING_LENGTH + 1];
+    } value;
+} rs_shm_slot;
+
+/**
+ * @brief Layout of the shared memory object
+ */
+typedef struct {
+    /** @brief RS_SHM_MAGIC */
+    uint32_t magic;
+    /** @brief RS_SHM_LAYOUT_VERSION */
+    uint32_t layout_version;
+    /** @brief Number of slots */
+    uint32_t slot_count;
+    /** @brief Size of a slot in bytes */
+    uint32_t slot_size;
+    uint8_t reserved[48];
+    /** @brief Slots indexed by lambda ID */
+    rs_shm_slot slots[RS_SHM_SLOTS];
+} rs_shm_table;
+
+/**
+ * @brief Map the table published by the server read-only
+ *
+ * The pointer is not const only so it can be passed to rs_shm_detach(), the mapping faults on writes.
+ *
+ * @param name Name of the shared memory object, RS_SHM_DEFAULT_NAME by default
+ * @return The table or NULL if it does not exist or has an incompatible layout
+ */
+static inline rs_shm_table *rs_shm_attach(const char *name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(rs_shm_table)) {
+        close(fd);
+        return NULL;
+    }
+    void *mem = mmap(NULL, sizeof(rs_shm_table), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+    rs_shm_table *table = (rs_shm_table *) mem;
+    if (table->magic != RS_SHM_MAGIC || table->layout_version != RS_SHM_LAYOUT_VERSION ||
+        table->slot_size != sizeof(rs_shm_slot)) {
+        munmap(mem, sizeof(rs_shm_table));
+        return NULL;
+    }
+    return table;
+}
+
+/**
+ * @brief Unmap a table mapped with rs_shm_attach()
+ *
+ * @param table Table
+ */
+static inline void rs_shm_detach(rs_shm_table *table) {
+    munmap(table, sizeof(rs_shm_table));
+}
+
+/**
+ * @brief Copy a consistent snapshot of a slot
+ *
+ * @param table Table
+ * @param id Lambda ID
+ * @param slot Where to copy the slot to
+ * @return If the slot holds a result
+ */
+static inline bool rs_shm_read(const rs_shm_table *table, uint8_t id, rs_shm_slot *slot) {
+    if (id >= RS_SHM_SLOTS) {
+        return false;
+    }
+    const rs_shm_slot *src = &table->slots[id];
+    for (;;) {
+        uint32_t begin = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+        if (begin & 1) {
+            continue;
+        }
+        memcpy(slot, src, sizeof(rs_shm_slot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&src->seq, __ATOMIC_RELAXED) == begin) {
+            break;
+        }
+    }
+    return slot->state == RS_SHM_VALUE;
+}
+
+/**
+ * @brief Find the slot of a lambda by name
+ *
+ * IDs stay valid until the lambda is unregistered, so the lookup only has to be done once.
+ *
+ * @param table Table
+ * @param name Name of the lambda
+ * @return Lambda ID or -1 if not registered
+ */
+static inline int rs_shm_find(const rs_shm_table *table, const char *name) {
+    rs_shm_slot slot;
+    for (int id = 0; id < RS_SHM_SLOTS; id++) {
+        rs_shm_read(table, (uint8_t) id, &slot);
+        if (slot.state != RS_SHM_EMPTY && strncmp(slot.name, name, RS_SHM_NAME_LENGTH + 1) == 0) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Writer side, used by the server only
+ */
+
+/**
+ * @brief Create the shared memory object and map it for writing, all slots are empty
+ *
+ * @param name Name of the shared memory object
+ * @return 0 on success, -1 otherwise (errno is set)
+ */
+int rs_shm_create(const char *name);
+
+/**
+ * @brief Unmap and remove the shared memory object
+ */
+void rs_shm_destroy(void);
+
+/**
+ * @brief Check if the table was created
+ *
+ * @return If rs_shm_create() was successful and rs_shm_destroy() not called yet
+ */
+bool rs_shm_enabled(void);
+
+/**
+ * @brief Overwrite a slot, does nothing if the table was not created
+ *
+ * Calls have to be serialized, there is only one writer per slot.
+ *
+ * @param id Lambda ID
+ * @param contents New contents, the sequence number is ignored
+ */
+void rs_shm_write(uint8_t id, const rs_shm_slot *contents);
+
+/**
+ * @brief Mark a slot as empty, does nothing if the table was not created
+ *
+ * @param id Lambda ID
+ */
+void rs_shm_clear(uint8_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RIOTSENSORS_RS_SHM_H
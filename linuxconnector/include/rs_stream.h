@@ -0,0 +1,170 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Bounded per-client queues of stored results for push streams
+ * @file    rs_stream.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * Every stream client owns one queue. The connector pushes every stored result into the queues of all clients
+ * subscribed to the lambda. A queue holds at most one pending update per lambda: a new result of a lambda that is
+ * still queued replaces the queued value in place (latest value wins), so a slow client skips intermediate values
+ * instead of falling behind. If the queue is full of updates of other lambdas, the oldest update is dropped.
+ */
+
+#ifndef RIOTSENSORS_RS_STREAM_H
+#define RIOTSENSORS_RS_STREAM_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <lambda_registry.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Number of updates a stream queue holds */
+#define RS_STREAM_QUEUE_CAPACITY 64
+
+/**
+ * @brief A stored result of a lambda
+ */
+typedef struct {
+    /** @brief ID of the lambda */
+    lambda_id_t id;
+    /** @brief Name of the lambda */
+    char name[MAX_LAMBDA_NAME_LENGTH + 1];
+    /** @brief Type of the lambda */
+    rs_lambda_type_t type;
+    /** @brief Version of the result (see rs_linux_registered_lambda) */
+    uint32_t version;
+    /** @brief Time the result was stored in milliseconds since the epoch */
+    uint64_t timestamp;
+    /** @brief Result, a string result is owned by the update */
+    generic_lambda_return value;
+} rs_stream_update;
+
+/**
+ * @brief Queue of the updates not yet sent to one client
+ */
+typedef struct {
+    /** @brief Bit set of the subscribed lambda IDs */
+    uint8_t ids[(MAX_LAMBDAS + 7) / 8];
+    /** @brief Type of the subscribed lambdas, 0 for all types */
+    rs_lambda_type_t type;
+    /** @brief Ring buffer of queued updates */
+    rs_stream_update updates[RS_STREAM_QUEUE_CAPACITY];
+    /** @brief Index of the oldest queued update */
+    size_t head;
+    /** @brief Number of queued updates */
+    size_t count;
+    /** @brief Index of the queued update of every lambda, -1 if none is queued */
+    int16_t pending[MAX_LAMBDAS];
+    /** @brief Number of queued values replaced by a newer value of the same lambda */
+    uint64_t coalesced;
+    /** @brief Number of updates dropped because the queue was full */
+    uint64_t dropped;
+    /** @brief Set by rs_stream_close(), readers return immediately afterwards */
+    bool closed;
+    /** @brief eventfd signalled when an update is queued into the empty queue or the stream is closed, -1 if none */
+    int notify_fd;
+    pthread_mutex_t lock;
+    pthread_cond_t added;
+} rs_stream;
+
+/**
+ * @brief Initialize an empty stream queue
+ *
+ * @param s Stream
+ * @param ids Bit set of the subscribed lambda IDs, NULL to subscribe to all lambdas
+ * @param type Type of the subscribed lambdas, 0 for all types
+ */
+void rs_stream_init(rs_stream *s, const uint8_t *ids, rs_lambda_type_t type);
+
+/**
+ * @brief Free the queued updates and the resources of a stream queue
+ *
+ * @param s Stream
+ */
+void rs_stream_free(rs_stream *s);
+
+/**
+ * @brief Check if a stream is subscribed to a lambda
+ *
+ * @param s Stream
+ * @param id ID of the lambda
+ * @param type Type of the lambda
+ * @return If results of the lambda are pushed to the stream
+ */
+bool rs_stream_matches(const rs_stream *s, lambda_id_t id, rs_lambda_type_t type);
+
+/**
+ * @brief Queue an update and wake up the reader, replaces a queued update of the same lambda
+ *
+ * @param s Stream
+ * @param update Update, a string result is copied
+ */
+void rs_stream_push(rs_stream *s, const rs_stream_update *update);
+
+/**
+ * @brief Take the queued updates in the order they were queued, waiting for an update if there is none
+ *
+ * @param s Stream
+ * @param updates Where to store the updates, string results have to be freed with rs_stream_update_free()
+ * @param max Maximum number of updates to take
+ * @param wait_ms Milliseconds to wait for an update if there are none, 0 to return immediately
+ * @return Number of updates taken, 0 on timeout or if the stream was closed
+ */
+size_t rs_stream_read(rs_stream *s, rs_stream_update *updates, size_t max, uint32_t wait_ms);
+
+/**
+ * @brief Get a file descriptor to wait for updates with poll() or epoll instead of rs_stream_read()
+ *
+ * The descriptor becomes readable when an update is queued into the empty queue or the stream is closed. The reader
+ * has to reset it with rs_stream_clear_fd() before taking all queued updates.
+ *
+ * @param s Stream
+ * @return Non-blocking eventfd, -1 if it could not be created
+ */
+int rs_stream_fd(const rs_stream *s);
+
+/**
+ * @brief Reset the file descriptor of a stream after it became readable
+ *
+ * @param s Stream
+ */
+void rs_stream_clear_fd(rs_stream *s);
+
+/**
+ * @brief Wake up the reader and make all following reads return immediately
+ *
+ * @param s Stream
+ */
+void rs_stream_close(rs_stream *s);
+
+/**
+ * @brief Check if a stream was closed
+ *
+ * @param s Stream
+ * @return If rs_stream_close() was called
+ */
+bool rs_stream_closed(rs_stream *s);
+
+/**
+ * @brief Free the string result of an update taken with rs_stream_read()
+ *
+ * @param update Update
+ */
+void rs_stream_update_free(rs_stream_update *update);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RIOTSENSORS_RS_STREAM_H
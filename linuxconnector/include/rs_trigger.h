@@ -0,0 +1,225 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Triggers evaluated on every stored result and the queue of fired events
+ * @file    rs_trigger.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#ifndef RIOTSENSORS_RS_TRIGGER_H
+#define RIOTSENSORS_RS_TRIGGER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <rs_constants.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Maximum length of a trigger name */
+#define RS_TRIGGER_NAME_LENGTH 16
+/** @brief Number of events kept in the event queue, the oldest events are dropped first */
+#define RS_EVENT_QUEUE_CAPACITY 1024
+
+/** @brief Fires when the value rises above a level */
+#define RS_TRIGGER_ABOVE 1
+/** @brief Fires when the value falls below a level */
+#define RS_TRIGGER_BELOW 2
+/** @brief Fires when the value changes faster than a given amount per second */
+#define RS_TRIGGER_RATE 3
+/** @brief Fires when the value reaches the upper level and again when it falls back to the lower level */
+#define RS_TRIGGER_HYSTERESIS 4
+
+/**
+ * @brief Kind of a trigger (RS_TRIGGER_* kind constants)
+ */
+typedef uint8_t rs_trigger_kind_t;
+
+/** @brief The trigger was parsed successfully */
+#define RS_TRIGGER_SUCCESS 0
+/** @brief The trigger definition is not well formed */
+#define RS_TRIGGER_SYNTAX -1
+/** @brief The trigger name is empty or too long */
+#define RS_TRIGGER_INVALNAME -2
+/** @brief A trigger with this name already exists */
+#define RS_TRIGGER_DUPLICATE -3
+/** @brief Could not allocate the required memory */
+#define RS_TRIGGER_NOMEM -4
+/** @brief The maximum number of triggers is reached */
+#define RS_TRIGGER_LIMIT_REACHED -5
+
+/**
+ * @brief A trigger on the results of one lambda
+ */
+typedef struct rs_trigger {
+    /** @brief Name of the trigger */
+    char name[RS_TRIGGER_NAME_LENGTH + 1];
+    /** @brief Name of the observed lambda */
+    char lambda[MAX_LAMBDA_NAME_LENGTH + 1];
+    /** @brief RS_TRIGGER_* kind */
+    rs_trigger_kind_t kind;
+    /** @brief Level for RS_TRIGGER_BELOW, lower level for RS_TRIGGER_HYSTERESIS */
+    double low;
+    /** @brief Level for RS_TRIGGER_ABOVE, rate per second for RS_TRIGGER_RATE, upper level for RS_TRIGGER_HYSTERESIS */
+    double high;
+    /** @brief If the condition of the trigger currently holds, it fires again only after it was reset */
+    bool active;
+    /** @brief If last_value and last_timestamp are set */
+    bool has_last;
+    /** @brief Previous value, used for rates */
+    double last_value;
+    /** @brief Timestamp of the previous value in milliseconds since the epoch */
+    uint64_t last_timestamp;
+    /** @brief Next trigger on the same lambda */
+    struct rs_trigger *next;
+} rs_trigger;
+
+/**
+ * @brief An event emitted by a trigger
+ */
+typedef struct {
+    /** @brief Sequence number, increases by one for every event */
+    uint64_t seq;
+    /** @brief Timestamp of the result in milliseconds since the epoch */
+    uint64_t timestamp;
+    /** @brief Result that fired the trigger (the rate per second for RS_TRIGGER_RATE) */
+    double value;
+    /** @brief Name of the trigger */
+    char trigger[RS_TRIGGER_NAME_LENGTH + 1];
+    /** @brief Name of the lambda */
+    char lambda[MAX_LAMBDA_NAME_LENGTH + 1];
+    /** @brief RS_TRIGGER_* kind */
+    rs_trigger_kind_t kind;
+    /** @brief False if a RS_TRIGGER_HYSTERESIS trigger was reset, true otherwise */
+    bool active;
+} rs_trigger_event;
+
+/**
+ * @brief Bounded queue of events, new events overwrite the oldest ones
+ */
+typedef struct {
+    rs_trigger_event events[RS_EVENT_QUEUE_CAPACITY];
+    /** @brief Sequence number of the next event */
+    uint64_t next_seq;
+    /** @brief Number of events overwritten because the queue was full */
+    uint64_t dropped;
+    /** @brief eventfd signalled when an event is pushed, -1 until rs_event_queue_fd() created it */
+    int notify_fd;
+    pthread_mutex_t lock;
+    pthread_cond_t added;
+} rs_event_queue;
+
+/**
+ * @brief Parse a trigger definition
+ *
+ * The definition has the form NAME=LAMBDA:KIND:ARGS with the kinds above:LEVEL, below:LEVEL, rate:PER_SECOND and
+ * hysteresis:LOW:HIGH.
+ *
+ * @param t Where to store the trigger
+ * @param definition Trigger definition
+ * @return A RS_TRIGGER_* result constant
+ */
+int8_t rs_trigger_parse(rs_trigger *t, const char *definition);
+
+/**
+ * @brief Evaluate a trigger for a new result in constant time
+ *
+ * @param t Trigger
+ * @param timestamp Timestamp of the result in milliseconds since the epoch
+ * @param value Result
+ * @param event Where to store the event (without sequence number) if the trigger fired
+ * @return If the trigger fired
+ */
+bool rs_trigger_evaluate(rs_trigger *t, uint64_t timestamp, double value, rs_trigger_event *event);
+
+/**
+ * @brief Initialize an empty event queue
+ *
+ * @param q Event queue
+ */
+void rs_event_queue_init(rs_event_queue *q);
+
+/**
+ * @brief Free the resources of an event queue
+ *
+ * @param q Event queue
+ */
+void rs_event_queue_free(rs_event_queue *q);
+
+/**
+ * @brief Add an event and wake up all waiting readers
+ *
+ * @param q Event queue
+ * @param event Event, the sequence number is assigned by the queue
+ */
+void rs_event_queue_push(rs_event_queue *q, rs_trigger_event *event);
+
+/**
+ * @brief Read the events following a sequence number, waiting for new events if there are none
+ *
+ * @param q Event queue
+ * @param after Sequence number of the last event the reader has seen, 0 to read all available events
+ * @param events Where to store the events
+ * @param max Maximum number of events to read
+ * @param wait_ms Milliseconds to wait for a new event if there are none, 0 to return immediately
+ * @return Number of events read
+ */
+size_t rs_event_queue_read(rs_event_queue *q, uint64_t after, rs_trigger_event *events, size_t max,
+                           uint32_t wait_ms);
+
+/**
+ * @brief Get a file descriptor to wait for events with poll() or epoll instead of rs_event_queue_read()
+ *
+ * The descriptor is created on the first call and shared by all callers, so it suits one event loop serving all
+ * waiting readers. It becomes readable when an event is pushed, the loop has to reset it with
+ * rs_event_queue_clear_fd() before reading the new events of its readers.
+ *
+ * @param q Event queue
+ * @return Non-blocking eventfd, -1 if it could not be created
+ */
+int rs_event_queue_fd(rs_event_queue *q);
+
+/**
+ * @brief Reset the file descriptor returned by rs_event_queue_fd()
+ *
+ * @param q Event queue
+ */
+void rs_event_queue_clear_fd(rs_event_queue *q);
+
+/**
+ * @brief Get the number of events that were dropped because the queue was full
+ *
+ * @param q Event queue
+ * @return Number of dropped events
+ */
+uint64_t rs_event_queue_dropped(rs_event_queue *q);
+
+/**
+ * @brief Get a human readable string for a trigger kind
+ *
+ * @param c RS_TRIGGER_* kind constant
+ * @return A string or NULL
+ */
+const char *stringify_rs_trigger_kind_t(rs_trigger_kind_t c);
+
+/**
+ * @brief Get a human readable string for a trigger result
+ *
+ * @param c RS_TRIGGER_* result constant
+ * @return A string or NULL
+ */
+const char *stringify_rs_trigger_result(int8_t c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RIOTSENSORS_RS_TRIGGER_H
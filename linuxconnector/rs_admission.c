@@ -0,0 +1,154 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_admission.h>
+
+#include <pthread.h>
+#include <time.h>
+
+static pthread_mutex_t admission_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static rs_admission_limits limits = {RS_ADMISSION_DEFAULT_LAMBDA_CALLS, RS_ADMISSION_DEFAULT_DEVICE_CALLS, 0, 0};
+
+static uint32_t in_flight[MAX_LAMBDAS];
+
+static uint32_t in_flight_total = 0;
+
+/**
+ * Bytes in the token bucket
+ */
+static double tokens = 0;
+
+/**
+ * Time of the last refill in seconds of the monotonic clock
+ */
+static double refilled = 0;
+
+/**
+ * Bytes missing in the token bucket at the last rejection by RS_ADMISSION_RATE_LIMIT, 0 after other rejections
+ */
+static double missing = 0;
+
+static uint64_t outcomes[RS_ADMISSION_OUTCOMES];
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+void rs_admission_set_limits(const rs_admission_limits *new_limits) {
+    pthread_mutex_lock(&admission_lock);
+    limits = *new_limits;
+    tokens = limits.burst_bytes;
+    refilled = now_seconds();
+    missing = 0;
+    pthread_mutex_unlock(&admission_lock);
+}
+
+void rs_admission_get_limits(rs_admission_limits *current) {
+    pthread_mutex_lock(&admission_lock);
+    *current = limits;
+    pthread_mutex_unlock(&admission_lock);
+}
+
+size_t rs_admission_call_bytes(rs_lambda_type_t type, bool by_name) {
+    size_t bytes = by_name ? sizeof(rs_packet_call_by_name_t) : sizeof(rs_packet_call_by_id_t);
+    switch (type) {
+        case RS_LAMBDA_INT:
+            return bytes + sizeof(rs_packet_lambda_result_int_t);
+        case RS_LAMBDA_DOUBLE:
+            return bytes + sizeof(rs_packet_lambda_result_double_t);
+        default:
+            return bytes + sizeof(rs_packet_lambda_result_string_t) + RS_ADMISSION_STRING_BYTES;
+    }
+}
+
+/**
+ * @brief Check the limits of a call, the lock has to be held
+ *
+ * @param id ID of the lambda
+ * @param bytes Bytes of the call and its answer
+ * @return RS_ADMISSION_* outcome
+ */
+static uint8_t admit(lambda_id_t id, size_t bytes) {
+    if (limits.lambda_calls != 0 && in_flight[id] >= limits.lambda_calls) {
+        return RS_ADMISSION_LAMBDA_LIMIT;
+    }
+    if (limits.device_calls != 0 && in_flight_total >= limits.device_calls) {
+        return RS_ADMISSION_DEVICE_LIMIT;
+    }
+    if (limits.bytes_per_second != 0) {
+        double now = now_seconds();
+        tokens += (now - refilled) * limits.bytes_per_second;
+        refilled = now;
+        // a burst smaller than a single call would reject every call
+        double capacity = limits.burst_bytes > bytes ? limits.burst_bytes : (double) bytes;
+        if (tokens > capacity) {
+            tokens = capacity;
+        }
+        if (tokens < (double) bytes) {
+            missing = (double) bytes - tokens;
+            return RS_ADMISSION_RATE_LIMIT;
+        }
+        tokens -= (double) bytes;
+    }
+    return RS_ADMISSION_ADMITTED;
+}
+
+uint8_t rs_admission_acquire(lambda_id_t id, size_t bytes) {
+    pthread_mutex_lock(&admission_lock);
+    uint8_t outcome = admit(id, bytes);
+    if (outcome == RS_ADMISSION_ADMITTED) {
+        in_flight[id]++;
+        in_flight_total++;
+    } else if (outcome != RS_ADMISSION_RATE_LIMIT) {
+        missing = 0;
+    }
+    outcomes[outcome]++;
+    pthread_mutex_unlock(&admission_lock);
+    return outcome;
+}
+
+void rs_admission_release(lambda_id_t id) {
+    pthread_mutex_lock(&admission_lock);
+    if (in_flight[id] > 0) {
+        in_flight[id]--;
+        in_flight_total--;
+    }
+    pthread_mutex_unlock(&admission_lock);
+}
+
+uint32_t rs_admission_retry_after(void) {
+    pthread_mutex_lock(&admission_lock);
+    // unanswered calls time out after a second, the bucket needs the missing bytes
+    uint32_t seconds = 1;
+    if (missing > 0 && limits.bytes_per_second != 0) {
+        double refill = missing / limits.bytes_per_second;
+        if (refill > 1) {
+            seconds = (uint32_t) refill + (refill > (uint32_t) refill ? 1 : 0);
+        }
+    }
+    pthread_mutex_unlock(&admission_lock);
+    return seconds;
+}
+
+uint32_t rs_admission_in_flight(lambda_id_t id) {
+    pthread_mutex_lock(&admission_lock);
+    uint32_t count = id < MAX_LAMBDAS ? in_flight[id] : in_flight_total;
+    pthread_mutex_unlock(&admission_lock);
+    return count;
+}
+
+uint64_t rs_admission_count(uint8_t outcome) {
+    if (outcome >= RS_ADMISSION_OUTCOMES) {
+        return 0;
+    }
+    pthread_mutex_lock(&admission_lock);
+    uint64_t count = outcomes[outcome];
+    pthread_mutex_unlock(&admission_lock);
+    return count;
+}
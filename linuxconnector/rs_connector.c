@@ -20,10 +20,482 @@ struct spt_context linux_sptctx;
 
 pthread_mutex_t accessing_registry = PTHREAD_MUTEX_INITIALIZER;
 
+/**
+ * Incremented whenever a lambda is registered or unregistered
+ */
+static uint32_t registry_version = 0;
+
+/**
+ * Number of lambdas the device announced, valid for the registry generation in device_lambdas_generation (see
+ * next_device_id())
+ */
+static lambda_id_t device_lambda_count = 0;
+static uint32_t device_lambdas_generation = 0;
+
+/**
+ * Incremented whenever the cached result of any lambda changes
+ */
+static uint32_t values_version = 0;
+
+/**
+ * All defined triggers
+ */
+static rs_trigger *triggers[RS_MAX_TRIGGERS];
+
+/**
+ * Number of defined triggers
+ */
+static size_t trigger_count = 0;
+
+/**
+ * Events of fired triggers
+ */
+static rs_event_queue event_queue = {.next_seq = 1, .dropped = 0, .notify_fd = -1,
+        .lock = PTHREAD_MUTEX_INITIALIZER, .added = PTHREAD_COND_INITIALIZER};
+
+/**
+ * Open push streams, guarded by accessing_registry
+ */
+static rs_stream *streams[RS_MAX_STREAMS];
+
+/**
+ * Number of open push streams
+ */
+static size_t stream_count = 0;
+
+/**
+ * @brief A call whose caller does not wait for the answer
+ */
+typedef struct rs_pending_call {
+    struct rs_pending_call *next;
+    /** @brief ID of the called lambda, MAX_LAMBDAS if it was not found */
+    lambda_id_t id;
+    /** @brief If the lambda was not found or unregistered while waiting */
+    bool unknown;
+    /** @brief If the call was admitted and sent to the device */
+    bool admitted;
+    /** @brief Absolute time (CLOCK_REALTIME) after which the call timed out */
+    struct timespec deadline;
+    rs_call_callback callback;
+    void *ctx;
+    /** @brief RS_CALL_* result, set on completion */
+    int8_t res;
+    generic_lambda_return result;
+    uint32_t version;
+} rs_pending_call;
+
+/**
+ * Calls sent by call_lambda_by_id_async() and call_lambda_by_name_async() waiting for their answer, guarded by the
+ * registry lock
+ */
+static rs_pending_call *pending_calls = NULL;
+
+/**
+ * Signalled when a call is added to pending_calls or the expiry thread has to stop
+ */
+static pthread_cond_t pending_changed = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Thread completing the pending calls that ran into their deadline, started by the first asynchronous call
+ */
+static pthread_t expiry_thread;
+static bool expiry_running = false;
+static bool expiry_stopping = false;
+
+/**
+ * @brief Mark the cached result of a lambda as changed
+ *
+ * @param arg Connector data of the lambda
+ */
+static void touch_lambda_result(rs_linux_registered_lambda *arg) {
+    arg->version++;
+    __atomic_add_fetch(&values_version, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Publish the registration and the cached result of a lambda to the shared memory table
+ *
+ * @param lambda Registered lambda
+ * @param timestamp Time the result was stored, 0 if there is none
+ */
+static void publish_lambda(rs_registered_lambda *lambda, uint64_t timestamp) {
+    if (!rs_shm_enabled()) {
+        return;
+    }
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    rs_shm_slot slot;
+    memset(&slot, 0, sizeof(slot));
+    slot.state = arg->data_cached ? RS_SHM_VALUE : RS_SHM_REGISTERED;
+    slot.type = lambda->type;
+    slot.cache = lambda->cache;
+    slot.version = arg->version;
+    slot.timestamp = timestamp;
+    strncpy(slot.name, lambda->name, RS_SHM_NAME_LENGTH);
+    if (arg->data_cached) {
+        switch (lambda->type) {
+            case RS_LAMBDA_INT:
+                slot.value.i = arg->ret.ret_i;
+                break;
+            case RS_LAMBDA_DOUBLE:
+                slot.value.d = arg->ret.ret_d;
+                break;
+            case RS_LAMBDA_STRING:
+                slot.truncated = strlen(arg->ret.ret_s) > RS_SHM_STRING_LENGTH;
+                strncpy(slot.value.s, arg->ret.ret_s, RS_SHM_STRING_LENGTH);
+                break;
+            default:
+                break;
+        }
+    }
+    rs_shm_write(lambda->id, &slot);
+}
+
+/**
+ * @brief Push a stored result of a lambda to all streams subscribed to it
+ *
+ * @param lambda Registered lambda with a cached result
+ * @param timestamp Time the result was stored
+ */
+static void stream_lambda(rs_registered_lambda *lambda, uint64_t timestamp) {
+    if (stream_count == 0) {
+        return;
+    }
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    rs_stream_update update;
+    memset(&update, 0, sizeof(update));
+    update.id = lambda->id;
+    strncpy(update.name, lambda->name, MAX_LAMBDA_NAME_LENGTH);
+    update.type = lambda->type;
+    update.version = arg->version;
+    update.timestamp = timestamp;
+    update.value = arg->ret;
+    for (size_t i = 0; i < stream_count; i++) {
+        if (rs_stream_matches(streams[i], lambda->id, lambda->type)) {
+            rs_stream_push(streams[i], &update);
+        }
+    }
+}
+
+/**
+ * @brief Reclaimer of RS_MEMORY_HISTORY, evicts history buffers by the configured policy
+ *
+ * Only called while accessing_registry is held, from the append that needs the memory.
+ *
+ * @param bytes Number of bytes that should be freed
+ * @return Number of freed bytes
+ */
+static size_t reclaim_histories(size_t bytes) {
+    size_t freed = 0;
+    bool lru = rs_memory_get_policy() == RS_EVICT_LRU;
+    while (freed < bytes) {
+        rs_history *victim = NULL;
+        for (lambda_id_t i = 0; i < get_number_of_registered_lambdas(); i++) {
+            rs_registered_lambda *lambda = get_registered_lambda_by_id(i);
+            if (lambda == NULL) {
+                continue;
+            }
+            rs_history *h = &((rs_linux_registered_lambda *) lambda->arg.obj)->history;
+            if (rs_history_bytes(h) == 0) {
+                continue;
+            }
+            if (victim == NULL || (lru ? h->last_used < victim->last_used : h->allocated_at < victim->allocated_at)) {
+                victim = h;
+            }
+        }
+        if (victim == NULL) {
+            break;
+        }
+        size_t evicted = rs_history_evict(victim);
+        rs_memory_count_eviction(RS_MEMORY_HISTORY, evicted);
+        freed += evicted;
+    }
+    return freed;
+}
+
+/**
+ * @brief Allocate and initialize the connector data of a lambda
+ *
+ * @return Connector data or NULL if out of memory
+ */
+static rs_linux_registered_lambda *new_linux_lambda(void) {
+    rs_linux_registered_lambda *arg = malloc(sizeof(rs_linux_registered_lambda));
+    if (arg == NULL) {
+        return NULL;
+    }
+    arg->received = 0;
+    arg->data_cached = false;
+    arg->last_call_error = 0;
+    arg->version = 0;
+    arg->device_id = 0;
+    arg->derived = NULL;
+    memset(arg->dependents, 0, sizeof(arg->dependents));
+    arg->triggers = NULL;
+    arg->call_sent = 0;
+    pthread_cond_init(&arg->wait_result, NULL);
+    rs_history_init(&arg->history);
+    return arg;
+}
+
+/**
+ * @brief Get a lambda by the ID the device uses for it
+ *
+ * Registry and device assign IDs in registration order, but derived lambdas shift the registry IDs upwards and
+ * announcements the server rejected shift them downwards.
+ *
+ * @param device_id ID of the lambda on the device
+ * @return Registered lambda or NULL if not found
+ */
+static rs_registered_lambda *get_device_lambda(lambda_id_t device_id) {
+    for (lambda_id_t i = 0; i < get_number_of_registered_lambdas(); i++) {
+        rs_registered_lambda *lambda = get_registered_lambda_by_id(i);
+        if (lambda != NULL) {
+            rs_linux_registered_lambda *arg = lambda->arg.obj;
+            if (arg->derived == NULL && arg->device_id == device_id) {
+                return lambda;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Link a newly registered lambda to the derived lambdas that use it as an input
+ *
+ * @param lambda Newly registered lambda
+ */
+static void resolve_derived_inputs(rs_registered_lambda *lambda) {
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    for (lambda_id_t i = 0; i < get_number_of_registered_lambdas(); i++) {
+        rs_registered_lambda *other = get_registered_lambda_by_id(i);
+        if (other == NULL) {
+            continue;
+        }
+        rs_linux_derived_lambda *derived = ((rs_linux_registered_lambda *) other->arg.obj)->derived;
+        if (derived == NULL) {
+            continue;
+        }
+        for (uint8_t j = 0; j < derived->expr.input_count; j++) {
+            if (strcmp(derived->expr.inputs[j], lambda->name) == 0) {
+                derived->input_ids[j] = lambda->id;
+                arg->dependents[other->id / 8] |= (uint8_t) (1 << (other->id % 8));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Unlink a lambda that is about to be unregistered from the derived lambdas that use it as an input
+ *
+ * @param lambda Lambda to unregister
+ */
+static void unresolve_derived_inputs(rs_registered_lambda *lambda) {
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    for (lambda_id_t i = 0; i < get_number_of_registered_lambdas(); i++) {
+        if (!(arg->dependents[i / 8] & (1 << (i % 8)))) {
+            continue;
+        }
+        rs_registered_lambda *other = get_registered_lambda_by_id(i);
+        if (other == NULL) {
+            continue;
+        }
+        rs_linux_derived_lambda *derived = ((rs_linux_registered_lambda *) other->arg.obj)->derived;
+        for (uint8_t j = 0; derived != NULL && j < derived->expr.input_count; j++) {
+            if (derived->input_ids[j] == lambda->id) {
+                derived->input_ids[j] = -1;
+            }
+        }
+    }
+    memset(arg->dependents, 0, sizeof(arg->dependents));
+}
+
+/**
+ * @brief Attach the defined triggers to a newly registered lambda
+ *
+ * @param lambda Newly registered lambda
+ */
+static void link_triggers(rs_registered_lambda *lambda) {
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    arg->triggers = NULL;
+    for (size_t i = 0; i < trigger_count; i++) {
+        if (strcmp(triggers[i]->lambda, lambda->name) == 0) {
+            triggers[i]->next = arg->triggers;
+            arg->triggers = triggers[i];
+        }
+    }
+}
+
+/**
+ * @brief Evaluate the triggers of a lambda for a new numeric result
+ *
+ * @param lambda Lambda that stored the result
+ * @param timestamp Timestamp of the result
+ * @param value Result
+ */
+static void evaluate_triggers(rs_registered_lambda *lambda, uint64_t timestamp, double value) {
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    for (rs_trigger *t = arg->triggers; t != NULL; t = t->next) {
+        rs_trigger_event event;
+        if (rs_trigger_evaluate(t, timestamp, value, &event)) {
+            rs_event_queue_push(&event_queue, &event);
+            spt_log_msg("trigger", "Trigger %s fired for lambda %s with value %f\n", t->name, lambda->name,
+                        event.value);
+        }
+    }
+}
+
+static void update_derived_lambdas(rs_registered_lambda *lambda, int depth);
+
+static rs_pending_call *answer_pending_calls(rs_registered_lambda *lambda, rs_pending_call *completed);
+
+static void run_completed_calls(rs_pending_call *completed);
+
+static void stop_pending_calls(void);
+
+/**
+ * @brief Evaluate a derived lambda if all of its inputs have a cached numeric result
+ *
+ * @param lambda Derived lambda
+ * @param depth Number of derived lambdas evaluated before in this chain of updates
+ */
+static void evaluate_derived_lambda(rs_registered_lambda *lambda, int depth) {
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    rs_linux_derived_lambda *derived = arg->derived;
+    if (derived == NULL) {
+        return;
+    }
+    double inputs[RS_EXPR_MAX_INPUTS];
+    for (uint8_t i = 0; i < derived->expr.input_count; i++) {
+        if (derived->input_ids[i] < 0) {
+            return;
+        }
+        rs_registered_lambda *input = get_registered_lambda_by_id((lambda_id_t) derived->input_ids[i]);
+        if (input == NULL) {
+            return;
+        }
+        rs_linux_registered_lambda *input_arg = input->arg.obj;
+        if (!input_arg->data_cached) {
+            return;
+        }
+        if (input->type == RS_LAMBDA_INT) {
+            inputs[i] = (double) input_arg->ret.ret_i;
+        } else if (input->type == RS_LAMBDA_DOUBLE) {
+            inputs[i] = input_arg->ret.ret_d;
+        } else {
+            return;
+        }
+    }
+    double value;
+    if (rs_expr_eval(&derived->expr, inputs, &value) != RS_EXPR_SUCCESS) {
+        spt_log_msg("derived", "Expression of derived lambda %s did not evaluate to a finite number\n", lambda->name);
+        return;
+    }
+    bool changed = !arg->data_cached || memcmp(&arg->ret.ret_d, &value, sizeof(rs_double_t)) != 0;
+    uint64_t now = rs_history_now();
+    arg->ret.ret_d = value;
+    rs_history_append(&arg->history, now, value);
+    evaluate_triggers(lambda, now, value);
+    arg->last_call_error = RS_CALL_SUCCESS;
+    arg->data_cached = true;
+    if (changed) {
+        touch_lambda_result(arg);
+    }
+    publish_lambda(lambda, now);
+    stream_lambda(lambda, now);
+    if (changed) {
+        arg->received++;
+        pthread_cond_broadcast(&arg->wait_result);
+        update_derived_lambdas(lambda, depth + 1);
+    }
+}
+
+/**
+ * @brief Re-evaluate all derived lambdas that use a lambda whose cached result just changed
+ *
+ * @param lambda Lambda with a changed result
+ * @param depth Number of derived lambdas evaluated before in this chain of updates
+ */
+static void update_derived_lambdas(rs_registered_lambda *lambda, int depth) {
+    if (depth >= RS_DERIVED_MAX_DEPTH) {
+        fprintf(stderr, "Stopped updating derived lambdas after %s: chain too long or cyclic\n", lambda->name);
+        return;
+    }
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    for (size_t byte = 0; byte < sizeof(arg->dependents); byte++) {
+        if (arg->dependents[byte] == 0) {
+            continue;
+        }
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            if (arg->dependents[byte] & (1 << bit)) {
+                rs_registered_lambda *dependent = get_registered_lambda_by_id((lambda_id_t) (byte * 8 + bit));
+                if (dependent != NULL) {
+                    evaluate_derived_lambda(dependent, depth);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Assign the ID the device uses for a lambda it announced, the registry lock has to be held
+ *
+ * The device numbers every lambda it registers, including the ones the server rejects, so the count is kept apart
+ * from the registry and only restarts when the registry is reset.
+ *
+ * @return ID of the announced lambda on the device
+ */
+static lambda_id_t next_device_id(void) {
+    if (device_lambdas_generation != get_lambda_registry_generation()) {
+        device_lambdas_generation = get_lambda_registry_generation();
+        device_lambda_count = 0;
+    }
+    return device_lambda_count++;
+}
+
+uint32_t rs_linux_get_registry_version(void) {
+    return __atomic_load_n(&registry_version, __ATOMIC_ACQUIRE);
+}
+
+uint32_t rs_linux_get_values_version(void) {
+    return __atomic_load_n(&values_version, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Count a call packet sent to the device and start measuring its round-trip time, the registry lock has to be
+ * held
+ *
+ * @param lambda Called lambda
+ */
+static void count_lambda_call_sent(rs_registered_lambda *lambda) {
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    rs_metrics_count_sent(lambda->id);
+    // the device answers in order, so a pending call is answered first
+    if (arg->call_sent == 0) {
+        arg->call_sent = rs_metrics_now();
+    }
+}
+
+/**
+ * @brief Count a result or error packet received from the device and record the round-trip time of the pending call,
+ * the registry lock has to be held
+ *
+ * @param lambda Lambda the answer belongs to
+ */
+static void count_lambda_answer(rs_registered_lambda *lambda) {
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    rs_metrics_count_received(lambda->id);
+    if (arg->call_sent != 0) {
+        rs_metrics_record_rtt(lambda->id, rs_metrics_now() - arg->call_sent);
+        arg->call_sent = 0;
+    }
+}
+
 void handle_received_packet(struct spt_context *sptctx, struct serial_data_packet *packet) {
     if (sptctx->log_in_line) {
         putchar('\n');
     }
+    pthread_mutex_lock(&accessing_registry);
+    // asynchronous calls answered by this packet, completed after the lock is released
+    rs_pending_call *completed = NULL;
     rs_packet_type_t ptype;
     if (packet->len < sizeof(ptype)) {
         fprintf(stderr, "Packet with size %d is too small for packet type detection (min size %d)\n", packet->len,
@@ -40,16 +512,29 @@ void handle_received_packet(struct spt_context *sptctx, struct serial_data_packe
                 rs_packet_registered_t mypkt;
                 memcpy(&mypkt, packet->data, sizeof(rs_packet_registered_t));
                 ntoh_rs_packet_registered_t(&mypkt);
-                rs_linux_registered_lambda *arg = malloc(sizeof(rs_linux_registered_lambda));
-                arg->data_cached = false;
-                pthread_cond_init(&arg->wait_result, NULL);
-                lambda_arg larg;
-                larg.obj = arg;
-                int8_t res = lambda_registry_register(mypkt.name, mypkt.ltype, mypkt.cache, larg);
+                rs_linux_registered_lambda *arg = new_linux_lambda();
+                // counted even if the registration fails, the device has registered the lambda anyway
+                lambda_id_t device_id = next_device_id();
+                int8_t res = RS_REGISTER_NOMEM;
+                if (arg != NULL) {
+                    arg->device_id = device_id;
+                    lambda_arg larg;
+                    larg.obj = arg;
+                    res = lambda_registry_register(mypkt.name, mypkt.ltype, mypkt.cache, larg);
+                }
                 if (res < 0) {
                     fprintf(stderr, "Error while registering lambda with name %s and type %d: code %d\n", mypkt.name,
                             mypkt.ltype, res);
+                    if (arg != NULL) {
+                        pthread_cond_destroy(&arg->wait_result);
+                        free(arg);
+                    }
                 } else {
+                    rs_metrics_reset_lambda((lambda_id_t) res);
+                    resolve_derived_inputs(get_registered_lambda_by_id((lambda_id_t) res));
+                    link_triggers(get_registered_lambda_by_id((lambda_id_t) res));
+                    publish_lambda(get_registered_lambda_by_id((lambda_id_t) res), 0);
+                    __atomic_add_fetch(&registry_version, 1, __ATOMIC_RELEASE);
                     spt_log_msg("packet", "Registered lambda with name %s and type %d: id %d\n", mypkt.name,
                                 mypkt.ltype, res);
                 }
@@ -64,15 +549,25 @@ void handle_received_packet(struct spt_context *sptctx, struct serial_data_packe
                 rs_packet_unregistered_t mypkt;
                 memcpy(&mypkt, packet->data, sizeof(rs_packet_unregistered_t));
                 ntoh_rs_packet_unregistered_t(&mypkt);
-                rs_registered_lambda *lambda = get_registered_lambda_by_id(mypkt.lambda_id);
+                rs_registered_lambda *lambda = get_device_lambda(mypkt.lambda_id);
                 if (lambda == NULL) {
                     fprintf(stderr, "Error while unregistering packet with id %d: lambda unknown\n", mypkt.lambda_id);
                 } else {
                     rs_linux_registered_lambda *arg = lambda->arg.obj;
-                    pthread_cond_destroy(&arg->wait_result);
-                    int8_t res = lambda_registry_unregister(mypkt.lambda_id);
+                    lambda_id_t id = lambda->id;
+                    unresolve_derived_inputs(lambda);
+                    arg->triggers = NULL;
+                    // callers waiting for a result still use the condition and run into their timeout, so
+                    // neither the condition nor the connector data are destroyed here
+                    rs_history_free(&arg->history);
+                    if (lambda->type == RS_LAMBDA_STRING && arg->data_cached) {
+                        rs_memory_release(RS_MEMORY_STRINGS, strlen(arg->ret.ret_s) + 1);
+                    }
+                    int8_t res = lambda_registry_unregister(id);
                     if (res == RS_UNREGISTER_SUCCESS) {
-                        spt_log_msg("packet", "Unregistered lambda with id %d\n", mypkt.lambda_id);
+                        rs_shm_clear(id);
+                        __atomic_add_fetch(&registry_version, 1, __ATOMIC_RELEASE);
+                        spt_log_msg("packet", "Unregistered lambda with id %d\n", id);
                     } else {
                         fprintf(stderr, "Error while unregistering packet with id %d: code %d\n", mypkt.lambda_id, res);
                     }
@@ -88,16 +583,31 @@ void handle_received_packet(struct spt_context *sptctx, struct serial_data_packe
                 rs_packet_lambda_result_int_t mypkt;
                 memcpy(&mypkt, packet->data, sizeof(rs_packet_lambda_result_int_t));
                 ntoh_rs_packet_lambda_result_int_t(&mypkt);
-                rs_registered_lambda *lambda = get_registered_lambda_by_id(mypkt.result_base.lambda_id);
+                rs_registered_lambda *lambda = get_device_lambda(mypkt.result_base.lambda_id);
                 if (lambda == NULL) {
                     fprintf(stderr, "Error while processing int result packet of lambda with id %d: lambda unknown\n",
                             mypkt.result_base.lambda_id);
                 } else {
                     rs_linux_registered_lambda *arg = lambda->arg.obj;
+                    bool changed = !arg->data_cached || arg->ret.ret_i != mypkt.result;
+                    uint64_t now = rs_history_now();
                     arg->ret.ret_i = mypkt.result;
+                    rs_history_append(&arg->history, now, (double) mypkt.result);
+                    evaluate_triggers(lambda, now, (double) mypkt.result);
                     arg->last_call_error = RS_CALL_SUCCESS;
                     arg->data_cached = true;
+                    if (changed) {
+                        touch_lambda_result(arg);
+                    }
+                    publish_lambda(lambda, now);
+                    stream_lambda(lambda, now);
+                    if (changed) {
+                        update_derived_lambdas(lambda, 0);
+                    }
+                    count_lambda_answer(lambda);
+                    arg->received++;
                     pthread_cond_broadcast(&arg->wait_result);
+                    completed = answer_pending_calls(lambda, completed);
                     spt_log_msg("packet", "Received int result of lambda with id %d\n", mypkt.result_base.lambda_id);
                 }
             }
@@ -111,17 +621,33 @@ void handle_received_packet(struct spt_context *sptctx, struct serial_data_packe
                 rs_packet_lambda_result_double_t mypkt;
                 memcpy(&mypkt, packet->data, sizeof(rs_packet_lambda_result_double_t));
                 ntoh_rs_packet_lambda_result_double_t(&mypkt);
-                rs_registered_lambda *lambda = get_registered_lambda_by_id(mypkt.result_base.lambda_id);
+                rs_registered_lambda *lambda = get_device_lambda(mypkt.result_base.lambda_id);
                 if (lambda == NULL) {
                     fprintf(stderr,
                             "Error while processing double result packet of lambda with id %d: lambda unknown\n",
                             mypkt.result_base.lambda_id);
                 } else {
                     rs_linux_registered_lambda *arg = lambda->arg.obj;
+                    bool changed = !arg->data_cached ||
+                                   memcmp(&arg->ret.ret_d, &mypkt.result, sizeof(rs_double_t)) != 0;
+                    uint64_t now = rs_history_now();
                     arg->ret.ret_d = mypkt.result;
+                    rs_history_append(&arg->history, now, mypkt.result);
+                    evaluate_triggers(lambda, now, mypkt.result);
                     arg->last_call_error = RS_CALL_SUCCESS;
                     arg->data_cached = true;
+                    if (changed) {
+                        touch_lambda_result(arg);
+                    }
+                    publish_lambda(lambda, now);
+                    stream_lambda(lambda, now);
+                    if (changed) {
+                        update_derived_lambdas(lambda, 0);
+                    }
+                    count_lambda_answer(lambda);
+                    arg->received++;
                     pthread_cond_broadcast(&arg->wait_result);
+                    completed = answer_pending_calls(lambda, completed);
                     spt_log_msg("packet", "Received double result of lambda with id %d\n", mypkt.result_base.lambda_id);
                 }
             }
@@ -135,22 +661,34 @@ void handle_received_packet(struct spt_context *sptctx, struct serial_data_packe
                 rs_packet_lambda_result_string_t *mypkt = malloc(packet->len);
                 memcpy(mypkt, packet->data, packet->len);
                 ntoh_rs_packet_lambda_result_string_t(mypkt);
-                rs_registered_lambda *lambda = get_registered_lambda_by_id(mypkt->result_base.lambda_id);
+                rs_registered_lambda *lambda = get_device_lambda(mypkt->result_base.lambda_id);
                 if (lambda == NULL) {
                     fprintf(stderr,
                             "Error while processing string result packet of lambda with id %d: lambda unknown\n",
                             mypkt->result_base.lambda_id);
                 } else {
                     rs_linux_registered_lambda *arg = lambda->arg.obj;
+                    char *result = malloc(mypkt->result_length);
+                    memcpy(result, &mypkt->result, mypkt->result_length);
+                    bool changed = !arg->data_cached || strcmp(arg->ret.ret_s, result) != 0;
+                    rs_memory_account(RS_MEMORY_STRINGS, strlen(result) + 1);
                     if (arg->data_cached) {
+                        rs_memory_release(RS_MEMORY_STRINGS, strlen(arg->ret.ret_s) + 1);
                         free(arg->ret.ret_s);
                     }
-                    char *result = malloc(mypkt->result_length);
-                    memcpy(result, &mypkt->result, mypkt->result_length);
                     arg->ret.ret_s = result;
                     arg->last_call_error = RS_CALL_SUCCESS;
                     arg->data_cached = true;
+                    if (changed) {
+                        touch_lambda_result(arg);
+                    }
+                    uint64_t now = rs_history_now();
+                    publish_lambda(lambda, now);
+                    stream_lambda(lambda, now);
+                    count_lambda_answer(lambda);
+                    arg->received++;
                     pthread_cond_broadcast(&arg->wait_result);
+                    completed = answer_pending_calls(lambda, completed);
                     spt_log_msg("packet", "Received string result of lambda with id %d\n",
                                 mypkt->result_base.lambda_id);
                 }
@@ -165,7 +703,7 @@ void handle_received_packet(struct spt_context *sptctx, struct serial_data_packe
                 rs_packet_lambda_result_error_t mypkt;
                 memcpy(&mypkt, packet->data, sizeof(rs_packet_lambda_result_error_t));
                 ntoh_rs_packet_lambda_result_error_t(&mypkt);
-                rs_registered_lambda *lambda = get_registered_lambda_by_id(mypkt.result_base.lambda_id);
+                rs_registered_lambda *lambda = get_device_lambda(mypkt.result_base.lambda_id);
                 if (lambda == NULL) {
                     fprintf(stderr,
                             "Error while processing error result packet of lambda with id %d: lambda unknown\n",
@@ -173,7 +711,10 @@ void handle_received_packet(struct spt_context *sptctx, struct serial_data_packe
                 } else {
                     rs_linux_registered_lambda *arg = lambda->arg.obj;
                     arg->last_call_error = mypkt.error_code;
+                    count_lambda_answer(lambda);
+                    arg->received++;
                     pthread_cond_broadcast(&arg->wait_result);
+                    completed = answer_pending_calls(lambda, completed);
                     spt_log_msg("packet", "Received error result of lambda with id %d: code %d\n",
                                 mypkt.result_base.lambda_id, mypkt.error_code);
                 }
@@ -185,6 +726,8 @@ void handle_received_packet(struct spt_context *sptctx, struct serial_data_packe
                     packet->len);
         }
     }
+    pthread_mutex_unlock(&accessing_registry);
+    run_completed_calls(completed);
     if (sptctx->log_in_line) {
         spt_log_msg(SPT_LOG_STANDARD_CATEGORY, "");
     }
@@ -199,6 +742,7 @@ int rs_linux_start(const char *serial_file) {
         return -1;
     }
     init_lambda_registry();
+    rs_memory_set_reclaimer(RS_MEMORY_HISTORY, reclaim_histories);
     serial_io_context_init(&linux_sictx, serialfd, serialfd);
     spt_init_context(&linux_sptctx, &linux_sictx, handle_received_packet);
     spt_log_msg("main", "Starting SPT...\n");
@@ -206,66 +750,296 @@ int rs_linux_start(const char *serial_file) {
     return 0;
 }
 
+void rs_linux_lock_registry(void) {
+    pthread_mutex_lock(&accessing_registry);
+}
+
+void rs_linux_unlock_registry(void) {
+    pthread_mutex_unlock(&accessing_registry);
+}
+
+bool copy_registered_lambda_by_id(lambda_id_t id, rs_registered_lambda *copy) {
+    pthread_mutex_lock(&accessing_registry);
+    rs_registered_lambda *lambda = get_registered_lambda_by_id(id);
+    if (lambda != NULL) {
+        *copy = *lambda;
+    }
+    pthread_mutex_unlock(&accessing_registry);
+    return lambda != NULL;
+}
+
+bool copy_registered_lambda_by_name(const char *name, rs_registered_lambda *copy) {
+    pthread_mutex_lock(&accessing_registry);
+    rs_registered_lambda *lambda = get_registered_lambda_by_name(name);
+    if (lambda != NULL) {
+        *copy = *lambda;
+    }
+    pthread_mutex_unlock(&accessing_registry);
+    return lambda != NULL;
+}
+
 int rs_linux_stop(void) {
     spt_stop(&linux_sptctx);
+    stop_pending_calls();
+    pthread_mutex_lock(&accessing_registry);
+    for (size_t i = 0; i < stream_count; i++) {
+        rs_stream_close(streams[i]);
+    }
+    pthread_mutex_unlock(&accessing_registry);
+    rs_memory_set_reclaimer(RS_MEMORY_HISTORY, NULL);
+    rs_linux_clear_triggers();
+    rs_shm_destroy();
     free_lambda_registry();
     return 0;
 }
 
-int8_t wait_lambda_result(rs_registered_lambda *lambda, generic_lambda_return *result) {
+/**
+ * @brief Copy the cached result of a lambda, string results are duplicated
+ *
+ * @param lambda Lambda with a cached result
+ * @param result Where to store the result
+ * @param version Where to store the version of the result, may be NULL
+ */
+static void copy_cached_result(rs_registered_lambda *lambda, generic_lambda_return *result, uint32_t *version) {
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    memcpy(result, &arg->ret, sizeof(generic_lambda_return));
+    if (lambda->type == RS_LAMBDA_STRING) {
+        // the cached string is freed by the next result, while the caller may still use it without the lock
+        result->ret_s = strdup(arg->ret.ret_s);
+    }
+    if (version != NULL) {
+        *version = arg->version;
+    }
+}
+
+/**
+ * @brief Get the outcome of a call that was answered or timed out, the registry lock has to be held
+ *
+ * @param lambda Called lambda
+ * @param answered If a result or error packet was received after the call
+ * @param result Where to store the result, a string result is a copy that has to be freed by the caller
+ * @param version Where to store the version of the result, may be NULL
+ * @return A RS_CALL_* constant
+ */
+static int8_t finish_lambda_call(rs_registered_lambda *lambda, bool answered, generic_lambda_return *result,
+                                 uint32_t *version) {
     rs_linux_registered_lambda *arg = lambda->arg.obj;
-    struct timespec spec;
-    clock_gettime(CLOCK_REALTIME, &spec);
-    spec.tv_sec += 1;
-    if (pthread_cond_timedwait(&arg->wait_result, &accessing_registry, &spec) == ETIMEDOUT) {
+    if (!answered) {
+        rs_metrics_count_timeout(lambda->id);
+        // a late answer must not be taken as the answer of the next call
+        arg->call_sent = 0;
         if (arg->last_call_error != 0) {
             int8_t error_code = arg->last_call_error;
             arg->last_call_error = 0;
-            pthread_mutex_unlock(&accessing_registry);
             return error_code;
         }
         if (lambda->cache == RS_CACHE_ON_TIMEOUT) {
             if (arg->data_cached) {
+                rs_metrics_count_cache(lambda->cache, RS_METRICS_CACHE_HIT);
                 spt_log_msg("cache",
                             "Using cached result for lambda with ID %d and cache policy RS_CACHE_ON_TIMEOUT because of timeout\n",
                             lambda->id);
-                *result = arg->ret;
-                pthread_mutex_unlock(&accessing_registry);
+                copy_cached_result(lambda, result, version);
                 return RS_CALL_CACHE_TIMEOUT;
             } else {
+                rs_metrics_count_cache(lambda->cache, RS_METRICS_CACHE_EMPTY);
                 spt_log_msg("cache",
                             "Could not find result for lambda with ID %d and cache policy RS_CACHE_ON_TIMEOUT in cache, tried because of timeout\n",
                             lambda->id);
-                pthread_mutex_unlock(&accessing_registry);
                 return RS_CALL_CACHE_TIMEOUT_EMPTY;
             }
         } else {
             spt_log_msg("result",
                         "Did not get result for lambda with ID %d in time\n", lambda->id);
-            pthread_mutex_unlock(&accessing_registry);
             return RS_CALL_TIMEOUT;
         }
     }
+    if (arg->last_call_error != RS_CALL_SUCCESS) {
+        int8_t error_code = arg->last_call_error;
+        spt_log_msg("result", "Got error %d for lambda with ID %d\n", error_code, lambda->id);
+        return error_code;
+    }
     spt_log_msg("result",
                 "Got result of lambda with ID %d in time\n", lambda->id);
-    memcpy(result, &arg->ret, sizeof(generic_lambda_return));
-    pthread_mutex_unlock(&accessing_registry);
+    copy_cached_result(lambda, result, version);
     return RS_CALL_SUCCESS;
 }
 
-int8_t check_lambda_cache(rs_registered_lambda *lambda, generic_lambda_return *result) {
+/**
+ * @brief Wait until a result or error packet of a lambda was received after a call, the registry lock has to be
+ * held and is still held on return
+ *
+ * @param lambda Called lambda
+ * @param received Value of the received counter of the lambda when the call was sent
+ * @param deadline Absolute time (CLOCK_REALTIME) after which the call timed out
+ * @param result Where to store the result, a string result is a copy that has to be freed by the caller
+ * @param version Where to store the version of the result, may be NULL
+ * @return A RS_CALL_* constant
+ */
+static int8_t await_lambda_result(rs_registered_lambda *lambda, uint32_t received, const struct timespec *deadline,
+                                  generic_lambda_return *result, uint32_t *version) {
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    int rc = 0;
+    while (arg->received == received && rc != ETIMEDOUT) {
+        rc = pthread_cond_timedwait(&arg->wait_result, &accessing_registry, deadline);
+    }
+    return finish_lambda_call(lambda, arg->received != received, result, version);
+}
+
+int8_t wait_lambda_result(rs_registered_lambda *lambda, generic_lambda_return *result, uint32_t *version) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 1;
+    uint32_t received = ((rs_linux_registered_lambda *) lambda->arg.obj)->received;
+    int8_t res = await_lambda_result(lambda, received, &deadline, result, version);
+    pthread_mutex_unlock(&accessing_registry);
+    return res;
+}
+
+/**
+ * @brief Move the pending calls of a lambda that got an answer to the completed calls, the registry lock has to be
+ * held
+ *
+ * @param lambda Lambda a result or error packet was received for
+ * @param completed Completed calls so far
+ * @return Completed calls including the answered ones
+ */
+static rs_pending_call *answer_pending_calls(rs_registered_lambda *lambda, rs_pending_call *completed) {
+    rs_pending_call **p = &pending_calls;
+    while (*p != NULL) {
+        rs_pending_call *call = *p;
+        if (call->id != lambda->id) {
+            p = &call->next;
+            continue;
+        }
+        *p = call->next;
+        call->res = finish_lambda_call(lambda, true, &call->result, &call->version);
+        call->next = completed;
+        completed = call;
+    }
+    return completed;
+}
+
+/**
+ * @brief Complete a pending call that ran into its deadline or was cancelled, the registry lock has to be held
+ *
+ * @param call Pending call, already removed from pending_calls
+ */
+static void expire_pending_call(rs_pending_call *call) {
+    rs_registered_lambda *lambda = get_registered_lambda_by_id(call->id);
+    if (lambda == NULL) {
+        // unregistered while waiting
+        call->res = RS_CALL_NOTFOUND;
+        call->unknown = true;
+    } else {
+        call->res = finish_lambda_call(lambda, false, &call->result, &call->version);
+    }
+}
+
+/**
+ * @brief Finish completed calls and pass their results to the callers, the registry lock must not be held
+ *
+ * @param completed Completed calls, freed afterwards
+ */
+static void run_completed_calls(rs_pending_call *completed) {
+    while (completed != NULL) {
+        rs_pending_call *call = completed;
+        completed = call->next;
+        if (call->admitted) {
+            rs_admission_release(call->id);
+        }
+        rs_metrics_count_call(call->unknown ? (lambda_id_t) MAX_LAMBDAS : call->id, call->res);
+        call->callback(call->res, &call->result, call->version, call->ctx);
+        free(call);
+    }
+}
+
+static bool timespec_before(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/**
+ * @brief Main function of the expiry thread, completes pending calls when their deadline passed
+ */
+static void *expire_pending_calls(void *unused) {
+    UNUSED(unused);
+    pthread_mutex_lock(&accessing_registry);
+    while (!expiry_stopping) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        rs_pending_call *completed = NULL;
+        struct timespec next = {0, 0};
+        bool waiting = false;
+        rs_pending_call **p = &pending_calls;
+        while (*p != NULL) {
+            rs_pending_call *call = *p;
+            if (!timespec_before(&now, &call->deadline)) {
+                *p = call->next;
+                expire_pending_call(call);
+                call->next = completed;
+                completed = call;
+                continue;
+            }
+            if (!waiting || timespec_before(&call->deadline, &next)) {
+                next = call->deadline;
+                waiting = true;
+            }
+            p = &call->next;
+        }
+        if (completed != NULL) {
+            pthread_mutex_unlock(&accessing_registry);
+            run_completed_calls(completed);
+            pthread_mutex_lock(&accessing_registry);
+        } else if (waiting) {
+            pthread_cond_timedwait(&pending_changed, &accessing_registry, &next);
+        } else {
+            pthread_cond_wait(&pending_changed, &accessing_registry);
+        }
+    }
+    pthread_mutex_unlock(&accessing_registry);
+    return NULL;
+}
+
+/**
+ * @brief Stop the expiry thread and complete all pending calls as timed out
+ */
+static void stop_pending_calls(void) {
+    pthread_mutex_lock(&accessing_registry);
+    bool running = expiry_running;
+    expiry_stopping = true;
+    pthread_cond_signal(&pending_changed);
+    pthread_mutex_unlock(&accessing_registry);
+    if (running) {
+        pthread_join(expiry_thread, NULL);
+    }
+    pthread_mutex_lock(&accessing_registry);
+    rs_pending_call *completed = NULL;
+    while (pending_calls != NULL) {
+        rs_pending_call *call = pending_calls;
+        pending_calls = call->next;
+        expire_pending_call(call);
+        call->next = completed;
+        completed = call;
+    }
+    expiry_running = false;
+    expiry_stopping = false;
+    pthread_mutex_unlock(&accessing_registry);
+    run_completed_calls(completed);
+}
+
+int8_t check_lambda_cache(rs_registered_lambda *lambda, generic_lambda_return *result, uint32_t *version) {
     rs_linux_registered_lambda *arg = lambda->arg.obj;
     switch (lambda->cache) {
-        case RS_CACHE_NO_CACHE:
-            return RS_CALL_SUCCESS;
         case RS_CACHE_CALL_ONCE:
             if (arg->data_cached) {
                 spt_log_msg("cache",
                             "Found result for lambda with ID %d and cache policy RS_CACHE_CALL_ONCE in cache\n",
                             lambda->id);
-                *result = arg->ret;
+                rs_metrics_count_cache(lambda->cache, RS_METRICS_CACHE_HIT);
+                copy_cached_result(lambda, result, version);
                 return RS_CALL_CACHE;
             } else {
+                rs_metrics_count_cache(lambda->cache, RS_METRICS_CACHE_MISS);
                 return RS_CALL_SUCCESS;
             }
         case RS_CACHE_ONLY:
@@ -273,77 +1047,486 @@ int8_t check_lambda_cache(rs_registered_lambda *lambda, generic_lambda_return *r
                 spt_log_msg("cache",
                             "Found result for lambda with ID %d and cache policy RS_CACHE_ONLY in cache\n",
                             lambda->id);
-                *result = arg->ret;
+                rs_metrics_count_cache(lambda->cache, RS_METRICS_CACHE_HIT);
+                copy_cached_result(lambda, result, version);
                 return RS_CALL_CACHE;
             } else {
                 spt_log_msg("cache",
                             "Could not find result for lambda with ID %d and cache policy RS_CACHE_ONLY in cache\n",
                             lambda->id);
+                rs_metrics_count_cache(lambda->cache, RS_METRICS_CACHE_EMPTY);
                 return RS_CALL_CACHE_EMPTY;
             }
         default:
+            // RS_CACHE_NO_CACHE and RS_CACHE_ON_TIMEOUT always call the device
+            rs_metrics_count_cache(lambda->cache, RS_METRICS_CACHE_MISS);
             return RS_CALL_SUCCESS;
     }
 }
 
+/**
+ * @brief Admit a call to the serial link, the registry lock has to be held
+ *
+ * An admitted call has to be finished with rs_admission_release(). A rejected call of a lambda with cache policy
+ * RS_CACHE_ON_TIMEOUT is answered from the cache like a call that timed out.
+ *
+ * @param lambda Lambda to call
+ * @param by_name If the lambda is called by name
+ * @param result Where to store the cached result
+ * @param version Where to store the version of the cached result, may be NULL
+ * @return RS_CALL_SUCCESS if the call may be sent, RS_CALL_CACHE_TIMEOUT or RS_CALL_OVERLOAD otherwise
+ */
+static int8_t admit_call(rs_registered_lambda *lambda, bool by_name, generic_lambda_return *result,
+                         uint32_t *version) {
+    uint8_t outcome = rs_admission_acquire(lambda->id, rs_admission_call_bytes(lambda->type, by_name));
+    if (outcome == RS_ADMISSION_ADMITTED) {
+        return RS_CALL_SUCCESS;
+    }
+    if (lambda->cache == RS_CACHE_ON_TIMEOUT && ((rs_linux_registered_lambda *) lambda->arg.obj)->data_cached) {
+        rs_metrics_count_cache(lambda->cache, RS_METRICS_CACHE_HIT);
+        spt_log_msg("cache",
+                    "Using cached result for lambda with ID %d and cache policy RS_CACHE_ON_TIMEOUT because of overload\n",
+                    lambda->id);
+        copy_cached_result(lambda, result, version);
+        return RS_CALL_CACHE_TIMEOUT;
+    }
+    spt_log_msg("result", "Rejected call of lambda with ID %d by admission limit %d\n", lambda->id, outcome);
+    return RS_CALL_OVERLOAD;
+}
+
+/**
+ * @brief Send the packet to call a lambda by it's ID, the registry lock has to be held
+ *
+ * @param lambda Lambda to call
+ * @param expected_type Expected return type
+ */
+static void send_call_by_id(rs_registered_lambda *lambda, rs_lambda_type_t expected_type) {
+    spt_log_msg("packet", "Calling for lambda by ID with ID %d and expected type %d...\n", lambda->id, expected_type);
+    rs_packet_call_by_id_t *mypkt = malloc(sizeof(rs_packet_call_by_id_t));
+    mypkt->base.ptype = RS_PACKET_CALL_BY_ID;
+    mypkt->lambda_id = ((rs_linux_registered_lambda *) lambda->arg.obj)->device_id;
+    mypkt->expected_type = expected_type;
+    hton_rs_packet_call_by_id_t(mypkt);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) mypkt;
+    pkt.len = sizeof(*mypkt);
+    spt_send_packet(&linux_sptctx, &pkt);
+    free(mypkt);
+    count_lambda_call_sent(lambda);
+}
+
+/**
+ * @brief Send the packet to call a lambda by it's name, the registry lock has to be held
+ *
+ * @param lambda Lambda to call
+ * @param name Name the lambda is called by
+ * @param expected_type Expected return type
+ */
+static void send_call_by_name(rs_registered_lambda *lambda, const char *name, rs_lambda_type_t expected_type) {
+    spt_log_msg("packet", "Calling for lambda by name with name %s and expected type %d...\n", name, expected_type);
+    rs_packet_call_by_name_t *mypkt = malloc(sizeof(rs_packet_call_by_name_t));
+    mypkt->base.ptype = RS_PACKET_CALL_BY_NAME;
+    strcpy(mypkt->name, name);
+    mypkt->expected_type = expected_type;
+    hton_rs_packet_call_by_name_t(mypkt);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) mypkt;
+    pkt.len = sizeof(*mypkt);
+    spt_send_packet(&linux_sptctx, &pkt);
+    free(mypkt);
+    count_lambda_call_sent(lambda);
+}
+
 int8_t call_lambda_by_id(lambda_id_t id, rs_lambda_type_t expected_type, generic_lambda_return *result) {
+    return call_lambda_by_id_versioned(id, expected_type, result, NULL);
+}
+
+int8_t call_lambda_by_id_versioned(lambda_id_t id, rs_lambda_type_t expected_type, generic_lambda_return *result,
+                                   uint32_t *version) {
     UNUSED(result);
     pthread_mutex_lock(&accessing_registry);
     rs_registered_lambda *lambda = get_registered_lambda_by_id(id);
     if (lambda == NULL) {
         pthread_mutex_unlock(&accessing_registry);
+        rs_metrics_count_call(MAX_LAMBDAS, RS_CALL_NOTFOUND);
         return RS_CALL_NOTFOUND;
     }
+    int8_t res;
     if (lambda->type != expected_type) {
+        res = RS_CALL_WRONGTYPE;
         pthread_mutex_unlock(&accessing_registry);
-        return RS_CALL_WRONGTYPE;
-    }
-    int8_t cache_result = check_lambda_cache(lambda, result);
-    if (cache_result != 0) {
+    } else if ((res = check_lambda_cache(lambda, result, version)) != 0 ||
+               (res = admit_call(lambda, false, result, version)) != 0) {
         pthread_mutex_unlock(&accessing_registry);
-        return cache_result;
+    } else {
+        send_call_by_id(lambda, expected_type);
+        res = wait_lambda_result(lambda, result, version);
+        rs_admission_release(id);
     }
-    spt_log_msg("packet", "Calling for lambda by ID with ID %d and expected type %d...\n", id, expected_type);
-    rs_packet_call_by_id_t *mypkt = malloc(sizeof(rs_packet_call_by_id_t));
-    mypkt->base.ptype = RS_PACKET_CALL_BY_ID;
-    mypkt->lambda_id = id;
-    mypkt->expected_type = expected_type;
-    hton_rs_packet_call_by_id_t(mypkt);
-    struct serial_data_packet pkt;
-    pkt.data = (uint8_t *) mypkt;
-    pkt.len = sizeof(*mypkt);
-    spt_send_packet(&linux_sptctx, &pkt);
-    free(mypkt);
-    return wait_lambda_result(lambda, result);
+    rs_metrics_count_call(id, res);
+    return res;
+}
+
+void call_lambdas_by_id_versioned(size_t count, const lambda_id_t *ids, const rs_lambda_type_t *expected_types,
+                                  generic_lambda_return *results, uint32_t *versions, int8_t *codes) {
+    uint32_t *received = malloc(count * sizeof(uint32_t));
+    bool *sent = calloc(count, sizeof(bool));
+    pthread_mutex_lock(&accessing_registry);
+    // answer from the cache or send the call packets of all lambdas before waiting for any of them
+    for (size_t i = 0; i < count; i++) {
+        rs_registered_lambda *lambda = get_registered_lambda_by_id(ids[i]);
+        if (lambda == NULL) {
+            codes[i] = RS_CALL_NOTFOUND;
+            rs_metrics_count_call(MAX_LAMBDAS, codes[i]);
+            continue;
+        }
+        if (expected_types[i] != 0 && lambda->type != expected_types[i]) {
+            codes[i] = RS_CALL_WRONGTYPE;
+            rs_metrics_count_call(ids[i], codes[i]);
+            continue;
+        }
+        codes[i] = check_lambda_cache(lambda, &results[i], versions != NULL ? &versions[i] : NULL);
+        if (codes[i] == 0) {
+            codes[i] = admit_call(lambda, false, &results[i], versions != NULL ? &versions[i] : NULL);
+        }
+        if (codes[i] != 0) {
+            rs_metrics_count_call(ids[i], codes[i]);
+            continue;
+        }
+        send_call_by_id(lambda, lambda->type);
+        received[i] = ((rs_linux_registered_lambda *) lambda->arg.obj)->received;
+        sent[i] = true;
+    }
+    // all calls share one deadline, the lock is released while waiting so results of other lambdas are received
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 1;
+    for (size_t i = 0; i < count; i++) {
+        if (!sent[i]) {
+            continue;
+        }
+        rs_registered_lambda *lambda = get_registered_lambda_by_id(ids[i]);
+        if (lambda == NULL) {
+            // unregistered while waiting for another lambda
+            codes[i] = RS_CALL_NOTFOUND;
+            rs_metrics_count_call(MAX_LAMBDAS, codes[i]);
+        } else {
+            codes[i] = await_lambda_result(lambda, received[i], &deadline, &results[i],
+                                           versions != NULL ? &versions[i] : NULL);
+            rs_metrics_count_call(ids[i], codes[i]);
+        }
+        rs_admission_release(ids[i]);
+    }
+    pthread_mutex_unlock(&accessing_registry);
+    free(sent);
+    free(received);
 }
 
 int8_t call_lambda_by_name(const char *name, rs_lambda_type_t expected_type, generic_lambda_return *result) {
+    return call_lambda_by_name_versioned(name, expected_type, result, NULL);
+}
+
+int8_t call_lambda_by_name_versioned(const char *name, rs_lambda_type_t expected_type, generic_lambda_return *result,
+                                     uint32_t *version) {
     UNUSED(result);
     pthread_mutex_lock(&accessing_registry);
     rs_registered_lambda *lambda = get_registered_lambda_by_name(name);
     if (lambda == NULL) {
         pthread_mutex_unlock(&accessing_registry);
+        rs_metrics_count_call(MAX_LAMBDAS, RS_CALL_NOTFOUND);
         return RS_CALL_NOTFOUND;
     }
+    lambda_id_t id = lambda->id;
     if (lambda->type != expected_type) {
         pthread_mutex_unlock(&accessing_registry);
+        rs_metrics_count_call(id, RS_CALL_WRONGTYPE);
         return RS_CALL_WRONGTYPE;
     }
-    int8_t cache_result = check_lambda_cache(lambda, result);
+    int8_t cache_result = check_lambda_cache(lambda, result, version);
+    if (cache_result == 0) {
+        cache_result = admit_call(lambda, true, result, version);
+    }
     if (cache_result != 0) {
         pthread_mutex_unlock(&accessing_registry);
+        rs_metrics_count_call(id, cache_result);
         return cache_result;
     }
-    spt_log_msg("packet", "Calling for lambda by name with name %s and expected type %d...\n", name, expected_type);
-    rs_packet_call_by_name_t *mypkt = malloc(sizeof(rs_packet_call_by_name_t));
-    mypkt->base.ptype = RS_PACKET_CALL_BY_NAME;
-    strcpy(mypkt->name, name);
-    mypkt->expected_type = expected_type;
-    hton_rs_packet_call_by_name_t(mypkt);
-    struct serial_data_packet pkt;
-    pkt.data = (uint8_t *) mypkt;
-    pkt.len = sizeof(*mypkt);
-    spt_send_packet(&linux_sptctx, &pkt);
-    free(mypkt);
-    return wait_lambda_result(lambda, result);
+    send_call_by_name(lambda, name, expected_type);
+    int8_t res = wait_lambda_result(lambda, result, version);
+    rs_admission_release(id);
+    rs_metrics_count_call(id, res);
+    return res;
+}
+
+/**
+ * @brief Call a lambda without waiting for the answer, the registry lock has to be held and is released
+ *
+ * @param lambda Lambda to call, NULL if it was not found
+ * @param name Name the lambda is called by, NULL to call it by ID
+ * @param expected_type Expected return type
+ * @param callback Receives the outcome
+ * @param ctx Passed to the callback
+ */
+static void call_lambda_async(rs_registered_lambda *lambda, const char *name, rs_lambda_type_t expected_type,
+                              rs_call_callback callback, void *ctx) {
+    rs_pending_call *call = calloc(1, sizeof(rs_pending_call));
+    call->callback = callback;
+    call->ctx = ctx;
+    call->id = lambda != NULL ? lambda->id : (lambda_id_t) MAX_LAMBDAS;
+    if (lambda == NULL) {
+        call->res = RS_CALL_NOTFOUND;
+        call->unknown = true;
+    } else if (lambda->type != expected_type) {
+        call->res = RS_CALL_WRONGTYPE;
+    } else if ((call->res = check_lambda_cache(lambda, &call->result, &call->version)) == 0 &&
+               (call->res = admit_call(lambda, name != NULL, &call->result, &call->version)) == 0) {
+        if (name != NULL) {
+            send_call_by_name(lambda, name, expected_type);
+        } else {
+            send_call_by_id(lambda, expected_type);
+        }
+        call->admitted = true;
+        clock_gettime(CLOCK_REALTIME, &call->deadline);
+        call->deadline.tv_sec += 1;
+        call->next = pending_calls;
+        pending_calls = call;
+        if (!expiry_running && pthread_create(&expiry_thread, NULL, expire_pending_calls, NULL) == 0) {
+            expiry_running = true;
+        }
+        pthread_cond_signal(&pending_changed);
+        pthread_mutex_unlock(&accessing_registry);
+        return;
+    }
+    // answered without calling the device
+    pthread_mutex_unlock(&accessing_registry);
+    run_completed_calls(call);
+}
+
+void call_lambda_by_id_async(lambda_id_t id, rs_lambda_type_t expected_type, rs_call_callback callback, void *ctx) {
+    pthread_mutex_lock(&accessing_registry);
+    call_lambda_async(get_registered_lambda_by_id(id), NULL, expected_type, callback, ctx);
+}
+
+void call_lambda_by_name_async(const char *name, rs_lambda_type_t expected_type, rs_call_callback callback,
+                               void *ctx) {
+    pthread_mutex_lock(&accessing_registry);
+    call_lambda_async(get_registered_lambda_by_name(name), name, expected_type, callback, ctx);
+}
+
+static int8_t query_lambda_history(rs_registered_lambda *lambda, rs_query_op_t op, uint64_t from, uint64_t to,
+                                   double quantile, double *result, size_t *count) {
+    if (lambda == NULL) {
+        return RS_QUERY_NOTFOUND;
+    }
+    if (lambda->type != RS_LAMBDA_INT && lambda->type != RS_LAMBDA_DOUBLE) {
+        return RS_QUERY_WRONGTYPE;
+    }
+    rs_linux_registered_lambda *arg = lambda->arg.obj;
+    rs_history_touch(&arg->history);
+    return rs_history_query(&arg->history, op, from, to, quantile, result, count);
+}
+
+int8_t query_lambda_history_by_id(lambda_id_t id, rs_query_op_t op, uint64_t from, uint64_t to, double quantile,
+                                  double *result, size_t *count) {
+    pthread_mutex_lock(&accessing_registry);
+    int8_t res = query_lambda_history(get_registered_lambda_by_id(id), op, from, to, quantile, result, count);
+    pthread_mutex_unlock(&accessing_registry);
+    return res;
+}
+
+int8_t query_lambda_history_by_name(const char *name, rs_query_op_t op, uint64_t from, uint64_t to, double quantile,
+                                    double *result, size_t *count) {
+    pthread_mutex_lock(&accessing_registry);
+    int8_t res = query_lambda_history(get_registered_lambda_by_name(name), op, from, to, quantile, result, count);
+    pthread_mutex_unlock(&accessing_registry);
+    return res;
+}
+
+int8_t rs_linux_register_derived(const char *name, const char *expression) {
+    rs_linux_derived_lambda *derived = malloc(sizeof(rs_linux_derived_lambda));
+    if (derived == NULL) {
+        return RS_REGISTER_NOMEM;
+    }
+    size_t error_pos;
+    int8_t res = rs_expr_compile(&derived->expr, expression, &error_pos);
+    if (res != RS_EXPR_SUCCESS) {
+        fprintf(stderr, "Error in expression of derived lambda %s at position %d: %s\n", name, (int) error_pos,
+                stringify_rs_expr_result(res));
+        free(derived);
+        return res == RS_EXPR_NOMEM ? RS_REGISTER_NOMEM : RS_REGISTER_INVALPARAM;
+    }
+    for (uint8_t i = 0; i < derived->expr.input_count; i++) {
+        derived->input_ids[i] = -1;
+        if (strcmp(derived->expr.inputs[i], name) == 0) {
+            fprintf(stderr, "Derived lambda %s must not use itself as an input\n", name);
+            rs_expr_free(&derived->expr);
+            free(derived);
+            return RS_REGISTER_INVALPARAM;
+        }
+    }
+    rs_linux_registered_lambda *arg = new_linux_lambda();
+    if (arg == NULL) {
+        rs_expr_free(&derived->expr);
+        free(derived);
+        return RS_REGISTER_NOMEM;
+    }
+    arg->derived = derived;
+    lambda_arg larg;
+    larg.obj = arg;
+    pthread_mutex_lock(&accessing_registry);
+    res = lambda_registry_register(name, RS_LAMBDA_DOUBLE, RS_CACHE_ONLY, larg);
+    if (res < 0) {
+        pthread_mutex_unlock(&accessing_registry);
+        fprintf(stderr, "Error while registering derived lambda with name %s: code %d\n", name, res);
+        pthread_cond_destroy(&arg->wait_result);
+        rs_expr_free(&derived->expr);
+        free(derived);
+        free(arg);
+        return res;
+    }
+    rs_registered_lambda *lambda = get_registered_lambda_by_id((lambda_id_t) res);
+    for (uint8_t i = 0; i < derived->expr.input_count; i++) {
+        rs_registered_lambda *input = get_registered_lambda_by_name(derived->expr.inputs[i]);
+        if (input != NULL) {
+            derived->input_ids[i] = input->id;
+            ((rs_linux_registered_lambda *) input->arg.obj)->dependents[res / 8] |= (uint8_t) (1 << (res % 8));
+        }
+    }
+    resolve_derived_inputs(lambda);
+    link_triggers(lambda);
+    publish_lambda(lambda, 0);
+    __atomic_add_fetch(&registry_version, 1, __ATOMIC_RELEASE);
+    evaluate_derived_lambda(lambda, 0);
+    pthread_mutex_unlock(&accessing_registry);
+    spt_log_msg("derived", "Registered derived lambda with name %s: id %d\n", name, res);
+    return res;
+}
+
+int8_t rs_linux_add_trigger(const char *definition) {
+    rs_trigger *t = malloc(sizeof(rs_trigger));
+    if (t == NULL) {
+        return RS_TRIGGER_NOMEM;
+    }
+    int8_t res = rs_trigger_parse(t, definition);
+    if (res != RS_TRIGGER_SUCCESS) {
+        free(t);
+        return res;
+    }
+    pthread_mutex_lock(&accessing_registry);
+    if (trigger_count >= RS_MAX_TRIGGERS) {
+        pthread_mutex_unlock(&accessing_registry);
+        free(t);
+        return RS_TRIGGER_LIMIT_REACHED;
+    }
+    for (size_t i = 0; i < trigger_count; i++) {
+        if (strcmp(triggers[i]->name, t->name) == 0) {
+            pthread_mutex_unlock(&accessing_registry);
+            free(t);
+            return RS_TRIGGER_DUPLICATE;
+        }
+    }
+    triggers[trigger_count++] = t;
+    rs_registered_lambda *lambda = get_registered_lambda_by_name(t->lambda);
+    if (lambda != NULL) {
+        rs_linux_registered_lambda *arg = lambda->arg.obj;
+        t->next = arg->triggers;
+        arg->triggers = t;
+    }
+    pthread_mutex_unlock(&accessing_registry);
+    spt_log_msg("trigger", "Added trigger %s for lambda %s\n", t->name, t->lambda);
+    return RS_TRIGGER_SUCCESS;
+}
+
+void rs_linux_clear_triggers(void) {
+    pthread_mutex_lock(&accessing_registry);
+    for (lambda_id_t i = 0; i < get_number_of_registered_lambdas(); i++) {
+        rs_registered_lambda *lambda = get_registered_lambda_by_id(i);
+        if (lambda != NULL) {
+            ((rs_linux_registered_lambda *) lambda->arg.obj)->triggers = NULL;
+        }
+    }
+    for (size_t i = 0; i < trigger_count; i++) {
+        free(triggers[i]);
+        triggers[i] = NULL;
+    }
+    trigger_count = 0;
+    pthread_mutex_unlock(&accessing_registry);
+}
+
+size_t rs_linux_read_events(uint64_t after, rs_trigger_event *events, size_t max, uint32_t wait_ms) {
+    return rs_event_queue_read(&event_queue, after, events, max, wait_ms);
+}
+
+int rs_linux_events_fd(void) {
+    return rs_event_queue_fd(&event_queue);
+}
+
+void rs_linux_clear_events_fd(void) {
+    rs_event_queue_clear_fd(&event_queue);
+}
+
+uint64_t rs_linux_get_dropped_events(void) {
+    return rs_event_queue_dropped(&event_queue);
+}
+
+int rs_linux_enable_shm(const char *name) {
+    pthread_mutex_lock(&accessing_registry);
+    if (rs_shm_create(name) != 0) {
+        pthread_mutex_unlock(&accessing_registry);
+        return -1;
+    }
+    uint64_t now = rs_history_now();
+    for (lambda_id_t i = 0; i < get_number_of_registered_lambdas(); i++) {
+        rs_registered_lambda *lambda = get_registered_lambda_by_id(i);
+        if (lambda != NULL) {
+            publish_lambda(lambda, ((rs_linux_registered_lambda *) lambda->arg.obj)->data_cached ? now : 0);
+        }
+    }
+    pthread_mutex_unlock(&accessing_registry);
+    spt_log_msg("shm", "Publishing latest results to shared memory object %s\n", name);
+    return 0;
+}
+
+rs_stream *rs_linux_open_stream(const uint8_t *ids, rs_lambda_type_t type) {
+    rs_stream *s = malloc(sizeof(rs_stream));
+    if (s == NULL) {
+        return NULL;
+    }
+    rs_stream_init(s, ids, type);
+    pthread_mutex_lock(&accessing_registry);
+    if (stream_count == RS_MAX_STREAMS) {
+        pthread_mutex_unlock(&accessing_registry);
+        rs_stream_free(s);
+        free(s);
+        return NULL;
+    }
+    streams[stream_count++] = s;
+    pthread_mutex_unlock(&accessing_registry);
+    return s;
+}
+
+void rs_linux_update_stream(rs_stream *s, const uint8_t *ids, rs_lambda_type_t type) {
+    // streams are matched while accessing_registry is held
+    pthread_mutex_lock(&accessing_registry);
+    if (ids == NULL) {
+        memset(s->ids, 0xff, sizeof(s->ids));
+    } else {
+        memcpy(s->ids, ids, sizeof(s->ids));
+    }
+    s->type = type;
+    pthread_mutex_unlock(&accessing_registry);
+}
+
+void rs_linux_close_stream(rs_stream *s) {
+    pthread_mutex_lock(&accessing_registry);
+    for (size_t i = 0; i < stream_count; i++) {
+        if (streams[i] == s) {
+            streams[i] = streams[--stream_count];
+            streams[stream_count] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&accessing_registry);
+    rs_stream_free(s);
+    free(s);
 }
@@ -0,0 +1,390 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_expression.h>
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Operation codes of the stack machine
+ */
+#define OP_CONST 0
+#define OP_INPUT 1
+#define OP_ADD 2
+#define OP_SUB 3
+#define OP_MUL 4
+#define OP_DIV 5
+#define OP_POW 6
+#define OP_NEG 7
+#define OP_ABS 8
+#define OP_SQRT 9
+#define OP_EXP 10
+#define OP_LOG 11
+#define OP_LOG10 12
+#define OP_MIN 13
+#define OP_MAX 14
+
+/**
+ * @brief A function callable from expressions
+ */
+typedef struct {
+    const char *name;
+    uint8_t op;
+    uint8_t arity;
+} expr_function;
+
+static const expr_function functions[] = {
+        {"abs",   OP_ABS,   1},
+        {"sqrt",  OP_SQRT,  1},
+        {"exp",   OP_EXP,   1},
+        {"log",   OP_LOG,   1},
+        {"log10", OP_LOG10, 1},
+        {"min",   OP_MIN,   2},
+        {"max",   OP_MAX,   2},
+        {"pow",   OP_POW,   2},
+};
+
+/**
+ * @brief State of the recursive descent parser
+ */
+typedef struct {
+    const char *source;
+    const char *pos;
+    rs_expr *expr;
+    int8_t error;
+    /** @brief Current and maximum stack depth of the emitted code */
+    int depth;
+    int max_depth;
+    /** @brief Number of parse_unary() calls in progress, bounds the recursion of the parser */
+    int nesting;
+} expr_parser;
+
+static void parse_expr(expr_parser *p);
+
+static void skip_spaces(expr_parser *p) {
+    while (isspace((unsigned char) *p->pos)) {
+        p->pos++;
+    }
+}
+
+static void fail(expr_parser *p, int8_t error) {
+    if (p->error == RS_EXPR_SUCCESS) {
+        p->error = error;
+    }
+}
+
+/**
+ * @brief Append an instruction and track the stack depth it leads to
+ *
+ * @param p Parser
+ * @param op Operation code
+ * @param input Input index (OP_INPUT only)
+ * @param value Constant (OP_CONST only)
+ * @param stack_change Number of values the instruction pushes minus the number it pops
+ */
+static void emit(expr_parser *p, uint8_t op, uint8_t input, double value, int stack_change) {
+    if (p->error != RS_EXPR_SUCCESS) {
+        return;
+    }
+    if (p->expr->code_length >= RS_EXPR_MAX_CODE) {
+        fail(p, RS_EXPR_TOO_COMPLEX);
+        return;
+    }
+    rs_expr_instruction *ins = &p->expr->code[p->expr->code_length++];
+    ins->op = op;
+    ins->input = input;
+    ins->value = value;
+    p->depth += stack_change;
+    if (p->depth > p->max_depth) {
+        p->max_depth = p->depth;
+    }
+}
+
+/**
+ * @brief Get the input index of a lambda name, adding it if not referenced yet
+ */
+static int input_index(expr_parser *p, const char *name, size_t len) {
+    rs_expr *expr = p->expr;
+    for (uint8_t i = 0; i < expr->input_count; i++) {
+        if (strlen(expr->inputs[i]) == len && strncmp(expr->inputs[i], name, len) == 0) {
+            return i;
+        }
+    }
+    if (expr->input_count >= RS_EXPR_MAX_INPUTS) {
+        fail(p, RS_EXPR_TOO_COMPLEX);
+        return -1;
+    }
+    memcpy(expr->inputs[expr->input_count], name, len);
+    expr->inputs[expr->input_count][len] = '\0';
+    return expr->input_count++;
+}
+
+static void parse_call(expr_parser *p, const char *name, size_t len) {
+    const expr_function *fn = NULL;
+    for (size_t i = 0; i < sizeof(functions) / sizeof(functions[0]); i++) {
+        if (strlen(functions[i].name) == len && strncmp(functions[i].name, name, len) == 0) {
+            fn = &functions[i];
+            break;
+        }
+    }
+    if (fn == NULL) {
+        fail(p, RS_EXPR_UNKNOWN_FUNCTION);
+        return;
+    }
+    p->pos++; // '('
+    uint8_t args = 0;
+    for (;;) {
+        parse_expr(p);
+        args++;
+        skip_spaces(p);
+        if (*p->pos == ',') {
+            p->pos++;
+        } else {
+            break;
+        }
+    }
+    if (*p->pos != ')') {
+        fail(p, RS_EXPR_SYNTAX);
+        return;
+    }
+    p->pos++;
+    if (args != fn->arity) {
+        fail(p, RS_EXPR_UNKNOWN_FUNCTION);
+        return;
+    }
+    emit(p, fn->op, 0, 0.0, 1 - fn->arity);
+}
+
+static void parse_primary(expr_parser *p) {
+    skip_spaces(p);
+    char c = *p->pos;
+    if (c == '(') {
+        p->pos++;
+        parse_expr(p);
+        skip_spaces(p);
+        if (*p->pos != ')') {
+            fail(p, RS_EXPR_SYNTAX);
+            return;
+        }
+        p->pos++;
+    } else if (isdigit((unsigned char) c) || c == '.') {
+        char *end;
+        double value = strtod(p->pos, &end);
+        if (end == p->pos) {
+            fail(p, RS_EXPR_SYNTAX);
+            return;
+        }
+        p->pos = end;
+        emit(p, OP_CONST, 0, value, 1);
+    } else if (isalpha((unsigned char) c)) {
+        const char *name = p->pos;
+        while (isalnum((unsigned char) *p->pos)) {
+            p->pos++;
+        }
+        size_t len = (size_t) (p->pos - name);
+        skip_spaces(p);
+        if (*p->pos == '(') {
+            parse_call(p, name, len);
+            return;
+        }
+        if (len > MAX_LAMBDA_NAME_LENGTH) {
+            p->pos = name;
+            fail(p, RS_EXPR_SYNTAX);
+            return;
+        }
+        int index = input_index(p, name, len);
+        if (index >= 0) {
+            emit(p, OP_INPUT, (uint8_t) index, 0.0, 1);
+        }
+    } else {
+        fail(p, RS_EXPR_SYNTAX);
+    }
+}
+
+static void parse_unary(expr_parser *p);
+
+static void parse_power(expr_parser *p) {
+    parse_primary(p);
+    skip_spaces(p);
+    if (*p->pos == '^') {
+        p->pos++;
+        // right associative: a ^ b ^ c = a ^ (b ^ c)
+        parse_unary(p);
+        emit(p, OP_POW, 0, 0.0, -1);
+    }
+}
+
+static void parse_unary(expr_parser *p) {
+    // every recursion of the parser passes through here
+    if (p->error != RS_EXPR_SUCCESS) {
+        return;
+    }
+    if (p->nesting >= RS_EXPR_MAX_NESTING) {
+        fail(p, RS_EXPR_TOO_COMPLEX);
+        return;
+    }
+    p->nesting++;
+    skip_spaces(p);
+    if (*p->pos == '-') {
+        p->pos++;
+        parse_unary(p);
+        emit(p, OP_NEG, 0, 0.0, 0);
+    } else {
+        parse_power(p);
+    }
+    p->nesting--;
+}
+
+static void parse_term(expr_parser *p) {
+    parse_unary(p);
+    for (;;) {
+        skip_spaces(p);
+        char c = *p->pos;
+        if (p->error != RS_EXPR_SUCCESS || (c != '*' && c != '/')) {
+            return;
+        }
+        p->pos++;
+        parse_unary(p);
+        emit(p, c == '*' ? OP_MUL : OP_DIV, 0, 0.0, -1);
+    }
+}
+
+static void parse_expr(expr_parser *p) {
+    parse_term(p);
+    for (;;) {
+        skip_spaces(p);
+        char c = *p->pos;
+        if (p->error != RS_EXPR_SUCCESS || (c != '+' && c != '-')) {
+            return;
+        }
+        p->pos++;
+        parse_term(p);
+        emit(p, c == '+' ? OP_ADD : OP_SUB, 0, 0.0, -1);
+    }
+}
+
+int8_t rs_expr_compile(rs_expr *expr, const char *source, size_t *error_pos) {
+    expr->source = NULL;
+    expr->code_length = 0;
+    expr->input_count = 0;
+    expr_parser p;
+    p.source = source;
+    p.pos = source;
+    p.expr = expr;
+    p.error = RS_EXPR_SUCCESS;
+    p.depth = 0;
+    p.max_depth = 0;
+    p.nesting = 0;
+    parse_expr(&p);
+    skip_spaces(&p);
+    if (p.error == RS_EXPR_SUCCESS && *p.pos != '\0') {
+        p.error = RS_EXPR_SYNTAX;
+    }
+    if (p.error == RS_EXPR_SUCCESS && p.max_depth > RS_EXPR_MAX_STACK) {
+        p.error = RS_EXPR_TOO_COMPLEX;
+    }
+    if (error_pos != NULL) {
+        *error_pos = (size_t) (p.pos - source);
+    }
+    if (p.error != RS_EXPR_SUCCESS) {
+        return p.error;
+    }
+    expr->source = malloc(strlen(source) + 1);
+    if (expr->source == NULL) {
+        return RS_EXPR_NOMEM;
+    }
+    strcpy(expr->source, source);
+    return RS_EXPR_SUCCESS;
+}
+
+int8_t rs_expr_eval(const rs_expr *expr, const double *inputs, double *result) {
+    double stack[RS_EXPR_MAX_STACK];
+    int top = -1;
+    for (uint8_t i = 0; i < expr->code_length; i++) {
+        const rs_expr_instruction *ins = &expr->code[i];
+        switch (ins->op) {
+            case OP_CONST:
+                stack[++top] = ins->value;
+                break;
+            case OP_INPUT:
+                stack[++top] = inputs[ins->input];
+                break;
+            case OP_ADD:
+                top--;
+                stack[top] += stack[top + 1];
+                break;
+            case OP_SUB:
+                top--;
+                stack[top] -= stack[top + 1];
+                break;
+            case OP_MUL:
+                top--;
+                stack[top] *= stack[top + 1];
+                break;
+            case OP_DIV:
+                top--;
+                stack[top] /= stack[top + 1];
+                break;
+            case OP_POW:
+                top--;
+                stack[top] = pow(stack[top], stack[top + 1]);
+                break;
+            case OP_MIN:
+                top--;
+                stack[top] = fmin(stack[top], stack[top + 1]);
+                break;
+            case OP_MAX:
+                top--;
+                stack[top] = fmax(stack[top], stack[top + 1]);
+                break;
+            case OP_NEG:
+                stack[top] = -stack[top];
+                break;
+            case OP_ABS:
+                stack[top] = fabs(stack[top]);
+                break;
+            case OP_SQRT:
+                stack[top] = sqrt(stack[top]);
+                break;
+            case OP_EXP:
+                stack[top] = exp(stack[top]);
+                break;
+            case OP_LOG:
+                stack[top] = log(stack[top]);
+                break;
+            case OP_LOG10:
+                stack[top] = log10(stack[top]);
+                break;
+            default:
+                break;
+        }
+    }
+    if (!isfinite(stack[0])) {
+        return RS_EXPR_NOT_FINITE;
+    }
+    *result = stack[0];
+    return RS_EXPR_SUCCESS;
+}
+
+void rs_expr_free(rs_expr *expr) {
+    free(expr->source);
+    expr->source = NULL;
+    expr->code_length = 0;
+    expr->input_count = 0;
+}
+
+const char *stringify_rs_expr_result(int8_t c) {
+    static const char *strings[] = {"RS_EXPR_SUCCESS", "RS_EXPR_SYNTAX", "RS_EXPR_UNKNOWN_FUNCTION",
+                                    "RS_EXPR_TOO_COMPLEX", "RS_EXPR_NOMEM", "RS_EXPR_NOT_FINITE"};
+    if (c < -5 || c > 0) {
+        return NULL;
+    } else {
+        return strings[-c];
+    }
+}
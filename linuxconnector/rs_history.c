@@ -0,0 +1,346 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_history.h>
+#include <rs_memory.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Capacity of histories initialized from now on
+ */
+static size_t default_capacity = RS_HISTORY_DEFAULT_CAPACITY;
+
+void rs_history_set_default_capacity(size_t capacity) {
+    default_capacity = capacity;
+}
+
+size_t rs_history_get_default_capacity(void) {
+    return default_capacity;
+}
+
+void rs_history_init(rs_history *h) {
+    h->timestamps = NULL;
+    h->values = NULL;
+    h->capacity = default_capacity;
+    h->head = 0;
+    h->count = 0;
+    h->allocated_at = 0;
+    h->last_used = 0;
+    h->suspended = false;
+}
+
+void rs_history_free(rs_history *h) {
+    rs_memory_release(RS_MEMORY_HISTORY, rs_history_bytes(h));
+    free(h->timestamps);
+    free(h->values);
+    h->timestamps = NULL;
+    h->values = NULL;
+    h->head = 0;
+    h->count = 0;
+}
+
+size_t rs_history_bytes(const rs_history *h) {
+    return h->values == NULL ? 0 : h->capacity * (sizeof(uint64_t) + sizeof(double));
+}
+
+size_t rs_history_evict(rs_history *h) {
+    size_t bytes = rs_history_bytes(h);
+    rs_history_free(h);
+    h->suspended = true;
+    return bytes;
+}
+
+void rs_history_touch(rs_history *h) {
+    h->last_used = rs_memory_tick();
+    h->suspended = false;
+}
+
+int8_t rs_history_append(rs_history *h, uint64_t timestamp, double value) {
+    if (h->capacity == 0 || h->suspended) {
+        return RS_QUERY_SUCCESS;
+    }
+    if (h->values == NULL) {
+        size_t bytes = h->capacity * (sizeof(uint64_t) + sizeof(double));
+        if (!rs_memory_reserve(RS_MEMORY_HISTORY, bytes)) {
+            return RS_QUERY_NOMEM;
+        }
+        h->timestamps = malloc(h->capacity * sizeof(uint64_t));
+        h->values = malloc(h->capacity * sizeof(double));
+        if (h->timestamps == NULL || h->values == NULL) {
+            free(h->timestamps);
+            free(h->values);
+            h->timestamps = NULL;
+            h->values = NULL;
+            rs_memory_release(RS_MEMORY_HISTORY, bytes);
+            return RS_QUERY_NOMEM;
+        }
+        h->allocated_at = rs_memory_tick();
+        h->last_used = h->allocated_at;
+    }
+    if (h->count > 0) {
+        uint64_t newest = h->timestamps[(h->head + h->count - 1) % h->capacity];
+        if (timestamp < newest) {
+            timestamp = newest;
+        }
+    }
+    size_t pos;
+    if (h->count < h->capacity) {
+        pos = (h->head + h->count) % h->capacity;
+        h->count++;
+    } else {
+        pos = h->head;
+        h->head = (h->head + 1) % h->capacity;
+    }
+    h->timestamps[pos] = timestamp;
+    h->values[pos] = value;
+    return RS_QUERY_SUCCESS;
+}
+
+/**
+ * @brief Get the timestamp of the sample at a logical (oldest first) index
+ */
+static inline uint64_t timestamp_at(const rs_history *h, size_t i) {
+    return h->timestamps[(h->head + i) % h->capacity];
+}
+
+/**
+ * @brief Binary search for the first logical index whose timestamp is >= ts (strict: > ts)
+ */
+static size_t history_bound(const rs_history *h, uint64_t ts, int strict) {
+    size_t lo = 0;
+    size_t hi = h->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint64_t cur = timestamp_at(h, mid);
+        if (cur < ts || (strict && cur == ts)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int8_t rs_history_query(const rs_history *h, rs_query_op_t op, uint64_t from, uint64_t to, double quantile,
+                        double *result, size_t *count) {
+    if (from > to || (op == RS_QUERY_QUANTILE && !(quantile >= 0.0 && quantile <= 1.0))) {
+        return RS_QUERY_INVALPARAM;
+    }
+    size_t lo = 0;
+    size_t hi = 0;
+    if (h->count > 0) {
+        lo = history_bound(h, from, 0);
+        hi = history_bound(h, to, 1);
+    }
+    size_t n = hi > lo ? hi - lo : 0;
+    if (count != NULL) {
+        *count = n;
+    }
+    // the range is at most split into two contiguous spans by the ring buffer wrap around
+    const double *span1 = NULL;
+    size_t len1 = 0;
+    const double *span2 = NULL;
+    size_t len2 = 0;
+    if (n > 0) {
+        size_t start = (h->head + lo) % h->capacity;
+        span1 = h->values + start;
+        len1 = h->capacity - start < n ? h->capacity - start : n;
+        span2 = h->values;
+        len2 = n - len1;
+    }
+    switch (op) {
+        case RS_QUERY_COUNT:
+            *result = (double) n;
+            return RS_QUERY_SUCCESS;
+        case RS_QUERY_SUM:
+            *result = rs_kernel_sum(span1, len1) + rs_kernel_sum(span2, len2);
+            return RS_QUERY_SUCCESS;
+        default:
+            break;
+    }
+    if (n == 0) {
+        return RS_QUERY_EMPTY;
+    }
+    switch (op) {
+        case RS_QUERY_MIN:
+            *result = rs_kernel_min(span1, len1);
+            if (len2 > 0) {
+                double min2 = rs_kernel_min(span2, len2);
+                *result = min2 < *result ? min2 : *result;
+            }
+            return RS_QUERY_SUCCESS;
+        case RS_QUERY_MAX:
+            *result = rs_kernel_max(span1, len1);
+            if (len2 > 0) {
+                double max2 = rs_kernel_max(span2, len2);
+                *result = max2 > *result ? max2 : *result;
+            }
+            return RS_QUERY_SUCCESS;
+        case RS_QUERY_MEAN:
+            *result = (rs_kernel_sum(span1, len1) + rs_kernel_sum(span2, len2)) / (double) n;
+            return RS_QUERY_SUCCESS;
+        case RS_QUERY_QUANTILE: {
+            double *scratch = malloc(n * sizeof(double));
+            if (scratch == NULL) {
+                return RS_QUERY_NOMEM;
+            }
+            memcpy(scratch, span1, len1 * sizeof(double));
+            memcpy(scratch + len1, span2, len2 * sizeof(double));
+            *result = rs_kernel_quantile(scratch, n, quantile);
+            free(scratch);
+            return RS_QUERY_SUCCESS;
+        }
+        default:
+            return RS_QUERY_INVALPARAM;
+    }
+}
+
+uint64_t rs_history_now(void) {
+    struct timespec spec;
+    clock_gettime(CLOCK_REALTIME, &spec);
+    return (uint64_t) spec.tv_sec * 1000 + (uint64_t) spec.tv_nsec / 1000000;
+}
+
+/*
+ * The kernels use four independent accumulators so that the compiler can keep them in vector registers
+ */
+
+double rs_kernel_sum(const double *restrict values, size_t n) {
+    double acc0 = 0.0, acc1 = 0.0, acc2 = 0.0, acc3 = 0.0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 += values[i];
+        acc1 += values[i + 1];
+        acc2 += values[i + 2];
+        acc3 += values[i + 3];
+    }
+    for (; i < n; i++) {
+        acc0 += values[i];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+double rs_kernel_min(const double *restrict values, size_t n) {
+    double acc0 = values[0], acc1 = values[0], acc2 = values[0], acc3 = values[0];
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = values[i] < acc0 ? values[i] : acc0;
+        acc1 = values[i + 1] < acc1 ? values[i + 1] : acc1;
+        acc2 = values[i + 2] < acc2 ? values[i + 2] : acc2;
+        acc3 = values[i + 3] < acc3 ? values[i + 3] : acc3;
+    }
+    for (; i < n; i++) {
+        acc0 = values[i] < acc0 ? values[i] : acc0;
+    }
+    acc0 = acc1 < acc0 ? acc1 : acc0;
+    acc2 = acc3 < acc2 ? acc3 : acc2;
+    return acc2 < acc0 ? acc2 : acc0;
+}
+
+double rs_kernel_max(const double *restrict values, size_t n) {
+    double acc0 = values[0], acc1 = values[0], acc2 = values[0], acc3 = values[0];
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = values[i] > acc0 ? values[i] : acc0;
+        acc1 = values[i + 1] > acc1 ? values[i + 1] : acc1;
+        acc2 = values[i + 2] > acc2 ? values[i + 2] : acc2;
+        acc3 = values[i + 3] > acc3 ? values[i + 3] : acc3;
+    }
+    for (; i < n; i++) {
+        acc0 = values[i] > acc0 ? values[i] : acc0;
+    }
+    acc0 = acc1 > acc0 ? acc1 : acc0;
+    acc2 = acc3 > acc2 ? acc3 : acc2;
+    return acc2 > acc0 ? acc2 : acc0;
+}
+
+/**
+ * @brief Reorder values so that values[k] is the k-th smallest element, smaller ones before and greater ones after it
+ */
+static void select_kth(double *values, size_t n, size_t k) {
+    size_t left = 0;
+    size_t right = n - 1;
+    while (right > left) {
+        // median of three as pivot
+        size_t mid = left + (right - left) / 2;
+        double a = values[left], b = values[mid], c = values[right];
+        double pivot = (a < b) ? ((b < c) ? b : ((a < c) ? c : a)) : ((a < c) ? a : ((b < c) ? c : b));
+        size_t i = left;
+        size_t j = right;
+        while (i <= j) {
+            while (values[i] < pivot) {
+                i++;
+            }
+            while (values[j] > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                double tmp = values[i];
+                values[i] = values[j];
+                values[j] = tmp;
+                i++;
+                if (j == 0) {
+                    break;
+                }
+                j--;
+            }
+        }
+        if (k <= j) {
+            right = j;
+        } else if (k >= i) {
+            left = i;
+        } else {
+            return;
+        }
+    }
+}
+
+double rs_kernel_quantile(double *values, size_t n, double quantile) {
+    double pos = quantile * (double) (n - 1);
+    size_t k = (size_t) pos;
+    double frac = pos - (double) k;
+    select_kth(values, n, k);
+    double lower = values[k];
+    if (k + 1 >= n || frac <= 0.0) {
+        return lower;
+    }
+    // all elements after k are >= values[k], so the next rank is their minimum
+    double upper = rs_kernel_min(values + k + 1, n - k - 1);
+    return lower + frac * (upper - lower);
+}
+
+rs_query_op_t get_query_op_from_string(const char *str) {
+    static const char *strings[] = {NULL, "count", "sum", "min", "max", "mean", "quantile"};
+    for (rs_query_op_t i = RS_QUERY_COUNT; i <= RS_QUERY_QUANTILE; i++) {
+        if (strcmp(strings[i], str) == 0) {
+            return i;
+        }
+    }
+    return (rs_query_op_t) -1;
+}
+
+const char *stringify_rs_query_op_t(rs_query_op_t c) {
+    static const char *strings[] = {NULL, "RS_QUERY_COUNT", "RS_QUERY_SUM", "RS_QUERY_MIN", "RS_QUERY_MAX",
+                                    "RS_QUERY_MEAN", "RS_QUERY_QUANTILE"};
+    if (c < 1 || c > 6) {
+        return NULL;
+    } else {
+        return strings[c];
+    }
+}
+
+const char *stringify_rs_query_result(int8_t c) {
+    static const char *strings[] = {"RS_QUERY_SUCCESS", "RS_QUERY_NOTFOUND", "RS_QUERY_WRONGTYPE", "RS_QUERY_EMPTY",
+                                    "RS_QUERY_INVALPARAM", "RS_QUERY_NOMEM"};
+    if (c < -5 || c > 0) {
+        return NULL;
+    } else {
+        return strings[-c];
+    }
+}
@@ -0,0 +1,170 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_memory.h>
+
+#include <string.h>
+
+/**
+ * Maximum number of bytes of all categories, 0 for no limit
+ */
+static size_t budget = 0;
+
+/**
+ * Eviction policy used by the reclaimers
+ */
+static rs_evict_policy_t policy = RS_EVICT_LRU;
+
+/**
+ * Bytes used by all categories
+ */
+static size_t used_total = 0;
+
+/**
+ * Counter for rs_memory_tick()
+ */
+static uint64_t ticks = 0;
+
+static rs_memory_usage usages[RS_MEMORY_CATEGORIES];
+
+static rs_memory_reclaimer reclaimers[RS_MEMORY_CATEGORIES];
+
+void rs_memory_set_budget(size_t bytes) {
+    __atomic_store_n(&budget, bytes, __ATOMIC_RELAXED);
+}
+
+size_t rs_memory_get_budget(void) {
+    return __atomic_load_n(&budget, __ATOMIC_RELAXED);
+}
+
+void rs_memory_set_policy(rs_evict_policy_t p) {
+    __atomic_store_n(&policy, p, __ATOMIC_RELAXED);
+}
+
+rs_evict_policy_t rs_memory_get_policy(void) {
+    return __atomic_load_n(&policy, __ATOMIC_RELAXED);
+}
+
+void rs_memory_set_reclaimer(rs_memory_category_t category, rs_memory_reclaimer reclaimer) {
+    __atomic_store_n(&reclaimers[category], reclaimer, __ATOMIC_RELEASE);
+}
+
+bool rs_memory_try_reserve(rs_memory_category_t category, size_t bytes) {
+    size_t limit = rs_memory_get_budget();
+    size_t used = __atomic_load_n(&used_total, __ATOMIC_RELAXED);
+    do {
+        if (limit != 0 && used + bytes > limit) {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&used_total, &used, used + bytes, true, __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+    __atomic_add_fetch(&usages[category].bytes, bytes, __ATOMIC_RELAXED);
+    return true;
+}
+
+/**
+ * @brief Run the reclaimers of all categories up to the given one until the bytes fit into the budget
+ *
+ * Nothing is evicted if the bytes would not fit even after evicting everything these categories hold.
+ */
+static void reclaim(rs_memory_category_t category, size_t bytes) {
+    size_t limit = rs_memory_get_budget();
+    if (limit == 0) {
+        return;
+    }
+    size_t reclaimable = 0;
+    for (rs_memory_category_t c = 0; c <= category; c++) {
+        if (__atomic_load_n(&reclaimers[c], __ATOMIC_ACQUIRE) != NULL) {
+            reclaimable += __atomic_load_n(&usages[c].bytes, __ATOMIC_RELAXED);
+        }
+    }
+    if (__atomic_load_n(&used_total, __ATOMIC_RELAXED) - reclaimable + bytes > limit) {
+        return;
+    }
+    for (rs_memory_category_t c = 0; c <= category; c++) {
+        size_t used = __atomic_load_n(&used_total, __ATOMIC_RELAXED);
+        if (used + bytes <= limit) {
+            return;
+        }
+        rs_memory_reclaimer reclaimer = __atomic_load_n(&reclaimers[c], __ATOMIC_ACQUIRE);
+        if (reclaimer != NULL) {
+            reclaimer(used + bytes - limit);
+        }
+    }
+}
+
+bool rs_memory_reserve(rs_memory_category_t category, size_t bytes) {
+    if (rs_memory_try_reserve(category, bytes)) {
+        return true;
+    }
+    reclaim(category, bytes);
+    if (rs_memory_try_reserve(category, bytes)) {
+        return true;
+    }
+    __atomic_add_fetch(&usages[category].refused, 1, __ATOMIC_RELAXED);
+    return false;
+}
+
+void rs_memory_account(rs_memory_category_t category, size_t bytes) {
+    if (rs_memory_try_reserve(category, bytes)) {
+        return;
+    }
+    reclaim(category, bytes);
+    __atomic_add_fetch(&used_total, bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&usages[category].bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void rs_memory_release(rs_memory_category_t category, size_t bytes) {
+    __atomic_sub_fetch(&used_total, bytes, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&usages[category].bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void rs_memory_count_eviction(rs_memory_category_t category, size_t bytes) {
+    __atomic_add_fetch(&usages[category].evictions, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&usages[category].evicted_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void rs_memory_get_usage(rs_memory_category_t category, rs_memory_usage *usage) {
+    usage->bytes = __atomic_load_n(&usages[category].bytes, __ATOMIC_RELAXED);
+    usage->evictions = __atomic_load_n(&usages[category].evictions, __ATOMIC_RELAXED);
+    usage->evicted_bytes = __atomic_load_n(&usages[category].evicted_bytes, __ATOMIC_RELAXED);
+    usage->refused = __atomic_load_n(&usages[category].refused, __ATOMIC_RELAXED);
+}
+
+size_t rs_memory_get_used(void) {
+    return __atomic_load_n(&used_total, __ATOMIC_RELAXED);
+}
+
+uint64_t rs_memory_tick(void) {
+    return __atomic_add_fetch(&ticks, 1, __ATOMIC_RELAXED);
+}
+
+rs_evict_policy_t get_evict_policy_from_string(const char *str) {
+    if (strcmp(str, "lru") == 0) {
+        return RS_EVICT_LRU;
+    } else if (strcmp(str, "oldest") == 0) {
+        return RS_EVICT_OLDEST;
+    }
+    return (rs_evict_policy_t) -1;
+}
+
+const char *stringify_rs_evict_policy_t(rs_evict_policy_t c) {
+    static const char *strings[] = {NULL, "RS_EVICT_LRU", "RS_EVICT_OLDEST"};
+    if (c < 1 || c > 2) {
+        return NULL;
+    } else {
+        return strings[c];
+    }
+}
+
+const char *stringify_rs_memory_category_t(rs_memory_category_t c) {
+    static const char *strings[] = {"RS_MEMORY_RESPONSES", "RS_MEMORY_HISTORY", "RS_MEMORY_STRINGS"};
+    if (c >= RS_MEMORY_CATEGORIES) {
+        return NULL;
+    } else {
+        return strings[c];
+    }
+}
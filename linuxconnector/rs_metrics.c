@@ -0,0 +1,184 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_metrics.h>
+
+#include <time.h>
+
+/**
+ * Counters of a lambda, padded to cache lines of their own
+ */
+typedef struct {
+    rs_lambda_metrics counters;
+} __attribute__((aligned(RS_CACHE_LINE))) padded_lambda_metrics;
+
+/**
+ * Outcome counters of a cache policy, padded to a cache line of their own
+ */
+typedef struct {
+    uint64_t outcomes[RS_METRICS_CACHE_OUTCOMES];
+} __attribute__((aligned(RS_CACHE_LINE))) padded_cache_metrics;
+
+static padded_lambda_metrics lambdas[MAX_LAMBDAS];
+
+/**
+ * Round-trip time histograms, the size of a histogram is a multiple of the cache line size
+ */
+static uint64_t rtt_histograms[MAX_LAMBDAS][RS_METRICS_RTT_BUCKETS] __attribute__((aligned(RS_CACHE_LINE)));
+
+/**
+ * Indexed by the RS_CACHE_* policy
+ */
+static padded_cache_metrics cache_lookups[RS_CACHE_ON_TIMEOUT + 1];
+
+/**
+ * Calls of unknown lambdas and error codes of the device, indexed by the code reinterpreted as unsigned
+ */
+static uint64_t codes[UINT8_MAX + 1] __attribute__((aligned(RS_CACHE_LINE)));
+
+static void add(uint64_t *counter, uint64_t value) {
+    __atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+}
+
+static uint64_t load(const uint64_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+uint64_t rs_metrics_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + (uint64_t) now.tv_nsec / 1000 + 1;
+}
+
+void rs_metrics_reset_lambda(lambda_id_t id) {
+    uint64_t *counters = (uint64_t *) &lambdas[id].counters;
+    for (size_t i = 0; i < sizeof(rs_lambda_metrics) / sizeof(uint64_t); i++) {
+        __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+    }
+    for (size_t i = 0; i < RS_METRICS_RTT_BUCKETS; i++) {
+        __atomic_store_n(&rtt_histograms[id][i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+void rs_metrics_count_call(lambda_id_t id, int8_t code) {
+    if (id >= MAX_LAMBDAS) {
+        add(&codes[(uint8_t) code], 1);
+        return;
+    }
+    add(&lambdas[id].counters.calls, 1);
+    if (code >= RS_CALL_OVERLOAD && code <= RS_CALL_CACHE_TIMEOUT) {
+        // counted on the cache lines of the lambda, so callers of different lambdas do not share a line
+        add(&lambdas[id].counters.results[code - RS_CALL_OVERLOAD], 1);
+    } else {
+        add(&codes[(uint8_t) code], 1);
+    }
+}
+
+void rs_metrics_count_sent(lambda_id_t id) {
+    add(&lambdas[id].counters.sent, 1);
+}
+
+void rs_metrics_count_received(lambda_id_t id) {
+    add(&lambdas[id].counters.received, 1);
+}
+
+void rs_metrics_count_timeout(lambda_id_t id) {
+    add(&lambdas[id].counters.timeouts, 1);
+}
+
+void rs_metrics_count_cache(rs_cache_type_t policy, uint8_t outcome) {
+    if (policy <= RS_CACHE_ON_TIMEOUT && outcome < RS_METRICS_CACHE_OUTCOMES) {
+        add(&cache_lookups[policy].outcomes[outcome], 1);
+    }
+}
+
+void rs_metrics_record_rtt(lambda_id_t id, uint64_t micros) {
+    add(&rtt_histograms[id][rs_metrics_rtt_bucket(micros)], 1);
+    add(&lambdas[id].counters.rtt_count, 1);
+    add(&lambdas[id].counters.rtt_sum, micros);
+}
+
+void rs_metrics_get_lambda(lambda_id_t id, rs_lambda_metrics *metrics) {
+    const rs_lambda_metrics *m = &lambdas[id].counters;
+    metrics->calls = load(&m->calls);
+    metrics->sent = load(&m->sent);
+    metrics->received = load(&m->received);
+    metrics->timeouts = load(&m->timeouts);
+    metrics->rtt_count = load(&m->rtt_count);
+    metrics->rtt_sum = load(&m->rtt_sum);
+    for (size_t i = 0; i < RS_METRICS_CALL_RESULTS; i++) {
+        metrics->results[i] = load(&m->results[i]);
+    }
+}
+
+void rs_metrics_get_rtt_histogram(lambda_id_t id, uint64_t *buckets) {
+    for (size_t i = 0; i < RS_METRICS_RTT_BUCKETS; i++) {
+        buckets[i] = load(&rtt_histograms[id][i]);
+    }
+}
+
+uint64_t rs_metrics_get_cache(rs_cache_type_t policy, uint8_t outcome) {
+    if (policy > RS_CACHE_ON_TIMEOUT || outcome >= RS_METRICS_CACHE_OUTCOMES) {
+        return 0;
+    }
+    return load(&cache_lookups[policy].outcomes[outcome]);
+}
+
+uint64_t rs_metrics_get_code(int8_t code) {
+    uint64_t count = load(&codes[(uint8_t) code]);
+    if (code >= RS_CALL_OVERLOAD && code <= RS_CALL_CACHE_TIMEOUT) {
+        for (lambda_id_t id = 0; id < MAX_LAMBDAS; id++) {
+            count += load(&lambdas[id].counters.results[code - RS_CALL_OVERLOAD]);
+        }
+    }
+    return count;
+}
+
+size_t rs_metrics_rtt_bucket(uint64_t micros) {
+    if (micros < RS_METRICS_RTT_SUB_BUCKETS) {
+        return (size_t) micros;
+    }
+    int msb = 63 - __builtin_clzll(micros);
+    if (msb >= RS_METRICS_RTT_MAX_BITS) {
+        return RS_METRICS_RTT_BUCKETS - 1;
+    }
+    // the sub bucket keeps the RS_METRICS_RTT_SUB_BITS bits below the most significant one
+    int shift = msb - RS_METRICS_RTT_SUB_BITS;
+    return (size_t) (shift + 1) * RS_METRICS_RTT_SUB_BUCKETS + (size_t) (micros >> shift) -
+           RS_METRICS_RTT_SUB_BUCKETS;
+}
+
+uint64_t rs_metrics_rtt_bucket_limit(size_t bucket) {
+    if (bucket < RS_METRICS_RTT_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = (int) (bucket / RS_METRICS_RTT_SUB_BUCKETS) - 1;
+    uint64_t sub = bucket % RS_METRICS_RTT_SUB_BUCKETS + RS_METRICS_RTT_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+uint64_t rs_metrics_rtt_quantile(const uint64_t *buckets, double quantile) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < RS_METRICS_RTT_BUCKETS; i++) {
+        total += buckets[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    // rank of the quantile, at least the first value
+    uint64_t rank = (uint64_t) (quantile * (double) total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < RS_METRICS_RTT_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return rs_metrics_rtt_bucket_limit(i);
+        }
+    }
+    return rs_metrics_rtt_bucket_limit(RS_METRICS_RTT_BUCKETS - 1);
+}
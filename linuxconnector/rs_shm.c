@@ -0,0 +1,92 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_shm.h>
+
+#include <limits.h>
+#include <stddef.h>
+
+#include <rs_constants.h>
+
+/*
+ * The reader header must not depend on the protocol headers, so its copies of the limits are checked here
+ */
+typedef char rs_shm_check_slots[RS_SHM_SLOTS == MAX_LAMBDAS ? 1 : -1];
+typedef char rs_shm_check_name[RS_SHM_NAME_LENGTH == MAX_LAMBDA_NAME_LENGTH ? 1 : -1];
+typedef char rs_shm_check_slot_size[sizeof(rs_shm_slot) == 128 ? 1 : -1];
+
+/**
+ * Mapped table, NULL if not created
+ */
+static rs_shm_table *table = NULL;
+
+/**
+ * Name of the shared memory object
+ */
+static char table_name[NAME_MAX];
+
+int rs_shm_create(const char *name) {
+    if (strlen(name) >= sizeof(table_name)) {
+        return -1;
+    }
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, sizeof(rs_shm_table)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    void *mem = mmap(NULL, sizeof(rs_shm_table), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        shm_unlink(name);
+        return -1;
+    }
+    rs_shm_table *t = mem;
+    // ftruncate zeroed the object, so all slots are empty with an even sequence number
+    t->layout_version = RS_SHM_LAYOUT_VERSION;
+    t->slot_count = RS_SHM_SLOTS;
+    t->slot_size = sizeof(rs_shm_slot);
+    // readers check the magic number last
+    __atomic_store_n(&t->magic, RS_SHM_MAGIC, __ATOMIC_RELEASE);
+    strcpy(table_name, name);
+    table = t;
+    return 0;
+}
+
+void rs_shm_destroy(void) {
+    if (table == NULL) {
+        return;
+    }
+    munmap(table, sizeof(rs_shm_table));
+    shm_unlink(table_name);
+    table = NULL;
+}
+
+bool rs_shm_enabled(void) {
+    return table != NULL;
+}
+
+void rs_shm_write(uint8_t id, const rs_shm_slot *contents) {
+    if (table == NULL || id >= RS_SHM_SLOTS) {
+        return;
+    }
+    rs_shm_slot *slot = &table->slots[id];
+    uint32_t seq = slot->seq;
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((char *) slot + sizeof(slot->seq), (const char *) contents + sizeof(contents->seq),
+           sizeof(rs_shm_slot) - sizeof(slot->seq));
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void rs_shm_clear(uint8_t id) {
+    rs_shm_slot empty;
+    memset(&empty, 0, sizeof(empty));
+    rs_shm_write(id, &empty);
+}
@@ -0,0 +1,175 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_stream.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+void rs_stream_init(rs_stream *s, const uint8_t *ids, rs_lambda_type_t type) {
+    if (ids == NULL) {
+        memset(s->ids, 0xff, sizeof(s->ids));
+    } else {
+        memcpy(s->ids, ids, sizeof(s->ids));
+    }
+    s->type = type;
+    s->head = 0;
+    s->count = 0;
+    for (size_t i = 0; i < MAX_LAMBDAS; i++) {
+        s->pending[i] = -1;
+    }
+    s->coalesced = 0;
+    s->dropped = 0;
+    s->closed = false;
+    s->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->added, NULL);
+}
+
+void rs_stream_free(rs_stream *s) {
+    for (size_t i = 0; i < s->count; i++) {
+        rs_stream_update_free(&s->updates[(s->head + i) % RS_STREAM_QUEUE_CAPACITY]);
+    }
+    s->count = 0;
+    if (s->notify_fd >= 0) {
+        close(s->notify_fd);
+        s->notify_fd = -1;
+    }
+    pthread_cond_destroy(&s->added);
+    pthread_mutex_destroy(&s->lock);
+}
+
+bool rs_stream_matches(const rs_stream *s, lambda_id_t id, rs_lambda_type_t type) {
+    if (s->type != 0 && s->type != type) {
+        return false;
+    }
+    return (s->ids[id / 8] & (1 << (id % 8))) != 0;
+}
+
+/**
+ * @brief Copy an update into a queue slot, duplicating a string result
+ *
+ * @param dest Queue slot
+ * @param src Update
+ */
+static void copy_update(rs_stream_update *dest, const rs_stream_update *src) {
+    *dest = *src;
+    if (src->type == RS_LAMBDA_STRING) {
+        dest->value.ret_s = strdup(src->value.ret_s);
+    }
+}
+
+/**
+ * @brief Make the file descriptor of a stream readable
+ *
+ * @param s Stream
+ */
+static void signal_fd(rs_stream *s) {
+    if (s->notify_fd >= 0) {
+        uint64_t one = 1;
+        // only fails if the counter would overflow, it is readable then anyway
+        ssize_t res = write(s->notify_fd, &one, sizeof(one));
+        (void) res;
+    }
+}
+
+void rs_stream_push(rs_stream *s, const rs_stream_update *update) {
+    pthread_mutex_lock(&s->lock);
+    if (s->count == 0) {
+        // readers of the file descriptor take all updates, so it is signalled once per batch
+        signal_fd(s);
+    }
+    int16_t queued = s->pending[update->id];
+    if (queued >= 0) {
+        // latest value wins, the update keeps its position in the queue
+        rs_stream_update_free(&s->updates[queued]);
+        copy_update(&s->updates[queued], update);
+        s->coalesced++;
+    } else {
+        if (s->count == RS_STREAM_QUEUE_CAPACITY) {
+            rs_stream_update *oldest = &s->updates[s->head];
+            s->pending[oldest->id] = -1;
+            rs_stream_update_free(oldest);
+            s->head = (s->head + 1) % RS_STREAM_QUEUE_CAPACITY;
+            s->count--;
+            s->dropped++;
+        }
+        size_t index = (s->head + s->count) % RS_STREAM_QUEUE_CAPACITY;
+        copy_update(&s->updates[index], update);
+        s->pending[update->id] = (int16_t) index;
+        s->count++;
+    }
+    pthread_cond_signal(&s->added);
+    pthread_mutex_unlock(&s->lock);
+}
+
+size_t rs_stream_read(rs_stream *s, rs_stream_update *updates, size_t max, uint32_t wait_ms) {
+    pthread_mutex_lock(&s->lock);
+    if (wait_ms > 0 && s->count == 0 && !s->closed) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += wait_ms / 1000;
+        deadline.tv_nsec += (long) (wait_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while (s->count == 0 && !s->closed) {
+            if (pthread_cond_timedwait(&s->added, &s->lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+    }
+    size_t count = 0;
+    if (!s->closed) {
+        for (; count < s->count && count < max; count++) {
+            updates[count] = s->updates[s->head];
+            s->pending[updates[count].id] = -1;
+            s->head = (s->head + 1) % RS_STREAM_QUEUE_CAPACITY;
+        }
+        s->count -= count;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return count;
+}
+
+void rs_stream_close(rs_stream *s) {
+    pthread_mutex_lock(&s->lock);
+    s->closed = true;
+    signal_fd(s);
+    pthread_cond_broadcast(&s->added);
+    pthread_mutex_unlock(&s->lock);
+}
+
+int rs_stream_fd(const rs_stream *s) {
+    return s->notify_fd;
+}
+
+void rs_stream_clear_fd(rs_stream *s) {
+    if (s->notify_fd >= 0) {
+        uint64_t value;
+        ssize_t res = read(s->notify_fd, &value, sizeof(value));
+        (void) res;
+    }
+}
+
+bool rs_stream_closed(rs_stream *s) {
+    pthread_mutex_lock(&s->lock);
+    bool closed = s->closed;
+    pthread_mutex_unlock(&s->lock);
+    return closed;
+}
+
+void rs_stream_update_free(rs_stream_update *update) {
+    if (update->type == RS_LAMBDA_STRING) {
+        free(update->value.ret_s);
+        update->value.ret_s = NULL;
+    }
+}
@@ -0,0 +1,253 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_trigger.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/**
+ * @brief Copy a name terminated by delimiter, checking the length and that it is alphanumeric
+ *
+ * @param dest Where to store the name
+ * @param max_length Maximum length of the name
+ * @param src Start of the name
+ * @param delimiter Character after the name
+ * @return Pointer to the delimiter or NULL if the name is invalid
+ */
+static const char *parse_name(char *dest, size_t max_length, const char *src, char delimiter) {
+    const char *end = strchr(src, delimiter);
+    if (end == NULL || end == src || (size_t) (end - src) > max_length) {
+        return NULL;
+    }
+    for (const char *c = src; c < end; c++) {
+        if (!isalnum((unsigned char) *c) && *c != '_') {
+            return NULL;
+        }
+    }
+    memcpy(dest, src, (size_t) (end - src));
+    dest[end - src] = '\0';
+    return end;
+}
+
+/**
+ * @brief Parse a number followed by delimiter
+ *
+ * @param src Start of the number
+ * @param value Where to store the number
+ * @param delimiter Character after the number
+ * @return Pointer to the delimiter or NULL if the number is invalid
+ */
+static const char *parse_number(const char *src, double *value, char delimiter) {
+    char *end;
+    *value = strtod(src, &end);
+    if (end == src || *end != delimiter || !isfinite(*value)) {
+        return NULL;
+    }
+    return end;
+}
+
+int8_t rs_trigger_parse(rs_trigger *t, const char *definition) {
+    memset(t, 0, sizeof(rs_trigger));
+    const char *pos = parse_name(t->name, RS_TRIGGER_NAME_LENGTH, definition, '=');
+    if (pos == NULL) {
+        return RS_TRIGGER_INVALNAME;
+    }
+    pos = parse_name(t->lambda, MAX_LAMBDA_NAME_LENGTH, pos + 1, ':');
+    if (pos == NULL) {
+        return RS_TRIGGER_SYNTAX;
+    }
+    pos++;
+    if (strncmp(pos, "above:", 6) == 0) {
+        t->kind = RS_TRIGGER_ABOVE;
+        pos = parse_number(pos + 6, &t->high, '\0');
+    } else if (strncmp(pos, "below:", 6) == 0) {
+        t->kind = RS_TRIGGER_BELOW;
+        pos = parse_number(pos + 6, &t->low, '\0');
+    } else if (strncmp(pos, "rate:", 5) == 0) {
+        t->kind = RS_TRIGGER_RATE;
+        pos = parse_number(pos + 5, &t->high, '\0');
+        if (pos != NULL && t->high < 0) {
+            return RS_TRIGGER_SYNTAX;
+        }
+    } else if (strncmp(pos, "hysteresis:", 11) == 0) {
+        t->kind = RS_TRIGGER_HYSTERESIS;
+        pos = parse_number(pos + 11, &t->low, ':');
+        if (pos != NULL) {
+            pos = parse_number(pos + 1, &t->high, '\0');
+        }
+        if (pos != NULL && t->low > t->high) {
+            return RS_TRIGGER_SYNTAX;
+        }
+    } else {
+        return RS_TRIGGER_SYNTAX;
+    }
+    return pos == NULL ? RS_TRIGGER_SYNTAX : RS_TRIGGER_SUCCESS;
+}
+
+bool rs_trigger_evaluate(rs_trigger *t, uint64_t timestamp, double value, rs_trigger_event *event) {
+    bool fire = false;
+    event->value = value;
+    event->active = true;
+    switch (t->kind) {
+        case RS_TRIGGER_ABOVE:
+            fire = value > t->high && !t->active;
+            t->active = value > t->high;
+            break;
+        case RS_TRIGGER_BELOW:
+            fire = value < t->low && !t->active;
+            t->active = value < t->low;
+            break;
+        case RS_TRIGGER_RATE:
+            if (t->has_last && timestamp > t->last_timestamp) {
+                double rate = (value - t->last_value) * 1000.0 / (double) (timestamp - t->last_timestamp);
+                bool exceeded = fabs(rate) > t->high;
+                fire = exceeded && !t->active;
+                t->active = exceeded;
+                event->value = rate;
+            }
+            if (!t->has_last || timestamp > t->last_timestamp) {
+                t->has_last = true;
+                t->last_value = value;
+                t->last_timestamp = timestamp;
+            }
+            break;
+        case RS_TRIGGER_HYSTERESIS:
+            if (!t->active && value >= t->high) {
+                t->active = true;
+                fire = true;
+            } else if (t->active && value <= t->low) {
+                t->active = false;
+                fire = true;
+                event->active = false;
+            }
+            break;
+        default:
+            break;
+    }
+    if (fire) {
+        event->seq = 0;
+        event->timestamp = timestamp;
+        strcpy(event->trigger, t->name);
+        strcpy(event->lambda, t->lambda);
+        event->kind = t->kind;
+    }
+    return fire;
+}
+
+void rs_event_queue_init(rs_event_queue *q) {
+    q->next_seq = 1;
+    q->dropped = 0;
+    q->notify_fd = -1;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->added, NULL);
+}
+
+void rs_event_queue_free(rs_event_queue *q) {
+    if (q->notify_fd >= 0) {
+        close(q->notify_fd);
+        q->notify_fd = -1;
+    }
+    pthread_cond_destroy(&q->added);
+    pthread_mutex_destroy(&q->lock);
+}
+
+void rs_event_queue_push(rs_event_queue *q, rs_trigger_event *event) {
+    pthread_mutex_lock(&q->lock);
+    if (q->next_seq > RS_EVENT_QUEUE_CAPACITY) {
+        q->dropped++;
+    }
+    event->seq = q->next_seq++;
+    q->events[event->seq % RS_EVENT_QUEUE_CAPACITY] = *event;
+    pthread_cond_broadcast(&q->added);
+    if (q->notify_fd >= 0) {
+        uint64_t one = 1;
+        // only fails if the counter would overflow, it is readable then anyway
+        ssize_t res = write(q->notify_fd, &one, sizeof(one));
+        (void) res;
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+size_t rs_event_queue_read(rs_event_queue *q, uint64_t after, rs_trigger_event *events, size_t max,
+                           uint32_t wait_ms) {
+    pthread_mutex_lock(&q->lock);
+    if (wait_ms > 0 && q->next_seq - 1 <= after) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += wait_ms / 1000;
+        deadline.tv_nsec += (long) (wait_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while (q->next_seq - 1 <= after) {
+            if (pthread_cond_timedwait(&q->added, &q->lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+    }
+    uint64_t oldest = q->next_seq > RS_EVENT_QUEUE_CAPACITY ? q->next_seq - RS_EVENT_QUEUE_CAPACITY : 1;
+    uint64_t seq = after + 1 > oldest ? after + 1 : oldest;
+    size_t count = 0;
+    for (; seq < q->next_seq && count < max; seq++) {
+        events[count++] = q->events[seq % RS_EVENT_QUEUE_CAPACITY];
+    }
+    pthread_mutex_unlock(&q->lock);
+    return count;
+}
+
+int rs_event_queue_fd(rs_event_queue *q) {
+    pthread_mutex_lock(&q->lock);
+    if (q->notify_fd < 0) {
+        q->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    int fd = q->notify_fd;
+    pthread_mutex_unlock(&q->lock);
+    return fd;
+}
+
+void rs_event_queue_clear_fd(rs_event_queue *q) {
+    pthread_mutex_lock(&q->lock);
+    if (q->notify_fd >= 0) {
+        uint64_t value;
+        ssize_t res = read(q->notify_fd, &value, sizeof(value));
+        (void) res;
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+uint64_t rs_event_queue_dropped(rs_event_queue *q) {
+    pthread_mutex_lock(&q->lock);
+    uint64_t dropped = q->dropped;
+    pthread_mutex_unlock(&q->lock);
+    return dropped;
+}
+
+const char *stringify_rs_trigger_kind_t(rs_trigger_kind_t c) {
+    static const char *strings[] = {NULL, "above", "below", "rate", "hysteresis"};
+    if (c < 1 || c > 4) {
+        return NULL;
+    } else {
+        return strings[c];
+    }
+}
+
+const char *stringify_rs_trigger_result(int8_t c) {
+    static const char *strings[] = {"RS_TRIGGER_SUCCESS", "RS_TRIGGER_SYNTAX", "RS_TRIGGER_INVALNAME",
+                                    "RS_TRIGGER_DUPLICATE", "RS_TRIGGER_NOMEM", "RS_TRIGGER_LIMIT_REACHED"};
+    if (c < -5 || c > 0) {
+        return NULL;
+    } else {
+        return strings[-c];
+    }
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <rs_admission.h>
+
+static void set_limits(uint32_t lambda_calls, uint32_t device_calls, uint32_t bytes_per_second,
+                       uint32_t burst_bytes) {
+    rs_admission_limits limits = {lambda_calls, device_calls, bytes_per_second, burst_bytes};
+    rs_admission_set_limits(&limits);
+}
+
+static void reset_limits() {
+    set_limits(RS_ADMISSION_DEFAULT_LAMBDA_CALLS, RS_ADMISSION_DEFAULT_DEVICE_CALLS, 0, 0);
+}
+
+TEST(rs_admission, concurrency_limits) {
+    set_limits(2, 3, 0, 0);
+    uint64_t lambda_rejections = rs_admission_count(RS_ADMISSION_LAMBDA_LIMIT);
+    uint64_t device_rejections = rs_admission_count(RS_ADMISSION_DEVICE_LIMIT);
+    ASSERT_EQ(rs_admission_acquire(1, 10), RS_ADMISSION_ADMITTED);
+    ASSERT_EQ(rs_admission_acquire(1, 10), RS_ADMISSION_ADMITTED);
+    ASSERT_EQ(rs_admission_acquire(1, 10), RS_ADMISSION_LAMBDA_LIMIT);
+    ASSERT_EQ(rs_admission_acquire(2, 10), RS_ADMISSION_ADMITTED);
+    ASSERT_EQ(rs_admission_acquire(3, 10), RS_ADMISSION_DEVICE_LIMIT);
+    ASSERT_EQ(rs_admission_in_flight(1), 2u);
+    ASSERT_EQ(rs_admission_in_flight(MAX_LAMBDAS), 3u);
+    ASSERT_EQ(rs_admission_retry_after(), 1u);
+    rs_admission_release(1);
+    ASSERT_EQ(rs_admission_acquire(3, 10), RS_ADMISSION_ADMITTED);
+    rs_admission_release(1);
+    rs_admission_release(2);
+    rs_admission_release(3);
+    // releasing more than was admitted does not underflow
+    rs_admission_release(3);
+    ASSERT_EQ(rs_admission_in_flight(MAX_LAMBDAS), 0u);
+    ASSERT_EQ(rs_admission_count(RS_ADMISSION_LAMBDA_LIMIT), lambda_rejections + 1);
+    ASSERT_EQ(rs_admission_count(RS_ADMISSION_DEVICE_LIMIT), device_rejections + 1);
+    ASSERT_EQ(rs_admission_count(RS_ADMISSION_OUTCOMES), 0u);
+    // 0 disables the limits
+    set_limits(0, 0, 0, 0);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(rs_admission_acquire(1, 10), RS_ADMISSION_ADMITTED);
+    }
+    for (int i = 0; i < 100; i++) {
+        rs_admission_release(1);
+    }
+    reset_limits();
+}
+
+TEST(rs_admission, token_bucket) {
+    // 1000 bytes per second with room for two calls of 40 bytes
+    set_limits(0, 0, 1000, 80);
+    ASSERT_EQ(rs_admission_acquire(1, 40), RS_ADMISSION_ADMITTED);
+    ASSERT_EQ(rs_admission_acquire(1, 40), RS_ADMISSION_ADMITTED);
+    ASSERT_EQ(rs_admission_acquire(1, 40), RS_ADMISSION_RATE_LIMIT);
+    ASSERT_EQ(rs_admission_retry_after(), 1u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    ASSERT_EQ(rs_admission_acquire(1, 40), RS_ADMISSION_ADMITTED);
+    for (int i = 0; i < 3; i++) {
+        rs_admission_release(1);
+    }
+    // a call larger than the burst is still admitted once the bucket refilled
+    set_limits(0, 0, 100, 10);
+    ASSERT_EQ(rs_admission_acquire(1, 50), RS_ADMISSION_RATE_LIMIT);
+    set_limits(0, 0, 10, 10);
+    ASSERT_EQ(rs_admission_acquire(1, 50), RS_ADMISSION_RATE_LIMIT);
+    // 40 missing bytes at 10 bytes per second
+    ASSERT_EQ(rs_admission_retry_after(), 4u);
+    reset_limits();
+}
+
+TEST(rs_admission, call_bytes) {
+    ASSERT_EQ(rs_admission_call_bytes(RS_LAMBDA_INT, false),
+              sizeof(rs_packet_call_by_id_t) + sizeof(rs_packet_lambda_result_int_t));
+    ASSERT_GT(rs_admission_call_bytes(RS_LAMBDA_INT, true), rs_admission_call_bytes(RS_LAMBDA_INT, false));
+    ASSERT_GT(rs_admission_call_bytes(RS_LAMBDA_STRING, false), rs_admission_call_bytes(RS_LAMBDA_INT, false));
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <rs_connector.h>
 #include <lambda_registry.h>
 
@@ -87,4 +90,671 @@ TEST(rs_connector, handle_result) {
     ASSERT_EQ(arg->last_call_error, 0);
     ASSERT_EQ(arg->ret.ret_i, 42);
     free_lambda_registry();
-}
\ No newline at end of file
+}
+TEST(rs_connector, history_query) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_NO_CACHE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "kram", 5);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    init_lambda_registry();
+    handle_received_packet(&sptctx, &pkt);
+    ASSERT_NE(get_registered_lambda_by_name("kram"), (void *) NULL);
+    rs_packet_lambda_result_int_t a2;
+    a2.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    a2.result_base.lambda_id = get_registered_lambda_by_name("kram")->id;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &a2;
+    pkt2.len = sizeof(a2);
+    for (rs_int_t i = 1; i <= 10; i++) {
+        a2.result = i;
+        handle_received_packet(&sptctx, &pkt2);
+    }
+    double result;
+    size_t count;
+    ASSERT_EQ(query_lambda_history_by_name("kram", RS_QUERY_MAX, 0, UINT64_MAX, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(count, 10u);
+    ASSERT_EQ(result, 10.0);
+    ASSERT_EQ(query_lambda_history_by_id(a2.result_base.lambda_id, RS_QUERY_SUM, 0, UINT64_MAX, 0, &result, &count),
+              RS_QUERY_SUCCESS);
+    ASSERT_EQ(result, 55.0);
+    ASSERT_EQ(query_lambda_history_by_name("nothere", RS_QUERY_MAX, 0, UINT64_MAX, 0, &result, &count),
+              RS_QUERY_NOTFOUND);
+    free_lambda_registry();
+}
+
+TEST(rs_connector, versions) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_CALL_ONCE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "kram", 5);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    init_lambda_registry();
+    uint32_t registry_version = rs_linux_get_registry_version();
+    uint32_t values_version = rs_linux_get_values_version();
+    handle_received_packet(&sptctx, &pkt);
+    ASSERT_NE(rs_linux_get_registry_version(), registry_version);
+    rs_packet_lambda_result_int_t a2;
+    a2.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    a2.result_base.lambda_id = get_registered_lambda_by_name("kram")->id;
+    a2.result = 42;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &a2;
+    pkt2.len = sizeof(a2);
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_NE(rs_linux_get_values_version(), values_version);
+    rs_linux_registered_lambda *arg = (rs_linux_registered_lambda *) get_registered_lambda_by_name("kram")->arg.obj;
+    ASSERT_EQ(arg->version, 1u);
+    generic_lambda_return result;
+    uint32_t version = 0;
+    ASSERT_EQ(call_lambda_by_name_versioned("kram", RS_LAMBDA_INT, &result, &version), RS_CALL_CACHE);
+    ASSERT_EQ(result.ret_i, 42);
+    ASSERT_EQ(version, 1u);
+    free_lambda_registry();
+}
+
+TEST(rs_connector, version_only_changes_with_value) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_NO_CACHE;
+    a.ltype = RS_LAMBDA_DOUBLE;
+    memcpy(a.name, "kram", 5);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    init_lambda_registry();
+    handle_received_packet(&sptctx, &pkt);
+    rs_packet_lambda_result_double_t a2;
+    a2.result_base.base.ptype = RS_PACKET_RESULT_DOUBLE;
+    a2.result_base.lambda_id = get_registered_lambda_by_name("kram")->id;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &a2;
+    pkt2.len = sizeof(a2);
+    rs_linux_registered_lambda *arg = (rs_linux_registered_lambda *) get_registered_lambda_by_name("kram")->arg.obj;
+    a2.result = 1.5;
+    hton_rs_packet_lambda_result_double_t(&a2);
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_EQ(arg->version, 1u);
+    a2.result = 1.5;
+    hton_rs_packet_lambda_result_double_t(&a2);
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_EQ(arg->version, 1u);
+    a2.result = 2.5;
+    hton_rs_packet_lambda_result_double_t(&a2);
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_EQ(arg->version, 2u);
+    ASSERT_EQ(arg->ret.ret_d, 2.5);
+    free_lambda_registry();
+}
+
+TEST(rs_connector, derived_lambda) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    ASSERT_EQ(rs_linux_register_derived("sum", "a + 2 * b"), 0);
+    ASSERT_EQ(rs_linux_register_derived("bad", "a +"), RS_REGISTER_INVALPARAM);
+    ASSERT_EQ(rs_linux_register_derived("self", "self + 1"), RS_REGISTER_INVALPARAM);
+    ASSERT_EQ(get_registered_lambda_by_name("sum")->type, RS_LAMBDA_DOUBLE);
+    ASSERT_EQ(get_registered_lambda_by_name("sum")->cache, RS_CACHE_ONLY);
+
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_NO_CACHE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "a", 2);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(&sptctx, &pkt);
+    a.ltype = RS_LAMBDA_DOUBLE;
+    memcpy(a.name, "b", 2);
+    handle_received_packet(&sptctx, &pkt);
+    // registry IDs are shifted by the derived lambda, the device still uses 0 and 1
+    ASSERT_EQ(get_registered_lambda_by_name("a")->id, 1);
+    ASSERT_EQ(get_registered_lambda_by_name("b")->id, 2);
+
+    generic_lambda_return result;
+    ASSERT_EQ(call_lambda_by_name("sum", RS_LAMBDA_DOUBLE, &result), RS_CALL_CACHE_EMPTY);
+
+    rs_packet_lambda_result_int_t r1;
+    r1.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r1.result_base.lambda_id = 0;
+    r1.result = 3;
+    struct serial_data_packet pkt1;
+    pkt1.data = (uint8_t *) &r1;
+    pkt1.len = sizeof(r1);
+    handle_received_packet(&sptctx, &pkt1);
+    ASSERT_EQ(((rs_linux_registered_lambda *) get_registered_lambda_by_name("a")->arg.obj)->ret.ret_i, 3);
+    ASSERT_EQ(call_lambda_by_name("sum", RS_LAMBDA_DOUBLE, &result), RS_CALL_CACHE_EMPTY);
+
+    rs_packet_lambda_result_double_t r2;
+    r2.result_base.base.ptype = RS_PACKET_RESULT_DOUBLE;
+    r2.result_base.lambda_id = 1;
+    r2.result = 1.5;
+    hton_rs_packet_lambda_result_double_t(&r2);
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &r2;
+    pkt2.len = sizeof(r2);
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_EQ(call_lambda_by_name("sum", RS_LAMBDA_DOUBLE, &result), RS_CALL_CACHE);
+    ASSERT_EQ(result.ret_d, 6.0);
+
+    // derived lambdas can build on each other and are updated in a chain
+    ASSERT_EQ(rs_linux_register_derived("twice", "sum * 2"), 3);
+    ASSERT_EQ(call_lambda_by_id(3, RS_LAMBDA_DOUBLE, &result), RS_CALL_CACHE);
+    ASSERT_EQ(result.ret_d, 12.0);
+    r1.result = 5;
+    handle_received_packet(&sptctx, &pkt1);
+    ASSERT_EQ(call_lambda_by_id(3, RS_LAMBDA_DOUBLE, &result), RS_CALL_CACHE);
+    ASSERT_EQ(result.ret_d, 16.0);
+
+    // after the input is gone the last derived value stays cached
+    rs_packet_unregistered_t u;
+    u.base.ptype = RS_PACKET_UNREGISTERED;
+    u.lambda_id = 0;
+    struct serial_data_packet pkt3;
+    pkt3.data = (uint8_t *) &u;
+    pkt3.len = sizeof(u);
+    handle_received_packet(&sptctx, &pkt3);
+    ASSERT_EQ(get_registered_lambda_by_name("a"), (void *) NULL);
+    auto sum = (rs_linux_registered_lambda *) get_registered_lambda_by_name("sum")->arg.obj;
+    ASSERT_EQ(sum->derived->input_ids[0], -1);
+    ASSERT_EQ(sum->ret.ret_d, 8.0);
+    free_lambda_registry();
+}
+
+TEST(rs_connector, rejected_registration_keeps_device_ids) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    ASSERT_EQ(rs_linux_register_derived("temp", "1 + 1"), 0);
+
+    // the device announces a lambda whose name is taken, it still uses up device ID 0
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_NO_CACHE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "temp", 5);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(&sptctx, &pkt);
+    memcpy(a.name, "hum", 4);
+    handle_received_packet(&sptctx, &pkt);
+    ASSERT_EQ(get_number_of_registered_lambdas(), 2);
+    rs_registered_lambda *hum = get_registered_lambda_by_name("hum");
+    ASSERT_EQ(hum->id, 1);
+    auto arg = (rs_linux_registered_lambda *) hum->arg.obj;
+    ASSERT_EQ(arg->device_id, 1);
+
+    // a result of the rejected lambda is not taken for the next one
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r.result_base.lambda_id = 0;
+    r.result = 21;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &r;
+    pkt2.len = sizeof(r);
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_FALSE(arg->data_cached);
+    r.result_base.lambda_id = 1;
+    r.result = 55;
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_TRUE(arg->data_cached);
+    ASSERT_EQ(arg->ret.ret_i, 55);
+    free_lambda_registry();
+}
+
+TEST(rs_connector, trigger_events) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    ASSERT_EQ(rs_linux_add_trigger("hot=temp:above:30"), RS_TRIGGER_SUCCESS);
+    ASSERT_EQ(rs_linux_add_trigger("hot=temp:below:3"), RS_TRIGGER_DUPLICATE);
+    ASSERT_EQ(rs_linux_add_trigger("bad=temp:above"), RS_TRIGGER_SYNTAX);
+    rs_trigger_event events[8];
+    // skip events of earlier tests
+    size_t n;
+    uint64_t last = 0;
+    while ((n = rs_linux_read_events(last, events, 8, 0)) > 0) {
+        last = events[n - 1].seq;
+    }
+
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_NO_CACHE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "temp", 5);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(&sptctx, &pkt);
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r.result_base.lambda_id = get_registered_lambda_by_name("temp")->id;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &r;
+    pkt2.len = sizeof(r);
+    for (rs_int_t value : {25, 31, 35, 20, 40}) {
+        r.result = value;
+        handle_received_packet(&sptctx, &pkt2);
+    }
+    ASSERT_EQ(rs_linux_read_events(last, events, 8, 0), 2u);
+    ASSERT_STREQ(events[0].trigger, "hot");
+    ASSERT_EQ(events[0].value, 31.0);
+    ASSERT_EQ(events[1].value, 40.0);
+    ASSERT_EQ(events[1].seq, events[0].seq + 1);
+    rs_linux_clear_triggers();
+    free_lambda_registry();
+}
+
+TEST(rs_connector, shm_publish) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    std::string name = "/rs_connector_test_" + std::to_string(getpid());
+    ASSERT_EQ(rs_linux_enable_shm(name.c_str()), 0);
+    rs_shm_table *table = rs_shm_attach(name.c_str());
+    ASSERT_NE(table, nullptr);
+
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_CALL_ONCE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "kram", 5);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(&sptctx, &pkt);
+    int id = rs_shm_find(table, "kram");
+    ASSERT_EQ(id, get_registered_lambda_by_name("kram")->id);
+    rs_shm_slot slot;
+    ASSERT_FALSE(rs_shm_read(table, (uint8_t) id, &slot));
+    ASSERT_EQ(slot.state, RS_SHM_REGISTERED);
+    ASSERT_EQ(slot.cache, RS_CACHE_CALL_ONCE);
+
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r.result_base.lambda_id = (lambda_id_t) id;
+    r.result = 42;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &r;
+    pkt2.len = sizeof(r);
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_TRUE(rs_shm_read(table, (uint8_t) id, &slot));
+    ASSERT_EQ(slot.type, RS_LAMBDA_INT);
+    ASSERT_EQ(slot.value.i, 42);
+    ASSERT_GT(slot.timestamp, 0u);
+
+    rs_packet_unregistered_t u;
+    u.base.ptype = RS_PACKET_UNREGISTERED;
+    u.lambda_id = (lambda_id_t) id;
+    struct serial_data_packet pkt3;
+    pkt3.data = (uint8_t *) &u;
+    pkt3.len = sizeof(u);
+    handle_received_packet(&sptctx, &pkt3);
+    ASSERT_EQ(rs_shm_find(table, "kram"), -1);
+    rs_shm_detach(table);
+    rs_shm_destroy();
+    free_lambda_registry();
+}
+
+TEST(rs_connector, stream_fan_out) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_NO_CACHE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "kram", 5);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(&sptctx, &pkt);
+    memcpy(a.name, "other", 6);
+    handle_received_packet(&sptctx, &pkt);
+    lambda_id_t id = get_registered_lambda_by_name("kram")->id;
+
+    uint8_t ids[(MAX_LAMBDAS + 7) / 8] = {0};
+    ids[id / 8] |= 1 << (id % 8);
+    rs_stream *subscribed = rs_linux_open_stream(ids, 0);
+    rs_stream *all = rs_linux_open_stream(nullptr, 0);
+    rs_stream *doubles = rs_linux_open_stream(nullptr, RS_LAMBDA_DOUBLE);
+    ASSERT_NE(subscribed, nullptr);
+    ASSERT_NE(all, nullptr);
+    ASSERT_NE(doubles, nullptr);
+
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &r;
+    pkt2.len = sizeof(r);
+    r.result_base.lambda_id = get_registered_lambda_by_name("other")->id;
+    r.result = 1;
+    handle_received_packet(&sptctx, &pkt2);
+    r.result_base.lambda_id = id;
+    for (rs_int_t value : {40, 41, 42}) {
+        r.result = value;
+        handle_received_packet(&sptctx, &pkt2);
+    }
+
+    rs_stream_update updates[4];
+    ASSERT_EQ(rs_stream_read(subscribed, updates, 4, 0), 1u);
+    ASSERT_EQ(updates[0].id, id);
+    ASSERT_STREQ(updates[0].name, "kram");
+    ASSERT_EQ(updates[0].value.ret_i, 42);
+    ASSERT_GT(updates[0].timestamp, 0u);
+    ASSERT_EQ(rs_stream_read(all, updates, 4, 0), 2u);
+    ASSERT_STREQ(updates[0].name, "other");
+    ASSERT_EQ(updates[1].value.ret_i, 42);
+    ASSERT_EQ(rs_stream_read(doubles, updates, 4, 0), 0u);
+    rs_linux_update_stream(doubles, ids, RS_LAMBDA_INT);
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_EQ(rs_stream_read(doubles, updates, 4, 0), 1u);
+    ASSERT_EQ(updates[0].id, id);
+    rs_linux_close_stream(subscribed);
+    rs_linux_close_stream(all);
+    rs_linux_close_stream(doubles);
+    free_lambda_registry();
+}
+
+TEST(rs_connector, call_multiple_from_cache) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_CALL_ONCE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "kram", 5);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(&sptctx, &pkt);
+    a.cache = RS_CACHE_ONLY;
+    a.ltype = RS_LAMBDA_STRING;
+    memcpy(a.name, "door", 5);
+    handle_received_packet(&sptctx, &pkt);
+    a.ltype = RS_LAMBDA_DOUBLE;
+    memcpy(a.name, "empty", 6);
+    handle_received_packet(&sptctx, &pkt);
+    lambda_id_t kram = get_registered_lambda_by_name("kram")->id;
+    lambda_id_t door = get_registered_lambda_by_name("door")->id;
+    lambda_id_t empty = get_registered_lambda_by_name("empty")->id;
+
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r.result_base.lambda_id = kram;
+    r.result = 42;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &r;
+    pkt2.len = sizeof(r);
+    handle_received_packet(&sptctx, &pkt2);
+    char buf[sizeof(rs_packet_lambda_result_string_t) + 6];
+    auto s = (rs_packet_lambda_result_string_t *) buf;
+    s->result_base.base.ptype = RS_PACKET_RESULT_STRING;
+    s->result_base.lambda_id = door;
+    s->result_length = 7;
+    memcpy(&s->result, "closed", 7);
+    hton_rs_packet_lambda_result_string_t(s);
+    struct serial_data_packet pkt3;
+    pkt3.data = (uint8_t *) buf;
+    pkt3.len = sizeof(buf);
+    handle_received_packet(&sptctx, &pkt3);
+
+    lambda_id_t ids[] = {kram, door, empty, (lambda_id_t) (kram + 10), door};
+    rs_lambda_type_t types[] = {RS_LAMBDA_INT, 0, 0, 0, RS_LAMBDA_INT};
+    generic_lambda_return results[5];
+    uint32_t versions[5] = {0};
+    int8_t codes[5];
+    // the last entry only checks the type, the list must not contain the same lambda twice otherwise
+    call_lambdas_by_id_versioned(5, ids, types, results, versions, codes);
+    ASSERT_EQ(codes[0], RS_CALL_CACHE);
+    ASSERT_EQ(results[0].ret_i, 42);
+    ASSERT_EQ(versions[0], 1u);
+    ASSERT_EQ(codes[1], RS_CALL_CACHE);
+    ASSERT_STREQ(results[1].ret_s, "closed");
+    free(results[1].ret_s);
+    ASSERT_EQ(codes[2], RS_CALL_CACHE_EMPTY);
+    ASSERT_EQ(codes[3], RS_CALL_NOTFOUND);
+    ASSERT_EQ(codes[4], RS_CALL_WRONGTYPE);
+    free_lambda_registry();
+}
+
+TEST(rs_connector, metrics) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_CALL_ONCE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "meter", 6);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(&sptctx, &pkt);
+    a.cache = RS_CACHE_NO_CACHE;
+    memcpy(a.name, "slow", 5);
+    handle_received_packet(&sptctx, &pkt);
+    lambda_id_t meter = get_registered_lambda_by_name("meter")->id;
+    lambda_id_t slow = get_registered_lambda_by_name("slow")->id;
+    uint64_t hits = rs_metrics_get_cache(RS_CACHE_CALL_ONCE, RS_METRICS_CACHE_HIT);
+    uint64_t misses = rs_metrics_get_cache(RS_CACHE_CALL_ONCE, RS_METRICS_CACHE_MISS);
+    uint64_t wrong_types = rs_metrics_get_code(RS_CALL_WRONGTYPE);
+    uint64_t timeouts = rs_metrics_get_code(RS_CALL_TIMEOUT);
+
+    // the answer arrives while the caller waits
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r.result_base.lambda_id = meter;
+    r.result = 7;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &r;
+    pkt2.len = sizeof(r);
+    std::thread device([&sptctx, &pkt2]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        handle_received_packet(&sptctx, &pkt2);
+    });
+    generic_lambda_return result;
+    ASSERT_EQ(call_lambda_by_id(meter, RS_LAMBDA_INT, &result), RS_CALL_SUCCESS);
+    device.join();
+    ASSERT_EQ(call_lambda_by_id(meter, RS_LAMBDA_INT, &result), RS_CALL_CACHE);
+    ASSERT_EQ(call_lambda_by_id(meter, RS_LAMBDA_DOUBLE, &result), RS_CALL_WRONGTYPE);
+    rs_lambda_metrics m;
+    rs_metrics_get_lambda(meter, &m);
+    ASSERT_EQ(m.calls, 3u);
+    ASSERT_EQ(m.sent, 1u);
+    ASSERT_EQ(m.received, 1u);
+    ASSERT_EQ(m.timeouts, 0u);
+    ASSERT_EQ(m.rtt_count, 1u);
+    ASSERT_GE(m.rtt_sum, 20000u);
+    ASSERT_EQ(rs_metrics_get_cache(RS_CACHE_CALL_ONCE, RS_METRICS_CACHE_HIT), hits + 1);
+    ASSERT_EQ(rs_metrics_get_cache(RS_CACHE_CALL_ONCE, RS_METRICS_CACHE_MISS), misses + 1);
+    ASSERT_EQ(rs_metrics_get_code(RS_CALL_WRONGTYPE), wrong_types + 1);
+
+    // a late answer is not taken as the round trip of a call
+    ASSERT_EQ(call_lambda_by_id(slow, RS_LAMBDA_INT, &result), RS_CALL_TIMEOUT);
+    r.result_base.lambda_id = slow;
+    handle_received_packet(&sptctx, &pkt2);
+    rs_metrics_get_lambda(slow, &m);
+    ASSERT_EQ(m.calls, 1u);
+    ASSERT_EQ(m.sent, 1u);
+    ASSERT_EQ(m.received, 1u);
+    ASSERT_EQ(m.timeouts, 1u);
+    ASSERT_EQ(m.rtt_count, 0u);
+    ASSERT_EQ(rs_metrics_get_code(RS_CALL_TIMEOUT), timeouts + 1);
+
+    // counters start over when an ID is assigned to a lambda
+    lambda_id_t next = (lambda_id_t) (slow + 1);
+    rs_metrics_count_timeout(next);
+    a.cache = RS_CACHE_ONLY;
+    memcpy(a.name, "other", 6);
+    handle_received_packet(&sptctx, &pkt);
+    ASSERT_EQ(get_registered_lambda_by_name("other")->id, next);
+    rs_metrics_get_lambda(next, &m);
+    ASSERT_EQ(m.timeouts, 0u);
+    free_lambda_registry();
+}
+
+TEST(rs_connector, admission) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_NO_CACHE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "busy", 5);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(&sptctx, &pkt);
+    a.cache = RS_CACHE_ON_TIMEOUT;
+    memcpy(a.name, "backup", 7);
+    handle_received_packet(&sptctx, &pkt);
+    lambda_id_t busy = get_registered_lambda_by_name("busy")->id;
+    lambda_id_t backup = get_registered_lambda_by_name("backup")->id;
+    rs_admission_limits limits = {1, 0, 0, 0};
+    rs_admission_set_limits(&limits);
+    uint64_t overloads = rs_metrics_get_code(RS_CALL_OVERLOAD);
+
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r.result_base.lambda_id = backup;
+    r.result = 5;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &r;
+    pkt2.len = sizeof(r);
+    handle_received_packet(&sptctx, &pkt2);
+
+    // the first caller of each lambda waits for the device, the second one is rejected right away
+    int8_t first_busy = 0;
+    int8_t first_backup = 0;
+    std::thread caller([&]() {
+        generic_lambda_return result;
+        first_busy = call_lambda_by_id(busy, RS_LAMBDA_INT, &result);
+    });
+    std::thread caller2([&]() {
+        generic_lambda_return result;
+        first_backup = call_lambda_by_id(backup, RS_LAMBDA_INT, &result);
+    });
+    while (rs_admission_in_flight(MAX_LAMBDAS) < 2) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    generic_lambda_return result;
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(call_lambda_by_id(busy, RS_LAMBDA_INT, &result), RS_CALL_OVERLOAD);
+    ASSERT_EQ(call_lambda_by_name("busy", RS_LAMBDA_INT, &result), RS_CALL_OVERLOAD);
+    // the cache policy allows the cached result instead
+    ASSERT_EQ(call_lambda_by_id(backup, RS_LAMBDA_INT, &result), RS_CALL_CACHE_TIMEOUT);
+    ASSERT_EQ(result.ret_i, 5);
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+    r.result_base.lambda_id = busy;
+    handle_received_packet(&sptctx, &pkt2);
+    r.result_base.lambda_id = backup;
+    handle_received_packet(&sptctx, &pkt2);
+    caller.join();
+    caller2.join();
+    ASSERT_EQ(first_busy, RS_CALL_SUCCESS);
+    ASSERT_EQ(first_backup, RS_CALL_SUCCESS);
+    ASSERT_EQ(rs_admission_in_flight(MAX_LAMBDAS), 0u);
+    ASSERT_EQ(rs_metrics_get_code(RS_CALL_OVERLOAD), overloads + 2);
+
+    limits = {RS_ADMISSION_DEFAULT_LAMBDA_CALLS, RS_ADMISSION_DEFAULT_DEVICE_CALLS, 0, 0};
+    rs_admission_set_limits(&limits);
+    free_lambda_registry();
+}
+
+/**
+ * @brief Outcome of an asynchronous call
+ */
+struct async_outcome {
+    std::atomic<int> calls{0};
+    int8_t res = 0;
+    rs_int_t value = 0;
+};
+
+static void record_async_outcome(int8_t res, generic_lambda_return *result, uint32_t version, void *ctx) {
+    (void) version;
+    auto outcome = (async_outcome *) ctx;
+    outcome->res = res;
+    outcome->value = res == RS_CALL_SUCCESS ? result->ret_i : 0;
+    outcome->calls++;
+}
+
+TEST(rs_connector, call_async) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = RS_CACHE_NO_CACHE;
+    a.ltype = RS_LAMBDA_INT;
+    memcpy(a.name, "async", 6);
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(&sptctx, &pkt);
+    lambda_id_t id = get_registered_lambda_by_name("async")->id;
+
+    // failures are reported before the call returns
+    async_outcome unknown;
+    call_lambda_by_id_async(200, RS_LAMBDA_INT, record_async_outcome, &unknown);
+    ASSERT_EQ(unknown.calls, 1);
+    ASSERT_EQ(unknown.res, RS_CALL_NOTFOUND);
+    async_outcome wrong_type;
+    call_lambda_by_name_async("async", RS_LAMBDA_DOUBLE, record_async_outcome, &wrong_type);
+    ASSERT_EQ(wrong_type.calls, 1);
+    ASSERT_EQ(wrong_type.res, RS_CALL_WRONGTYPE);
+
+    // both pending calls are answered by one result packet
+    async_outcome by_id, by_name;
+    call_lambda_by_id_async(id, RS_LAMBDA_INT, record_async_outcome, &by_id);
+    call_lambda_by_name_async("async", RS_LAMBDA_INT, record_async_outcome, &by_name);
+    ASSERT_EQ(by_id.calls, 0);
+    ASSERT_EQ(by_name.calls, 0);
+    ASSERT_EQ(rs_admission_in_flight(id), 2u);
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r.result_base.lambda_id = id;
+    r.result = 17;
+    struct serial_data_packet pkt2;
+    pkt2.data = (uint8_t *) &r;
+    pkt2.len = sizeof(r);
+    handle_received_packet(&sptctx, &pkt2);
+    ASSERT_EQ(by_id.calls, 1);
+    ASSERT_EQ(by_id.res, RS_CALL_SUCCESS);
+    ASSERT_EQ(by_id.value, 17);
+    ASSERT_EQ(by_name.calls, 1);
+    ASSERT_EQ(by_name.value, 17);
+    ASSERT_EQ(rs_admission_in_flight(id), 0u);
+
+    // a call without answer is completed by the expiry thread
+    uint64_t timeouts = rs_metrics_get_code(RS_CALL_TIMEOUT);
+    async_outcome unanswered;
+    auto start = std::chrono::steady_clock::now();
+    call_lambda_by_id_async(id, RS_LAMBDA_INT, record_async_outcome, &unanswered);
+    while (unanswered.calls == 0 && std::chrono::steady_clock::now() - start < std::chrono::seconds(3)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(unanswered.calls, 1);
+    ASSERT_EQ(unanswered.res, RS_CALL_TIMEOUT);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(900));
+    ASSERT_EQ(rs_metrics_get_code(RS_CALL_TIMEOUT), timeouts + 1);
+    ASSERT_EQ(rs_admission_in_flight(id), 0u);
+    free_lambda_registry();
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+
+#include <rs_expression.h>
+
+static double eval(const char *source, const double *inputs) {
+    rs_expr expr;
+    EXPECT_EQ(rs_expr_compile(&expr, source, nullptr), RS_EXPR_SUCCESS);
+    double result = NAN;
+    EXPECT_EQ(rs_expr_eval(&expr, inputs, &result), RS_EXPR_SUCCESS);
+    rs_expr_free(&expr);
+    return result;
+}
+
+TEST(rs_expression, precedence) {
+    ASSERT_EQ(eval("1 + 2 * 3", nullptr), 7.0);
+    ASSERT_EQ(eval("(1 + 2) * 3", nullptr), 9.0);
+    ASSERT_EQ(eval("10 - 4 - 3", nullptr), 3.0);
+    ASSERT_EQ(eval("2 ^ 3 ^ 2", nullptr), 512.0);
+    ASSERT_EQ(eval("-2 ^ 2", nullptr), -4.0);
+    ASSERT_EQ(eval("8 / -2", nullptr), -4.0);
+}
+
+TEST(rs_expression, functions) {
+    ASSERT_EQ(eval("abs(-3) + sqrt(16)", nullptr), 7.0);
+    ASSERT_EQ(eval("min(4, 2) + max(4, 2)", nullptr), 6.0);
+    ASSERT_EQ(eval("pow(2, 10)", nullptr), 1024.0);
+    ASSERT_DOUBLE_EQ(eval("log(exp(2.5))", nullptr), 2.5);
+    ASSERT_DOUBLE_EQ(eval("log10(1000)", nullptr), 3.0);
+}
+
+TEST(rs_expression, inputs) {
+    rs_expr expr;
+    ASSERT_EQ(rs_expr_compile(&expr, "temp1 + temp2 + temp1", nullptr), RS_EXPR_SUCCESS);
+    ASSERT_EQ(expr.input_count, 2);
+    ASSERT_STREQ(expr.inputs[0], "temp1");
+    ASSERT_STREQ(expr.inputs[1], "temp2");
+    ASSERT_STREQ(expr.source, "temp1 + temp2 + temp1");
+    double inputs[] = {1.5, 2.0};
+    double result;
+    ASSERT_EQ(rs_expr_eval(&expr, inputs, &result), RS_EXPR_SUCCESS);
+    ASSERT_EQ(result, 5.0);
+    rs_expr_free(&expr);
+}
+
+TEST(rs_expression, dew_point) {
+    // Magnus formula
+    const char *source = "243.12 * (log(hum / 100) + 17.62 * temp / (243.12 + temp)) / "
+            "(17.62 - (log(hum / 100) + 17.62 * temp / (243.12 + temp)))";
+    rs_expr expr;
+    ASSERT_EQ(rs_expr_compile(&expr, source, nullptr), RS_EXPR_SUCCESS);
+    ASSERT_EQ(expr.input_count, 2);
+    double inputs[] = {50.0, 20.0};
+    double result;
+    ASSERT_EQ(rs_expr_eval(&expr, inputs, &result), RS_EXPR_SUCCESS);
+    ASSERT_NEAR(result, 9.26, 0.01);
+    rs_expr_free(&expr);
+}
+
+TEST(rs_expression, errors) {
+    rs_expr expr;
+    size_t pos;
+    ASSERT_EQ(rs_expr_compile(&expr, "", &pos), RS_EXPR_SYNTAX);
+    ASSERT_EQ(rs_expr_compile(&expr, "1 +", &pos), RS_EXPR_SYNTAX);
+    ASSERT_EQ(rs_expr_compile(&expr, "(1 + 2", &pos), RS_EXPR_SYNTAX);
+    ASSERT_EQ(rs_expr_compile(&expr, "1 + 2 3", &pos), RS_EXPR_SYNTAX);
+    ASSERT_EQ(pos, 6u);
+    ASSERT_EQ(rs_expr_compile(&expr, "foo(1)", &pos), RS_EXPR_UNKNOWN_FUNCTION);
+    ASSERT_EQ(rs_expr_compile(&expr, "min(1)", &pos), RS_EXPR_UNKNOWN_FUNCTION);
+    ASSERT_EQ(rs_expr_compile(&expr, "a+b+c+d+e+f+g+h+i", &pos), RS_EXPR_TOO_COMPLEX);
+    // deep nesting is rejected before it exhausts the stack of the parser
+    std::string nested = std::string(100000, '(') + "1" + std::string(100000, ')');
+    ASSERT_EQ(rs_expr_compile(&expr, nested.c_str(), &pos), RS_EXPR_TOO_COMPLEX);
+    ASSERT_EQ(pos, (size_t) RS_EXPR_MAX_NESTING);
+    ASSERT_EQ(rs_expr_compile(&expr, std::string(100000, '-').append("1").c_str(), &pos), RS_EXPR_TOO_COMPLEX);
+    ASSERT_EQ(rs_expr_compile(&expr, (std::string(RS_EXPR_MAX_NESTING - 1, '(') + "1" +
+                                      std::string(RS_EXPR_MAX_NESTING - 1, ')')).c_str(), &pos), RS_EXPR_SUCCESS);
+    rs_expr_free(&expr);
+    ASSERT_EQ(rs_expr_compile(&expr, "1/0", &pos), RS_EXPR_SUCCESS);
+    double result;
+    ASSERT_EQ(rs_expr_eval(&expr, nullptr, &result), RS_EXPR_NOT_FINITE);
+    rs_expr_free(&expr);
+    ASSERT_STREQ(stringify_rs_expr_result(RS_EXPR_SYNTAX), "RS_EXPR_SYNTAX");
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include <rs_history.h>
+
+static void fill_history(rs_history *h, size_t capacity, size_t samples) {
+    rs_history_set_default_capacity(capacity);
+    rs_history_init(h);
+    rs_history_set_default_capacity(RS_HISTORY_DEFAULT_CAPACITY);
+    for (size_t i = 0; i < samples; i++) {
+        ASSERT_EQ(rs_history_append(h, 1000 + i * 10, (double) i), RS_QUERY_SUCCESS);
+    }
+}
+
+TEST(rs_history, empty) {
+    rs_history h;
+    rs_history_init(&h);
+    double result;
+    size_t count = 42;
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_COUNT, 0, UINT64_MAX, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(count, 0u);
+    ASSERT_EQ(result, 0.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MAX, 0, UINT64_MAX, 0, &result, &count), RS_QUERY_EMPTY);
+    rs_history_free(&h);
+}
+
+TEST(rs_history, range_bounds) {
+    rs_history h;
+    fill_history(&h, 100, 50);
+    double result;
+    size_t count;
+    // timestamps 1000, 1010, ..., 1490
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_COUNT, 1010, 1030, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(count, 3u);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MIN, 1005, 1035, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(result, 1.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MAX, 1005, 1035, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(result, 3.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_SUM, 0, UINT64_MAX, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(result, 49.0 * 50.0 / 2.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MAX, 2000, 3000, 0, &result, &count), RS_QUERY_EMPTY);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MAX, 3000, 2000, 0, &result, &count), RS_QUERY_INVALPARAM);
+    rs_history_free(&h);
+}
+
+TEST(rs_history, ring_wrap_around) {
+    rs_history h;
+    fill_history(&h, 16, 40);
+    double result;
+    size_t count;
+    // only the samples 24..39 are left
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_COUNT, 0, UINT64_MAX, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(count, 16u);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MIN, 0, UINT64_MAX, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(result, 24.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MAX, 0, UINT64_MAX, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(result, 39.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MEAN, 1000 + 30 * 10, 1000 + 33 * 10, 0, &result, &count),
+              RS_QUERY_SUCCESS);
+    ASSERT_EQ(result, 31.5);
+    rs_history_free(&h);
+}
+
+TEST(rs_history, unsorted_timestamps_are_clamped) {
+    rs_history h;
+    rs_history_init(&h);
+    rs_history_append(&h, 2000, 1.0);
+    rs_history_append(&h, 1000, 2.0);
+    double result;
+    size_t count;
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_COUNT, 2000, 2000, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(count, 2u);
+    rs_history_free(&h);
+}
+
+TEST(rs_history, quantile) {
+    rs_history h;
+    fill_history(&h, 1000, 101);
+    double result;
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_QUANTILE, 0, UINT64_MAX, 0.5, &result, nullptr), RS_QUERY_SUCCESS);
+    ASSERT_DOUBLE_EQ(result, 50.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_QUANTILE, 0, UINT64_MAX, 0.95, &result, nullptr), RS_QUERY_SUCCESS);
+    ASSERT_DOUBLE_EQ(result, 95.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_QUANTILE, 0, UINT64_MAX, 0.0, &result, nullptr), RS_QUERY_SUCCESS);
+    ASSERT_DOUBLE_EQ(result, 0.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_QUANTILE, 0, UINT64_MAX, 1.0, &result, nullptr), RS_QUERY_SUCCESS);
+    ASSERT_DOUBLE_EQ(result, 100.0);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_QUANTILE, 1000, 1010, 0.5, &result, nullptr), RS_QUERY_SUCCESS);
+    ASSERT_DOUBLE_EQ(result, 0.5);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_QUANTILE, 0, UINT64_MAX, 1.5, &result, nullptr), RS_QUERY_INVALPARAM);
+    rs_history_free(&h);
+}
+
+TEST(rs_history, kernels_match_scalar_loop) {
+    std::vector<double> values;
+    for (int i = 0; i < 1003; i++) {
+        values.push_back((double) ((i * 7919) % 1009) - 500.0);
+    }
+    double sum = 0.0, min = values[0], max = values[0];
+    for (double v : values) {
+        sum += v;
+        min = std::min(min, v);
+        max = std::max(max, v);
+    }
+    ASSERT_DOUBLE_EQ(rs_kernel_sum(values.data(), values.size()), sum);
+    ASSERT_EQ(rs_kernel_min(values.data(), values.size()), min);
+    ASSERT_EQ(rs_kernel_max(values.data(), values.size()), max);
+    std::vector<double> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    ASSERT_EQ(rs_kernel_quantile(values.data(), values.size(), 0.25), sorted[250] + 0.5 * (sorted[251] - sorted[250]));
+}
+
+TEST(rs_history, op_strings) {
+    ASSERT_EQ(get_query_op_from_string("max"), RS_QUERY_MAX);
+    ASSERT_EQ(get_query_op_from_string("quantile"), RS_QUERY_QUANTILE);
+    ASSERT_EQ(get_query_op_from_string("median"), (rs_query_op_t) -1);
+    ASSERT_STREQ(stringify_rs_query_result(RS_QUERY_EMPTY), "RS_QUERY_EMPTY");
+}
+
+/*
+ * Benchmark of the range query against a naive sample by sample loop, run with --gtest_also_run_disabled_tests
+ */
+TEST(rs_history, DISABLED_benchmark_10m_samples) {
+    const size_t samples = 10000000;
+    rs_history h;
+    fill_history(&h, samples, samples);
+    const uint64_t from = 1000 + 10 * (samples / 10);
+    const uint64_t to = 1000 + 10 * (samples - samples / 10);
+
+    auto start = std::chrono::steady_clock::now();
+    double naive_max = 0.0;
+    double naive_sum = 0.0;
+    size_t naive_count = 0;
+    for (size_t i = 0; i < h.count; i++) {
+        size_t pos = (h.head + i) % h.capacity;
+        if (h.timestamps[pos] >= from && h.timestamps[pos] <= to) {
+            naive_max = naive_count == 0 || h.values[pos] > naive_max ? h.values[pos] : naive_max;
+            naive_sum += h.values[pos];
+            naive_count++;
+        }
+    }
+    auto naive_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    double max, sum;
+    size_t count;
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MAX, from, to, 0, &max, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_SUM, from, to, 0, &sum, &count), RS_QUERY_SUCCESS);
+    auto query_time = std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(count, naive_count);
+    ASSERT_EQ(max, naive_max);
+    ASSERT_DOUBLE_EQ(sum, naive_sum);
+    printf("naive scalar loop: %lld us, range query: %lld us\n",
+           (long long) std::chrono::duration_cast<std::chrono::microseconds>(naive_time).count(),
+           (long long) std::chrono::duration_cast<std::chrono::microseconds>(query_time).count());
+    rs_history_free(&h);
+}
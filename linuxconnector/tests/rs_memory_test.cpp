@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <rs_memory.h>
+#include <rs_history.h>
+
+static size_t responses_held = 0;
+static size_t history_calls = 0;
+
+static size_t reclaim_responses(size_t bytes) {
+    size_t freed = bytes < responses_held ? bytes : responses_held;
+    responses_held -= freed;
+    rs_memory_release(RS_MEMORY_RESPONSES, freed);
+    rs_memory_count_eviction(RS_MEMORY_RESPONSES, freed);
+    return freed;
+}
+
+static size_t reclaim_history(size_t) {
+    history_calls++;
+    return 0;
+}
+
+TEST(rs_memory, accounting) {
+    rs_memory_usage before;
+    rs_memory_get_usage(RS_MEMORY_STRINGS, &before);
+    size_t used = rs_memory_get_used();
+    ASSERT_TRUE(rs_memory_reserve(RS_MEMORY_STRINGS, 100));
+    rs_memory_usage after;
+    rs_memory_get_usage(RS_MEMORY_STRINGS, &after);
+    ASSERT_EQ(after.bytes, before.bytes + 100);
+    ASSERT_EQ(rs_memory_get_used(), used + 100);
+    rs_memory_release(RS_MEMORY_STRINGS, 100);
+    ASSERT_EQ(rs_memory_get_used(), used);
+}
+
+TEST(rs_memory, budget_and_reclaim_order) {
+    size_t used = rs_memory_get_used();
+    rs_memory_set_budget(used + 1000);
+    rs_memory_set_reclaimer(RS_MEMORY_RESPONSES, reclaim_responses);
+    rs_memory_set_reclaimer(RS_MEMORY_HISTORY, reclaim_history);
+    history_calls = 0;
+    rs_memory_usage before;
+    rs_memory_get_usage(RS_MEMORY_RESPONSES, &before);
+
+    ASSERT_TRUE(rs_memory_try_reserve(RS_MEMORY_RESPONSES, 800));
+    responses_held = 800;
+    ASSERT_FALSE(rs_memory_try_reserve(RS_MEMORY_HISTORY, 300));
+    // responses never evict data of later categories
+    ASSERT_FALSE(rs_memory_reserve(RS_MEMORY_RESPONSES, 1100));
+    ASSERT_EQ(history_calls, 0u);
+    // evicting responses is enough, history is not asked
+    ASSERT_TRUE(rs_memory_reserve(RS_MEMORY_HISTORY, 300));
+    ASSERT_EQ(history_calls, 0u);
+    ASSERT_EQ(responses_held, 700u);
+    // strings are always accounted, even above the budget
+    rs_memory_account(RS_MEMORY_STRINGS, 900);
+    ASSERT_EQ(history_calls, 1u);
+    ASSERT_EQ(responses_held, 0u);
+    ASSERT_EQ(rs_memory_get_used(), used + 1200);
+    rs_memory_usage after;
+    rs_memory_get_usage(RS_MEMORY_RESPONSES, &after);
+    ASSERT_EQ(after.evictions, before.evictions + 2);
+    ASSERT_EQ(after.evicted_bytes, before.evicted_bytes + 800);
+    ASSERT_EQ(after.refused, before.refused + 1);
+
+    rs_memory_release(RS_MEMORY_STRINGS, 900);
+    rs_memory_release(RS_MEMORY_HISTORY, 300);
+    rs_memory_set_reclaimer(RS_MEMORY_RESPONSES, NULL);
+    rs_memory_set_reclaimer(RS_MEMORY_HISTORY, NULL);
+    rs_memory_set_budget(0);
+    ASSERT_EQ(rs_memory_get_used(), used);
+}
+
+TEST(rs_memory, history_budget) {
+    size_t used = rs_memory_get_used();
+    rs_history_set_default_capacity(64);
+    rs_history h;
+    rs_history_init(&h);
+    rs_history_set_default_capacity(RS_HISTORY_DEFAULT_CAPACITY);
+    rs_memory_set_budget(used + 64 * 16 - 1);
+    ASSERT_EQ(rs_history_append(&h, 1000, 1.0), RS_QUERY_NOMEM);
+    rs_memory_set_budget(used + 64 * 16);
+    ASSERT_EQ(rs_history_append(&h, 1000, 1.0), RS_QUERY_SUCCESS);
+    ASSERT_EQ(rs_history_bytes(&h), 64u * 16);
+    ASSERT_EQ(rs_memory_get_used(), used + 64 * 16);
+
+    // an evicted history ignores appends until it is used again
+    ASSERT_EQ(rs_history_evict(&h), 64u * 16);
+    ASSERT_EQ(rs_memory_get_used(), used);
+    ASSERT_EQ(rs_history_append(&h, 1010, 2.0), RS_QUERY_SUCCESS);
+    ASSERT_EQ(rs_history_bytes(&h), 0u);
+    uint64_t allocated = h.allocated_at;
+    rs_history_touch(&h);
+    ASSERT_EQ(rs_history_append(&h, 1020, 3.0), RS_QUERY_SUCCESS);
+    ASSERT_GT(h.allocated_at, allocated);
+    double result;
+    size_t count;
+    ASSERT_EQ(rs_history_query(&h, RS_QUERY_MAX, 0, UINT64_MAX, 0, &result, &count), RS_QUERY_SUCCESS);
+    ASSERT_EQ(count, 1u);
+    ASSERT_EQ(result, 3.0);
+    rs_history_free(&h);
+    rs_memory_set_budget(0);
+    ASSERT_EQ(rs_memory_get_used(), used);
+}
+
+TEST(rs_memory, policy_names) {
+    ASSERT_EQ(get_evict_policy_from_string("lru"), RS_EVICT_LRU);
+    ASSERT_EQ(get_evict_policy_from_string("oldest"), RS_EVICT_OLDEST);
+    ASSERT_EQ(get_evict_policy_from_string("random"), (rs_evict_policy_t) -1);
+    ASSERT_STREQ(stringify_rs_evict_policy_t(RS_EVICT_OLDEST), "RS_EVICT_OLDEST");
+    ASSERT_STREQ(stringify_rs_memory_category_t(RS_MEMORY_HISTORY), "RS_MEMORY_HISTORY");
+}
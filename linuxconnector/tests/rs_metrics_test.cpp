@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <rs_metrics.h>
+#include <rs_constants.h>
+
+TEST(rs_metrics, rtt_buckets) {
+    // exact below the sub bucket count
+    for (uint64_t v = 0; v < RS_METRICS_RTT_SUB_BUCKETS; v++) {
+        ASSERT_EQ(rs_metrics_rtt_bucket(v), v);
+        ASSERT_EQ(rs_metrics_rtt_bucket_limit(v), v);
+    }
+    size_t last = 0;
+    for (uint64_t v = RS_METRICS_RTT_SUB_BUCKETS; v < (1ull << RS_METRICS_RTT_MAX_BITS); v += v / 97 + 1) {
+        size_t bucket = rs_metrics_rtt_bucket(v);
+        ASSERT_GE(bucket, last);
+        ASSERT_LT(bucket, (size_t) RS_METRICS_RTT_BUCKETS);
+        uint64_t limit = rs_metrics_rtt_bucket_limit(bucket);
+        ASSERT_GE(limit, v);
+        ASSERT_LT((double) (limit - v), (double) v / RS_METRICS_RTT_SUB_BUCKETS);
+        ASSERT_EQ(rs_metrics_rtt_bucket(limit), bucket);
+        if (bucket + 1 < RS_METRICS_RTT_BUCKETS) {
+            ASSERT_EQ(rs_metrics_rtt_bucket(limit + 1), bucket + 1);
+        }
+        last = bucket;
+    }
+    ASSERT_EQ(rs_metrics_rtt_bucket(1ull << RS_METRICS_RTT_MAX_BITS), (size_t) RS_METRICS_RTT_BUCKETS - 1);
+    ASSERT_EQ(rs_metrics_rtt_bucket(UINT64_MAX), (size_t) RS_METRICS_RTT_BUCKETS - 1);
+}
+
+TEST(rs_metrics, rtt_histogram_and_quantiles) {
+    const lambda_id_t id = 3;
+    rs_metrics_reset_lambda(id);
+    // 1 ms to 100 ms in steps of 1 ms
+    for (uint64_t ms = 1; ms <= 100; ms++) {
+        rs_metrics_record_rtt(id, ms * 1000);
+    }
+    rs_lambda_metrics m;
+    rs_metrics_get_lambda(id, &m);
+    ASSERT_EQ(m.rtt_count, 100u);
+    ASSERT_EQ(m.rtt_sum, 5050000u);
+    std::vector<uint64_t> buckets(RS_METRICS_RTT_BUCKETS);
+    rs_metrics_get_rtt_histogram(id, buckets.data());
+    uint64_t total = 0;
+    for (uint64_t count : buckets) {
+        total += count;
+    }
+    ASSERT_EQ(total, 100u);
+    const double quantiles[] = {0.5, 0.9, 0.99};
+    for (double q : quantiles) {
+        double exact = q * 100000;
+        auto estimate = (double) rs_metrics_rtt_quantile(buckets.data(), q);
+        ASSERT_GE(estimate, exact);
+        ASSERT_LE(estimate, exact * (1 + 1.0 / RS_METRICS_RTT_SUB_BUCKETS));
+    }
+    ASSERT_EQ(rs_metrics_rtt_quantile(buckets.data(), 0), rs_metrics_rtt_bucket_limit(rs_metrics_rtt_bucket(1000)));
+    rs_metrics_reset_lambda(id);
+    rs_metrics_get_lambda(id, &m);
+    ASSERT_EQ(m.rtt_count, 0u);
+    rs_metrics_get_rtt_histogram(id, buckets.data());
+    ASSERT_EQ(rs_metrics_rtt_quantile(buckets.data(), 0.5), 0u);
+}
+
+TEST(rs_metrics, counters) {
+    const lambda_id_t id = 4;
+    rs_metrics_reset_lambda(id);
+    uint64_t notfound = rs_metrics_get_code(RS_CALL_NOTFOUND);
+    uint64_t device_error = rs_metrics_get_code(-42);
+    uint64_t empty = rs_metrics_get_cache(RS_CACHE_ONLY, RS_METRICS_CACHE_EMPTY);
+    rs_metrics_count_call(id, RS_CALL_SUCCESS);
+    rs_metrics_count_call(id, -42);
+    rs_metrics_count_call(MAX_LAMBDAS, RS_CALL_NOTFOUND);
+    rs_metrics_count_sent(id);
+    rs_metrics_count_received(id);
+    rs_metrics_count_timeout(id);
+    rs_metrics_count_cache(RS_CACHE_ONLY, RS_METRICS_CACHE_EMPTY);
+    // unknown policies and outcomes are ignored
+    rs_metrics_count_cache(RS_CACHE_ON_TIMEOUT + 1, RS_METRICS_CACHE_HIT);
+    rs_metrics_count_cache(RS_CACHE_ONLY, RS_METRICS_CACHE_OUTCOMES);
+    rs_lambda_metrics m;
+    rs_metrics_get_lambda(id, &m);
+    ASSERT_EQ(m.calls, 2u);
+    ASSERT_EQ(m.sent, 1u);
+    ASSERT_EQ(m.received, 1u);
+    ASSERT_EQ(m.timeouts, 1u);
+    ASSERT_EQ(rs_metrics_get_code(RS_CALL_NOTFOUND), notfound + 1);
+    ASSERT_EQ(rs_metrics_get_code(-42), device_error + 1);
+    ASSERT_EQ(rs_metrics_get_cache(RS_CACHE_ONLY, RS_METRICS_CACHE_EMPTY), empty + 1);
+    ASSERT_EQ(rs_metrics_get_cache(RS_CACHE_ON_TIMEOUT + 1, RS_METRICS_CACHE_HIT), 0u);
+}
+
+TEST(rs_metrics, concurrent_recording) {
+    const unsigned int threads = 4;
+    const unsigned int per_thread = 100000;
+    for (lambda_id_t id = 0; id < threads; id++) {
+        rs_metrics_reset_lambda(id);
+    }
+    rs_metrics_reset_lambda(10);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threads; t++) {
+        workers.emplace_back([t, per_thread]() {
+            for (unsigned int i = 0; i < per_thread; i++) {
+                rs_metrics_count_sent((lambda_id_t) t);
+                rs_metrics_record_rtt((lambda_id_t) t, i % 5000);
+                // all threads share the counters of this lambda
+                rs_metrics_count_received(10);
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    rs_lambda_metrics m;
+    for (lambda_id_t id = 0; id < threads; id++) {
+        rs_metrics_get_lambda(id, &m);
+        ASSERT_EQ(m.sent, per_thread);
+        ASSERT_EQ(m.rtt_count, per_thread);
+    }
+    rs_metrics_get_lambda(10, &m);
+    ASSERT_EQ(m.received, (uint64_t) threads * per_thread);
+}
+
+TEST(rs_metrics, DISABLED_benchmark_recording) {
+    const unsigned int per_thread = 10000000;
+    const unsigned int max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int t = 0; t < threads; t++) {
+            workers.emplace_back([t, per_thread]() {
+                for (unsigned int i = 0; i < per_thread; i++) {
+                    // what a call of an uncached lambda records
+                    rs_metrics_count_sent((lambda_id_t) t);
+                    rs_metrics_record_rtt((lambda_id_t) t, 800 + i % 4096);
+                    rs_metrics_count_received((lambda_id_t) t);
+                    rs_metrics_count_call((lambda_id_t) t, RS_CALL_SUCCESS);
+                }
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        auto time = std::chrono::steady_clock::now() - start;
+        printf("%u threads: %.1f ns per recorded call\n", threads,
+               (double) std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / per_thread);
+    }
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <rs_shm.h>
+
+static std::string test_shm_name() {
+    return "/rs_shm_test_" + std::to_string(getpid());
+}
+
+TEST(rs_shm, write_and_read) {
+    std::string name = test_shm_name();
+    ASSERT_EQ(rs_shm_attach(name.c_str()), nullptr);
+    ASSERT_EQ(rs_shm_create(name.c_str()), 0);
+    ASSERT_TRUE(rs_shm_enabled());
+    rs_shm_table *table = rs_shm_attach(name.c_str());
+    ASSERT_NE(table, nullptr);
+    ASSERT_EQ(table->slot_count, (uint32_t) RS_SHM_SLOTS);
+    ASSERT_EQ(rs_shm_find(table, "temp"), -1);
+
+    rs_shm_slot slot{};
+    slot.state = RS_SHM_VALUE;
+    slot.type = 2;
+    slot.version = 7;
+    slot.timestamp = 1000;
+    strcpy(slot.name, "temp");
+    slot.value.d = 21.5;
+    rs_shm_write(3, &slot);
+    ASSERT_EQ(rs_shm_find(table, "temp"), 3);
+    rs_shm_slot read{};
+    ASSERT_TRUE(rs_shm_read(table, 3, &read));
+    ASSERT_EQ(read.seq % 2, 0u);
+    ASSERT_EQ(read.version, 7u);
+    ASSERT_EQ(read.timestamp, 1000u);
+    ASSERT_EQ(read.value.d, 21.5);
+    ASSERT_FALSE(rs_shm_read(table, 4, &read));
+    ASSERT_FALSE(rs_shm_read(table, 255, &read));
+
+    rs_shm_clear(3);
+    ASSERT_FALSE(rs_shm_read(table, 3, &read));
+    ASSERT_EQ(rs_shm_find(table, "temp"), -1);
+    rs_shm_detach(table);
+    rs_shm_destroy();
+    ASSERT_FALSE(rs_shm_enabled());
+    ASSERT_EQ(rs_shm_attach(name.c_str()), nullptr);
+}
+
+TEST(rs_shm, consistent_snapshots) {
+    std::string name = test_shm_name();
+    ASSERT_EQ(rs_shm_create(name.c_str()), 0);
+    rs_shm_table *table = rs_shm_attach(name.c_str());
+    ASSERT_NE(table, nullptr);
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> writes(0);
+    std::thread writer([&stop, &writes]() {
+        rs_shm_slot slot{};
+        slot.state = RS_SHM_VALUE;
+        slot.type = 1;
+        for (uint32_t k = 1; !stop; k++) {
+            slot.version = k;
+            slot.timestamp = k;
+            slot.value.i = (int32_t) k;
+            rs_shm_write(0, &slot);
+            writes = k;
+        }
+    });
+    while (writes == 0) {
+        std::this_thread::yield();
+    }
+    rs_shm_slot read{};
+    uint32_t last = 0;
+    for (size_t i = 0; i < 200000; i++) {
+        if (rs_shm_read(table, 0, &read)) {
+            // a torn read would mix fields of different writes
+            ASSERT_EQ(read.timestamp, read.version);
+            ASSERT_EQ(read.value.i, (int32_t) read.version);
+            ASSERT_GE(read.version, last);
+            last = read.version;
+        }
+    }
+    stop = true;
+    writer.join();
+    ASSERT_TRUE(rs_shm_read(table, 0, &read));
+    ASSERT_EQ(read.version, writes.load());
+    rs_shm_detach(table);
+    rs_shm_destroy();
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <poll.h>
+
+#include <rs_stream.h>
+
+static rs_stream_update make_update(lambda_id_t id, rs_int_t value) {
+    rs_stream_update u{};
+    u.id = id;
+    u.type = RS_LAMBDA_INT;
+    u.version = (uint32_t) value;
+    u.timestamp = 1000 + (uint64_t) value;
+    u.value.ret_i = value;
+    return u;
+}
+
+TEST(rs_stream, filter) {
+    uint8_t ids[(MAX_LAMBDAS + 7) / 8] = {0};
+    ids[0] = 1 << 3;
+    rs_stream s;
+    rs_stream_init(&s, ids, RS_LAMBDA_INT);
+    ASSERT_TRUE(rs_stream_matches(&s, 3, RS_LAMBDA_INT));
+    ASSERT_FALSE(rs_stream_matches(&s, 3, RS_LAMBDA_DOUBLE));
+    ASSERT_FALSE(rs_stream_matches(&s, 4, RS_LAMBDA_INT));
+    rs_stream_free(&s);
+    rs_stream_init(&s, nullptr, 0);
+    ASSERT_TRUE(rs_stream_matches(&s, 254, RS_LAMBDA_STRING));
+    rs_stream_free(&s);
+}
+
+TEST(rs_stream, latest_value_wins) {
+    rs_stream s;
+    rs_stream_init(&s, nullptr, 0);
+    rs_stream_update u = make_update(1, 10);
+    rs_stream_push(&s, &u);
+    u = make_update(2, 20);
+    rs_stream_push(&s, &u);
+    u = make_update(1, 11);
+    rs_stream_push(&s, &u);
+    rs_stream_update out[4];
+    ASSERT_EQ(rs_stream_read(&s, out, 4, 0), 2u);
+    // the coalesced update keeps the position of the first one
+    ASSERT_EQ(out[0].id, 1);
+    ASSERT_EQ(out[0].value.ret_i, 11);
+    ASSERT_EQ(out[1].id, 2);
+    ASSERT_EQ(s.coalesced, 1u);
+    u = make_update(1, 12);
+    rs_stream_push(&s, &u);
+    ASSERT_EQ(rs_stream_read(&s, out, 4, 0), 1u);
+    ASSERT_EQ(out[0].value.ret_i, 12);
+    ASSERT_EQ(s.coalesced, 1u);
+    rs_stream_free(&s);
+}
+
+TEST(rs_stream, drops_oldest_when_full) {
+    rs_stream s;
+    rs_stream_init(&s, nullptr, 0);
+    for (int i = 0; i < RS_STREAM_QUEUE_CAPACITY + 2; i++) {
+        rs_stream_update u = make_update((lambda_id_t) i, i);
+        rs_stream_push(&s, &u);
+    }
+    ASSERT_EQ(s.dropped, 2u);
+    rs_stream_update out[RS_STREAM_QUEUE_CAPACITY];
+    ASSERT_EQ(rs_stream_read(&s, out, RS_STREAM_QUEUE_CAPACITY, 0), (size_t) RS_STREAM_QUEUE_CAPACITY);
+    ASSERT_EQ(out[0].id, 2);
+    ASSERT_EQ(out[RS_STREAM_QUEUE_CAPACITY - 1].id, RS_STREAM_QUEUE_CAPACITY + 1);
+    // a dropped lambda is queued again by its next result
+    rs_stream_update u = make_update(0, 5);
+    rs_stream_push(&s, &u);
+    ASSERT_EQ(rs_stream_read(&s, out, 1, 0), 1u);
+    ASSERT_EQ(out[0].id, 0);
+    rs_stream_free(&s);
+}
+
+TEST(rs_stream, strings_are_copied) {
+    rs_stream s;
+    rs_stream_init(&s, nullptr, 0);
+    char value[] = "abc";
+    rs_stream_update u{};
+    u.id = 7;
+    u.type = RS_LAMBDA_STRING;
+    u.value.ret_s = value;
+    rs_stream_push(&s, &u);
+    value[0] = 'x';
+    rs_stream_update out;
+    ASSERT_EQ(rs_stream_read(&s, &out, 1, 0), 1u);
+    ASSERT_STREQ(out.value.ret_s, "abc");
+    rs_stream_update_free(&out);
+    // queued strings are freed with the stream
+    rs_stream_push(&s, &u);
+    rs_stream_push(&s, &u);
+    rs_stream_free(&s);
+}
+
+TEST(rs_stream, read_waits_and_close_wakes) {
+    rs_stream s;
+    rs_stream_init(&s, nullptr, 0);
+    rs_stream_update out;
+    ASSERT_EQ(rs_stream_read(&s, &out, 1, 10), 0u);
+    std::thread pusher([&s]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        rs_stream_update u = make_update(1, 1);
+        rs_stream_push(&s, &u);
+    });
+    ASSERT_EQ(rs_stream_read(&s, &out, 1, 5000), 1u);
+    pusher.join();
+    std::thread closer([&s]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        rs_stream_close(&s);
+    });
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(rs_stream_read(&s, &out, 1, 5000), 0u);
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(4));
+    ASSERT_TRUE(rs_stream_closed(&s));
+    closer.join();
+    rs_stream_free(&s);
+}
+
+static bool fd_readable(int fd) {
+    struct pollfd p = {fd, POLLIN, 0};
+    return poll(&p, 1, 0) == 1;
+}
+
+TEST(rs_stream, fd_signals_batches) {
+    rs_stream s;
+    rs_stream_init(&s, nullptr, 0);
+    int fd = rs_stream_fd(&s);
+    ASSERT_GE(fd, 0);
+    ASSERT_FALSE(fd_readable(fd));
+    rs_stream_update u = make_update(1, 1);
+    rs_stream_push(&s, &u);
+    u = make_update(2, 2);
+    rs_stream_push(&s, &u);
+    ASSERT_TRUE(fd_readable(fd));
+    rs_stream_clear_fd(&s);
+    ASSERT_FALSE(fd_readable(fd));
+    rs_stream_update out[4];
+    ASSERT_EQ(rs_stream_read(&s, out, 4, 0), 2u);
+    // the next update into the empty queue signals again
+    u = make_update(3, 3);
+    rs_stream_push(&s, &u);
+    ASSERT_TRUE(fd_readable(fd));
+    rs_stream_clear_fd(&s);
+    ASSERT_EQ(rs_stream_read(&s, out, 4, 0), 1u);
+    rs_stream_close(&s);
+    ASSERT_TRUE(fd_readable(fd));
+    rs_stream_free(&s);
+}
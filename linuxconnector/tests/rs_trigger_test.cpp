@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <poll.h>
+
+#include <rs_trigger.h>
+
+TEST(rs_trigger, parse) {
+    rs_trigger t;
+    ASSERT_EQ(rs_trigger_parse(&t, "hot=temp:above:30.5"), RS_TRIGGER_SUCCESS);
+    ASSERT_STREQ(t.name, "hot");
+    ASSERT_STREQ(t.lambda, "temp");
+    ASSERT_EQ(t.kind, RS_TRIGGER_ABOVE);
+    ASSERT_EQ(t.high, 30.5);
+    ASSERT_EQ(rs_trigger_parse(&t, "fan=temp:hysteresis:28:30"), RS_TRIGGER_SUCCESS);
+    ASSERT_EQ(t.kind, RS_TRIGGER_HYSTERESIS);
+    ASSERT_EQ(t.low, 28.0);
+    ASSERT_EQ(t.high, 30.0);
+    ASSERT_EQ(rs_trigger_parse(&t, "fan=temp:hysteresis:30:28"), RS_TRIGGER_SYNTAX);
+    ASSERT_EQ(rs_trigger_parse(&t, "jump=temp:rate:"), RS_TRIGGER_SYNTAX);
+    ASSERT_EQ(rs_trigger_parse(&t, "jump=temp:speed:1"), RS_TRIGGER_SYNTAX);
+    ASSERT_EQ(rs_trigger_parse(&t, "=temp:above:1"), RS_TRIGGER_INVALNAME);
+    ASSERT_EQ(rs_trigger_parse(&t, "a=b:below:1x"), RS_TRIGGER_SYNTAX);
+}
+
+TEST(rs_trigger, threshold_fires_on_crossing) {
+    rs_trigger t;
+    rs_trigger_parse(&t, "hot=temp:above:30");
+    rs_trigger_event e;
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 1000, 29.0, &e));
+    ASSERT_TRUE(rs_trigger_evaluate(&t, 2000, 31.0, &e));
+    ASSERT_EQ(e.value, 31.0);
+    ASSERT_EQ(e.timestamp, 2000u);
+    ASSERT_STREQ(e.trigger, "hot");
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 3000, 32.0, &e));
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 4000, 29.0, &e));
+    ASSERT_TRUE(rs_trigger_evaluate(&t, 5000, 30.5, &e));
+}
+
+TEST(rs_trigger, rate) {
+    rs_trigger t;
+    rs_trigger_parse(&t, "jump=temp:rate:2");
+    rs_trigger_event e;
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 1000, 20.0, &e));
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 2000, 21.0, &e));
+    ASSERT_TRUE(rs_trigger_evaluate(&t, 2500, 19.0, &e));
+    ASSERT_EQ(e.value, -4.0);
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 3000, 17.0, &e));
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 4000, 17.5, &e));
+    ASSERT_TRUE(rs_trigger_evaluate(&t, 5000, 20.0, &e));
+}
+
+TEST(rs_trigger, hysteresis) {
+    rs_trigger t;
+    rs_trigger_parse(&t, "fan=temp:hysteresis:28:30");
+    rs_trigger_event e;
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 1000, 29.0, &e));
+    ASSERT_TRUE(rs_trigger_evaluate(&t, 2000, 30.0, &e));
+    ASSERT_TRUE(e.active);
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 3000, 29.0, &e));
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 4000, 31.0, &e));
+    ASSERT_TRUE(rs_trigger_evaluate(&t, 5000, 27.5, &e));
+    ASSERT_FALSE(e.active);
+    ASSERT_FALSE(rs_trigger_evaluate(&t, 6000, 29.5, &e));
+}
+
+TEST(rs_trigger, queue_drops_oldest) {
+    auto q = new rs_event_queue;
+    rs_event_queue_init(q);
+    rs_trigger_event e{};
+    for (int i = 0; i < RS_EVENT_QUEUE_CAPACITY + 10; i++) {
+        e.value = i;
+        rs_event_queue_push(q, &e);
+    }
+    ASSERT_EQ(rs_event_queue_dropped(q), 10u);
+    rs_trigger_event out[4];
+    ASSERT_EQ(rs_event_queue_read(q, 0, out, 4, 0), 4u);
+    ASSERT_EQ(out[0].seq, 11u);
+    ASSERT_EQ(out[0].value, 10.0);
+    ASSERT_EQ(rs_event_queue_read(q, RS_EVENT_QUEUE_CAPACITY + 8, out, 4, 0), 2u);
+    ASSERT_EQ(out[1].seq, (uint64_t) RS_EVENT_QUEUE_CAPACITY + 10);
+    ASSERT_EQ(rs_event_queue_read(q, RS_EVENT_QUEUE_CAPACITY + 10, out, 4, 10), 0u);
+    rs_event_queue_free(q);
+    delete q;
+}
+
+TEST(rs_trigger, queue_fd) {
+    auto q = new rs_event_queue;
+    rs_event_queue_init(q);
+    int fd = rs_event_queue_fd(q);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(rs_event_queue_fd(q), fd);
+    pollfd p = {fd, POLLIN, 0};
+    ASSERT_EQ(poll(&p, 1, 0), 0);
+    rs_trigger_event e{};
+    rs_event_queue_push(q, &e);
+    rs_event_queue_push(q, &e);
+    ASSERT_EQ(poll(&p, 1, 0), 1);
+    rs_event_queue_clear_fd(q);
+    ASSERT_EQ(poll(&p, 1, 0), 0);
+    rs_trigger_event out[4];
+    ASSERT_EQ(rs_event_queue_read(q, 0, out, 4, 0), 2u);
+    rs_event_queue_free(q);
+    delete q;
+}
@@ -74,6 +74,15 @@ typedef struct {
  */
 lambda_id_t get_number_of_registered_lambdas(void);
 
+/**
+ * @brief Get a number that changes whenever the registry is initialized or freed
+ *
+ * Lets state kept alongside the registry notice that the registry was reset.
+ *
+ * @return Generation of the registry
+ */
+uint32_t get_lambda_registry_generation(void);
+
 /**
  * @brief Initialize the internal lambda registry
  */
@@ -100,6 +109,19 @@ rs_registered_lambda *get_registered_lambda_by_id(const lambda_id_t id);
  */
 rs_registered_lambda *get_registered_lambda_by_name(const char *name);
 
+/**
+ * @brief Get the IDs of the registered lambdas whose name starts with a prefix
+ *
+ * The names are kept in a prefix index, so the cost grows with the length of the prefix and the number of matching
+ * lambdas instead of the number of registered lambdas.
+ *
+ * @param prefix Prefix of the names, an empty prefix matches all lambdas
+ * @param ids Where to store the IDs of the matching lambdas, in the order of their names
+ * @param max Maximum number of IDs to store
+ * @return Number of matching lambdas, may be larger than max
+ */
+size_t get_registered_lambdas_by_prefix(const char *prefix, lambda_id_t *ids, size_t max);
+
 /**
  * @brief Register a new lambda
  *
@@ -73,6 +73,8 @@ const char *stringify_rs_unregister_result(int8_t c);
 #define RS_CALL_CACHE_EMPTY -4
 /** @brief Result could not be retrieved in time and was not found in cache */
 #define RS_CALL_CACHE_TIMEOUT_EMPTY -5
+/** @brief The call was not sent because too many calls are waiting for the device */
+#define RS_CALL_OVERLOAD -6
 
 /**
  * @brief Get a human readable string for a call result
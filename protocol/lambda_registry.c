@@ -7,9 +7,29 @@
 #include <lambda_registry.h>
 
 #include <ctype.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+/**
+ * @brief A node of the prefix index over the names of the registered lambdas
+ *
+ * The children of a node are a list sorted by their character, which keeps the index small for short alphanumeric
+ * names and yields the lambdas of a prefix in the order of their names.
+ */
+typedef struct lambda_name_node {
+    /** @brief First child */
+    struct lambda_name_node *child;
+    /** @brief Next node with the same parent and a larger character */
+    struct lambda_name_node *sibling;
+    /** @brief Character of the names at the depth of this node */
+    char c;
+    /** @brief If the name of a registered lambda ends at this node */
+    bool terminal;
+    /** @brief ID of the lambda whose name ends at this node */
+    lambda_id_t id;
+} lambda_name_node;
+
 /**
  * All registered lambdas
  */
@@ -20,14 +40,160 @@ static rs_registered_lambda *lambda_registry[MAX_LAMBDAS];
  */
 static lambda_id_t lambda_counter = 0;
 
+/**
+ * Changed by every init_lambda_registry() and free_lambda_registry()
+ */
+static uint32_t registry_generation = 0;
+
+/**
+ * Children of the root of the name index, the root itself stands for the empty name
+ */
+static lambda_name_node *lambda_names = NULL;
+
+/**
+ * @brief Find the position of a character in a sorted list of nodes
+ *
+ * @param list Link to the first node of the list
+ * @param c Character
+ * @return Link to the node with the character, or to the first node with a larger character where it is inserted
+ */
+static lambda_name_node **name_index_find(lambda_name_node **list, char c) {
+    while (*list != NULL && (unsigned char) (*list)->c < (unsigned char) c) {
+        list = &(*list)->sibling;
+    }
+    return list;
+}
+
+/**
+ * @brief Add a name to the index
+ *
+ * @param name Name of the lambda
+ * @param id ID of the lambda
+ * @return If the nodes could be allocated, nodes added before a failure are removed by name_index_remove()
+ */
+static bool name_index_add(const char *name, lambda_id_t id) {
+    lambda_name_node **list = &lambda_names;
+    lambda_name_node *node = NULL;
+    for (const char *p = name; *p != '\0'; p++) {
+        lambda_name_node **link = name_index_find(list, *p);
+        if (*link == NULL || (*link)->c != *p) {
+            lambda_name_node *added = malloc(sizeof(lambda_name_node));
+            if (added == NULL) {
+                return false;
+            }
+            added->child = NULL;
+            added->sibling = *link;
+            added->c = *p;
+            added->terminal = false;
+            added->id = 0;
+            *link = added;
+        }
+        node = *link;
+        list = &node->child;
+    }
+    if (node == NULL) {
+        return false;
+    }
+    node->terminal = true;
+    node->id = id;
+    return true;
+}
+
+/**
+ * @brief Remove a name from the index and free the nodes no other name uses
+ *
+ * @param list Link to the first node of the list the name continues in
+ * @param name Rest of the name
+ */
+static void name_index_remove(lambda_name_node **list, const char *name) {
+    lambda_name_node **link = name_index_find(list, *name);
+    lambda_name_node *node = *link;
+    if (node == NULL || node->c != *name) {
+        return;
+    }
+    if (name[1] == '\0') {
+        node->terminal = false;
+    } else {
+        name_index_remove(&node->child, name + 1);
+    }
+    if (!node->terminal && node->child == NULL) {
+        *link = node->sibling;
+        free(node);
+    }
+}
+
+/**
+ * @brief Find the node a name ends at
+ *
+ * @param name Name, may be empty
+ * @param list Where to store the children of the node
+ * @return The node, NULL if no name starts with the given one or the name is empty
+ */
+static lambda_name_node *name_index_lookup(const char *name, lambda_name_node **list) {
+    lambda_name_node *node = NULL;
+    *list = lambda_names;
+    for (const char *p = name; *p != '\0'; p++) {
+        node = *name_index_find(list, *p);
+        if (node == NULL || node->c != *p) {
+            *list = NULL;
+            return NULL;
+        }
+        *list = node->child;
+    }
+    return node;
+}
+
+/**
+ * @brief Collect the IDs of all names in a list of nodes and below, in the order of the names
+ *
+ * @param node First node of the list
+ * @param ids Where to store the IDs
+ * @param count Number of IDs collected so far
+ * @param max Maximum number of IDs to store
+ * @return Number of IDs collected, including those that did not fit
+ */
+static size_t name_index_collect(const lambda_name_node *node, lambda_id_t *ids, size_t count, size_t max) {
+    for (; node != NULL; node = node->sibling) {
+        if (node->terminal) {
+            if (count < max) {
+                ids[count] = node->id;
+            }
+            count++;
+        }
+        count = name_index_collect(node->child, ids, count, max);
+    }
+    return count;
+}
+
+/**
+ * @brief Free a list of nodes and everything below
+ *
+ * @param node First node of the list
+ */
+static void name_index_free(lambda_name_node *node) {
+    while (node != NULL) {
+        lambda_name_node *sibling = node->sibling;
+        name_index_free(node->child);
+        free(node);
+        node = sibling;
+    }
+}
+
 lambda_id_t get_number_of_registered_lambdas(void) {
     return lambda_counter;
 }
 
+uint32_t get_lambda_registry_generation(void) {
+    return registry_generation;
+}
+
 void init_lambda_registry(void) {
+    registry_generation++;
     for (lambda_id_t i = 0; i < MAX_LAMBDAS; i++) {
         lambda_registry[i] = NULL;
     }
+    name_index_free(lambda_names);
+    lambda_names = NULL;
 }
 
 void free_lambda_registry(void) {
@@ -38,6 +204,9 @@ void free_lambda_registry(void) {
         }
     }
     lambda_counter = 0;
+    registry_generation++;
+    name_index_free(lambda_names);
+    lambda_names = NULL;
 }
 
 rs_registered_lambda *get_registered_lambda_by_id(const lambda_id_t id) {
@@ -49,14 +218,26 @@ rs_registered_lambda *get_registered_lambda_by_id(const lambda_id_t id) {
 }
 
 rs_registered_lambda *get_registered_lambda_by_name(const char *name) {
-    for (lambda_id_t i = 0; i < lambda_counter; i++) {
-        if (lambda_registry[i] != NULL) {
-            if (strcmp(lambda_registry[i]->name, name) == 0) {
-                return lambda_registry[i];
-            }
+    lambda_name_node *list;
+    lambda_name_node *node = name_index_lookup(name, &list);
+    if (node == NULL || !node->terminal) {
+        return NULL;
+    }
+    return lambda_registry[node->id];
+}
+
+size_t get_registered_lambdas_by_prefix(const char *prefix, lambda_id_t *ids, size_t max) {
+    lambda_name_node *list;
+    lambda_name_node *node = name_index_lookup(prefix, &list);
+    size_t count = 0;
+    if (node != NULL && node->terminal) {
+        // the prefix itself is a name and sorts before the longer ones
+        if (max > 0) {
+            ids[0] = node->id;
         }
+        count++;
     }
-    return NULL;
+    return name_index_collect(list, ids, count, max);
 }
 
 int8_t
@@ -91,6 +272,12 @@ lambda_registry_register(const char *name, const rs_lambda_type_t type, const rs
     lambda_registry[myid]->type = type;
     lambda_registry[myid]->cache = cache;
     lambda_registry[myid]->arg = arg;
+    if (!name_index_add(name, myid)) {
+        name_index_remove(&lambda_names, name);
+        free(lambda_registry[myid]);
+        lambda_registry[myid] = NULL;
+        return RS_REGISTER_NOMEM;
+    }
     lambda_counter++;
     return myid;
 }
@@ -102,6 +289,7 @@ int8_t lambda_registry_unregister(const lambda_id_t id) {
     if (lambda_registry[id] == NULL) {
         return RS_UNREGISTER_NOTFOUND;
     }
+    name_index_remove(&lambda_names, lambda_registry[id]->name);
     free(lambda_registry[id]);
     lambda_registry[id] = NULL;
     return RS_UNREGISTER_SUCCESS;
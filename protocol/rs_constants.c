@@ -28,12 +28,12 @@ const char *stringify_rs_unregister_result(int8_t c) {
 }
 
 const char *stringify_rs_call_result(int8_t c) {
-    static const char *strings[] = {"RS_CALL_CACHE_TIMEOUT_EMPTY", "RS_CALL_CACHE_EMPTY", "RS_CALL_TIMEOUT",
-                                    "RS_CALL_WRONGTYPE", "RS_CALL_NOTFOUND", "RS_CALL_SUCCESS", "RS_CALL_CACHE",
-                                    "RS_CALL_CACHE_TIMEOUT"};
-    if (c < -5 || c > 2) {
+    static const char *strings[] = {"RS_CALL_OVERLOAD", "RS_CALL_CACHE_TIMEOUT_EMPTY", "RS_CALL_CACHE_EMPTY",
+                                    "RS_CALL_TIMEOUT", "RS_CALL_WRONGTYPE", "RS_CALL_NOTFOUND", "RS_CALL_SUCCESS",
+                                    "RS_CALL_CACHE", "RS_CALL_CACHE_TIMEOUT"};
+    if (c < -6 || c > 2) {
         return NULL;
     } else {
-        return strings[c + 5];
+        return strings[c + 6];
     }
 }
@@ -51,4 +51,45 @@ TEST(lambda_registry, unregister) {
     ASSERT_EQ(id = lambda_registry_register("myDouble", RS_LAMBDA_INT, RS_CACHE_NO_CACHE, larg2), 1);
     ASSERT_EQ(get_registered_lambda_by_id(id)->arg.obj, &testval2);
     free_lambda_registry();
-}
\ No newline at end of file
+}
+
+TEST(lambda_registry, prefix) {
+    init_lambda_registry();
+    lambda_arg larg;
+    larg.obj = &testval1;
+    ASSERT_EQ(lambda_registry_register("tempA2", RS_LAMBDA_INT, RS_CACHE_NO_CACHE, larg), 0);
+    ASSERT_EQ(lambda_registry_register("humA1", RS_LAMBDA_INT, RS_CACHE_NO_CACHE, larg), 1);
+    ASSERT_EQ(lambda_registry_register("tempA1", RS_LAMBDA_INT, RS_CACHE_NO_CACHE, larg), 2);
+    ASSERT_EQ(lambda_registry_register("temp", RS_LAMBDA_INT, RS_CACHE_NO_CACHE, larg), 3);
+    ASSERT_EQ(lambda_registry_register("tem", RS_LAMBDA_INT, RS_CACHE_NO_CACHE, larg), 4);
+    lambda_id_t ids[MAX_LAMBDAS];
+    // matches are sorted by name, a name equal to the prefix comes first
+    ASSERT_EQ(get_registered_lambdas_by_prefix("temp", ids, MAX_LAMBDAS), 3u);
+    ASSERT_EQ(ids[0], 3);
+    ASSERT_EQ(ids[1], 2);
+    ASSERT_EQ(ids[2], 0);
+    ASSERT_EQ(get_registered_lambdas_by_prefix("tempA1", ids, MAX_LAMBDAS), 1u);
+    ASSERT_EQ(ids[0], 2);
+    ASSERT_EQ(get_registered_lambdas_by_prefix("tempB", ids, MAX_LAMBDAS), 0u);
+    ASSERT_EQ(get_registered_lambdas_by_prefix("tempA12", ids, MAX_LAMBDAS), 0u);
+    ASSERT_EQ(get_registered_lambdas_by_prefix("", ids, MAX_LAMBDAS), 5u);
+    ASSERT_EQ(ids[0], 1);
+    // the count includes the matches that did not fit
+    ASSERT_EQ(get_registered_lambdas_by_prefix("te", ids, 2), 4u);
+    ASSERT_EQ(ids[0], 4);
+    ASSERT_EQ(ids[1], 3);
+    // a name that is a prefix of others stays in the index when they are unregistered and the other way round
+    ASSERT_EQ(lambda_registry_unregister(3), RS_UNREGISTER_SUCCESS);
+    ASSERT_EQ(get_registered_lambda_by_name("temp"), (void *) NULL);
+    ASSERT_EQ(get_registered_lambda_by_name("tempA1")->id, 2);
+    ASSERT_EQ(get_registered_lambdas_by_prefix("temp", ids, MAX_LAMBDAS), 2u);
+    ASSERT_EQ(lambda_registry_unregister(2), RS_UNREGISTER_SUCCESS);
+    ASSERT_EQ(lambda_registry_unregister(0), RS_UNREGISTER_SUCCESS);
+    ASSERT_EQ(get_registered_lambdas_by_prefix("temp", ids, MAX_LAMBDAS), 0u);
+    ASSERT_EQ(get_registered_lambdas_by_prefix("te", ids, MAX_LAMBDAS), 1u);
+    ASSERT_EQ(get_registered_lambda_by_name("tem")->id, 4);
+    ASSERT_EQ(lambda_registry_register("tempA1", RS_LAMBDA_INT, RS_CACHE_NO_CACHE, larg), 5);
+    ASSERT_EQ(get_registered_lambda_by_name("tempA1")->id, 5);
+    free_lambda_registry();
+    ASSERT_EQ(get_registered_lambdas_by_prefix("", ids, MAX_LAMBDAS), 0u);
+}
@@ -0,0 +1,147 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Floods the CoAP server with requests and prints the packets per second it answers with a growing number
+ *          of worker threads
+ * @file    rs_coap_bench.cpp
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * The server runs in this process on a local port. Every flooder thread uses a socket of its own, so SO_REUSEPORT
+ * spreads the flooders across the workers, and keeps a window of non-confirmable GET requests for /v1/stats in
+ * flight. Every answer is followed by a new request, requests lost in full socket buffers are resent after a
+ * timeout.
+ *
+ * Usage: riotsensors_coap_bench [SECONDS [FLOODERS [MAX_WORKERS]]]
+ */
+
+#include <rs_server_coap.h>
+
+#include <arpa/inet.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/** @brief Port of the benchmarked server */
+#define BENCH_COAP_PORT 56840
+/** @brief Requests every flooder keeps in flight */
+#define BENCH_WINDOW 32
+/** @brief Milliseconds without an answer after which a flooder resends its window */
+#define BENCH_TIMEOUT 100
+
+/**
+ * @brief Build a non-confirmable GET request for /v1/stats
+ *
+ * @param id Message ID
+ * @return Encoded request
+ */
+static std::string stats_request(uint16_t id) {
+    std::string pdu;
+    pdu += (char) 0x50;
+    pdu += (char) 0x01;
+    pdu += (char) (id >> 8);
+    pdu += (char) id;
+    pdu += (char) 0xb2;
+    pdu += "v1";
+    pdu += (char) 0x05;
+    pdu += "stats";
+    return pdu;
+}
+
+/**
+ * @brief Send requests and count the answers until stop is set
+ *
+ * @param stop Set when the measurement is over
+ * @param answers Incremented for every answer
+ */
+static void flood(const std::atomic<bool> *stop, std::atomic<uint64_t> *answers) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(BENCH_COAP_PORT);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (const sockaddr *) &server, sizeof(server)) < 0) {
+        perror("flooder");
+        return;
+    }
+    uint16_t id = 0;
+    uint64_t local = 0;
+    char buf[1500];
+    while (!stop->load()) {
+        for (int i = 0; i < BENCH_WINDOW; i++) {
+            std::string pdu = stats_request(id++);
+            send(fd, pdu.data(), pdu.length(), 0);
+        }
+        pollfd p = {fd, POLLIN, 0};
+        while (!stop->load() && poll(&p, 1, BENCH_TIMEOUT) > 0) {
+            while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+                local++;
+                std::string pdu = stats_request(id++);
+                send(fd, pdu.data(), pdu.length(), 0);
+            }
+        }
+    }
+    answers->fetch_add(local);
+    close(fd);
+}
+
+/**
+ * @brief Measure the answers per second of a server with a number of workers
+ *
+ * @param workers Number of CoAP worker threads
+ * @param flooders Number of flooder threads
+ * @param seconds Duration of the measurement
+ */
+static void measure(unsigned int workers, unsigned int flooders, unsigned int seconds) {
+    riotsensors_start_opts opts{};
+    opts.coap_port = BENCH_COAP_PORT;
+    opts.coap_threads = workers;
+    opts.observe_interval = RS_OBSERVE_DEFAULT_INTERVAL;
+    std::thread server(startCoAPServer, &opts);
+    // let the workers bind their sockets before the flooders pick one
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> answers(0);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < flooders; i++) {
+        threads.emplace_back(flood, &stop, &answers);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stopCoAPServer();
+    server.join();
+    printf("%-8u %12.0f\n", workers, answers.load() / elapsed);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int seconds = argc > 1 ? (unsigned int) strtoul(argv[1], nullptr, 10) : 3;
+    unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+    unsigned int flooders = argc > 2 ? (unsigned int) strtoul(argv[2], nullptr, 10) : cores;
+    unsigned int max_workers = argc > 3 ? (unsigned int) strtoul(argv[3], nullptr, 10) : cores;
+    if (seconds == 0 || flooders == 0 || max_workers == 0) {
+        fprintf(stderr, "Usage: %s [SECONDS [FLOODERS [MAX_WORKERS]]]\n", argv[0]);
+        return 1;
+    }
+    printf("%u flooders with %d requests in flight each, %u seconds per run\n", flooders, BENCH_WINDOW, seconds);
+    printf("%-8s %12s\n", "workers", "answers/s");
+    for (unsigned int workers = 1; workers <= max_workers; workers *= 2) {
+        measure(workers, flooders, seconds);
+    }
+    return 0;
+}
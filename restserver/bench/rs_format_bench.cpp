@@ -0,0 +1,173 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Compares payload size and serialization time of JSON and CBOR responses and the effect of compressing them
+ * @file    rs_format_bench.cpp
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * Fills the registry with int, double and string lambdas with cached results and serializes the list, showcache
+ * and call responses in both formats, the call of the double lambda also with a pre-serialized lambda fragment and
+ * in the compact field selections. The list and showcache bodies are compressed with gzip and deflate
+ * afterwards, the compression time is what the first request after a change costs, later ones are served from
+ * the response cache.
+ *
+ * Usage: riotsensors_format_bench [LAMBDAS [ITERATIONS]]
+ */
+
+#include <rs_compression.h>
+#include <rs_rest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+/**
+ * @brief Register lambdas of all types with a cached result
+ *
+ * @param count Number of lambdas
+ */
+static void fill_registry(unsigned int count) {
+    init_lambda_registry();
+    for (unsigned int i = 0; i < count; i++) {
+        auto arg = (rs_linux_registered_lambda *) calloc(1, sizeof(rs_linux_registered_lambda));
+        rs_lambda_type_t type = (rs_lambda_type_t) (RS_LAMBDA_INT + i % 3);
+        arg->data_cached = true;
+        switch (type) {
+            case RS_LAMBDA_INT:
+                arg->ret.ret_i = (int) (i * 1013);
+                break;
+            case RS_LAMBDA_DOUBLE:
+                arg->ret.ret_d = 21.5 + i * 0.37;
+                break;
+            default:
+                arg->ret.ret_s = strdup("door closed");
+                break;
+        }
+        char name[MAX_LAMBDA_NAME_LENGTH];
+        snprintf(name, sizeof(name), "sensor%u", i);
+        lambda_arg larg;
+        larg.obj = arg;
+        lambda_registry_register(name, type, (rs_cache_type_t) (i % 2 == 0 ? RS_CACHE_ONLY : RS_CACHE_CALL_ONCE),
+                                 larg);
+    }
+}
+
+/**
+ * @brief Serialize a response repeatedly and print its size and the mean time per serialization
+ *
+ * @param name Name of the response
+ * @param iterations Number of serializations per format
+ * @param assemble Creates the response body in a format
+ */
+static void measure(const char *name, unsigned int iterations,
+                    const std::function<rest_body(rest_format)> &assemble) {
+    size_t sizes[2];
+    double nanos[2];
+    for (int f = 0; f < 2; f++) {
+        auto format = (rest_format) f;
+        size_t bytes = 0;
+        // warm up the allocator and the caches
+        for (unsigned int i = 0; i < iterations / 10 + 1; i++) {
+            bytes += assemble(format)->size();
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < iterations; i++) {
+            bytes += assemble(format)->size();
+        }
+        auto end = std::chrono::steady_clock::now();
+        sizes[f] = assemble(format)->size();
+        nanos[f] = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / iterations;
+        // keeps the serialization from being optimized away
+        if (bytes == 0) {
+            printf("empty response\n");
+        }
+    }
+    printf("%-12s %10zu %10zu %9.1f%% %12.0f %12.0f %9.1f%%\n", name, sizes[0], sizes[1],
+           100.0 * sizes[1] / sizes[0], nanos[0], nanos[1], 100.0 * nanos[1] / nanos[0]);
+}
+
+/**
+ * @brief Compress a body repeatedly with all content codings and print the compression ratio and the mean time
+ * per compression
+ *
+ * @param name Name of the response
+ * @param iterations Number of compressions per content coding
+ * @param format Format of the body
+ * @param body Uncompressed body
+ */
+static void measure_compression(const char *name, unsigned int iterations, rest_format format,
+                                const std::string &body) {
+    static const rest_encoding encodings[] = {rest_encoding::GZIP, rest_encoding::DEFLATE};
+    for (rest_encoding encoding : encodings) {
+        std::string compressed;
+        rest_compress(body, encoding, &compressed);
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < iterations; i++) {
+            rest_compress(body, encoding, &compressed);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double nanos = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / iterations;
+        printf("%-12s %-6s %-8s %10zu %10zu %9.1f%% %12.0f %10.1f\n", name,
+               format == rest_format::CBOR ? "cbor" : "json", rest_encoding_name(encoding), body.size(),
+               compressed.size(), 100.0 * compressed.size() / body.size(), nanos, body.size() * 1000.0 / nanos);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int lambdas = argc > 1 ? (unsigned int) strtoul(argv[1], nullptr, 10) : 16;
+    unsigned int iterations = argc > 2 ? (unsigned int) strtoul(argv[2], nullptr, 10) : 100000;
+    if (lambdas == 0 || lambdas > MAX_LAMBDAS || iterations == 0) {
+        fprintf(stderr, "Usage: %s [LAMBDAS (1-%d) [ITERATIONS]]\n", argv[0], MAX_LAMBDAS);
+        return 1;
+    }
+    fill_registry(lambdas);
+    printf("%u lambdas, %u iterations\n", lambdas, iterations);
+    printf("%-12s %10s %10s %10s %12s %12s %10s\n", "response", "json B", "cbor B", "size", "json ns", "cbor ns",
+           "time");
+    measure("list", iterations, [](rest_format format) { return assemble_list_rest(format); });
+    measure("showcache", iterations, [](rest_format format) { return assemble_cache_rest(format); });
+    // fill_registry() cycles through the types starting with int
+    static const char *call_names[] = {"call int", "call double", "call string"};
+    for (lambda_id_t id = 0; id < 3 && id < lambdas; id++) {
+        rs_registered_lambda *lambda = get_registered_lambda_by_id(id);
+        auto arg = (rs_linux_registered_lambda *) lambda->arg.obj;
+        measure(call_names[id], iterations, [lambda, arg](rest_format format) {
+            return assemble_call_success_rest(lambda, true, false, &arg->ret, format);
+        });
+    }
+    if (lambdas > 1) {
+        // what a poller of the double lambda gets with a pre-serialized lambda fragment, fields=result and view=value
+        rs_registered_lambda *lambda = get_registered_lambda_by_id(1);
+        auto arg = (rs_linux_registered_lambda *) lambda->arg.obj;
+        rest_body fragments[2] = {assemble_lambda_properties_rest(lambda, rest_format::JSON),
+                                  assemble_lambda_properties_rest(lambda, rest_format::CBOR)};
+        measure("  fragment", iterations, [lambda, arg, &fragments](rest_format format) {
+            return assemble_call_success_rest(lambda, true, false, &arg->ret, format, RS_FIELDS_ALL,
+                                              fragments[(int) format].get());
+        });
+        measure("  result", iterations, [lambda, arg](rest_format format) {
+            return assemble_call_success_rest(lambda, true, false, &arg->ret, format, RS_FIELD_RESULT);
+        });
+        measure("  value", iterations, [lambda, arg](rest_format format) {
+            return assemble_call_success_rest(lambda, true, false, &arg->ret, format, RS_FIELDS_VALUE);
+        });
+    }
+    // compression is much slower than serialization, but only done once per data version
+    unsigned int compressions = iterations / 100 + 1;
+    printf("\n%u compressions, bodies below %zu bytes are sent uncompressed by default\n", compressions,
+           (size_t) RS_COMPRESS_DEFAULT_MIN_BYTES);
+    printf("%-12s %-6s %-8s %10s %10s %10s %12s %10s\n", "response", "format", "coding", "plain B", "coded B",
+           "ratio", "ns", "MB/s");
+    for (int f = 0; f < 2; f++) {
+        auto format = (rest_format) f;
+        measure_compression("list", compressions, format, *assemble_list_rest(format));
+        measure_compression("showcache", compressions, format, *assemble_cache_rest(format));
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Compares how fast the CoAP thread picks up new results when it polls the result stream and when the
+ *          stream wakes up its event loop
+ * @file    rs_loop_bench.cpp
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * A producer thread pushes results into a stream the way the serial thread of the connector does. The event loop
+ * either polls the stream every 50 milliseconds like the former libevent based CoAP thread or waits for the file
+ * descriptor of the stream. Printed are the delays between pushing a result and handling it in the loop and the
+ * number of times the loop woke up, also while no results arrived.
+ *
+ * Usage: riotsensors_loop_bench [RESULTS [INTERVAL_MS]]
+ */
+
+#include <rs_event_loop.h>
+#include <rs_stream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+/** @brief Polling interval of the former CoAP thread in milliseconds */
+#define POLL_INTERVAL 50
+
+static uint64_t now_micros() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Push results into a stream and measure the delay until the loop handled them
+ *
+ * @param name Name of the model
+ * @param poll If the loop polls the stream instead of waiting for its file descriptor
+ * @param results Number of pushed results
+ * @param interval_ms Milliseconds between two results
+ */
+static void measure(const char *name, bool poll, unsigned int results, unsigned int interval_ms) {
+    rs_stream stream;
+    rs_stream_init(&stream, nullptr, 0);
+    RiotsensorsEventLoop loop;
+    std::vector<uint64_t> delays;
+    delays.reserve(results);
+    unsigned long wakeups = 0;
+    auto take = [&]() {
+        wakeups++;
+        rs_stream_update updates[16];
+        size_t count;
+        while ((count = rs_stream_read(&stream, updates, 16, 0)) > 0) {
+            uint64_t now = now_micros();
+            for (size_t i = 0; i < count; i++) {
+                delays.push_back(now - updates[i].timestamp);
+            }
+        }
+        if (delays.size() >= results) {
+            loop.stop();
+        }
+    };
+    if (poll) {
+        int timer = loop.addTimer(take);
+        loop.armTimer(timer, POLL_INTERVAL, POLL_INTERVAL);
+    } else {
+        loop.add(rs_stream_fd(&stream), [&]() {
+            rs_stream_clear_fd(&stream);
+            take();
+        });
+    }
+    std::thread producer([&stream, results, interval_ms]() {
+        for (unsigned int i = 0; i < results; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+            rs_stream_update u{};
+            // every result of its own lambda, so none is coalesced
+            u.id = (lambda_id_t) (i % MAX_LAMBDAS);
+            u.type = RS_LAMBDA_INT;
+            u.value.ret_i = (rs_int_t) i;
+            u.timestamp = now_micros();
+            rs_stream_push(&stream, &u);
+        }
+    });
+    auto start = std::chrono::steady_clock::now();
+    loop.run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    producer.join();
+    rs_stream_free(&stream);
+    std::sort(delays.begin(), delays.end());
+    double sum = 0;
+    for (uint64_t delay : delays) {
+        sum += delay;
+    }
+    printf("%-10s %10.0f %10llu %10llu %10llu %12.1f\n", name, sum / delays.size(),
+           (unsigned long long) delays[delays.size() / 2], (unsigned long long) delays[delays.size() * 99 / 100],
+           (unsigned long long) delays.back(), wakeups / seconds);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int results = argc > 1 ? (unsigned int) strtoul(argv[1], nullptr, 10) : 200;
+    unsigned int interval_ms = argc > 2 ? (unsigned int) strtoul(argv[2], nullptr, 10) : 7;
+    if (results == 0) {
+        fprintf(stderr, "Usage: %s [RESULTS [INTERVAL_MS]]\n", argv[0]);
+        return 1;
+    }
+    printf("%u results, one every %u ms\n", results, interval_ms);
+    printf("%-10s %10s %10s %10s %10s %12s\n", "model", "mean us", "p50 us", "p99 us", "max us", "wakeups/s");
+    measure("poll", true, results, interval_ms);
+    measure("eventfd", false, results, interval_ms);
+    // without results the polling loop keeps waking up, the other one sleeps
+    measure("poll idle", true, 2, 1000);
+    measure("fd idle", false, 2, 1000);
+    return 0;
+}
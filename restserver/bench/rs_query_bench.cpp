@@ -0,0 +1,149 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Compares the cost of parsing the query parameters of CoAP requests with the former per-option string
+ *          matching and with coap_query_match()
+ * @file    rs_query_bench.cpp
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * The Uri-Query option values of typical requests are parsed the way the handlers of the CoAP server do it: the former
+ * parser copied every option into a string and tried one key after another, the current one matches each option
+ * once against all keys of the handler. Both produce the lambda type and the values the handler goes on with.
+ * Printed is the time per request.
+ *
+ * Usage: riotsensors_query_bench [ITERATIONS]
+ */
+
+#include <rs_coap_query.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A request of the benchmark, the values of its Uri-Query options
+ */
+struct bench_request {
+    const char *description;
+    std::vector<std::string> options;
+};
+
+/**
+ * @brief The former matching of one option, executing the lambda with the value if the key matches
+ */
+template<typename Callback>
+static bool match_opt_and_execute(const std::string &name, const uint8_t *value, size_t length, Callback l) {
+    std::string opt_value((const char *) value, length);
+
+    std::string::size_type loc = opt_value.find('=');
+    std::string key_value;
+    if (loc != std::string::npos) {
+        key_value = opt_value.substr(0, loc);
+    } else {
+        key_value = std::string(opt_value);
+    }
+
+    if (!strcmp(name.c_str(), key_value.c_str())) {
+        std::string arg_str = opt_value.substr(name.length() + 1);
+        l(arg_str);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Parse the query of a call by name request like the former handler
+ *
+ * @return Sum of the lambda type and the lengths of the values, so that the work is not optimized away
+ */
+static size_t parse_former(const bench_request &request) {
+    int type = 0;
+    std::string name, fields_value, view;
+    for (const std::string &option : request.options) {
+        auto value = (const uint8_t *) option.data();
+        if (match_opt_and_execute("type", value, option.length(), [&type](std::string v) -> void {
+            type = (int) strtol(v.c_str(), nullptr, 10);
+        })) {
+            continue;
+        }
+        if (match_opt_and_execute("name", value, option.length(), [&name](std::string v) -> void {
+            name = v;
+        })) {
+            continue;
+        }
+        if (match_opt_and_execute("fields", value, option.length(), [&fields_value](std::string v) -> void {
+            fields_value = v;
+        })) {
+            continue;
+        }
+        match_opt_and_execute("view", value, option.length(), [&view](std::string v) -> void {
+            view = v;
+        });
+    }
+    return (size_t) type + name.length() + fields_value.length() + view.length();
+}
+
+/**
+ * @brief Parse the query of a call by name request like the current handler
+ *
+ * @return Sum of the lambda type and the lengths of the values, so that the work is not optimized away
+ */
+static size_t parse_current(const bench_request &request) {
+    coap_query_param params[] = {coap_query_param("type"), coap_query_param("name"), coap_query_param("fields"),
+                                 coap_query_param("view")};
+    for (const std::string &option : request.options) {
+        coap_query_match((const uint8_t *) option.data(), option.length(), params, 4);
+    }
+    int type = 0;
+    char buf[8];
+    if (params[0].found && params[0].copy(buf, sizeof(buf))) {
+        type = (int) strtol(buf, nullptr, 10);
+    }
+    // the handler keeps the name for the call, the other values are only inspected
+    std::string name = params[1].str();
+    return (size_t) type + name.length() + params[2].length + params[3].length;
+}
+
+/**
+ * @brief Measure the nanoseconds per request of a parser
+ */
+template<typename Parser>
+static double measure(const bench_request &request, unsigned long iterations, Parser parse) {
+    volatile size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        sink = sink + parse(request);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return elapsed / iterations;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    if (iterations == 0) {
+        fprintf(stderr, "Usage: %s [ITERATIONS]\n", argv[0]);
+        return 1;
+    }
+    std::vector<bench_request> requests = {
+            {"type, name",               {"type=1", "name=temp"}},
+            {"type, long name",          {"type=1", "name=temperature_living_room"}},
+            {"type, name, fields, view", {"type=1", "name=temperature", "fields=result", "view=value"}},
+            {"unknown options",          {"type=1", "name=temperature", "lang=en", "debug=1", "x"}},
+    };
+    printf("%lu iterations per request\n", iterations);
+    printf("%-28s %14s %14s\n", "request", "former ns", "current ns");
+    for (const bench_request &request : requests) {
+        double former = measure(request, iterations, parse_former);
+        double current = measure(request, iterations, parse_current);
+        printf("%-28s %14.1f %14.1f\n", request.description, former, current);
+    }
+    return 0;
+}
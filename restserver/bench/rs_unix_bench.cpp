@@ -0,0 +1,278 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Compares the round trip latency of the binary server on a Unix domain socket with the HTTP server on the
+ *          loopback interface
+ * @file    rs_unix_bench.cpp
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * Both servers run in this process on a registry of int lambdas with cached results, so no call reaches a device.
+ * One client per server sends a call of a lambda and a list of all lambdas over a persistent connection and waits
+ * for every answer before sending the next request. The binary client also sends windows of pipelined calls, the
+ * time per call is the time of the window divided by its size.
+ *
+ * Usage: riotsensors_unix_bench [ITERATIONS [LAMBDAS]]
+ */
+
+#include <rs_server_http.h>
+#include <rs_server_unix.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/** @brief Port of the benchmarked HTTP server */
+#define BENCH_HTTP_PORT 59081
+/** @brief Path of the benchmarked binary server */
+#define BENCH_UNIX_PATH "/tmp/riotsensors_bench.sock"
+/** @brief Calls in one window of pipelined calls */
+#define BENCH_PIPELINE 32
+
+/**
+ * @brief Register int lambdas with a cached result
+ *
+ * @param count Number of lambdas
+ */
+static void fill_registry(unsigned int count) {
+    init_lambda_registry();
+    for (unsigned int i = 0; i < count; i++) {
+        auto arg = (rs_linux_registered_lambda *) calloc(1, sizeof(rs_linux_registered_lambda));
+        arg->data_cached = true;
+        arg->ret.ret_i = (rs_int_t) (i * 1013);
+        char name[MAX_LAMBDA_NAME_LENGTH];
+        snprintf(name, sizeof(name), "sensor%u", i);
+        lambda_arg larg;
+        larg.obj = arg;
+        lambda_registry_register(name, RS_LAMBDA_INT, RS_CACHE_ONLY, larg);
+    }
+}
+
+/**
+ * @brief Connect to a server, waiting for it to start
+ *
+ * @param family AF_UNIX or AF_INET
+ * @return The socket, -1 if the server did not start
+ */
+static int connect_client(int family) {
+    sockaddr_un unix_addr{};
+    unix_addr.sun_family = AF_UNIX;
+    strcpy(unix_addr.sun_path, BENCH_UNIX_PATH);
+    sockaddr_in inet_addr{};
+    inet_addr.sin_family = AF_INET;
+    inet_addr.sin_port = htons(BENCH_HTTP_PORT);
+    inet_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto addr = family == AF_UNIX ? (const sockaddr *) &unix_addr : (const sockaddr *) &inet_addr;
+    socklen_t length = family == AF_UNIX ? sizeof(unix_addr) : sizeof(inet_addr);
+    for (int i = 0; i < 50; i++) {
+        int fd = socket(family, SOCK_STREAM, 0);
+        if (connect(fd, addr, length) == 0) {
+            int one = 1;
+            if (family == AF_INET) {
+                // the requests are small, Nagle would delay them
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            return fd;
+        }
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return -1;
+}
+
+static void send_all(int fd, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.length()) {
+        ssize_t written = send(fd, data.data() + sent, data.length() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            perror("send");
+            exit(EXIT_FAILURE);
+        }
+        sent += (size_t) written;
+    }
+}
+
+static void receive_exactly(int fd, char *buf, size_t length) {
+    size_t received = 0;
+    while (received < length) {
+        ssize_t r = recv(fd, buf + received, length - received, 0);
+        if (r <= 0) {
+            fprintf(stderr, "Connection closed by the server\n");
+            exit(EXIT_FAILURE);
+        }
+        received += (size_t) r;
+    }
+}
+
+/**
+ * @brief Frame a request of the binary server
+ *
+ * @param packet Request packet
+ * @param length Length of the packet
+ * @return Framed request
+ */
+static std::string unix_frame(const void *packet, size_t length) {
+    uint32_t prefix = htonl((uint32_t) length);
+    return std::string((const char *) &prefix, sizeof(prefix)) + std::string((const char *) packet, length);
+}
+
+/**
+ * @brief Receive an answer of the binary server
+ *
+ * @param fd Socket
+ * @param buf Buffer of the answer
+ */
+static void unix_receive(int fd, std::string *buf) {
+    uint32_t length;
+    receive_exactly(fd, (char *) &length, sizeof(length));
+    buf->resize(ntohl(length));
+    receive_exactly(fd, &(*buf)[0], buf->length());
+}
+
+/**
+ * @brief Receive a HTTP response with a Content-Length header
+ *
+ * @param fd Socket
+ * @param buf Buffer of the response
+ */
+static void http_receive(int fd, std::string *buf) {
+    buf->clear();
+    char chunk[4096];
+    std::string::size_type end;
+    while ((end = buf->find("\r\n\r\n")) == std::string::npos) {
+        ssize_t r = recv(fd, chunk, sizeof(chunk), 0);
+        if (r <= 0) {
+            fprintf(stderr, "Connection closed by the server\n");
+            exit(EXIT_FAILURE);
+        }
+        buf->append(chunk, (size_t) r);
+    }
+    std::string::size_type header = buf->find("Content-Length: ");
+    size_t body = header != std::string::npos && header < end ? strtoul(buf->c_str() + header + 16, nullptr, 10) : 0;
+    size_t received = buf->length() - end - 4;
+    if (received < body) {
+        size_t offset = buf->length();
+        buf->resize(offset + body - received);
+        receive_exactly(fd, &(*buf)[offset], body - received);
+    }
+}
+
+/**
+ * @brief Repeat a round trip and print the mean, median and 99th percentile of its latency
+ *
+ * @param name Name of the round trip
+ * @param iterations Number of round trips
+ * @param requests Number of requests of one round trip, the latency is divided by it
+ * @param round_trip Sends the requests and waits for the answers
+ */
+static void measure(const char *name, unsigned int iterations, unsigned int requests,
+                    const std::function<void()> &round_trip) {
+    // warm up the connection and the response caches
+    for (unsigned int i = 0; i < iterations / 10 + 1; i++) {
+        round_trip();
+    }
+    std::vector<double> latencies;
+    latencies.reserve(iterations);
+    for (unsigned int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        round_trip();
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+                                    .count() / requests);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double latency : latencies) {
+        sum += latency;
+    }
+    printf("%-22s %10.1f %10.1f %10.1f\n", name, sum / latencies.size(), latencies[latencies.size() / 2],
+           latencies[latencies.size() * 99 / 100]);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int iterations = argc > 1 ? (unsigned int) strtoul(argv[1], nullptr, 10) : 20000;
+    unsigned int lambdas = argc > 2 ? (unsigned int) strtoul(argv[2], nullptr, 10) : 16;
+    if (iterations == 0 || lambdas == 0 || lambdas > MAX_LAMBDAS) {
+        fprintf(stderr, "Usage: %s [ITERATIONS [LAMBDAS]]\n", argv[0]);
+        return 1;
+    }
+    fill_registry(lambdas);
+    riotsensors_start_opts opts{};
+    opts.http_port = BENCH_HTTP_PORT;
+    opts.http_threads = 1;
+    opts.unix_path = (char *) BENCH_UNIX_PATH;
+    std::thread http_server(startHTTPServer, &opts);
+    std::thread unix_server(startUnixServer, &opts);
+    int http_fd = connect_client(AF_INET);
+    int unix_fd = connect_client(AF_UNIX);
+    if (http_fd < 0 || unix_fd < 0) {
+        fprintf(stderr, "Could not connect to the servers\n");
+        return 1;
+    }
+
+    rs_packet_call_by_id_t call{};
+    call.base.ptype = RS_PACKET_CALL_BY_ID;
+    call.lambda_id = 0;
+    call.expected_type = RS_LAMBDA_INT;
+    hton_rs_packet_call_by_id_t(&call);
+    std::string unix_call = unix_frame(&call, sizeof(call));
+    rs_unix_packet_select_t list{};
+    list.base.ptype = RS_UNIX_PACKET_LIST;
+    list.type = 0;
+    std::string unix_list = unix_frame(&list, sizeof(list));
+    std::string unix_window;
+    for (int i = 0; i < BENCH_PIPELINE; i++) {
+        unix_window += unix_call;
+    }
+    std::string http_call = "GET /v1/call/id/" + std::to_string(RS_LAMBDA_INT) +
+                            "/0 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string http_list = "GET /v1/list HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string buf;
+
+    printf("%u round trips on %u lambdas with cached results, latencies in us\n", iterations, lambdas);
+    printf("%-22s %10s %10s %10s\n", "request", "mean", "p50", "p99");
+    measure("http call", iterations, 1, [&]() {
+        send_all(http_fd, http_call);
+        http_receive(http_fd, &buf);
+    });
+    measure("unix call", iterations, 1, [&]() {
+        send_all(unix_fd, unix_call);
+        unix_receive(unix_fd, &buf);
+    });
+    measure("http list", iterations, 1, [&]() {
+        send_all(http_fd, http_list);
+        http_receive(http_fd, &buf);
+    });
+    measure("unix list", iterations, 1, [&]() {
+        send_all(unix_fd, unix_list);
+        unix_receive(unix_fd, &buf);
+    });
+    measure("unix call pipelined", iterations / BENCH_PIPELINE + 1, BENCH_PIPELINE, [&]() {
+        send_all(unix_fd, unix_window);
+        for (int i = 0; i < BENCH_PIPELINE; i++) {
+            unix_receive(unix_fd, &buf);
+        }
+    });
+
+    send_all(http_fd, "GET /v1/kill HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    http_server.join();
+    stopUnixServer();
+    unix_server.join();
+    close(http_fd);
+    close(unix_fd);
+    return 0;
+}
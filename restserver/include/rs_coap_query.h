@@ -0,0 +1,85 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Parser of the query parameters of CoAP requests
+ * @file    rs_coap_query.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * Every Uri-Query option is split into key and value in place and matched against the parameters a handler looks
+ * for, so parsing a request does not allocate. The values point into the request and are only valid while it
+ * exists.
+ */
+
+#ifndef RIOTSENSORS_RS_COAP_QUERY_H
+#define RIOTSENSORS_RS_COAP_QUERY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief A query parameter a handler looks for, filled by coap_query_match()
+ */
+struct coap_query_param {
+    /** @brief Key of the parameter */
+    const char *key;
+    /** @brief Value of the parameter in the request, not NUL-terminated */
+    const char *value;
+    /** @brief Length of the value */
+    size_t length;
+    /** @brief If the request contains the parameter */
+    bool found;
+
+    /**
+     * @brief Create a parameter that has not been found yet
+     *
+     * @param name Key of the parameter
+     */
+    explicit coap_query_param(const char *name) : key(name), value(nullptr), length(0), found(false) {
+    }
+
+    /**
+     * @brief Copy the value
+     *
+     * @return The value, empty if the parameter was not found
+     */
+    std::string str() const;
+
+    /**
+     * @brief Copy the value into a NUL-terminated buffer
+     *
+     * @param buf Buffer
+     * @param size Size of the buffer
+     * @return If the value fits into the buffer
+     */
+    bool copy(char *buf, size_t size) const;
+
+    /**
+     * @brief Parse the value as a decimal number
+     *
+     * @param number Where to store the number
+     * @param max Largest accepted number
+     * @return If the value only consists of digits and is not larger than max
+     */
+    bool toUnsigned(unsigned long *number, unsigned long max) const;
+};
+
+/**
+ * @brief Match a Uri-Query option against the parameters a handler looks for
+ *
+ * The option is split at the first '=', an option without '=' has an empty value. A repeated key overwrites the
+ * earlier value.
+ *
+ * @param option Value of the option
+ * @param length Length of the option value
+ * @param params Parameters to fill
+ * @param count Number of parameters
+ * @return If the option matched a parameter
+ */
+bool coap_query_match(const uint8_t *option, size_t length, coap_query_param *params, size_t count);
+
+#endif //RIOTSENSORS_RS_COAP_QUERY_H
@@ -0,0 +1,67 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Content codings for compressed REST responses
+ * @file    rs_compression.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#ifndef RIOTSENSORS_RS_COMPRESSION_H
+#define RIOTSENSORS_RS_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/** @brief Default minimum size in bytes of a body to be compressed, smaller bodies hardly shrink */
+#define RS_COMPRESS_DEFAULT_MIN_BYTES 1024
+
+/**
+ * @brief Content coding of a response body
+ */
+enum class rest_encoding : uint8_t {
+    /** @brief Uncompressed */
+    IDENTITY = 0,
+    /** @brief gzip file format (RFC 1952) */
+    GZIP = 1,
+    /** @brief zlib data format (RFC 1950) as used by the HTTP deflate coding */
+    DEFLATE = 2
+};
+
+/**
+ * @brief Compress a body
+ *
+ * @param body Uncompressed body
+ * @param encoding Content coding, must not be IDENTITY
+ * @param compressed Where to store the compressed body
+ * @return If the body was compressed
+ */
+bool rest_compress(const std::string &body, rest_encoding encoding, std::string *compressed);
+
+/**
+ * @brief Get the name of a content coding as used in the Accept-Encoding and Content-Encoding headers
+ *
+ * @param encoding Content coding
+ * @return Name (eg. gzip)
+ */
+const char *rest_encoding_name(rest_encoding encoding);
+
+/**
+ * @brief Set the minimum size of a body to be compressed
+ *
+ * @param bytes Minimum size in bytes
+ */
+void rest_set_compress_min_bytes(size_t bytes);
+
+/**
+ * @brief Get the minimum size of a body to be compressed
+ *
+ * @return Minimum size in bytes
+ */
+size_t rest_get_compress_min_bytes();
+
+#endif //RIOTSENSORS_RS_COMPRESSION_H
@@ -0,0 +1,118 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   epoll based event loop of a server thread
+ * @file    rs_event_loop.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * The loop owns the sockets, timers and wakeup descriptors of one thread and runs their handlers inline, so a
+ * request or a new result is completed by the thread that noticed it without any handoff.
+ */
+
+#ifndef RIOTSENSORS_RS_EVENT_LOOP_H
+#define RIOTSENSORS_RS_EVENT_LOOP_H
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+/** @brief Maximum number of events taken from epoll at once */
+#define RS_EVENT_LOOP_BATCH 32
+
+/**
+ * @brief Event loop waiting for readable file descriptors and expired timers
+ */
+class RiotsensorsEventLoop {
+public:
+    /**
+     * @brief Handler of a readable file descriptor or an expired timer
+     */
+    typedef std::function<void()> handler;
+
+    RiotsensorsEventLoop();
+
+    ~RiotsensorsEventLoop();
+
+    RiotsensorsEventLoop(const RiotsensorsEventLoop &) = delete;
+
+    RiotsensorsEventLoop &operator=(const RiotsensorsEventLoop &) = delete;
+
+    /**
+     * @brief Check if the epoll instance could be created
+     *
+     * @return If the loop can be used
+     */
+    bool valid() const;
+
+    /**
+     * @brief Call a handler whenever a file descriptor is readable, the descriptor stays owned by the caller
+     *
+     * @param fd File descriptor
+     * @param on_readable Handler, has to read until the descriptor would block or accept spurious calls
+     * @return If the descriptor was added
+     */
+    bool add(int fd, handler on_readable);
+
+    /**
+     * @brief Stop watching a file descriptor, must not be called by the handler of the descriptor itself
+     *
+     * @param fd File descriptor added with add()
+     */
+    void remove(int fd);
+
+    /**
+     * @brief Choose the events a descriptor added with add() is watched for
+     *
+     * The handler given to add() is still called if the descriptor is hung up or failed while it is not watched for
+     * being readable.
+     *
+     * @param fd File descriptor added with add()
+     * @param readable If the handler given to add() is called when the descriptor is readable
+     * @param on_writable Handler called when the descriptor is writable, may reset itself, nullptr to not watch for it
+     * @return If the descriptor is watched as requested
+     */
+    bool modify(int fd, bool readable, handler on_writable);
+
+    /**
+     * @brief Create a timer, it is disarmed until armTimer() is called
+     *
+     * @param on_expired Handler
+     * @return ID of the timer, -1 on failure
+     */
+    int addTimer(handler on_expired);
+
+    /**
+     * @brief Arm or disarm a timer
+     *
+     * @param timer ID of the timer
+     * @param delay_ms Milliseconds until the handler is called, 0 to disarm the timer
+     * @param interval_ms Milliseconds between the following calls, 0 for a single call
+     */
+    void armTimer(int timer, uint32_t delay_ms, uint32_t interval_ms = 0);
+
+    /**
+     * @brief Run the handlers of ready descriptors and timers until stop() is called
+     */
+    void run();
+
+    /**
+     * @brief Make run() return, may be called from any thread and before run()
+     */
+    void stop();
+
+private:
+    int epoll_fd;
+    /** @brief eventfd written by stop() */
+    int stop_fd;
+    std::unordered_map<int, handler> handlers;
+    /** @brief Handlers of the descriptors watched for being writable */
+    std::unordered_map<int, handler> writers;
+    /** @brief timerfds created by addTimer(), closed by the loop */
+    std::unordered_map<int, handler> timers;
+};
+
+#endif //RIOTSENSORS_RS_EVENT_LOOP_H
@@ -0,0 +1,111 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Cache for serialized REST responses
+ * @file    rs_response_cache.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#ifndef RIOTSENSORS_RS_RESPONSE_CACHE_H
+#define RIOTSENSORS_RS_RESPONSE_CACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <rs_compression.h>
+#include <rs_rest_writer.h>
+
+/**
+ * @brief Kind of a cached response
+ */
+enum class rest_response_kind : uint8_t {
+    /** @brief Successful call of a single lambda */
+    CALL = 1,
+    /** @brief List of registered lambdas */
+    LIST = 2,
+    /** @brief List of registered lambdas and their cached values */
+    SHOWCACHE = 3,
+    /** @brief Properties of a lambda embedded in the responses of its calls */
+    LAMBDA = 4
+};
+
+/**
+ * @brief Stores serialized response bodies together with the version of the data they were built from
+ *
+ * An entry is only returned if the requested version matches the stored one, so a response is rebuilt exactly once
+ * after the underlying data changed. Compressed bodies are stored next to the uncompressed ones, so they are
+ * compressed once per version as well. Bodies are shared with the responses being sent, so a hit copies nothing.
+ * Entries are accounted as RS_MEMORY_RESPONSES and evicted by the configured
+ * policy when the memory budget is exhausted.
+ */
+class RiotsensorsResponseCache {
+public:
+    /**
+     * @brief Get a cached response body
+     *
+     * @param kind Kind of the response
+     * @param discriminator Distinguishes responses of the same kind (eg. lambda ID or type filter)
+     * @param format Format of the body
+     * @param encoding Content coding of the body
+     * @param version Current version of the data the response is built from
+     * @param body Where to store the body on a hit
+     * @return If a body with the given version was found
+     */
+    bool get(rest_response_kind kind, uint16_t discriminator, rest_format format, rest_encoding encoding,
+             uint64_t version, rest_body *body);
+
+    /**
+     * @brief Store a response body
+     *
+     * @param kind Kind of the response
+     * @param discriminator Distinguishes responses of the same kind (eg. lambda ID or type filter)
+     * @param format Format of the body
+     * @param encoding Content coding of the body
+     * @param version Version of the data read before the body was built
+     * @param body Serialized response body
+     */
+    void put(rest_response_kind kind, uint16_t discriminator, rest_format format, rest_encoding encoding,
+             uint64_t version, const rest_body &body);
+
+    /**
+     * @brief Remove all cached responses
+     */
+    void clear();
+
+    /**
+     * @brief Evict responses by the configured policy
+     *
+     * @param bytes Number of bytes that should be freed
+     * @return Number of freed bytes
+     */
+    size_t evict(size_t bytes);
+
+private:
+    struct entry {
+        uint64_t version;
+        rest_body body;
+        /** @brief Accounted bytes */
+        size_t bytes;
+        /** @brief rs_memory_tick() when the entry was stored */
+        uint64_t created;
+        /** @brief rs_memory_tick() when the entry was stored or last returned */
+        uint64_t last_used;
+    };
+
+    /**
+     * @brief Evict the entry chosen by the configured policy, the lock has to be held
+     *
+     * @return Number of freed bytes, 0 if the cache is empty
+     */
+    size_t evict_one();
+
+    std::mutex lock;
+    std::unordered_map<uint32_t, entry> entries;
+};
+
+#endif //RIOTSENSORS_RS_RESPONSE_CACHE_H
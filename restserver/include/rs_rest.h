@@ -5,7 +5,7 @@
  */
 
 /**
- * @brief   Functions to create RESTful JSON answers for the server
+ * @brief   Functions to create RESTful JSON or CBOR answers for the server
  * @file    rs_rest.h
  * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
  */
@@ -14,8 +14,32 @@
 #define RIOTSENSORS_RS_REST_H
 
 #include <iostream>
+#include <string>
+#include <vector>
 #include <lambda_registry.h>
 #include <rs_connector.h>
+#include <rs_rest_writer.h>
+
+/** @brief Media type of the Prometheus text exposition format */
+#define RS_PROMETHEUS_MEDIA_TYPE "text/plain; version=0.0.4"
+
+/** @brief Field success of a successful call response */
+#define RS_FIELD_SUCCESS 0x01
+/** @brief Field lambda of a successful call response */
+#define RS_FIELD_LAMBDA 0x02
+/** @brief Field cache of a successful call response */
+#define RS_FIELD_CACHE 0x04
+/** @brief Field result of a successful call response */
+#define RS_FIELD_RESULT 0x08
+/** @brief All fields of a successful call response, the default */
+#define RS_FIELDS_ALL 0x0f
+/** @brief Compact view, the body is the bare result without an enclosing object */
+#define RS_FIELDS_VALUE 0x10
+
+/**
+ * @brief RS_FIELD_* bits selecting the fields of a successful call response, or RS_FIELDS_VALUE
+ */
+typedef uint8_t rest_fields;
 
 /**
  * @brief Create a JSON string for successful calls
@@ -24,11 +48,26 @@
  * @param cache_retrieved If the result was retrieved from cache
  * @param timeout If a timeout occurred
  * @param result Result (has to match the type of the lambda)
- * @return A JSON string
+ * @param format Format of the string
+ * @param fields Fields of the response
+ * @param lambda_fragment Properties of the lambda created by assemble_lambda_properties_rest() in the same format,
+ * nullptr to serialize them
+ * @return A shared JSON or CBOR body
  */
-std::string
+rest_body
 assemble_call_success_rest(rs_registered_lambda *lambda, bool cache_retrieved, bool timeout,
-                           generic_lambda_return *result);
+                           generic_lambda_return *result, rest_format format = rest_format::JSON,
+                           rest_fields fields = RS_FIELDS_ALL, const std::string *lambda_fragment = nullptr);
+
+/**
+ * @brief Create the properties of a lambda as embedded in call responses, to be reused while the registry does not
+ * change
+ *
+ * @param lambda Registered lambda
+ * @param format Format of the fragment
+ * @return A shared JSON or CBOR object
+ */
+rest_body assemble_lambda_properties_rest(const rs_registered_lambda *lambda, rest_format format = rest_format::JSON);
 
 /**
  * @brief Create a JSON string for failed calls by id
@@ -36,9 +75,27 @@ assemble_call_success_rest(rs_registered_lambda *lambda, bool cache_retrieved, b
  * @param id ID of the lambda
  * @param lambda Lambda if found, NULL otherwise
  * @param error Occurred error code (RS_CALL_* constant)
- * @return A JSON string
+ * @param format Format of the string
+ * @return A JSON or CBOR string
  */
-std::string assemble_call_error_rest_id(lambda_id_t id, const rs_registered_lambda *lambda, int8_t error);
+std::string assemble_call_error_rest_id(lambda_id_t id, const rs_registered_lambda *lambda, int8_t error,
+                                        rest_format format = rest_format::JSON);
+
+/**
+ * @brief Create a JSON string for the calls of several lambdas, holding the same object as a single call for each
+ * lambda in the requested order
+ *
+ * @param count Number of called lambdas
+ * @param ids IDs of the lambdas
+ * @param lambdas Lambdas if found, NULL otherwise
+ * @param codes RS_CALL_* constant of each call
+ * @param results Result of each call (has to match the type of the lambda)
+ * @param format Format of the string
+ * @return A JSON or CBOR string
+ */
+std::string assemble_call_multi_rest(size_t count, const lambda_id_t *ids, const rs_registered_lambda *const *lambdas,
+                                     const int8_t *codes, const generic_lambda_return *results,
+                                     rest_format format = rest_format::JSON);
 
 /**
  * @brief Create a JSON string for failed calls by name
@@ -46,38 +103,164 @@ std::string assemble_call_error_rest_id(lambda_id_t id, const rs_registered_lamb
  * @param name Name of the lambda
  * @param lambda Lambda if found, NULL otherwise
  * @param error Occurred error code (RS_CALL_* constant)
- * @return A JSON string
+ * @param format Format of the string
+ * @return A JSON or CBOR string
  */
-std::string assemble_call_error_rest_name(std::string name, const rs_registered_lambda *lambda, int8_t error);
+std::string assemble_call_error_rest_name(std::string name, const rs_registered_lambda *lambda, int8_t error,
+                                          rest_format format = rest_format::JSON);
 
 /**
  * @brief Create a JSON string with a list of all registered lambdas
  *
- * @return A JSON string
+ * @param format Format of the string
+ * @return A shared JSON or CBOR body
  */
-std::string assemble_list_rest();
+rest_body assemble_list_rest(rest_format format = rest_format::JSON);
 
 /**
  * @brief Create a JSON string with a list of all registered lambdas of a specific type
  *
  * @param type Type of the lambda
- * @return A JSON string
+ * @param format Format of the string
+ * @return A shared JSON or CBOR body
  */
-std::string assemble_list_rest_for_type(rs_lambda_type_t type);
+rest_body assemble_list_rest_for_type(rs_lambda_type_t type, rest_format format = rest_format::JSON);
 
 /**
  * @brief Create a JSON string with a list of all registered lambdas and their cached results
  *
- * @return A JSON string
+ * @param format Format of the string
+ * @return A shared JSON or CBOR body
  */
-std::string assemble_cache_rest();
+rest_body assemble_cache_rest(rest_format format = rest_format::JSON);
 
 /**
  * @brief Create a JSON string with a list of all registered lambdas of a specific type and their cached results
  *
  * @param type Type of the lambda
+ * @param format Format of the string
+ * @return A shared JSON or CBOR body
+ */
+rest_body assemble_cache_rest_for_type(rs_lambda_type_t type, rest_format format = rest_format::JSON);
+
+/**
+ * @brief Get the IDs of the lambdas selected by a name pattern, the registry has to be locked by the caller
+ *
+ * @param pattern Name of a lambda, or a prefix followed by '*' (eg. temp*) selecting all lambdas whose name starts
+ * with it
+ * @param ids Where to store the IDs, in the order of the names
+ */
+void select_lambdas_by_name(const std::string &pattern, std::vector<lambda_id_t> *ids);
+
+/**
+ * @brief Create a JSON string with a list of the registered lambdas selected by a name pattern
+ *
+ * @param pattern Name pattern (see select_lambdas_by_name())
+ * @param type Type of the lambdas, 0 for all types
+ * @param format Format of the string
+ * @return A shared JSON or CBOR body
+ */
+rest_body assemble_list_rest_for_name(const std::string &pattern, rs_lambda_type_t type,
+                                      rest_format format = rest_format::JSON);
+
+/**
+ * @brief Create a JSON string with a list of the registered lambdas selected by a name pattern and their cached
+ * results
+ *
+ * @param pattern Name pattern (see select_lambdas_by_name())
+ * @param type Type of the lambdas, 0 for all types
+ * @param format Format of the string
+ * @return A shared JSON or CBOR body
+ */
+rest_body assemble_cache_rest_for_name(const std::string &pattern, rs_lambda_type_t type,
+                                       rest_format format = rest_format::JSON);
+
+/**
+ * @brief Create a JSON string for successful range queries over the result history
+ *
+ * @param lambda Queried lambda
+ * @param op Executed RS_QUERY_* operation
+ * @param from Lower time bound of the query
+ * @param to Upper time bound of the query
+ * @param quantile Requested quantile (only used for RS_QUERY_QUANTILE)
+ * @param count Number of samples within the range
+ * @param result Result of the query
+ * @param format Format of the string
+ * @return A JSON or CBOR string
+ */
+std::string assemble_query_success_rest(const rs_registered_lambda *lambda, rs_query_op_t op, uint64_t from,
+                                        uint64_t to, double quantile, size_t count, double result,
+                                        rest_format format = rest_format::JSON);
+
+/**
+ * @brief Create a JSON string for failed range queries by id
+ *
+ * @param id ID of the lambda
+ * @param lambda Lambda if found, NULL otherwise
+ * @param error Occurred error code (RS_QUERY_* constant)
+ * @param format Format of the string
+ * @return A JSON or CBOR string
+ */
+std::string assemble_query_error_rest_id(lambda_id_t id, const rs_registered_lambda *lambda, int8_t error,
+                                         rest_format format = rest_format::JSON);
+
+/**
+ * @brief Create a JSON string for failed range queries by name
+ *
+ * @param name Name of the lambda
+ * @param lambda Lambda if found, NULL otherwise
+ * @param error Occurred error code (RS_QUERY_* constant)
+ * @param format Format of the string
+ * @return A JSON or CBOR string
+ */
+std::string assemble_query_error_rest_name(std::string name, const rs_registered_lambda *lambda, int8_t error,
+                                           rest_format format = rest_format::JSON);
+
+/**
+ * @brief Create a JSON string for a single fired trigger event
+ *
+ * @param event Event
+ * @return A JSON string
+ */
+std::string assemble_event_rest(const rs_trigger_event *event);
+
+/**
+ * @brief Create a JSON string for a batch of fired trigger events
+ *
+ * @param events Events
+ * @param count Number of events
+ * @param after Sequence number the events were requested after
+ * @param dropped Number of events dropped by the event queue so far
+ * @param format Format of the string
+ * @return A JSON or CBOR string
+ */
+std::string assemble_events_rest(const rs_trigger_event *events, size_t count, uint64_t after, uint64_t dropped,
+                                 rest_format format = rest_format::JSON);
+
+/**
+ * @brief Create a JSON string for a result pushed to a stream
+ *
+ * @param update Stored result
  * @return A JSON string
  */
-std::string assemble_cache_rest_for_type(rs_lambda_type_t type);
+std::string assemble_stream_update_rest(const rs_stream_update *update);
+
+/**
+ * @brief Create a JSON string for the memory budget and the usage of each memory category
+ *
+ * @param format Format of the string
+ * @return A JSON or CBOR string
+ */
+std::string assemble_stats_rest(rest_format format = rest_format::JSON);
+
+/**
+ * @brief Create the call counters, cache statistics and serial round-trip times in the Prometheus text format
+ *
+ * Every registered lambda gets its call counters, a histogram of its round-trip times with power of two bucket
+ * bounds and the quantiles estimated from the finer buckets of rs_metrics.h.
+ *
+ * @return A Prometheus text exposition
+ */
+std::string assemble_metrics_prometheus();
 
 #endif //RIOTSENSORS_RS_REST_H
@@ -0,0 +1,245 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Writers for the serialization formats of REST responses
+ * @file    rs_rest_writer.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * Responses are built by a sequence of SAX style calls as known from rapidjson. RestWriter forwards them either to
+ * a rapidjson writer or to a CBOR encoder (RFC 7049), so every response is defined once for all formats.
+ *
+ * Both encoders write into buffers that are reused by the serializing thread, so building a response allocates
+ * nothing once the buffers have grown to the size of the largest response.
+ */
+
+#ifndef RIOTSENSORS_RS_REST_WRITER_H
+#define RIOTSENSORS_RS_REST_WRITER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <rapidjson/writer.h>
+
+/** @brief CoAP Content-Format of application/json */
+#define RS_COAP_FORMAT_JSON 50
+/** @brief CoAP Content-Format of application/cbor */
+#define RS_COAP_FORMAT_CBOR 60
+
+/**
+ * @brief Serialization format of a response body
+ */
+enum class rest_format : uint8_t {
+    /** @brief application/json */
+    JSON = 0,
+    /** @brief application/cbor */
+    CBOR = 1
+};
+
+/**
+ * @brief Immutable serialized response body, shared by the response cache and the responses being sent
+ */
+typedef std::shared_ptr<const std::string> rest_body;
+
+/**
+ * @brief rapidjson output stream appending to a string
+ */
+class StringOutputStream {
+public:
+    typedef char Ch;
+
+    explicit StringOutputStream(std::string *out) : out(out) {
+    }
+
+    void Put(char c) {
+        *out += c;
+    }
+
+    void Flush() {
+    }
+
+private:
+    std::string *out;
+};
+
+/**
+ * @brief Encodes SAX style calls as CBOR, maps and arrays are encoded with indefinite length
+ */
+class CborWriter {
+public:
+    /**
+     * @brief Create a writer appending to a buffer
+     *
+     * @param out Buffer the encoded data is appended to
+     */
+    explicit CborWriter(std::string *out);
+
+    bool Null();
+
+    bool Bool(bool b);
+
+    bool Int(int i);
+
+    bool Uint(unsigned u);
+
+    bool Int64(int64_t i);
+
+    bool Uint64(uint64_t u);
+
+    /**
+     * @brief Encode a double, as single precision float if that is lossless
+     */
+    bool Double(double d);
+
+    bool String(const char *str);
+
+    bool Key(const char *str);
+
+    bool StartObject();
+
+    bool EndObject();
+
+    bool StartArray();
+
+    bool EndArray();
+
+    /**
+     * @brief Append a complete data item encoded by another CborWriter
+     *
+     * @param encoded Encoded data item
+     */
+    bool RawValue(const std::string &encoded);
+
+    /**
+     * @brief Get the encoded data
+     *
+     * @return Encoded data, may contain null bytes
+     */
+    const std::string &str() const;
+
+private:
+    /**
+     * @brief Write the initial byte of a data item and its argument in the shortest form
+     *
+     * @param major Major type (0 to 7)
+     * @param value Argument
+     */
+    void head(uint8_t major, uint64_t value);
+
+    std::string *buffer;
+};
+
+/**
+ * @brief Serialization state reused by the RestWriter instances of one thread
+ */
+struct rest_writer_buffers {
+    std::string buffer;
+    StringOutputStream stream;
+    rapidjson::Writer<StringOutputStream> json;
+    CborWriter cbor;
+
+    rest_writer_buffers() : stream(&buffer), json(stream), cbor(&buffer) {
+    }
+};
+
+/**
+ * @brief Writer for a response body in one of the supported formats
+ */
+class RestWriter {
+public:
+    /**
+     * @brief Create an empty writer, it takes reusable buffers of the calling thread
+     *
+     * @param format Format of the body
+     */
+    explicit RestWriter(rest_format format);
+
+    /**
+     * @brief Return the buffers to the calling thread
+     */
+    ~RestWriter();
+
+    RestWriter(const RestWriter &) = delete;
+
+    RestWriter &operator=(const RestWriter &) = delete;
+
+    bool Null();
+
+    bool Bool(bool b);
+
+    bool Int(int i);
+
+    bool Uint(unsigned u);
+
+    bool Int64(int64_t i);
+
+    bool Uint64(uint64_t u);
+
+    bool Double(double d);
+
+    bool String(const char *str);
+
+    bool Key(const char *str);
+
+    bool StartObject();
+
+    bool EndObject();
+
+    bool StartArray();
+
+    bool EndArray();
+
+    /**
+     * @brief Write a value serialized before by a writer of the same format, eg. a fragment shared by many bodies
+     *
+     * @param fragment Serialized object, array or scalar
+     * @param type Type of the value, only used for the bookkeeping of the JSON writer
+     */
+    bool RawValue(const std::string &fragment, rapidjson::Type type = rapidjson::kObjectType);
+
+    /**
+     * @brief Get the serialized body without copying it
+     *
+     * @return Body in the format of the writer, valid until the writer is destroyed
+     */
+    const std::string &body() const;
+
+    /**
+     * @brief Get a copy of the serialized body
+     *
+     * @return Body in the format of the writer
+     */
+    std::string str() const;
+
+    /**
+     * @brief Get the serialized body as a shared body
+     *
+     * @return Copy of the body
+     */
+    rest_body share() const;
+
+private:
+    rest_format format;
+    std::unique_ptr<rest_writer_buffers> buffers;
+};
+
+/**
+ * @brief Get the media type of a format
+ *
+ * @param format Format
+ * @return Media type (eg. application/json)
+ */
+const char *rest_format_media_type(rest_format format);
+
+/**
+ * @brief Get the CoAP Content-Format of a format
+ *
+ * @param format Format
+ * @return RS_COAP_FORMAT_* constant
+ */
+unsigned int rest_format_coap_content_format(rest_format format);
+
+#endif //RIOTSENSORS_RS_REST_WRITER_H
@@ -15,13 +15,85 @@
 
 #include <pistache/endpoint.h>
 #include <rs_packets.h>
+#include <rs_admission.h>
+#include <rs_history.h>
+#include <rs_memory.h>
+#include <rs_stream.h>
+#include <rs_compression.h>
+#include <rs_rest.h>
+#include <rs_rest_writer.h>
+#include <functional>
+#include <string>
+#include <vector>
 
 using namespace Pistache;
 
+/** @brief Seconds a result of a lambda with cache policy RS_CACHE_CALL_ONCE may be cached by clients */
+#define RS_MAX_AGE_CALL_ONCE 3600
+/** @brief Seconds a result of a lambda with cache policy RS_CACHE_ONLY may be cached by clients */
+#define RS_MAX_AGE_CACHE_ONLY 1
+/** @brief Maximum number of events read from the event queue at once */
+#define RS_EVENTS_BATCH 64
+/** @brief Maximum number of milliseconds an event stream waits for new events */
+#define RS_EVENTS_MAX_WAIT 30000
+/** @brief Maximum number of results read from a stream queue at once */
+#define RS_STREAM_BATCH 16
+/** @brief Milliseconds a result stream stays open, clients reconnect afterwards */
+#define RS_STREAM_MAX_DURATION 60000
+/** @brief Milliseconds without results after which a comment is sent to keep the stream open */
+#define RS_STREAM_KEEPALIVE 15000
+/** @brief Default minimum number of milliseconds between two notifications of a CoAP observer */
+#define RS_OBSERVE_DEFAULT_INTERVAL 1000
+
+/**
+ * @brief Return type consisting of HTTP response code, response body and caching information for REST responses
+ */
+struct rest_response_info {
+    /** @brief HTTP response code */
+    Http::Code code;
+    /** @brief Response body, shared with the response cache */
+    rest_body body;
+    /** @brief Version of the data the body was built from, 0 if the response has no entity tag */
+    uint64_t etag;
+    /**
+     * @brief Seconds the response may be cached by clients and proxies, negative if it must not be stored, for
+     *        Too_Many_Requests the seconds after which the client may retry
+     */
+    int32_t max_age;
+    /** @brief Content coding of the body */
+    rest_encoding encoding;
+
+    rest_response_info(Http::Code response_code, rest_body response_body, uint64_t response_etag = 0,
+                       int32_t response_max_age = -1, rest_encoding response_encoding = rest_encoding::IDENTITY)
+            : code(response_code), body(std::move(response_body)), etag(response_etag), max_age(response_max_age),
+              encoding(response_encoding) {
+    }
+
+    rest_response_info(Http::Code response_code, std::string response_body, uint64_t response_etag = 0,
+                       int32_t response_max_age = -1, rest_encoding response_encoding = rest_encoding::IDENTITY)
+            : rest_response_info(response_code, std::make_shared<const std::string>(std::move(response_body)),
+                                 response_etag, response_max_age, response_encoding) {
+    }
+};
+
+/**
+ * @brief Parameters of a range query over the result history of a lambda
+ */
+struct rest_query_params {
+    /** @brief RS_QUERY_* operation */
+    rs_query_op_t op;
+    /** @brief Lower time bound in milliseconds since the epoch (inclusive) */
+    uint64_t from;
+    /** @brief Upper time bound in milliseconds since the epoch (inclusive) */
+    uint64_t to;
+    /** @brief Quantile in [0, 1] for RS_QUERY_QUANTILE */
+    double quantile;
+};
+
 /**
- * @brief Return type consisting of HTTP response code and response body for REST responses
+ * @brief Receives the response of an asynchronous REST call
  */
-typedef std::pair<Http::Code, std::string> rest_response_info;
+typedef std::function<void(const rest_response_info &)> rest_call_done;
 
 /**
  * @brief Handler functions for REST operations and responses
@@ -33,34 +105,250 @@ public:
      *
      * @param type Type of the lambda
      * @param id ID of the lambda
+     * @param format Format of the response body
+     * @param fields Fields of a successful response (see parseCallFields())
      * @return A pair containing the HTTP response code and the response body
      */
-    static rest_response_info handleCallById(rs_lambda_type_t type, lambda_id_t id);
+    static rest_response_info handleCallById(rs_lambda_type_t type, lambda_id_t id,
+                                             rest_format format = rest_format::JSON,
+                                             rest_fields fields = RS_FIELDS_ALL);
 
     /**
      * @brief Handle a REST call for a lambda identified by it's name
      *
      * @param type Type of the lambda
      * @param name Name of the lambda
+     * @param format Format of the response body
+     * @param fields Fields of a successful response (see parseCallFields())
      * @return A pair containing the HTTP response code and the response body
      */
-    static rest_response_info handleCallByName(rs_lambda_type_t type, std::string name);
+    static rest_response_info handleCallByName(rs_lambda_type_t type, std::string name,
+                                               rest_format format = rest_format::JSON,
+                                               rest_fields fields = RS_FIELDS_ALL);
+
+    /**
+     * @brief Handle a REST call for a lambda identified by it's ID without blocking the calling thread
+     *
+     * @param type Type of the lambda
+     * @param id ID of the lambda
+     * @param format Format of the response body
+     * @param fields Fields of a successful response (see parseCallFields())
+     * @param done Receives the response, called by the calling thread if the call is answered immediately or by a
+     * thread of the connector once the device answered or the call timed out
+     */
+    static void handleCallByIdAsync(rs_lambda_type_t type, lambda_id_t id, rest_format format, rest_fields fields,
+                                    rest_call_done done);
+
+    /**
+     * @brief Handle a REST call for a lambda identified by it's name without blocking the calling thread
+     *
+     * @param type Type of the lambda
+     * @param name Name of the lambda
+     * @param format Format of the response body
+     * @param fields Fields of a successful response (see parseCallFields())
+     * @param done Receives the response (see handleCallByIdAsync())
+     */
+    static void handleCallByNameAsync(rs_lambda_type_t type, std::string name, rest_format format,
+                                      rest_fields fields, rest_call_done done);
+
+    /**
+     * @brief Handle a REST call for several lambdas identified by their IDs, cached results are answered immediately
+     * and the other lambdas are called concurrently
+     *
+     * @param ids IDs of the lambdas
+     * @param types Expected type of each lambda, 0 to accept the registered type
+     * @param format Format of the response body
+     * @return A pair containing the HTTP response code and the response body
+     */
+    static rest_response_info handleCallMulti(const std::vector<lambda_id_t> &ids,
+                                              const std::vector<rs_lambda_type_t> &types,
+                                              rest_format format = rest_format::JSON);
+
+    /**
+     * @brief Handle a REST call for several lambdas identified by their IDs without blocking the calling thread
+     *
+     * Every lambda is called on its own with call_lambda_by_id_async(), the response is created once the last call
+     * completed.
+     *
+     * @param ids IDs of the lambdas
+     * @param types Expected type of each lambda, 0 to accept the registered type
+     * @param format Format of the response body
+     * @param done Receives the response (see handleCallByIdAsync())
+     */
+    static void handleCallMultiAsync(const std::vector<lambda_id_t> &ids, const std::vector<rs_lambda_type_t> &types,
+                                     rest_format format, rest_call_done done);
+
+    /**
+     * @brief Parse the parameters of a call of several lambdas, empty strings are treated as missing parameters
+     *
+     * The lambdas are either given by their IDs or selected by a name pattern, which is resolved to the IDs of the
+     * lambdas registered at this time.
+     *
+     * @param ids Comma separated list of lambda IDs
+     * @param types Comma separated list of lambda type codes, either one for all lambdas or one per lambda (default
+     * the registered types), only one if the lambdas are selected by name
+     * @param name Name pattern (see parseNamePattern()) selecting the lambdas instead of ids
+     * @param id_list Where to store the lambda IDs
+     * @param type_list Where to store the expected type of each lambda, 0 for the registered type
+     * @return nullptr on success, an error text otherwise
+     */
+    static const char *parseMultiParams(const std::string &ids, const std::string &types, const std::string &name,
+                                        std::vector<lambda_id_t> *id_list, std::vector<rs_lambda_type_t> *type_list);
+
+    /**
+     * @brief Check a name pattern selecting lambdas
+     *
+     * @param name Name of a lambda, or a prefix followed by '*' (eg. temp*) selecting all lambdas whose name starts
+     * with it
+     * @return nullptr if the pattern is valid, an error text otherwise
+     */
+    static const char *parseNamePattern(const std::string &name);
+
+    /**
+     * @brief Parse the field selection of a call, empty strings are treated as missing parameters
+     *
+     * @param fields Comma separated list of the fields success, lambda, cache and result (default all)
+     * @param view full (default) or value for the bare result
+     * @param selected Where to store the selected fields
+     * @return nullptr on success, an error text otherwise
+     */
+    static const char *parseCallFields(const std::string &fields, const std::string &view, rest_fields *selected);
 
     /**
      * @brief Handle a REST call to list all registered lambdas
      *
-     * @param type Type of the lambdas to be listed
+     * Lists selected by name are not kept in the response cache.
+     *
+     * @param type Type of the lambdas to be listed, 0 for all types
+     * @param name Name pattern (see parseNamePattern()) of the lambdas to be listed, empty for all lambdas
+     * @param format Format of the response body
+     * @param encoding Preferred content coding, the body is only compressed if it is large enough
      * @return A pair containing the HTTP response code and the response body
      */
-    static rest_response_info handleList(rs_lambda_type_t type);
+    static rest_response_info handleList(rs_lambda_type_t type, const std::string &name,
+                                         rest_format format = rest_format::JSON,
+                                         rest_encoding encoding = rest_encoding::IDENTITY);
 
     /**
      * @brief Handle a REST call to list all registered lambdas and their cached results
      *
-     * @param type Type of the lambdas to be listed
+     * Lists selected by name are not kept in the response cache.
+     *
+     * @param type Type of the lambdas to be listed, 0 for all types
+     * @param name Name pattern (see parseNamePattern()) of the lambdas to be listed, empty for all lambdas
+     * @param format Format of the response body
+     * @param encoding Preferred content coding, the body is only compressed if it is large enough
+     * @return A pair containing the HTTP response code and the response body
+     */
+    static rest_response_info handleCache(rs_lambda_type_t type, const std::string &name,
+                                          rest_format format = rest_format::JSON,
+                                          rest_encoding encoding = rest_encoding::IDENTITY);
+
+    /**
+     * @brief Handle a REST range query over the result history of a lambda identified by it's ID
+     *
+     * @param id ID of the lambda
+     * @param params Query parameters
+     * @param format Format of the response body
+     * @return A pair containing the HTTP response code and the response body
+     */
+    static rest_response_info handleQueryById(lambda_id_t id, const rest_query_params &params,
+                                              rest_format format = rest_format::JSON);
+
+    /**
+     * @brief Handle a REST range query over the result history of a lambda identified by it's name
+     *
+     * @param name Name of the lambda
+     * @param params Query parameters
+     * @param format Format of the response body
+     * @return A pair containing the HTTP response code and the response body
+     */
+    static rest_response_info handleQueryByName(std::string name, const rest_query_params &params,
+                                                rest_format format = rest_format::JSON);
+
+    /**
+     * @brief Parse the parameters of a range query, empty strings are treated as missing parameters
+     *
+     * @param op Name of the operation (count, sum, min, max, mean, quantile)
+     * @param from Lower time bound in milliseconds since the epoch (default 0)
+     * @param to Upper time bound in milliseconds since the epoch (default now)
+     * @param last Duration in milliseconds, sets the lower time bound relative to now if given
+     * @param quantile Quantile in [0, 1] (default 0.5)
+     * @param params Where to store the parsed parameters
+     * @return nullptr on success, an error text otherwise
+     */
+    static const char *parseQueryParams(const std::string &op, const std::string &from, const std::string &to,
+                                        const std::string &last, const std::string &quantile,
+                                        rest_query_params *params);
+
+    /**
+     * @brief Handle a REST call to read the fired trigger events following a sequence number without waiting
+     *
+     * @param after Sequence number of the last event the client has seen
+     * @param format Format of the response body
+     * @return A pair containing the HTTP response code and the response body
+     */
+    static rest_response_info handleEvents(uint64_t after, rest_format format = rest_format::JSON);
+
+    /**
+     * @brief Parse the parameters of an event request, empty strings are treated as missing parameters
+     *
+     * @param after Sequence number of the last event the client has seen (default 0)
+     * @param wait Milliseconds to wait for new events (default 0, at most RS_EVENTS_MAX_WAIT)
+     * @param after_seq Where to store the parsed sequence number
+     * @param wait_ms Where to store the parsed waiting time
+     * @return nullptr on success, an error text otherwise
+     */
+    static const char *parseEventParams(const std::string &after, const std::string &wait, uint64_t *after_seq,
+                                        uint32_t *wait_ms);
+
+    /**
+     * @brief Create the response notifying observers about a new result of a lambda, the device is not called
+     *
+     * @param update Stored result
+     * @param format Format of the response body
+     * @param fields Fields of the response body
+     * @return A pair containing the HTTP response code and the response body
+     */
+    static rest_response_info handleNotification(const rs_stream_update *update,
+                                                 rest_format format = rest_format::JSON,
+                                                 rest_fields fields = RS_FIELDS_ALL);
+
+    /**
+     * @brief Parse the parameters of a result stream request, empty strings are treated as missing parameters
+     *
+     * @param ids Comma separated list of lambda IDs (default all lambdas)
+     * @param type Name of the lambda type (default all types)
+     * @param id_set Where to store the bit set of the subscribed lambda IDs
+     * @param all_ids Where to store if all lambdas are subscribed
+     * @param lambda_type Where to store the lambda type, 0 for all types
+     * @return nullptr on success, an error text otherwise
+     */
+    static const char *parseStreamParams(const std::string &ids, const std::string &type, uint8_t *id_set,
+                                         bool *all_ids, rs_lambda_type_t *lambda_type);
+
+    /**
+     * @brief Handle a REST call for the memory budget and the memory used by cached data
+     *
+     * @param format Format of the response body
      * @return A pair containing the HTTP response code and the response body
      */
-    static rest_response_info handleCache(rs_lambda_type_t type);
+    static rest_response_info handleStats(rest_format format = rest_format::JSON);
+
+    /**
+     * @brief Handle a REST call for the call counters, cache statistics and serial round-trip times
+     *
+     * @return A pair containing the HTTP response code and the response body in the Prometheus text format
+     */
+    static rest_response_info handleMetrics();
+
+    /**
+     * @brief Evict cached responses, reclaimer of RS_MEMORY_RESPONSES
+     *
+     * @param bytes Number of bytes to free
+     * @return Number of bytes freed
+     */
+    static size_t reclaimResponses(size_t bytes);
 };
 
 /**
@@ -76,6 +364,29 @@ struct riotsensors_start_opts {
     char *serial;
     uint16_t http_port;
     uint16_t coap_port;
+    /** @brief Number of CoAP worker threads sharing the port */
+    unsigned int coap_threads;
+    /** @brief Minimum number of milliseconds between two notifications of a CoAP observer */
+    uint32_t observe_interval;
+    /** @brief Number of threads serving HTTP requests */
+    unsigned int http_threads;
+    size_t history_capacity;
+    /** @brief Memory budget for cached data in bytes, 0 for no limit */
+    size_t memory_budget;
+    /** @brief RS_EVICT_* policy used when the memory budget is exhausted */
+    rs_evict_policy_t evict_policy;
+    /** @brief Name of the shared memory object the latest results are published to, nullptr if disabled */
+    char *shm_name;
+    /** @brief Path of the Unix domain socket of the binary server, nullptr if disabled */
+    char *unix_path;
+    /** @brief Minimum size in bytes of a HTTP response body to be compressed */
+    size_t compress_min_bytes;
+    /** @brief Definitions of derived lambdas in the form NAME=EXPRESSION */
+    std::vector<std::string> derived;
+    /** @brief Trigger definitions (see rs_trigger_parse()) */
+    std::vector<std::string> triggers;
+    /** @brief Limits of the calls sent to the device */
+    rs_admission_limits admission;
 };
 
 /**
@@ -16,6 +16,15 @@
 #include <rs_server.h>
 #include <coap/coap.h>
 
+/** @brief Maximum number of datagrams a CoAP worker receives or sends with one system call */
+#define RS_COAP_BATCH 32
+
+/** @brief Path prefix of the resource every registered lambda gets, followed by the name of the lambda */
+#define RS_COAP_LAMBDA_PATH "v1/lambda/"
+
+/** @brief Resource type of the lambda resources in /.well-known/core */
+#define RS_COAP_LAMBDA_RT "\"riotsensors.lambda\""
+
 /**
  * @brief Processes all received CoAP REST calls
  */
@@ -24,11 +33,15 @@ public:
     /**
      * @brief Handle a REST call for a lambda identified by it's ID
      *
+     * Requests with an Observe option register the client as an observer of the lambda, notifications are
+     * created by this handler without a request. If the device does not answer before the handler returns, the
+     * request is acknowledged with an empty message and the answer is sent in a separate response.
+     *
      * @param ctx CoAP context
      * @param resource CoAP resource
      * @param local_interface CoAP local interface
      * @param peer CoAP peer endpoint
-     * @param request CoAP request
+     * @param request CoAP request, nullptr for notifications
      * @param token CoAP token
      * @param response CoAP response to send
      */
@@ -39,11 +52,15 @@ public:
     /**
      * @brief Handle a REST call for a lambda identified by it's name
      *
+     * Requests with an Observe option register the client as an observer of the lambda, notifications are
+     * created by this handler without a request. If the device does not answer before the handler returns, the
+     * request is acknowledged with an empty message and the answer is sent in a separate response.
+     *
      * @param ctx CoAP context
      * @param resource CoAP resource
      * @param local_interface CoAP local interface
      * @param peer CoAP peer endpoint
-     * @param request CoAP request
+     * @param request CoAP request, nullptr for notifications
      * @param token CoAP token
      * @param response CoAP response to send
      */
@@ -51,6 +68,41 @@ public:
                                  const coap_endpoint_t *local_interface, coap_address_t *peer,
                                  coap_pdu_t *request, str *token, coap_pdu_t *response);
 
+    /**
+     * @brief Handle a call on the resource of a lambda
+     *
+     * Every CoAP worker adds a resource below RS_COAP_LAMBDA_PATH for each registered lambda, bound to the ID and
+     * type of the lambda, and removes it when the lambda is unregistered. libcoap routes a request by the hash of its
+     * path, so neither the lambda nor its type have to be given or looked up. The resources are observable and
+     * answered like handleCallById().
+     *
+     * @param ctx CoAP context
+     * @param resource CoAP resource
+     * @param local_interface CoAP local interface
+     * @param peer CoAP peer endpoint
+     * @param request CoAP request, nullptr for notifications
+     * @param token CoAP token
+     * @param response CoAP response to send
+     */
+    static void handleLambda(coap_context_t *ctx, struct coap_resource_t *resource,
+                             const coap_endpoint_t *local_interface, coap_address_t *peer,
+                             coap_pdu_t *request, str *token, coap_pdu_t *response);
+
+    /**
+     * @brief Handle a REST call for several lambdas identified by their IDs
+     *
+     * @param ctx CoAP context
+     * @param resource CoAP resource
+     * @param local_interface CoAP local interface
+     * @param peer CoAP peer endpoint
+     * @param request CoAP request
+     * @param token CoAP token
+     * @param response CoAP response
+     */
+    static void handleCallMulti(coap_context_t *ctx, struct coap_resource_t *resource,
+                                const coap_endpoint_t *local_interface, coap_address_t *peer,
+                                coap_pdu_t *request, str *token, coap_pdu_t *response);
+
     /**
      * @brief Handle a REST call to list all registered lambdas
      *
@@ -81,6 +133,66 @@ public:
                             const coap_endpoint_t *local_interface, coap_address_t *peer,
                             coap_pdu_t *request, str *token, coap_pdu_t *response);
 
+    /**
+     * @brief Handle a REST range query over the result history of a lambda identified by it's ID
+     *
+     * @param ctx CoAP context
+     * @param resource CoAP resource
+     * @param local_interface CoAP local interface
+     * @param peer CoAP peer endpoint
+     * @param request CoAP request
+     * @param token CoAP token
+     * @param response CoAP response to send
+     */
+    static void handleQueryById(coap_context_t *ctx, struct coap_resource_t *resource,
+                                const coap_endpoint_t *local_interface, coap_address_t *peer,
+                                coap_pdu_t *request, str *token, coap_pdu_t *response);
+
+    /**
+     * @brief Handle a REST range query over the result history of a lambda identified by it's name
+     *
+     * @param ctx CoAP context
+     * @param resource CoAP resource
+     * @param local_interface CoAP local interface
+     * @param peer CoAP peer endpoint
+     * @param request CoAP request
+     * @param token CoAP token
+     * @param response CoAP response to send
+     */
+    static void handleQueryByName(coap_context_t *ctx, struct coap_resource_t *resource,
+                                  const coap_endpoint_t *local_interface, coap_address_t *peer,
+                                  coap_pdu_t *request, str *token, coap_pdu_t *response);
+
+    /**
+     * @brief Handle a REST call to read the fired trigger events following the sequence number in the after option
+     *
+     * @param ctx CoAP context
+     * @param resource CoAP resource
+     * @param local_interface CoAP local interface
+     * @param peer CoAP peer endpoint
+     * @param request CoAP request
+     * @param token CoAP token
+     * @param response CoAP response to send
+     */
+    static void handleEvents(coap_context_t *ctx, struct coap_resource_t *resource,
+                             const coap_endpoint_t *local_interface, coap_address_t *peer,
+                             coap_pdu_t *request, str *token, coap_pdu_t *response);
+
+    /**
+     * @brief Handle a REST call for the memory budget and the memory used by cached data
+     *
+     * @param ctx CoAP context
+     * @param resource CoAP resource
+     * @param local_interface CoAP local interface
+     * @param peer CoAP peer endpoint
+     * @param request CoAP request
+     * @param token CoAP token
+     * @param response CoAP response to send
+     */
+    static void handleStats(coap_context_t *ctx, struct coap_resource_t *resource,
+                            const coap_endpoint_t *local_interface, coap_address_t *peer,
+                            coap_pdu_t *request, str *token, coap_pdu_t *response);
+
     /**
      * @brief Handle a REST call to kill the server
      *
@@ -100,9 +212,17 @@ public:
 /**
  * @brief Start the CoAP REST server
  *
- * @param thread_ctx Unused context for pthreads
+ * Runs riotsensors_start_opts::coap_threads workers sharing the port with SO_REUSEPORT, one of them on the calling
+ * thread, and returns once all of them stopped.
+ *
+ * @param thread_ctx Start options (riotsensors_start_opts)
  * @return Unused return value for pthreads
  */
 void *startCoAPServer(void *thread_ctx);
 
+/**
+ * @brief Make the CoAP REST server return from startCoAPServer(), may be called from any thread
+ */
+void stopCoAPServer();
+
 #endif //RIOTSENSORS_RIOTSENSORS_SERVER_COAP_H
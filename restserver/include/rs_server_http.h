@@ -19,12 +19,105 @@
 
 using namespace Pistache;
 
+/**
+ * @brief ETag response header carrying the entity tag of a response
+ */
+class ETagHeader : public Http::Header::Header {
+public:
+    NAME("ETag")
+
+    ETagHeader() = default;
+
+    /**
+     * @brief Create the header
+     *
+     * @param value Formatted entity tag including quotes and weak prefix
+     */
+    explicit ETagHeader(std::string value) : tag(std::move(value)) {
+    }
+
+    void parse(const std::string &data) override {
+        tag = data;
+    }
+
+    void write(std::ostream &os) const override {
+        os << tag;
+    }
+
+private:
+    std::string tag;
+};
+
+/**
+ * @brief Retry-After response header telling a rejected client when to try again
+ */
+class RetryAfterHeader : public Http::Header::Header {
+public:
+    NAME("Retry-After")
+
+    RetryAfterHeader() = default;
+
+    /**
+     * @brief Create the header
+     *
+     * @param value Seconds to wait
+     */
+    explicit RetryAfterHeader(uint32_t value) : seconds(value) {
+    }
+
+    void parse(const std::string &data) override {
+        seconds = (uint32_t) std::stoul(data);
+    }
+
+    void write(std::ostream &os) const override {
+        os << seconds;
+    }
+
+private:
+    uint32_t seconds = 0;
+};
+
+/**
+ * @brief Vary response header naming the request headers a response was selected by
+ */
+class VaryHeader : public Http::Header::Header {
+public:
+    NAME("Vary")
+
+    VaryHeader() = default;
+
+    /**
+     * @brief Create the header
+     *
+     * @param value Comma separated list of request header names
+     */
+    explicit VaryHeader(std::string value) : fields(std::move(value)) {
+    }
+
+    void parse(const std::string &data) override {
+        fields = data;
+    }
+
+    void write(std::ostream &os) const override {
+        os << fields;
+    }
+
+private:
+    std::string fields;
+};
+
+/**
+ * @brief Event loop thread serving the responses that stay open (defined in rs_server_http.cpp)
+ */
+struct http_push_loop;
+
 /**
  * @brief Processes all received HTTP REST calls
  */
 class RiotsensorsHTTPProvider : public RiotsensorsRESTProvider {
 private:
     Http::Endpoint *server;
+    http_push_loop *push;
 public:
     /**
      * @brief Set the endpoint instance this handler is associated to
@@ -33,6 +126,13 @@ public:
      */
     void setServer(Http::Endpoint *server);
 
+    /**
+     * @brief Set the event loop the responses that stay open are handed over to
+     *
+     * @param push Push loop
+     */
+    void setPushLoop(http_push_loop *push);
+
     /**
      * @brief Handle a REST call for a lambda identified by it's ID
      *
@@ -49,6 +149,22 @@ public:
      */
     void handleCallByName(const Rest::Request &request, Http::ResponseWriter response);
 
+    /**
+     * @brief Handle a REST call for a lambda identified by the name in its resource path, with the registered type
+     *
+     * @param request Received request
+     * @param response Response to send
+     */
+    void handleLambda(const Rest::Request &request, Http::ResponseWriter response);
+
+    /**
+     * @brief Handle a REST call for several lambdas identified by their IDs
+     *
+     * @param request Received request
+     * @param response Response to send
+     */
+    void handleCallMulti(const Rest::Request &request, Http::ResponseWriter response);
+
     /**
      * @brief Handle a REST call to list all registered lambdas
      *
@@ -65,6 +181,64 @@ public:
      */
     void handleCache(const Rest::Request &request, Http::ResponseWriter response);
 
+    /**
+     * @brief Handle a REST range query over the result history of a lambda identified by it's ID
+     *
+     * @param request Received request
+     * @param response Response to send
+     */
+    void handleQueryById(const Rest::Request &request, Http::ResponseWriter response);
+
+    /**
+     * @brief Handle a REST range query over the result history of a lambda identified by it's name
+     *
+     * @param request Received request
+     * @param response Response to send
+     */
+    void handleQueryByName(const Rest::Request &request, Http::ResponseWriter response);
+
+    /**
+     * @brief Stream fired trigger events as newline delimited JSON objects
+     *
+     * Events after the sequence number in the after parameter are sent immediately. The stream then stays open
+     * for the number of milliseconds in the wait parameter and forwards new events as they are fired. Clients
+     * reconnect with the sequence number of the last event they received. The response is handed over to the push
+     * loop, so the reactor thread is not blocked while waiting.
+     *
+     * @param request Received request
+     * @param response Response to send
+     */
+    void handleEvents(const Rest::Request &request, Http::ResponseWriter response);
+
+    /**
+     * @brief Push every result stored for the lambdas selected by the ids and type parameters as Server-Sent Events
+     *
+     * Each client has its own bounded queue that keeps only the latest value of every lambda, so a slow client
+     * skips intermediate results. The stream ends after RS_STREAM_MAX_DURATION milliseconds and EventSource
+     * clients reconnect on their own. The response is handed over to the push loop, which sends the results when
+     * the queue signals them and a keepalive comment after RS_STREAM_KEEPALIVE milliseconds without results.
+     *
+     * @param request Received request
+     * @param response Response to send
+     */
+    void handleStream(const Rest::Request &request, Http::ResponseWriter response);
+
+    /**
+     * @brief Handle a REST call for the memory budget and the memory used by cached data
+     *
+     * @param request Received request
+     * @param response Response to send
+     */
+    void handleStats(const Rest::Request &request, Http::ResponseWriter response);
+
+    /**
+     * @brief Handle a REST call for the metrics in the Prometheus text format
+     *
+     * @param request Received request
+     * @param response Response to send
+     */
+    void handleMetrics(const Rest::Request &request, Http::ResponseWriter response);
+
     /**
      * @brief Handle a REST call to kill the server
      *
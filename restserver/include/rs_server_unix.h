@@ -0,0 +1,100 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+/**
+ * @brief   Header file of the binary server on a Unix domain socket
+ * @file    rs_server_unix.h
+ * @author  Patrick Grosse <patrick.grosse@uni-muenster.de>
+ *
+ * Clients on the same machine exchange the packets of the device protocol (rs_packets.h) instead of REST requests, so
+ * nothing is formatted or parsed as text. Every request and every answer is a frame of a 32 bit length in network
+ * byte order followed by that many bytes of one packet.
+ *
+ * Requests:
+ * - rs_packet_call_by_id_t and rs_packet_call_by_name_t call a lambda and are answered with the result packet of the
+ *   expected type, or with a rs_packet_lambda_result_error_t holding the RS_CALL_* constant of a failed call
+ * - rs_unix_packet_select_t of type RS_UNIX_PACKET_LIST is answered with a rs_unix_packet_selection_t followed by a
+ *   rs_unix_list_entry_t for every selected lambda
+ * - rs_unix_packet_select_t of type RS_UNIX_PACKET_CACHE is answered with a rs_unix_packet_selection_t followed by the
+ *   result packet of the cached value of every selected lambda, or an error packet with RS_CALL_CACHE_EMPTY
+ *
+ * Requests may be pipelined, they are answered in the order they were sent even if a later call is answered by the
+ * device first. A malformed request is answered with an error packet with RS_UNIX_INVALID_REQUEST, a frame longer than
+ * RS_UNIX_MAX_FRAME closes the connection.
+ */
+
+#ifndef RIOTSENSORS_RIOTSENSORS_SERVER_UNIX_H
+#define RIOTSENSORS_RIOTSENSORS_SERVER_UNIX_H
+
+#include <rs_server.h>
+
+/** @brief Default path of the socket */
+#define RS_UNIX_DEFAULT_PATH "/tmp/riotsensors.sock"
+
+/** @brief Maximum length of a request frame without the length prefix */
+#define RS_UNIX_MAX_FRAME 256
+
+/** @brief Number of unanswered requests of a connection after which no further requests are read */
+#define RS_UNIX_MAX_PIPELINE 1024
+
+/** @brief Number of unsent bytes of a connection after which no further requests are read */
+#define RS_UNIX_MAX_BACKLOG (256 * 1024)
+
+/** @brief Error code answering a request the server cannot parse */
+#define RS_UNIX_INVALID_REQUEST -16
+
+/** @brief Request listing the registered lambdas (rs_unix_packet_select_t) */
+#define RS_UNIX_PACKET_LIST 32
+/** @brief Request listing the cached results of the registered lambdas (rs_unix_packet_select_t) */
+#define RS_UNIX_PACKET_CACHE 33
+
+/**
+ * @brief Request selecting lambdas, followed by an optional name pattern up to the end of the frame
+ *
+ * The pattern is a name or a prefix followed by '*' (see select_lambdas_by_name()), without a pattern all lambdas
+ * are selected.
+ */
+typedef struct __packed {
+    rs_packet_base_t base;
+    /** @brief Type of the selected lambdas, 0 for all types */
+    rs_lambda_type_t type;
+} rs_unix_packet_select_t;
+
+/**
+ * @brief Answer of a rs_unix_packet_select_t, followed by one entry for every selected lambda
+ */
+typedef struct __packed {
+    /** @brief Type of the request */
+    rs_packet_base_t base;
+    /** @brief Number of entries in network byte order */
+    uint16_t count;
+} rs_unix_packet_selection_t;
+
+/**
+ * @brief Entry of the answer of a RS_UNIX_PACKET_LIST request
+ */
+typedef struct __packed {
+    lambda_id_t lambda_id;
+    /** @brief Properties of the lambda as registered by the device */
+    rs_packet_registered_t lambda;
+} rs_unix_list_entry_t;
+
+/**
+ * @brief Start the binary server on a Unix domain socket
+ *
+ * Replaces a stale socket file at riotsensors_start_opts::unix_path and returns once stopUnixServer() is called.
+ *
+ * @param thread_ctx Start options (riotsensors_start_opts)
+ * @return Unused return value for pthreads
+ */
+void *startUnixServer(void *thread_ctx);
+
+/**
+ * @brief Make the binary server return from startUnixServer(), may be called from any thread
+ */
+void stopUnixServer();
+
+#endif //RIOTSENSORS_RIOTSENSORS_SERVER_UNIX_H
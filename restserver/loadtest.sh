@@ -0,0 +1,39 @@
+#!/bin/bash
+# Measure how the HTTP server scales with the number of worker threads.
+#
+# Usage: loadtest.sh SERVER_BINARY DEVICE [URL_PATH]
+#
+# The server and the load generator are pinned to disjoint cores, the server gets 1 to 8 cores with as many
+# HTTP threads. Requires wrk and taskset. Answering calls from the cache needs a lambda with a cache policy,
+# otherwise every request waits for the device.
+set -e
+SERVER=$1
+DEVICE=$2
+URL_PATH=${3:-/v1/list}
+PORT=${PORT:-9080}
+DURATION=${DURATION:-20s}
+CONNECTIONS=${CONNECTIONS:-64}
+CORES=$(nproc)
+
+if [ -z "${SERVER}" ] || [ -z "${DEVICE}" ]; then
+    echo "Usage: $0 SERVER_BINARY DEVICE [URL_PATH]"
+    exit 1
+fi
+
+echo "threads requests/s latency"
+for THREADS in 1 2 4 8; do
+    if [ $((THREADS * 2)) -gt "${CORES}" ]; then
+        echo "------- Skipping ${THREADS} threads, needs $((THREADS * 2)) cores"
+        continue
+    fi
+    taskset -c 0-$((THREADS - 1)) "${SERVER}" -s "${DEVICE}" -h "${PORT}" -T "${THREADS}" > /dev/null 2>&1 &
+    PID=$!
+    sleep 2
+    RESULT=$(taskset -c "${THREADS}"-$((THREADS * 2 - 1)) wrk -t "${THREADS}" -c "${CONNECTIONS}" -d "${DURATION}" \
+        "http://127.0.0.1:${PORT}${URL_PATH}")
+    kill -INT "${PID}"
+    wait "${PID}" || true
+    RPS=$(echo "${RESULT}" | awk '/Requests\/sec/ {print $2}')
+    LATENCY=$(echo "${RESULT}" | awk '/Latency/ {print $2; exit}')
+    echo "${THREADS} ${RPS} ${LATENCY}"
+done
@@ -0,0 +1,60 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_coap_query.h>
+
+#include <cstring>
+
+std::string coap_query_param::str() const {
+    return found ? std::string(value, length) : std::string();
+}
+
+bool coap_query_param::copy(char *buf, size_t size) const {
+    if (length >= size) {
+        return false;
+    }
+    if (length > 0) {
+        memcpy(buf, value, length);
+    }
+    buf[length] = '\0';
+    return true;
+}
+
+bool coap_query_param::toUnsigned(unsigned long *number, unsigned long max) const {
+    if (length == 0) {
+        return false;
+    }
+    unsigned long parsed = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (value[i] < '0' || value[i] > '9') {
+            return false;
+        }
+        parsed = parsed * 10 + (unsigned long) (value[i] - '0');
+        if (parsed > max) {
+            return false;
+        }
+    }
+    *number = parsed;
+    return true;
+}
+
+bool coap_query_match(const uint8_t *option, size_t length, coap_query_param *params, size_t count) {
+    auto text = (const char *) option;
+    auto separator = (const char *) memchr(text, '=', length);
+    size_t key_length = separator != nullptr ? (size_t) (separator - text) : length;
+    for (size_t i = 0; i < count; i++) {
+        const char *key = params[i].key;
+        // the length of the key is bounded by the option, so long keys are not measured to the end
+        if (strnlen(key, key_length + 1) != key_length || memcmp(key, text, key_length) != 0) {
+            continue;
+        }
+        params[i].found = true;
+        params[i].value = separator != nullptr ? separator + 1 : text + length;
+        params[i].length = separator != nullptr ? length - key_length - 1 : 0;
+        return true;
+    }
+    return false;
+}
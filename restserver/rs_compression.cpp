@@ -0,0 +1,63 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_compression.h>
+
+#include <atomic>
+#include <zlib.h>
+
+/*
+ * zlib window bits, adding 16 makes deflate write a gzip header and trailer
+ */
+#define ZLIB_WINDOW_BITS 15
+#define GZIP_WINDOW_BITS (ZLIB_WINDOW_BITS + 16)
+
+/*
+ * Default of zlib, the responses are cached so higher levels hardly pay off
+ */
+#define COMPRESSION_LEVEL 6
+
+static std::atomic<size_t> compress_min_bytes(RS_COMPRESS_DEFAULT_MIN_BYTES);
+
+bool rest_compress(const std::string &body, rest_encoding encoding, std::string *compressed) {
+    if (encoding == rest_encoding::IDENTITY) {
+        return false;
+    }
+    z_stream stream{};
+    int window_bits = encoding == rest_encoding::GZIP ? GZIP_WINDOW_BITS : ZLIB_WINDOW_BITS;
+    if (deflateInit2(&stream, COMPRESSION_LEVEL, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    // the bound covers the gzip header as well, so a single deflate call finishes the stream
+    compressed->resize(deflateBound(&stream, (uLong) body.size()));
+    stream.next_in = (Bytef *) body.data();
+    stream.avail_in = (uInt) body.size();
+    stream.next_out = (Bytef *) &(*compressed)[0];
+    stream.avail_out = (uInt) compressed->size();
+    int res = deflate(&stream, Z_FINISH);
+    compressed->resize(stream.total_out);
+    deflateEnd(&stream);
+    return res == Z_STREAM_END;
+}
+
+const char *rest_encoding_name(rest_encoding encoding) {
+    switch (encoding) {
+        case rest_encoding::GZIP:
+            return "gzip";
+        case rest_encoding::DEFLATE:
+            return "deflate";
+        default:
+            return "identity";
+    }
+}
+
+void rest_set_compress_min_bytes(size_t bytes) {
+    compress_min_bytes = bytes;
+}
+
+size_t rest_get_compress_min_bytes() {
+    return compress_min_bytes;
+}
@@ -0,0 +1,154 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_event_loop.h>
+
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+static bool watch(int epoll_fd, int fd) {
+    struct epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+static void set_timespec(struct timespec *ts, uint32_t ms) {
+    ts->tv_sec = ms / 1000;
+    ts->tv_nsec = (long) (ms % 1000) * 1000000;
+}
+
+RiotsensorsEventLoop::RiotsensorsEventLoop() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd >= 0 && stop_fd >= 0 && !watch(epoll_fd, stop_fd)) {
+        close(stop_fd);
+        stop_fd = -1;
+    }
+}
+
+RiotsensorsEventLoop::~RiotsensorsEventLoop() {
+    for (auto &timer : timers) {
+        close(timer.first);
+    }
+    if (stop_fd >= 0) {
+        close(stop_fd);
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+}
+
+bool RiotsensorsEventLoop::valid() const {
+    return epoll_fd >= 0 && stop_fd >= 0;
+}
+
+bool RiotsensorsEventLoop::add(int fd, handler on_readable) {
+    if (!valid() || fd < 0 || !watch(epoll_fd, fd)) {
+        return false;
+    }
+    handlers[fd] = std::move(on_readable);
+    return true;
+}
+
+void RiotsensorsEventLoop::remove(int fd) {
+    if (handlers.erase(fd) > 0) {
+        writers.erase(fd);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+bool RiotsensorsEventLoop::modify(int fd, bool readable, handler on_writable) {
+    if (handlers.find(fd) == handlers.end()) {
+        return false;
+    }
+    struct epoll_event ev{};
+    ev.events = (readable ? (uint32_t) EPOLLIN : 0) | (on_writable ? (uint32_t) EPOLLOUT : 0);
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) != 0) {
+        return false;
+    }
+    if (on_writable) {
+        writers[fd] = std::move(on_writable);
+    } else {
+        writers.erase(fd);
+    }
+    return true;
+}
+
+int RiotsensorsEventLoop::addTimer(handler on_expired) {
+    if (!valid()) {
+        return -1;
+    }
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (!watch(epoll_fd, fd)) {
+        close(fd);
+        return -1;
+    }
+    timers[fd] = std::move(on_expired);
+    return fd;
+}
+
+void RiotsensorsEventLoop::armTimer(int timer, uint32_t delay_ms, uint32_t interval_ms) {
+    struct itimerspec spec{};
+    set_timespec(&spec.it_value, delay_ms);
+    set_timespec(&spec.it_interval, delay_ms == 0 ? 0 : interval_ms);
+    timerfd_settime(timer, 0, &spec, nullptr);
+}
+
+void RiotsensorsEventLoop::run() {
+    struct epoll_event events[RS_EVENT_LOOP_BATCH];
+    while (valid()) {
+        int ready = epoll_wait(epoll_fd, events, RS_EVENT_LOOP_BATCH, -1);
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            uint64_t value;
+            if (fd == stop_fd) {
+                ssize_t res = read(stop_fd, &value, sizeof(value));
+                (void) res;
+                return;
+            }
+            // looked up for every event, an earlier handler of the batch may have removed the descriptor
+            auto timer = timers.find(fd);
+            if (timer != timers.end()) {
+                // a timer rearmed by an earlier handler is not expired anymore
+                if (read(fd, &value, sizeof(value)) == sizeof(value)) {
+                    timer->second();
+                }
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                auto writer = writers.find(fd);
+                if (writer != writers.end()) {
+                    // copied, the handler may reset itself
+                    handler on_writable = writer->second;
+                    on_writable();
+                }
+            }
+            if (events[i].events & ~(uint32_t) EPOLLOUT) {
+                auto it = handlers.find(fd);
+                if (it != handlers.end()) {
+                    it->second();
+                }
+            }
+        }
+    }
+}
+
+void RiotsensorsEventLoop::stop() {
+    uint64_t one = 1;
+    ssize_t res = write(stop_fd, &one, sizeof(one));
+    (void) res;
+}
@@ -0,0 +1,269 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_server.h>
+
+#include <rs_server_coap.h>
+#include <rs_server_http.h>
+#include <rs_server_unix.h>
+#include <spt_logger.h>
+#include <argp.h>
+#include <algorithm>
+#include <thread>
+
+static pthread_t http_thread;
+static pthread_t coap_thread;
+static pthread_t unix_thread;
+
+/*
+ * ==============================
+ * ARGP options and main function
+ * ==============================
+ */
+
+const char *argp_program_version =
+        "riotsensors server 1.0";
+
+const char *argp_program_bug_address =
+        "<patrick.grosse@uni-muenster.de>";
+
+static struct argp_option options[] =
+        {
+                {"serial", 's', "FILE", 0, "file descriptor of serial console device (default /dev/ttyUSB0)"},
+                {"http",   'h', "PORT", 0, "port for the HTTP server (default 9080)"},
+                {"coap",   'c', "PORT", 0, "port for the CoAP server (default 5683)"},
+                {"observe-interval", 'O', "MS", 0,
+                        "minimum milliseconds between two notifications of a CoAP observer (default 1000)"},
+                {"threads", 'T', "COUNT", 0, "number of threads serving HTTP requests (default number of cores)"},
+                {"coap-threads", 'C', "COUNT", 0,
+                        "number of threads serving CoAP requests on the same port with SO_REUSEPORT (default 1)"},
+                {"history", 'H', "SAMPLES", 0, "number of results kept per lambda for range queries (default 4096)"},
+                {"derive", 'd', "NAME=EXPR", 0,
+                        "register a lambda computed from the cached results of other lambdas (repeatable)"},
+                {"trigger", 't', "NAME=LAMBDA:KIND:ARGS", 0,
+                        "add a trigger: above:LEVEL, below:LEVEL, rate:PER_SECOND or hysteresis:LOW:HIGH (repeatable)"},
+                {"memory", 'm', "BYTES", 0,
+                        "memory budget for cached strings, histories and responses, suffixes K, M and G (default 0, "
+                        "unlimited)"},
+                {"evict", 'e', "POLICY", 0, "what to evict if the memory budget is exhausted: lru or oldest (default lru)"},
+                {"shm", 'S', "NAME", OPTION_ARG_OPTIONAL,
+                        "publish the latest results to a shared memory table for local readers (default name "
+                        RS_SHM_DEFAULT_NAME ")"},
+                {"unix", 'u', "PATH", OPTION_ARG_OPTIONAL,
+                        "serve calls, lists and cached results as binary packets on a Unix domain socket for local "
+                        "clients (default path " RS_UNIX_DEFAULT_PATH ")"},
+                {"compress-min", 'z', "BYTES", 0,
+                        "minimum size of a list or showcache response to be compressed by gzip or deflate if the "
+                        "client accepts it, suffixes K, M and G (default 1K)"},
+                {"lambda-calls", 'l', "COUNT", 0,
+                        "maximum number of unanswered calls of one lambda, further calls are rejected (default 4, 0 "
+                        "unlimited)"},
+                {"device-calls", 'D', "COUNT", 0,
+                        "maximum number of unanswered calls of the device, further calls are rejected (default 32, 0 "
+                        "unlimited)"},
+                {"link-budget", 'b', "BYTES[:BURST]", 0,
+                        "bytes per second the serial link may carry for calls and at most BURST bytes at once, "
+                        "suffixes K, M and G (default 0, unlimited, BURST defaults to BYTES)"},
+                {nullptr}
+        };
+
+/**
+ * @brief Parse a number of bytes with an optional K, M or G suffix
+ *
+ * @param arg Argument
+ * @param bytes Where to store the number of bytes
+ * @return If the argument is valid
+ */
+static bool parse_bytes(const char *arg, size_t *bytes) {
+    char *end;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (end == arg) {
+        return false;
+    }
+    switch (*end) {
+        case 'G':
+        case 'g':
+            value *= 1024;
+            // fall through
+        case 'M':
+        case 'm':
+            value *= 1024;
+            // fall through
+        case 'K':
+        case 'k':
+            value *= 1024;
+            end++;
+            break;
+        default:
+            break;
+    }
+    *bytes = (size_t) value;
+    return *end == '\0';
+}
+
+static error_t
+parse_opt(int key, char *arg, struct argp_state *state) {
+    auto arguments = (struct riotsensors_start_opts *) state->input;
+
+    switch (key) {
+        case 's':
+            arguments->serial = arg;
+            break;
+        case 'h':
+            arguments->http_port = (uint16_t) std::stoul(arg);
+            break;
+        case 'c':
+            arguments->coap_port = (uint16_t) std::stoul(arg);
+            break;
+        case 'O':
+            arguments->observe_interval = (uint32_t) std::stoul(arg);
+            break;
+        case 'T':
+            arguments->http_threads = (unsigned int) std::stoul(arg);
+            if (arguments->http_threads == 0) {
+                argp_error(state, "at least one HTTP thread is required");
+            }
+            break;
+        case 'C':
+            arguments->coap_threads = (unsigned int) std::stoul(arg);
+            if (arguments->coap_threads == 0) {
+                argp_error(state, "at least one CoAP thread is required");
+            }
+            break;
+        case 'H':
+            arguments->history_capacity = (size_t) std::stoul(arg);
+            break;
+        case 'd':
+            arguments->derived.emplace_back(arg);
+            break;
+        case 't':
+            arguments->triggers.emplace_back(arg);
+            break;
+        case 'm':
+            if (!parse_bytes(arg, &arguments->memory_budget)) {
+                argp_error(state, "illegal memory budget %s", arg);
+            }
+            break;
+        case 'z':
+            if (!parse_bytes(arg, &arguments->compress_min_bytes)) {
+                argp_error(state, "illegal compression threshold %s", arg);
+            }
+            break;
+        case 'l':
+            arguments->admission.lambda_calls = (uint32_t) std::stoul(arg);
+            break;
+        case 'D':
+            arguments->admission.device_calls = (uint32_t) std::stoul(arg);
+            break;
+        case 'b': {
+            std::string budget(arg);
+            std::string::size_type loc = budget.find(':');
+            size_t rate;
+            size_t burst;
+            if (!parse_bytes(budget.substr(0, loc).c_str(), &rate) ||
+                (loc != std::string::npos && !parse_bytes(budget.substr(loc + 1).c_str(), &burst))) {
+                argp_error(state, "illegal link budget %s", arg);
+            }
+            arguments->admission.bytes_per_second = (uint32_t) rate;
+            arguments->admission.burst_bytes = (uint32_t) (loc != std::string::npos ? burst : rate);
+            break;
+        }
+        case 'S':
+            arguments->shm_name = arg != nullptr ? arg : (char *) RS_SHM_DEFAULT_NAME;
+            break;
+        case 'u':
+            arguments->unix_path = arg != nullptr ? arg : (char *) RS_UNIX_DEFAULT_PATH;
+            break;
+        case 'e':
+            arguments->evict_policy = get_evict_policy_from_string(arg);
+            if (arguments->evict_policy == (rs_evict_policy_t) -1) {
+                argp_error(state, "unknown eviction policy %s", arg);
+            }
+            break;
+        case ARGP_KEY_END:
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static char doc[] = "riotsensors REST server - a HTTP and CoAP REST server for riotsensors";
+
+static struct argp argp = {options, parse_opt, "", doc};
+
+int main(int argc, char *argv[]) {
+    auto arguments = new struct riotsensors_start_opts;
+    arguments->serial = (char *) "/dev/ttyUSB0";
+    arguments->http_port = 9080;
+    arguments->coap_port = 5683;
+    arguments->coap_threads = 1;
+    arguments->observe_interval = RS_OBSERVE_DEFAULT_INTERVAL;
+    arguments->http_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    arguments->history_capacity = RS_HISTORY_DEFAULT_CAPACITY;
+    arguments->memory_budget = 0;
+    arguments->evict_policy = RS_EVICT_LRU;
+    arguments->shm_name = nullptr;
+    arguments->unix_path = nullptr;
+    arguments->compress_min_bytes = RS_COMPRESS_DEFAULT_MIN_BYTES;
+    rs_admission_get_limits(&arguments->admission);
+    argp_parse(&argp, argc, argv, 0, nullptr, arguments);
+    rs_history_set_default_capacity(arguments->history_capacity);
+    rs_memory_set_budget(arguments->memory_budget);
+    rs_memory_set_policy(arguments->evict_policy);
+    rest_set_compress_min_bytes(arguments->compress_min_bytes);
+    rs_admission_set_limits(&arguments->admission);
+    rs_memory_set_reclaimer(RS_MEMORY_RESPONSES, RiotsensorsRESTHandler::reclaimResponses);
+
+    if (rs_linux_start(arguments->serial) != 0) {
+        fprintf(stderr, "Could not start riotsensors on serial port %s\n", arguments->serial);
+        return 1;
+    }
+    if (arguments->shm_name != nullptr && rs_linux_enable_shm(arguments->shm_name) != 0) {
+        fprintf(stderr, "Could not create shared memory object %s\n", arguments->shm_name);
+        return 1;
+    }
+    for (const std::string &definition : arguments->derived) {
+        std::string::size_type loc = definition.find('=');
+        if (loc == std::string::npos ||
+            rs_linux_register_derived(definition.substr(0, loc).c_str(), definition.substr(loc + 1).c_str()) < 0) {
+            fprintf(stderr, "Could not register derived lambda %s\n", definition.c_str());
+            return 1;
+        }
+    }
+    for (const std::string &definition : arguments->triggers) {
+        int8_t res = rs_linux_add_trigger(definition.c_str());
+        if (res != RS_TRIGGER_SUCCESS) {
+            fprintf(stderr, "Could not add trigger %s: %s\n", definition.c_str(), stringify_rs_trigger_result(res));
+            return 1;
+        }
+    }
+
+    spt_log_msg("main", "Starting HTTP server on port %d with %u threads...\n", arguments->http_port,
+                arguments->http_threads);
+    pthread_create(&http_thread, nullptr, startHTTPServer, arguments);
+    spt_log_msg("main", "Starting CoAP server on port %d with %u threads...\n", arguments->coap_port,
+                arguments->coap_threads);
+    pthread_create(&coap_thread, nullptr, startCoAPServer, arguments);
+    if (arguments->unix_path != nullptr) {
+        spt_log_msg("main", "Starting binary server on %s...\n", arguments->unix_path);
+        pthread_create(&unix_thread, nullptr, startUnixServer, arguments);
+    }
+
+    pthread_join(http_thread, nullptr);
+    // the HTTP server returns after a kill request or a signal
+    stopCoAPServer();
+    pthread_join(coap_thread, nullptr);
+    if (arguments->unix_path != nullptr) {
+        stopUnixServer();
+        pthread_join(unix_thread, nullptr);
+    }
+
+    rs_linux_stop();
+    rs_memory_set_reclaimer(RS_MEMORY_RESPONSES, nullptr);
+
+    delete arguments;
+}
@@ -0,0 +1,89 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_response_cache.h>
+#include <rs_memory.h>
+
+static uint32_t make_key(rest_response_kind kind, uint16_t discriminator, rest_format format,
+                         rest_encoding encoding) {
+    return ((uint32_t) encoding << 28) | ((uint32_t) format << 24) | ((uint32_t) kind << 16) | discriminator;
+}
+
+bool RiotsensorsResponseCache::get(rest_response_kind kind, uint16_t discriminator, rest_format format,
+                                   rest_encoding encoding, uint64_t version, rest_body *body) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = entries.find(make_key(kind, discriminator, format, encoding));
+    if (it == entries.end() || it->second.version != version) {
+        return false;
+    }
+    it->second.last_used = rs_memory_tick();
+    *body = it->second.body;
+    return true;
+}
+
+void RiotsensorsResponseCache::put(rest_response_kind kind, uint16_t discriminator, rest_format format,
+                                   rest_encoding encoding, uint64_t version, const rest_body &body) {
+    std::lock_guard<std::mutex> guard(lock);
+    uint32_t key = make_key(kind, discriminator, format, encoding);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        rs_memory_release(RS_MEMORY_RESPONSES, it->second.bytes);
+        entries.erase(it);
+    }
+    size_t bytes = sizeof(key) + sizeof(entry) + body->size();
+    // the reclaimer would take the lock again, so make room here
+    while (!rs_memory_try_reserve(RS_MEMORY_RESPONSES, bytes)) {
+        if (evict_one() == 0) {
+            return;
+        }
+    }
+    entry &e = entries[key];
+    e.version = version;
+    e.body = body;
+    e.bytes = bytes;
+    e.created = rs_memory_tick();
+    e.last_used = e.created;
+}
+
+void RiotsensorsResponseCache::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto &it : entries) {
+        rs_memory_release(RS_MEMORY_RESPONSES, it.second.bytes);
+    }
+    entries.clear();
+}
+
+size_t RiotsensorsResponseCache::evict(size_t bytes) {
+    std::lock_guard<std::mutex> guard(lock);
+    size_t freed = 0;
+    while (freed < bytes) {
+        size_t evicted = evict_one();
+        if (evicted == 0) {
+            break;
+        }
+        freed += evicted;
+    }
+    return freed;
+}
+
+size_t RiotsensorsResponseCache::evict_one() {
+    bool lru = rs_memory_get_policy() == RS_EVICT_LRU;
+    auto victim = entries.end();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (victim == entries.end() || (lru ? it->second.last_used < victim->second.last_used
+                                            : it->second.created < victim->second.created)) {
+            victim = it;
+        }
+    }
+    if (victim == entries.end()) {
+        return 0;
+    }
+    size_t bytes = victim->second.bytes;
+    entries.erase(victim);
+    rs_memory_release(RS_MEMORY_RESPONSES, bytes);
+    rs_memory_count_eviction(RS_MEMORY_RESPONSES, bytes);
+    return bytes;
+}
@@ -5,10 +5,30 @@
  */
 
 #include <rs_rest.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
 
-void print_result(rapidjson::Writer<rapidjson::StringBuffer> *writer, const rs_registered_lambda *lambda,
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief Holds the registry lock of the connector while the registry is walked, the connector thread and other
+ * server threads change the registry and the cached results concurrently
+ */
+class registry_lock_guard {
+public:
+    registry_lock_guard() {
+        rs_linux_lock_registry();
+    }
+
+    ~registry_lock_guard() {
+        rs_linux_unlock_registry();
+    }
+
+    registry_lock_guard(const registry_lock_guard &) = delete;
+
+    registry_lock_guard &operator=(const registry_lock_guard &) = delete;
+};
+
+void print_result(RestWriter *writer, const rs_registered_lambda *lambda,
                   const generic_lambda_return *result) {
     switch (lambda->type) {
         case RS_LAMBDA_INT:
@@ -25,7 +45,7 @@ void print_result(rapidjson::Writer<rapidjson::StringBuffer> *writer, const rs_r
     }
 }
 
-void print_lambda_properties(rapidjson::Writer<rapidjson::StringBuffer> *writer, const rs_registered_lambda *lambda) {
+void print_lambda_properties(RestWriter *writer, const rs_registered_lambda *lambda) {
     writer->StartObject();
     writer->Key("id");
     writer->Uint(lambda->id);
@@ -49,10 +69,15 @@ void print_lambda_properties(rapidjson::Writer<rapidjson::StringBuffer> *writer,
         writer->String(stringify_rs_cache_type_t(lambda->cache));
         writer->EndObject();
     }
+    auto arg = (rs_linux_registered_lambda *) lambda->arg.obj;
+    if (arg->derived != nullptr) {
+        writer->Key("expression");
+        writer->String(arg->derived->expr.source);
+    }
     writer->EndObject();
 }
 
-void print_lambda_type_n_cache_unknown(rapidjson::Writer<rapidjson::StringBuffer> *writer) {
+void print_lambda_type_n_cache_unknown(RestWriter *writer) {
     writer->Key("type");
     {
         writer->StartObject();
@@ -73,7 +98,7 @@ void print_lambda_type_n_cache_unknown(rapidjson::Writer<rapidjson::StringBuffer
     }
 }
 
-void print_cache_content(rapidjson::Writer<rapidjson::StringBuffer> *writer, const rs_registered_lambda *lambda) {
+void print_cache_content(RestWriter *writer, const rs_registered_lambda *lambda) {
     auto arg = (rs_linux_registered_lambda *) lambda->arg.obj;
     writer->StartObject();
     writer->Key("cache_available");
@@ -85,69 +110,127 @@ void print_cache_content(rapidjson::Writer<rapidjson::StringBuffer> *writer, con
     writer->EndObject();
 }
 
-std::string
-assemble_call_success_rest(rs_registered_lambda *lambda, bool cache_retrieved, bool timeout,
-                           generic_lambda_return *result) {
-    rapidjson::StringBuffer s;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(s);
-    writer.StartObject();
-    writer.Key("success");
-    writer.Bool(true);
-    writer.Key("lambda");
-    {
-        print_lambda_properties(&writer, lambda);
+void print_call_success(RestWriter *writer, const rs_registered_lambda *lambda, bool cache_retrieved, bool timeout,
+                        const generic_lambda_return *result, rest_fields fields = RS_FIELDS_ALL,
+                        const std::string *lambda_fragment = nullptr) {
+    if (fields == RS_FIELDS_VALUE) {
+        print_result(writer, lambda, result);
+        return;
     }
-    writer.Key("cache");
-    {
-        writer.StartObject();
-        writer.Key("retrieved");
-        writer.Bool(cache_retrieved);
-        writer.Key("timeout");
-        writer.Bool(timeout);
-        writer.EndObject();
+    writer->StartObject();
+    if (fields & RS_FIELD_SUCCESS) {
+        writer->Key("success");
+        writer->Bool(true);
     }
-    writer.Key("result");
-    print_result(&writer, lambda, result);
-    writer.EndObject();
-    return s.GetString();
+    if (fields & RS_FIELD_LAMBDA) {
+        writer->Key("lambda");
+        if (lambda_fragment != nullptr) {
+            writer->RawValue(*lambda_fragment);
+        } else {
+            print_lambda_properties(writer, lambda);
+        }
+    }
+    if (fields & RS_FIELD_CACHE) {
+        writer->Key("cache");
+        writer->StartObject();
+        writer->Key("retrieved");
+        writer->Bool(cache_retrieved);
+        writer->Key("timeout");
+        writer->Bool(timeout);
+        writer->EndObject();
+    }
+    if (fields & RS_FIELD_RESULT) {
+        writer->Key("result");
+        print_result(writer, lambda, result);
+    }
+    writer->EndObject();
 }
 
-std::string assemble_call_error_rest_id(lambda_id_t id, const rs_registered_lambda *lambda, int8_t error) {
-    rapidjson::StringBuffer s;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(s);
-    writer.StartObject();
-    writer.Key("success");
-    writer.Bool(false);
-    writer.Key("lambda");
+void print_call_error_id(RestWriter *writer, lambda_id_t id, const rs_registered_lambda *lambda, int8_t error) {
+    writer->StartObject();
+    writer->Key("success");
+    writer->Bool(false);
+    writer->Key("lambda");
     {
         if (lambda != nullptr) {
-            print_lambda_properties(&writer, lambda);
+            print_lambda_properties(writer, lambda);
         } else {
-            writer.StartObject();
-            writer.Key("id");
-            writer.Uint(id);
-            writer.Key("name");
-            writer.String("unknown");
-            print_lambda_type_n_cache_unknown(&writer);
-            writer.EndObject();
+            writer->StartObject();
+            writer->Key("id");
+            writer->Uint(id);
+            writer->Key("name");
+            writer->String("unknown");
+            print_lambda_type_n_cache_unknown(writer);
+            writer->EndObject();
         }
     }
-    writer.Key("error");
+    writer->Key("error");
     {
-        writer.StartObject();
-        writer.Key("code");
-        writer.Int(error);
-        writer.Key("string");
-        writer.String(stringify_rs_call_result(error));
-        writer.EndObject();
+        writer->StartObject();
+        writer->Key("code");
+        writer->Int(error);
+        writer->Key("string");
+        writer->String(stringify_rs_call_result(error));
+        writer->EndObject();
+    }
+    writer->EndObject();
+}
+
+rest_body
+assemble_call_success_rest(rs_registered_lambda *lambda, bool cache_retrieved, bool timeout,
+                           generic_lambda_return *result, rest_format format, rest_fields fields,
+                           const std::string *lambda_fragment) {
+    RestWriter writer(format);
+    print_call_success(&writer, lambda, cache_retrieved, timeout, result, fields, lambda_fragment);
+    return writer.share();
+}
+
+rest_body assemble_lambda_properties_rest(const rs_registered_lambda *lambda, rest_format format) {
+    RestWriter writer(format);
+    print_lambda_properties(&writer, lambda);
+    return writer.share();
+}
+
+std::string assemble_call_error_rest_id(lambda_id_t id, const rs_registered_lambda *lambda, int8_t error,
+                                        rest_format format) {
+    RestWriter writer(format);
+    print_call_error_id(&writer, id, lambda, error);
+    return writer.str();
+}
+
+std::string assemble_call_multi_rest(size_t count, const lambda_id_t *ids, const rs_registered_lambda *const *lambdas,
+                                     const int8_t *codes, const generic_lambda_return *results, rest_format format) {
+    RestWriter writer(format);
+    size_t failed = 0;
+    writer.StartObject();
+    writer.Key("results");
+    {
+        writer.StartArray();
+        for (size_t i = 0; i < count; i++) {
+            bool has_result = codes[i] == RS_CALL_SUCCESS || codes[i] == RS_CALL_CACHE ||
+                              codes[i] == RS_CALL_CACHE_TIMEOUT;
+            if (has_result && lambdas[i] != nullptr) {
+                print_call_success(&writer, lambdas[i], codes[i] != RS_CALL_SUCCESS,
+                                   codes[i] == RS_CALL_CACHE_TIMEOUT, &results[i]);
+            } else {
+                failed++;
+                // a result without registry entry was unregistered while the call was running
+                print_call_error_id(&writer, ids[i], lambdas[i], has_result ? (int8_t) RS_CALL_NOTFOUND : codes[i]);
+            }
+        }
+        writer.EndArray();
     }
+    writer.Key("count");
+    writer.Uint64(count);
+    writer.Key("failed");
+    writer.Uint64(failed);
     writer.EndObject();
-    return s.GetString();
+    return writer.str();
 }
 
-std::string assemble_call_error_rest_name(std::string name, const rs_registered_lambda *lambda, int8_t error) {
-    rapidjson::StringBuffer s;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+std::string assemble_call_error_rest_name(std::string name, const rs_registered_lambda *lambda, int8_t error,
+                                          rest_format format) {
+    RestWriter writer(format);
     writer.StartObject();
     writer.Key("success");
     writer.Bool(false);
@@ -175,12 +258,12 @@ std::string assemble_call_error_rest_name(std::string name, const rs_registered_
         writer.EndObject();
     }
     writer.EndObject();
-    return s.GetString();
+    return writer.str();
 }
 
-std::string assemble_list_rest() {
-    rapidjson::StringBuffer s;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+rest_body assemble_list_rest(rest_format format) {
+    registry_lock_guard guard;
+    RestWriter writer(format);
     lambda_id_t count = 0;
     writer.StartObject();
     writer.Key("lambdas");
@@ -203,12 +286,12 @@ std::string assemble_list_rest() {
     writer.Key("count");
     writer.Int(count);
     writer.EndObject();
-    return s.GetString();
+    return writer.share();
 }
 
-std::string assemble_list_rest_for_type(const rs_lambda_type_t type) {
-    rapidjson::StringBuffer s;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+rest_body assemble_list_rest_for_type(const rs_lambda_type_t type, rest_format format) {
+    registry_lock_guard guard;
+    RestWriter writer(format);
     lambda_id_t count = 0;
     writer.StartObject();
     writer.Key("lambdas");
@@ -234,12 +317,12 @@ std::string assemble_list_rest_for_type(const rs_lambda_type_t type) {
     writer.Key("count");
     writer.Int(count);
     writer.EndObject();
-    return s.GetString();
+    return writer.share();
 }
 
-std::string assemble_cache_rest() {
-    rapidjson::StringBuffer s;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+rest_body assemble_cache_rest(rest_format format) {
+    registry_lock_guard guard;
+    RestWriter writer(format);
     lambda_id_t count = 0;
     writer.StartObject();
     writer.Key("lambdas");
@@ -271,12 +354,12 @@ std::string assemble_cache_rest() {
     writer.Key("count");
     writer.Int(count);
     writer.EndObject();
-    return s.GetString();
+    return writer.share();
 }
 
-std::string assemble_cache_rest_for_type(const rs_lambda_type_t type) {
-    rapidjson::StringBuffer s;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+rest_body assemble_cache_rest_for_type(const rs_lambda_type_t type, rest_format format) {
+    registry_lock_guard guard;
+    RestWriter writer(format);
     lambda_id_t count = 0;
     writer.StartObject();
     writer.Key("lambdas");
@@ -311,5 +394,503 @@ std::string assemble_cache_rest_for_type(const rs_lambda_type_t type) {
     writer.Key("count");
     writer.Int(count);
     writer.EndObject();
-    return s.GetString();
-}
\ No newline at end of file
+    return writer.share();
+}
+
+void select_lambdas_by_name(const std::string &pattern, std::vector<lambda_id_t> *ids) {
+    ids->clear();
+    if (pattern.empty() || pattern.back() != '*') {
+        rs_registered_lambda *lambda = get_registered_lambda_by_name(pattern.c_str());
+        if (lambda != nullptr) {
+            ids->push_back(lambda->id);
+        }
+        return;
+    }
+    std::string prefix = pattern.substr(0, pattern.length() - 1);
+    ids->resize(MAX_LAMBDAS);
+    ids->resize(std::min<size_t>(get_registered_lambdas_by_prefix(prefix.c_str(), ids->data(), ids->size()),
+                                 MAX_LAMBDAS));
+}
+
+/**
+ * @brief Create the list of the lambdas selected by a name pattern
+ *
+ * @param pattern Name pattern (see select_lambdas_by_name())
+ * @param type Type of the lambdas, 0 for all types
+ * @param format Format of the string
+ * @param cache If the cached results are listed as well
+ * @return A shared JSON or CBOR body
+ */
+static rest_body assemble_selection_rest(const std::string &pattern, rs_lambda_type_t type, rest_format format,
+                                         bool cache) {
+    registry_lock_guard guard;
+    std::vector<lambda_id_t> ids;
+    select_lambdas_by_name(pattern, &ids);
+    RestWriter writer(format);
+    lambda_id_t count = 0;
+    writer.StartObject();
+    writer.Key("lambdas");
+    {
+        writer.StartObject();
+        for (lambda_id_t id : ids) {
+            rs_registered_lambda *lambda = get_registered_lambda_by_id(id);
+            if (lambda == nullptr || (type != 0 && lambda->type != type)) {
+                continue;
+            }
+            count++;
+            char idstr[10];
+            sprintf(idstr, "%d", lambda->id);
+            writer.Key(idstr);
+            if (!cache) {
+                print_lambda_properties(&writer, lambda);
+                continue;
+            }
+            writer.StartObject();
+            writer.Key("lambda");
+            {
+                print_lambda_properties(&writer, lambda);
+            }
+            writer.Key("cache-content");
+            {
+                print_cache_content(&writer, lambda);
+            }
+            writer.EndObject();
+        }
+        writer.EndObject();
+    }
+    writer.Key("count");
+    writer.Int(count);
+    writer.EndObject();
+    return writer.share();
+}
+
+rest_body assemble_list_rest_for_name(const std::string &pattern, rs_lambda_type_t type, rest_format format) {
+    return assemble_selection_rest(pattern, type, format, false);
+}
+
+rest_body assemble_cache_rest_for_name(const std::string &pattern, rs_lambda_type_t type, rest_format format) {
+    return assemble_selection_rest(pattern, type, format, true);
+}
+
+std::string assemble_query_success_rest(const rs_registered_lambda *lambda, rs_query_op_t op, uint64_t from,
+                                        uint64_t to, double quantile, size_t count, double result,
+                                        rest_format format) {
+    RestWriter writer(format);
+    writer.StartObject();
+    writer.Key("success");
+    writer.Bool(true);
+    writer.Key("lambda");
+    {
+        print_lambda_properties(&writer, lambda);
+    }
+    writer.Key("query");
+    {
+        writer.StartObject();
+        writer.Key("op");
+        writer.String(stringify_rs_query_op_t(op));
+        writer.Key("from");
+        writer.Uint64(from);
+        writer.Key("to");
+        writer.Uint64(to);
+        if (op == RS_QUERY_QUANTILE) {
+            writer.Key("quantile");
+            writer.Double(quantile);
+        }
+        writer.Key("count");
+        writer.Uint64(count);
+        writer.EndObject();
+    }
+    writer.Key("result");
+    writer.Double(result);
+    writer.EndObject();
+    return writer.str();
+}
+
+std::string assemble_query_error_rest_id(lambda_id_t id, const rs_registered_lambda *lambda, int8_t error,
+                                         rest_format format) {
+    RestWriter writer(format);
+    writer.StartObject();
+    writer.Key("success");
+    writer.Bool(false);
+    writer.Key("lambda");
+    {
+        if (lambda != nullptr) {
+            print_lambda_properties(&writer, lambda);
+        } else {
+            writer.StartObject();
+            writer.Key("id");
+            writer.Uint(id);
+            writer.Key("name");
+            writer.String("unknown");
+            print_lambda_type_n_cache_unknown(&writer);
+            writer.EndObject();
+        }
+    }
+    writer.Key("error");
+    {
+        writer.StartObject();
+        writer.Key("code");
+        writer.Int(error);
+        writer.Key("string");
+        writer.String(stringify_rs_query_result(error));
+        writer.EndObject();
+    }
+    writer.EndObject();
+    return writer.str();
+}
+
+std::string assemble_query_error_rest_name(std::string name, const rs_registered_lambda *lambda, int8_t error,
+                                           rest_format format) {
+    RestWriter writer(format);
+    writer.StartObject();
+    writer.Key("success");
+    writer.Bool(false);
+    writer.Key("lambda");
+    {
+        if (lambda != nullptr) {
+            print_lambda_properties(&writer, lambda);
+        } else {
+            writer.StartObject();
+            writer.Key("id");
+            writer.Int(-1);
+            writer.Key("name");
+            writer.String(name.c_str());
+            print_lambda_type_n_cache_unknown(&writer);
+            writer.EndObject();
+        }
+    }
+    writer.Key("error");
+    {
+        writer.StartObject();
+        writer.Key("code");
+        writer.Int(error);
+        writer.Key("string");
+        writer.String(stringify_rs_query_result(error));
+        writer.EndObject();
+    }
+    writer.EndObject();
+    return writer.str();
+}
+
+void print_event(RestWriter *writer, const rs_trigger_event *event) {
+    writer->StartObject();
+    writer->Key("seq");
+    writer->Uint64(event->seq);
+    writer->Key("timestamp");
+    writer->Uint64(event->timestamp);
+    writer->Key("trigger");
+    writer->String(event->trigger);
+    writer->Key("lambda");
+    writer->String(event->lambda);
+    writer->Key("kind");
+    writer->String(stringify_rs_trigger_kind_t(event->kind));
+    writer->Key("active");
+    writer->Bool(event->active);
+    writer->Key("value");
+    writer->Double(event->value);
+    writer->EndObject();
+}
+
+std::string assemble_event_rest(const rs_trigger_event *event) {
+    RestWriter writer(rest_format::JSON);
+    print_event(&writer, event);
+    return writer.str();
+}
+
+std::string assemble_events_rest(const rs_trigger_event *events, size_t count, uint64_t after, uint64_t dropped,
+                                 rest_format format) {
+    RestWriter writer(format);
+    writer.StartObject();
+    writer.Key("events");
+    {
+        writer.StartArray();
+        for (size_t i = 0; i < count; i++) {
+            print_event(&writer, &events[i]);
+        }
+        writer.EndArray();
+    }
+    writer.Key("count");
+    writer.Uint64(count);
+    writer.Key("last");
+    writer.Uint64(count > 0 ? events[count - 1].seq : after);
+    writer.Key("dropped");
+    writer.Uint64(dropped);
+    writer.EndObject();
+    return writer.str();
+}
+
+std::string assemble_stream_update_rest(const rs_stream_update *update) {
+    RestWriter writer(rest_format::JSON);
+    writer.StartObject();
+    writer.Key("id");
+    writer.Uint(update->id);
+    writer.Key("name");
+    writer.String(update->name);
+    writer.Key("type");
+    {
+        writer.StartObject();
+        writer.Key("code");
+        writer.Uint(update->type);
+        writer.Key("string");
+        writer.String(stringify_rs_lambda_type_t(update->type));
+        writer.EndObject();
+    }
+    writer.Key("version");
+    writer.Uint(update->version);
+    writer.Key("timestamp");
+    writer.Uint64(update->timestamp);
+    writer.Key("result");
+    switch (update->type) {
+        case RS_LAMBDA_INT:
+            writer.Int(update->value.ret_i);
+            break;
+        case RS_LAMBDA_DOUBLE:
+            writer.Double(update->value.ret_d);
+            break;
+        case RS_LAMBDA_STRING:
+            writer.String(update->value.ret_s);
+            break;
+        default:
+            writer.Null();
+            break;
+    }
+    writer.EndObject();
+    return writer.str();
+}
+
+std::string assemble_stats_rest(rest_format format) {
+    static const char *category_names[] = {"responses", "history", "strings"};
+    RestWriter writer(format);
+    writer.StartObject();
+    writer.Key("memory");
+    {
+        writer.StartObject();
+        writer.Key("budget");
+        writer.Uint64(rs_memory_get_budget());
+        writer.Key("used");
+        writer.Uint64(rs_memory_get_used());
+        writer.Key("policy");
+        writer.String(stringify_rs_evict_policy_t(rs_memory_get_policy()));
+        writer.Key("categories");
+        writer.StartObject();
+        for (rs_memory_category_t c = 0; c < RS_MEMORY_CATEGORIES; c++) {
+            rs_memory_usage usage{};
+            rs_memory_get_usage(c, &usage);
+            writer.Key(category_names[c]);
+            writer.StartObject();
+            writer.Key("bytes");
+            writer.Uint64(usage.bytes);
+            writer.Key("evictions");
+            writer.Uint64(usage.evictions);
+            writer.Key("evicted_bytes");
+            writer.Uint64(usage.evicted_bytes);
+            writer.Key("refused");
+            writer.Uint64(usage.refused);
+            writer.EndObject();
+        }
+        writer.EndObject();
+        writer.EndObject();
+    }
+    writer.EndObject();
+    return writer.str();
+}
+
+/**
+ * @brief Append the HELP and TYPE lines of a metric
+ *
+ * @param out Exposition to append to
+ * @param name Name of the metric
+ * @param type Prometheus metric type (eg. counter)
+ * @param help Description of the metric
+ */
+static void prometheus_header(std::string *out, const char *name, const char *type, const char *help) {
+    *out += "# HELP ";
+    *out += name;
+    *out += ' ';
+    *out += help;
+    *out += "\n# TYPE ";
+    *out += name;
+    *out += ' ';
+    *out += type;
+    *out += '\n';
+}
+
+/**
+ * @brief Create the id and lambda labels of a lambda
+ *
+ * @param id ID of the lambda
+ * @param name Name of the lambda
+ * @return Labels without braces
+ */
+static std::string prometheus_lambda_labels(lambda_id_t id, const char *name) {
+    std::string labels = "id=\"" + std::to_string(id) + "\",lambda=\"";
+    for (const char *c = name; *c != '\0'; c++) {
+        if (*c == '\\' || *c == '"') {
+            labels += '\\';
+            labels += *c;
+        } else if (*c == '\n') {
+            labels += "\\n";
+        } else {
+            labels += *c;
+        }
+    }
+    labels += '"';
+    return labels;
+}
+
+/**
+ * @brief Append a sample
+ *
+ * @param out Exposition to append to
+ * @param name Name of the metric including suffixes like _bucket
+ * @param labels Labels without braces, may be empty
+ * @param value Value
+ */
+static void prometheus_sample(std::string *out, const char *name, const std::string &labels, uint64_t value) {
+    *out += name;
+    if (!labels.empty()) {
+        *out += '{';
+        *out += labels;
+        *out += '}';
+    }
+    *out += ' ';
+    *out += std::to_string(value);
+    *out += '\n';
+}
+
+/**
+ * @brief Format microseconds as seconds
+ */
+static std::string prometheus_seconds(uint64_t micros) {
+    char seconds[32];
+    snprintf(seconds, sizeof(seconds), "%llu.%06llu", (unsigned long long) (micros / 1000000),
+             (unsigned long long) (micros % 1000000));
+    return seconds;
+}
+
+std::string assemble_metrics_prometheus() {
+    static const char *outcome_names[] = {"hit", "miss", "empty"};
+    static const char *admission_names[] = {"admitted", "lambda_limit", "device_limit", "rate_limit"};
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    struct lambda_labels {
+        lambda_id_t id;
+        std::string labels;
+    };
+    std::vector<lambda_labels> lambdas;
+    {
+        registry_lock_guard guard;
+        for (lambda_id_t i = 0; i < MAX_LAMBDAS; i++) {
+            rs_registered_lambda *lambda = get_registered_lambda_by_id(i);
+            if (lambda != nullptr) {
+                lambdas.push_back({lambda->id, prometheus_lambda_labels(lambda->id, lambda->name)});
+            }
+        }
+    }
+    // the counters are atomics, reading them does not need the registry lock
+    std::vector<rs_lambda_metrics> metrics(lambdas.size());
+    for (size_t i = 0; i < lambdas.size(); i++) {
+        rs_metrics_get_lambda(lambdas[i].id, &metrics[i]);
+    }
+    std::string out;
+
+    prometheus_header(&out, "riotsensors_lambda_calls_total", "counter",
+                      "Calls of a lambda by the RS_CALL_* result they finished with");
+    for (size_t i = 0; i < lambdas.size(); i++) {
+        for (int8_t code = RS_CALL_OVERLOAD; code <= RS_CALL_CACHE_TIMEOUT; code++) {
+            prometheus_sample(&out, "riotsensors_lambda_calls_total",
+                              lambdas[i].labels + ",result=\"" + stringify_rs_call_result(code) + "\"",
+                              metrics[i].results[code - RS_CALL_OVERLOAD]);
+        }
+    }
+    prometheus_header(&out, "riotsensors_lambda_call_packets_total", "counter",
+                      "Call packets of a lambda sent to the device");
+    for (size_t i = 0; i < lambdas.size(); i++) {
+        prometheus_sample(&out, "riotsensors_lambda_call_packets_total", lambdas[i].labels, metrics[i].sent);
+    }
+    prometheus_header(&out, "riotsensors_lambda_result_packets_total", "counter",
+                      "Result and error packets of a lambda received from the device");
+    for (size_t i = 0; i < lambdas.size(); i++) {
+        prometheus_sample(&out, "riotsensors_lambda_result_packets_total", lambdas[i].labels, metrics[i].received);
+    }
+    prometheus_header(&out, "riotsensors_lambda_timeouts_total", "counter",
+                      "Calls of a lambda the device did not answer in time");
+    for (size_t i = 0; i < lambdas.size(); i++) {
+        prometheus_sample(&out, "riotsensors_lambda_timeouts_total", lambdas[i].labels, metrics[i].timeouts);
+    }
+
+    prometheus_header(&out, "riotsensors_call_results_total", "counter",
+                      "Calls of all lambdas by the RS_CALL_* result or device error code they finished with");
+    for (int code = INT8_MIN; code <= INT8_MAX; code++) {
+        uint64_t count = rs_metrics_get_code((int8_t) code);
+        if (count > 0) {
+            const char *result = stringify_rs_call_result((int8_t) code);
+            prometheus_sample(&out, "riotsensors_call_results_total",
+                              "code=\"" + std::to_string(code) + "\",result=\"" +
+                              (result != nullptr ? result : "device error") + "\"", count);
+        }
+    }
+
+    prometheus_header(&out, "riotsensors_cache_lookups_total", "counter",
+                      "Cache lookups of calls by cache policy and outcome");
+    for (rs_cache_type_t policy = RS_CACHE_NO_CACHE; policy <= RS_CACHE_ON_TIMEOUT; policy++) {
+        for (uint8_t outcome = 0; outcome < RS_METRICS_CACHE_OUTCOMES; outcome++) {
+            prometheus_sample(&out, "riotsensors_cache_lookups_total",
+                              std::string("policy=\"") + stringify_rs_cache_type_t(policy) + "\",outcome=\"" +
+                              outcome_names[outcome] + "\"", rs_metrics_get_cache(policy, outcome));
+        }
+    }
+
+    prometheus_header(&out, "riotsensors_calls_in_flight", "gauge",
+                      "Calls waiting for the answer of the device, bounded by the admission control");
+    prometheus_sample(&out, "riotsensors_calls_in_flight", "", rs_admission_in_flight(MAX_LAMBDAS));
+    prometheus_header(&out, "riotsensors_lambda_calls_in_flight", "gauge",
+                      "Calls of a lambda waiting for the answer of the device");
+    for (size_t i = 0; i < lambdas.size(); i++) {
+        prometheus_sample(&out, "riotsensors_lambda_calls_in_flight", lambdas[i].labels,
+                          rs_admission_in_flight(lambdas[i].id));
+    }
+    prometheus_header(&out, "riotsensors_admission_decisions_total", "counter",
+                      "Calls admitted to the serial link or rejected by the limit named by the outcome");
+    for (uint8_t outcome = 0; outcome < RS_ADMISSION_OUTCOMES; outcome++) {
+        prometheus_sample(&out, "riotsensors_admission_decisions_total",
+                          std::string("outcome=\"") + admission_names[outcome] + "\"", rs_admission_count(outcome));
+    }
+
+    std::vector<uint64_t> buckets(RS_METRICS_RTT_BUCKETS);
+    prometheus_header(&out, "riotsensors_serial_rtt_seconds", "histogram",
+                      "Time between sending a call packet and receiving the answer of the device");
+    for (size_t i = 0; i < lambdas.size(); i++) {
+        rs_metrics_get_rtt_histogram(lambdas[i].id, buckets.data());
+        uint64_t cumulative = 0;
+        // one bound per power of two, the last bucket also holds all longer round trips
+        for (size_t b = 0; b < RS_METRICS_RTT_BUCKETS - 1; b++) {
+            cumulative += buckets[b];
+            if ((b + 1) % RS_METRICS_RTT_SUB_BUCKETS == 0) {
+                prometheus_sample(&out, "riotsensors_serial_rtt_seconds_bucket", lambdas[i].labels + ",le=\"" +
+                                  prometheus_seconds(rs_metrics_rtt_bucket_limit(b)) + "\"", cumulative);
+            }
+        }
+        cumulative += buckets[RS_METRICS_RTT_BUCKETS - 1];
+        prometheus_sample(&out, "riotsensors_serial_rtt_seconds_bucket", lambdas[i].labels + ",le=\"+Inf\"",
+                          cumulative);
+        out += "riotsensors_serial_rtt_seconds_sum{" + lambdas[i].labels + "} " +
+               prometheus_seconds(metrics[i].rtt_sum) + "\n";
+        prometheus_sample(&out, "riotsensors_serial_rtt_seconds_count", lambdas[i].labels, metrics[i].rtt_count);
+    }
+    prometheus_header(&out, "riotsensors_serial_rtt_quantile_seconds", "gauge",
+                      "Quantiles of the round-trip times, the upper bound of the bucket with a relative error "
+                      "below 1/16");
+    for (size_t i = 0; i < lambdas.size(); i++) {
+        if (metrics[i].rtt_count == 0) {
+            continue;
+        }
+        rs_metrics_get_rtt_histogram(lambdas[i].id, buckets.data());
+        for (double quantile : quantiles) {
+            char label[32];
+            snprintf(label, sizeof(label), ",quantile=\"%g\"", quantile);
+            out += "riotsensors_serial_rtt_quantile_seconds{" + lambdas[i].labels + label + "} " +
+                   prometheus_seconds(rs_metrics_rtt_quantile(buckets.data(), quantile)) + "\n";
+        }
+    }
+    return out;
+}
@@ -0,0 +1,247 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_rest_writer.h>
+
+#include <cstring>
+#include <vector>
+
+/*
+ * Major types and simple values of CBOR
+ */
+#define CBOR_UNSIGNED 0
+#define CBOR_NEGATIVE 1
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE 0xf5
+#define CBOR_NULL 0xf6
+#define CBOR_FLOAT32 0xfa
+#define CBOR_FLOAT64 0xfb
+#define CBOR_INDEFINITE 31
+#define CBOR_BREAK 0xff
+
+void CborWriter::head(uint8_t major, uint64_t value) {
+    auto type = (char) (major << 5);
+    if (value < 24) {
+        *buffer += (char) (type | value);
+        return;
+    }
+    int bytes;
+    if (value <= 0xff) {
+        *buffer += (char) (type | 24);
+        bytes = 1;
+    } else if (value <= 0xffff) {
+        *buffer += (char) (type | 25);
+        bytes = 2;
+    } else if (value <= 0xffffffff) {
+        *buffer += (char) (type | 26);
+        bytes = 4;
+    } else {
+        *buffer += (char) (type | 27);
+        bytes = 8;
+    }
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        *buffer += (char) (value >> shift);
+    }
+}
+
+bool CborWriter::Null() {
+    *buffer += (char) CBOR_NULL;
+    return true;
+}
+
+bool CborWriter::Bool(bool b) {
+    *buffer += (char) (b ? CBOR_TRUE : CBOR_FALSE);
+    return true;
+}
+
+bool CborWriter::Int(int i) {
+    return Int64(i);
+}
+
+bool CborWriter::Uint(unsigned u) {
+    head(CBOR_UNSIGNED, u);
+    return true;
+}
+
+bool CborWriter::Int64(int64_t i) {
+    if (i >= 0) {
+        head(CBOR_UNSIGNED, (uint64_t) i);
+    } else {
+        // -1 - i without overflow for INT64_MIN
+        head(CBOR_NEGATIVE, ~(uint64_t) i);
+    }
+    return true;
+}
+
+bool CborWriter::Uint64(uint64_t u) {
+    head(CBOR_UNSIGNED, u);
+    return true;
+}
+
+bool CborWriter::Double(double d) {
+    auto f = (float) d;
+    uint64_t bits;
+    int bytes;
+    if ((double) f == d || d != d) {
+        uint32_t fbits;
+        memcpy(&fbits, &f, sizeof(fbits));
+        *buffer += (char) CBOR_FLOAT32;
+        bits = fbits;
+        bytes = 4;
+    } else {
+        memcpy(&bits, &d, sizeof(bits));
+        *buffer += (char) CBOR_FLOAT64;
+        bytes = 8;
+    }
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        *buffer += (char) (bits >> shift);
+    }
+    return true;
+}
+
+bool CborWriter::String(const char *str) {
+    size_t length = strlen(str);
+    head(CBOR_TEXT, length);
+    buffer->append(str, length);
+    return true;
+}
+
+bool CborWriter::Key(const char *str) {
+    return String(str);
+}
+
+bool CborWriter::StartObject() {
+    *buffer += (char) ((CBOR_MAP << 5) | CBOR_INDEFINITE);
+    return true;
+}
+
+bool CborWriter::EndObject() {
+    *buffer += (char) CBOR_BREAK;
+    return true;
+}
+
+bool CborWriter::StartArray() {
+    *buffer += (char) ((CBOR_ARRAY << 5) | CBOR_INDEFINITE);
+    return true;
+}
+
+bool CborWriter::EndArray() {
+    *buffer += (char) CBOR_BREAK;
+    return true;
+}
+
+bool CborWriter::RawValue(const std::string &encoded) {
+    buffer->append(encoded);
+    return true;
+}
+
+const std::string &CborWriter::str() const {
+    return *buffer;
+}
+
+CborWriter::CborWriter(std::string *out) : buffer(out) {
+}
+
+/*
+ * Buffers of the finished writers of this thread, usually a single entry
+ */
+static thread_local std::vector<std::unique_ptr<rest_writer_buffers>> free_buffers;
+
+RestWriter::RestWriter(rest_format format) : format(format) {
+    if (free_buffers.empty()) {
+        buffers.reset(new rest_writer_buffers());
+    } else {
+        buffers = std::move(free_buffers.back());
+        free_buffers.pop_back();
+        // keeps the capacity of the buffer
+        buffers->buffer.clear();
+        buffers->json.Reset(buffers->stream);
+    }
+}
+
+RestWriter::~RestWriter() {
+    free_buffers.push_back(std::move(buffers));
+}
+
+bool RestWriter::Null() {
+    return format == rest_format::CBOR ? buffers->cbor.Null() : buffers->json.Null();
+}
+
+bool RestWriter::Bool(bool b) {
+    return format == rest_format::CBOR ? buffers->cbor.Bool(b) : buffers->json.Bool(b);
+}
+
+bool RestWriter::Int(int i) {
+    return format == rest_format::CBOR ? buffers->cbor.Int(i) : buffers->json.Int(i);
+}
+
+bool RestWriter::Uint(unsigned u) {
+    return format == rest_format::CBOR ? buffers->cbor.Uint(u) : buffers->json.Uint(u);
+}
+
+bool RestWriter::Int64(int64_t i) {
+    return format == rest_format::CBOR ? buffers->cbor.Int64(i) : buffers->json.Int64(i);
+}
+
+bool RestWriter::Uint64(uint64_t u) {
+    return format == rest_format::CBOR ? buffers->cbor.Uint64(u) : buffers->json.Uint64(u);
+}
+
+bool RestWriter::Double(double d) {
+    return format == rest_format::CBOR ? buffers->cbor.Double(d) : buffers->json.Double(d);
+}
+
+bool RestWriter::String(const char *str) {
+    return format == rest_format::CBOR ? buffers->cbor.String(str) : buffers->json.String(str);
+}
+
+bool RestWriter::Key(const char *str) {
+    return format == rest_format::CBOR ? buffers->cbor.Key(str) : buffers->json.Key(str);
+}
+
+bool RestWriter::StartObject() {
+    return format == rest_format::CBOR ? buffers->cbor.StartObject() : buffers->json.StartObject();
+}
+
+bool RestWriter::EndObject() {
+    return format == rest_format::CBOR ? buffers->cbor.EndObject() : buffers->json.EndObject();
+}
+
+bool RestWriter::StartArray() {
+    return format == rest_format::CBOR ? buffers->cbor.StartArray() : buffers->json.StartArray();
+}
+
+bool RestWriter::EndArray() {
+    return format == rest_format::CBOR ? buffers->cbor.EndArray() : buffers->json.EndArray();
+}
+
+bool RestWriter::RawValue(const std::string &fragment, rapidjson::Type type) {
+    return format == rest_format::CBOR ? buffers->cbor.RawValue(fragment)
+                                       : buffers->json.RawValue(fragment.data(), fragment.length(), type);
+}
+
+const std::string &RestWriter::body() const {
+    return buffers->buffer;
+}
+
+std::string RestWriter::str() const {
+    return buffers->buffer;
+}
+
+rest_body RestWriter::share() const {
+    return std::make_shared<const std::string>(buffers->buffer);
+}
+
+const char *rest_format_media_type(rest_format format) {
+    return format == rest_format::CBOR ? "application/cbor" : "application/json";
+}
+
+unsigned int rest_format_coap_content_format(rest_format format) {
+    return format == rest_format::CBOR ? RS_COAP_FORMAT_CBOR : RS_COAP_FORMAT_JSON;
+}
@@ -7,140 +7,733 @@
 #include <rs_server.h>
 
 #include <rs_rest.h>
-#include <rs_server_coap.h>
-#include <rs_server_http.h>
+#include <rs_response_cache.h>
 #include <spt_logger.h>
-#include <argp.h>
+#include <unused.h>
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <mutex>
 
-static pthread_t http_thread;
-static pthread_t coap_thread;
+/**
+ * Serialized responses of the handlers below
+ */
+static RiotsensorsResponseCache response_cache;
 
-rest_response_info RiotsensorsRESTHandler::handleCallById(rs_lambda_type_t type, lambda_id_t id) {
-    spt_log_msg("web", "Calling for lambda by ID with ID %d and expected type %d...\n", id, type);
-    generic_lambda_return result{};
-    int8_t res = call_lambda_by_id(id, type, &result);
-    rs_registered_lambda *lambda = get_registered_lambda_by_id(id);
-    switch (res) {
-        case RS_CALL_SUCCESS:
-            return std::make_pair(Http::Code::Ok,
-                                  assemble_call_success_rest(lambda, false, false, &result));
-        case RS_CALL_CACHE:
-            return std::make_pair(Http::Code::Ok,
-                                  assemble_call_success_rest(lambda, true, false, &result));
-        case RS_CALL_CACHE_TIMEOUT:
-            return std::make_pair(Http::Code::Ok,
-                                  assemble_call_success_rest(lambda, true, true, &result));
+size_t RiotsensorsRESTHandler::reclaimResponses(size_t bytes) {
+    return response_cache.evict(bytes);
+}
+
+static uint64_t combine_versions(uint32_t high, uint32_t low) {
+    return ((uint64_t) high << 32) | low;
+}
+
+/**
+ * @brief Get the number of seconds clients may cache a call result, derived from the cache policy of the lambda
+ *
+ * @param lambda Called lambda
+ * @param res RS_CALL_* result of the call
+ * @return Seconds the result may be cached
+ */
+static int32_t call_max_age(const rs_registered_lambda *lambda, int8_t res) {
+    if (res == RS_CALL_CACHE_TIMEOUT) {
+        return 0;
+    }
+    switch (lambda->cache) {
+        case RS_CACHE_CALL_ONCE:
+            return RS_MAX_AGE_CALL_ONCE;
+        case RS_CACHE_ONLY:
+            return RS_MAX_AGE_CACHE_ONLY;
         default:
-            return std::make_pair(Http::Code::Not_Found, assemble_call_error_rest_id(id, lambda, res));
+            return 0;
+    }
+}
+
+/**
+ * @brief Get the serialized properties of a lambda embedded in call responses, built once per registry version
+ *
+ * @param lambda Called lambda
+ * @param registry_version Registry version read before the call
+ * @param format Format of the fragment
+ * @return The fragment
+ */
+static rest_body lambda_fragment(const rs_registered_lambda *lambda, uint32_t registry_version, rest_format format) {
+    uint64_t version = combine_versions(registry_version, 0);
+    rest_body fragment;
+    if (!response_cache.get(rest_response_kind::LAMBDA, lambda->id, format, rest_encoding::IDENTITY, version,
+                            &fragment)) {
+        fragment = assemble_lambda_properties_rest(lambda, format);
+        response_cache.put(rest_response_kind::LAMBDA, lambda->id, format, rest_encoding::IDENTITY, version,
+                           fragment);
     }
+    return fragment;
 }
 
-rest_response_info RiotsensorsRESTHandler::handleCallByName(rs_lambda_type_t type, std::string name) {
+/**
+ * @brief Create the response for a successful call, the body is taken from the response cache if possible
+ *
+ * A new result only requires the result itself to be serialized, the properties of the lambda are taken from a
+ * cached fragment.
+ *
+ * @param lambda Called lambda
+ * @param res RS_CALL_* result of the call (RS_CALL_SUCCESS, RS_CALL_CACHE or RS_CALL_CACHE_TIMEOUT)
+ * @param result Result (has to match the type of the lambda)
+ * @param registry_version Registry version read before the call
+ * @param value_version Version of the result
+ * @param format Format of the body
+ * @param fields Fields of the body
+ * @return The response
+ */
+static rest_response_info call_success_response(rs_registered_lambda *lambda, int8_t res,
+                                                generic_lambda_return *result, uint32_t registry_version,
+                                                uint32_t value_version, rest_format format, rest_fields fields) {
+    bool cache_retrieved = res != RS_CALL_SUCCESS;
+    bool timeout = res == RS_CALL_CACHE_TIMEOUT;
+    auto discriminator = (uint16_t) ((fields << 10) | (lambda->id << 2) | (cache_retrieved ? 1 : 0) |
+                                     (timeout ? 2 : 0));
+    uint64_t version = combine_versions(registry_version, value_version);
+    rest_body body;
+    if (!response_cache.get(rest_response_kind::CALL, discriminator, format, rest_encoding::IDENTITY, version,
+                            &body)) {
+        rest_body fragment;
+        if (fields != RS_FIELDS_VALUE && (fields & RS_FIELD_LAMBDA)) {
+            fragment = lambda_fragment(lambda, registry_version, format);
+        }
+        body = assemble_call_success_rest(lambda, cache_retrieved, timeout, result, format, fields, fragment.get());
+        response_cache.put(rest_response_kind::CALL, discriminator, format, rest_encoding::IDENTITY, version,
+                           body);
+    }
+    // bodies with other fields are built from the same version, but must not validate each other
+    uint64_t etag = version ^ ((uint64_t) (fields ^ RS_FIELDS_ALL) << 56);
+    return rest_response_info(Http::Code::Ok, body, etag, call_max_age(lambda, res));
+}
+
+/**
+ * @brief Create the response for a call and free the string result copied by the connector
+ *
+ * @param lambda Copy of the called lambda taken after the call, nullptr if it is not registered anymore
+ * @param type Type the lambda was called with, the connector only returns results of this type
+ * @param res RS_CALL_* result of the call
+ * @param result Result of the call
+ * @param registry_version Registry version read before the call
+ * @param value_version Version of the result
+ * @param format Format of the body
+ * @param fields Fields of a successful response, errors are always answered with all fields
+ * @param error_body Creates the body of an error response for a RS_CALL_* error code and the lambda it describes
+ * @return The response
+ */
+template<typename ErrorBody>
+static rest_response_info call_response(rs_registered_lambda *lambda, rs_lambda_type_t type, int8_t res,
+                                        generic_lambda_return *result, uint32_t registry_version,
+                                        uint32_t value_version, rest_format format, rest_fields fields,
+                                        ErrorBody error_body) {
+    bool has_result = res == RS_CALL_SUCCESS || res == RS_CALL_CACHE || res == RS_CALL_CACHE_TIMEOUT;
+    if (has_result && (lambda == nullptr || lambda->type != type)) {
+        // unregistered, or registered again with another type, while the call was running
+        if (type == RS_LAMBDA_STRING) {
+            free(result->ret_s);
+        }
+        return rest_response_info(Http::Code::Not_Found, error_body(RS_CALL_NOTFOUND, nullptr));
+    }
+    if (res == RS_CALL_OVERLOAD) {
+        return rest_response_info(Http::Code::Too_Many_Requests, error_body(res, lambda), 0,
+                                  (int32_t) rs_admission_retry_after());
+    }
+    if (!has_result) {
+        return rest_response_info(Http::Code::Not_Found, error_body(res, lambda));
+    }
+    rest_response_info answer = call_success_response(lambda, res, result, registry_version, value_version, format,
+                                                      fields);
+    if (type == RS_LAMBDA_STRING) {
+        free(result->ret_s);
+    }
+    return answer;
+}
+
+rest_response_info RiotsensorsRESTHandler::handleCallById(rs_lambda_type_t type, lambda_id_t id, rest_format format,
+                                                          rest_fields fields) {
+    spt_log_msg("web", "Calling for lambda by ID with ID %d and expected type %d...\n", id, type);
+    generic_lambda_return result{};
+    uint32_t registry_version = rs_linux_get_registry_version();
+    uint32_t value_version = 0;
+    int8_t res = call_lambda_by_id_versioned(id, type, &result, &value_version);
+    rs_registered_lambda copy{};
+    rs_registered_lambda *lambda = copy_registered_lambda_by_id(id, &copy) ? &copy : nullptr;
+    return call_response(lambda, type, res, &result, registry_version, value_version, format, fields,
+                         [id, format](int8_t error, const rs_registered_lambda *described) {
+                             return assemble_call_error_rest_id(id, described, error, format);
+                         });
+}
+
+rest_response_info RiotsensorsRESTHandler::handleCallByName(rs_lambda_type_t type, std::string name,
+                                                            rest_format format, rest_fields fields) {
     spt_log_msg("web", "Calling for lambda by name with name %s and expected type %d...\n", name.c_str(), type);
     generic_lambda_return result{};
-    int8_t res = call_lambda_by_name(name.c_str(), type, &result);
-    rs_registered_lambda *lambda = get_registered_lambda_by_name(name.c_str());
-    switch (res) {
-        case RS_CALL_SUCCESS:
-            return std::make_pair(Http::Code::Ok,
-                                  assemble_call_success_rest(lambda, false, false, &result));
-        case RS_CALL_CACHE:
-            return std::make_pair(Http::Code::Ok,
-                                  assemble_call_success_rest(lambda, true, false, &result));
-        case RS_CALL_CACHE_TIMEOUT:
-            return std::make_pair(Http::Code::Ok,
-                                  assemble_call_success_rest(lambda, true, true, &result));
-        default:
-            return std::make_pair(Http::Code::Not_Found, assemble_call_error_rest_name(name, lambda, res));
+    uint32_t registry_version = rs_linux_get_registry_version();
+    uint32_t value_version = 0;
+    int8_t res = call_lambda_by_name_versioned(name.c_str(), type, &result, &value_version);
+    rs_registered_lambda copy{};
+    rs_registered_lambda *lambda = copy_registered_lambda_by_name(name.c_str(), &copy) ? &copy : nullptr;
+    return call_response(lambda, type, res, &result, registry_version, value_version, format, fields,
+                         [&name, format](int8_t error, const rs_registered_lambda *described) {
+                             return assemble_call_error_rest_name(name, described, error, format);
+                         });
+}
 
+/**
+ * @brief State of an asynchronous call, owned by the connector until the call completes
+ */
+struct rest_async_call {
+    /** @brief ID of the lambda, only used if it is called by ID */
+    lambda_id_t id;
+    /** @brief Name of the lambda, empty if it is called by ID */
+    std::string name;
+    /** @brief Type the lambda is called with, the type of the result */
+    rs_lambda_type_t type;
+    uint32_t registry_version;
+    rest_format format;
+    rest_fields fields;
+    rest_call_done done;
+};
+
+/**
+ * @brief Create the response of a completed asynchronous call and pass it on (rs_call_callback)
+ */
+static void complete_async_call(int8_t res, generic_lambda_return *result, uint32_t version, void *ctx) {
+    std::unique_ptr<rest_async_call> call((rest_async_call *) ctx);
+    rs_registered_lambda copy{};
+    rest_format format = call->format;
+    if (call->name.empty()) {
+        lambda_id_t id = call->id;
+        rs_registered_lambda *lambda = copy_registered_lambda_by_id(id, &copy) ? &copy : nullptr;
+        call->done(call_response(lambda, call->type, res, result, call->registry_version, version, format,
+                                 call->fields,
+                                 [id, format](int8_t error, const rs_registered_lambda *described) {
+                                     return assemble_call_error_rest_id(id, described, error, format);
+                                 }));
+    } else {
+        const std::string &name = call->name;
+        rs_registered_lambda *lambda = copy_registered_lambda_by_name(name.c_str(), &copy) ? &copy : nullptr;
+        call->done(call_response(lambda, call->type, res, result, call->registry_version, version, format,
+                                 call->fields,
+                                 [&name, format](int8_t error, const rs_registered_lambda *described) {
+                                     return assemble_call_error_rest_name(name, described, error, format);
+                                 }));
     }
 }
 
-rest_response_info RiotsensorsRESTHandler::handleList(rs_lambda_type_t type) {
-    if (type == 0) {
-        spt_log_msg("web", "Listing all registered lambdas...\n");
-        return std::make_pair(Http::Code::Ok, assemble_list_rest());
+void RiotsensorsRESTHandler::handleCallByIdAsync(rs_lambda_type_t type, lambda_id_t id, rest_format format,
+                                                 rest_fields fields, rest_call_done done) {
+    spt_log_msg("web", "Calling for lambda by ID with ID %d and expected type %d...\n", id, type);
+    auto call = new rest_async_call{id, std::string(), type, rs_linux_get_registry_version(), format, fields,
+                                    std::move(done)};
+    call_lambda_by_id_async(id, type, complete_async_call, call);
+}
+
+void RiotsensorsRESTHandler::handleCallByNameAsync(rs_lambda_type_t type, std::string name, rest_format format,
+                                                   rest_fields fields, rest_call_done done) {
+    spt_log_msg("web", "Calling for lambda by name with name %s and expected type %d...\n", name.c_str(), type);
+    auto call = new rest_async_call{0, name, type, rs_linux_get_registry_version(), format, fields,
+                                    std::move(done)};
+    call_lambda_by_name_async(call->name.c_str(), type, complete_async_call, call);
+}
+
+/**
+ * @brief Replace the expected type 0 by the type each lambda is registered with
+ *
+ * The results are freed by the type they are called with, so every call has to name its type. Lambdas that are not
+ * registered get RS_LAMBDA_INT, their calls fail or check the type of a lambda registered in the meantime.
+ *
+ * @param ids IDs of the lambdas
+ * @param types Expected type of each lambda, 0 to accept the registered type
+ * @return The type to call each lambda with
+ */
+static std::vector<rs_lambda_type_t> resolve_call_types(const std::vector<lambda_id_t> &ids,
+                                                        const std::vector<rs_lambda_type_t> &types) {
+    std::vector<rs_lambda_type_t> resolved(types);
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (resolved[i] == 0) {
+            rs_registered_lambda copy{};
+            resolved[i] = copy_registered_lambda_by_id(ids[i], &copy) ? copy.type : (rs_lambda_type_t) RS_LAMBDA_INT;
+        }
     }
-    spt_log_msg("web", "Listing all registered lambdas for type %d...\n", type);
-    return std::make_pair(Http::Code::Ok, assemble_list_rest_for_type(type));
+    return resolved;
 }
 
-rest_response_info RiotsensorsRESTHandler::handleCache(rs_lambda_type_t type) {
-    if (type == 0) {
-        spt_log_msg("web", "Listing all registered lambdas and the cached values...\n");
-        return std::make_pair(Http::Code::Ok, assemble_cache_rest());
+/**
+ * @brief Create the response of a call of several lambdas and free the string results
+ *
+ * @param ids IDs of the lambdas
+ * @param types Type each lambda was called with (see resolve_call_types())
+ * @param codes RS_CALL_* result of each call
+ * @param results Results of the calls
+ * @param format Format of the response body
+ * @return The response
+ */
+static rest_response_info call_multi_response(const std::vector<lambda_id_t> &ids,
+                                              const std::vector<rs_lambda_type_t> &types,
+                                              const std::vector<int8_t> &codes,
+                                              std::vector<generic_lambda_return> &results, rest_format format) {
+    size_t count = ids.size();
+    std::vector<rs_registered_lambda> copies(count);
+    std::vector<const rs_registered_lambda *> lambdas(count);
+    // the combined response may be cached as long as the shortest lived result
+    int32_t max_age = RS_MAX_AGE_CALL_ONCE;
+    for (size_t i = 0; i < count; i++) {
+        lambdas[i] = copy_registered_lambda_by_id(ids[i], &copies[i]) ? &copies[i] : nullptr;
+        bool has_result = codes[i] == RS_CALL_SUCCESS || codes[i] == RS_CALL_CACHE ||
+                          codes[i] == RS_CALL_CACHE_TIMEOUT;
+        if (has_result && lambdas[i] != nullptr && lambdas[i]->type != types[i]) {
+            // registered again with another type while the call was running
+            lambdas[i] = nullptr;
+        }
+        if (has_result && lambdas[i] != nullptr) {
+            max_age = std::min(max_age, call_max_age(lambdas[i], codes[i]));
+        } else {
+            max_age = -1;
+        }
+    }
+    std::string body = assemble_call_multi_rest(count, ids.data(), lambdas.data(), codes.data(), results.data(),
+                                                format);
+    for (size_t i = 0; i < count; i++) {
+        bool has_result = codes[i] == RS_CALL_SUCCESS || codes[i] == RS_CALL_CACHE ||
+                          codes[i] == RS_CALL_CACHE_TIMEOUT;
+        if (has_result && types[i] == RS_LAMBDA_STRING) {
+            free(results[i].ret_s);
+        }
     }
-    spt_log_msg("web", "Listing all registered lambdas and the cached values for type %d...\n", type);
-    return std::make_pair(Http::Code::Ok, assemble_cache_rest_for_type(type));
+    return rest_response_info(Http::Code::Ok, body, 0, max_age);
 }
 
-/*
- * ==============================
- * ARGP options and main function
- * ==============================
+rest_response_info RiotsensorsRESTHandler::handleCallMulti(const std::vector<lambda_id_t> &ids,
+                                                           const std::vector<rs_lambda_type_t> &types,
+                                                           rest_format format) {
+    spt_log_msg("web", "Calling for %zu lambdas by ID...\n", ids.size());
+    size_t count = ids.size();
+    std::vector<generic_lambda_return> results(count);
+    std::vector<int8_t> codes(count);
+    std::vector<rs_lambda_type_t> call_types = resolve_call_types(ids, types);
+    call_lambdas_by_id_versioned(count, ids.data(), call_types.data(), results.data(), nullptr, codes.data());
+    return call_multi_response(ids, call_types, codes, results, format);
+}
+
+/**
+ * @brief State of an asynchronous call of several lambdas, shared by the calls of the single lambdas
  */
+struct rest_async_multi_call {
+    std::vector<lambda_id_t> ids;
+    /** @brief Type each lambda is called with */
+    std::vector<rs_lambda_type_t> types;
+    rest_format format;
+    rest_call_done done;
+    /** @brief Guards the fields below, the calls complete on different threads */
+    std::mutex lock;
+    std::vector<generic_lambda_return> results;
+    std::vector<int8_t> codes;
+    /** @brief Number of calls that have not completed yet */
+    size_t pending;
+};
 
-const char *argp_program_version =
-        "riotsensors server 1.0";
-
-const char *argp_program_bug_address =
-        "<patrick.grosse@uni-muenster.de>";
-
-static struct argp_option options[] =
-        {
-                {"serial", 's', "FILE", 0, "file descriptor of serial console device (default /dev/ttyUSB0)"},
-                {"http",   'h', "PORT", 0, "port for the HTTP server (default 9080)"},
-                {"coap",   'c', "PORT", 0, "port for the CoAP server (default 5683)"},
-                {nullptr}
-        };
-
-static error_t
-parse_opt(int key, char *arg, struct argp_state *state) {
-    auto arguments = (struct riotsensors_start_opts *) state->input;
-
-    switch (key) {
-        case 's':
-            arguments->serial = arg;
-            break;
-        case 'h':
-            arguments->http_port = (uint16_t) std::stoul(arg);
-            break;
-        case 'c':
-            arguments->coap_port = (uint16_t) std::stoul(arg);
-            break;
-        case ARGP_KEY_END:
-            break;
-        default:
-            return ARGP_ERR_UNKNOWN;
+/**
+ * @brief One call of an asynchronous call of several lambdas, owned by the connector until the call completes
+ */
+struct rest_async_multi_part {
+    std::shared_ptr<rest_async_multi_call> call;
+    /** @brief Index of the lambda in rest_async_multi_call::ids */
+    size_t index;
+};
+
+/**
+ * @brief Record the outcome of one call and pass the response on after the last one (rs_call_callback)
+ */
+static void complete_async_multi_part(int8_t res, generic_lambda_return *result, uint32_t version, void *ctx) {
+    UNUSED(version);
+    std::unique_ptr<rest_async_multi_part> part((rest_async_multi_part *) ctx);
+    rest_async_multi_call *call = part->call.get();
+    {
+        std::lock_guard<std::mutex> guard(call->lock);
+        call->codes[part->index] = res;
+        call->results[part->index] = *result;
+        if (--call->pending > 0) {
+            return;
+        }
     }
-    return 0;
+    // the last completion is the only thread left accessing the results
+    call->done(call_multi_response(call->ids, call->types, call->codes, call->results, call->format));
 }
 
-static char doc[] = "riotsensors REST server - a HTTP and CoAP REST server for riotsensors";
+void RiotsensorsRESTHandler::handleCallMultiAsync(const std::vector<lambda_id_t> &ids,
+                                                  const std::vector<rs_lambda_type_t> &types, rest_format format,
+                                                  rest_call_done done) {
+    spt_log_msg("web", "Calling for %zu lambdas by ID...\n", ids.size());
+    auto call = std::make_shared<rest_async_multi_call>();
+    call->ids = ids;
+    call->types = resolve_call_types(ids, types);
+    call->format = format;
+    call->done = std::move(done);
+    call->results.resize(ids.size());
+    call->codes.resize(ids.size());
+    call->pending = ids.size();
+    if (ids.empty()) {
+        call->done(call_multi_response(call->ids, call->types, call->codes, call->results, format));
+        return;
+    }
+    // all calls are sent before any answer is awaited, so they run concurrently on the device
+    for (size_t i = 0; i < ids.size(); i++) {
+        call_lambda_by_id_async(ids[i], call->types[i], complete_async_multi_part, new rest_async_multi_part{call, i});
+    }
+}
 
-static struct argp argp = {options, parse_opt, "", doc};
+const char *RiotsensorsRESTHandler::parseNamePattern(const std::string &name) {
+    size_t length = !name.empty() && name.back() == '*' ? name.length() - 1 : name.length();
+    if (name.empty() || length > MAX_LAMBDA_NAME_LENGTH) {
+        return "Illegal name parameter";
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (!isalnum((unsigned char) name[i])) {
+            return "Illegal name parameter";
+        }
+    }
+    return nullptr;
+}
+
+const char *RiotsensorsRESTHandler::parseMultiParams(const std::string &ids, const std::string &types,
+                                                     const std::string &name, std::vector<lambda_id_t> *id_list,
+                                                     std::vector<rs_lambda_type_t> *type_list) {
+    if (ids.empty() && name.empty()) {
+        return "Missing ids parameter";
+    }
+    if (!ids.empty() && !name.empty()) {
+        return "Either ids or name can be given";
+    }
+    id_list->clear();
+    if (!name.empty()) {
+        const char *error = parseNamePattern(name);
+        if (error != nullptr) {
+            return error;
+        }
+        if (types.find(',') != std::string::npos) {
+            return "Only one type can be given with name";
+        }
+        rs_linux_lock_registry();
+        select_lambdas_by_name(name, id_list);
+        rs_linux_unlock_registry();
+        if (id_list->empty()) {
+            return "No lambda matches the name parameter";
+        }
+    }
+    uint8_t seen[(MAX_LAMBDAS + 7) / 8] = {0};
+    std::string::size_type pos = 0;
+    while (!ids.empty() && pos <= ids.length()) {
+        std::string::size_type end = ids.find(',', pos);
+        if (end == std::string::npos) {
+            end = ids.length();
+        }
+        std::string item = ids.substr(pos, end - pos);
+        if (item.empty() || item.find_first_not_of("0123456789") != std::string::npos || item.length() > 3 ||
+            std::stoul(item) >= MAX_LAMBDAS) {
+            return "Illegal lambda id";
+        }
+        auto id = (lambda_id_t) std::stoul(item);
+        if (seen[id / 8] & (1 << (id % 8))) {
+            return "Duplicate lambda id";
+        }
+        seen[id / 8] |= (uint8_t) (1 << (id % 8));
+        id_list->push_back(id);
+        pos = end + 1;
+    }
+    type_list->clear();
+    pos = 0;
+    while (!types.empty() && pos <= types.length()) {
+        std::string::size_type end = types.find(',', pos);
+        if (end == std::string::npos) {
+            end = types.length();
+        }
+        rs_lambda_type_t type = get_lambda_type_from_string(types.substr(pos, end - pos).c_str());
+        if (type == (rs_lambda_type_t) -1) {
+            return "Unknown lambda type";
+        }
+        type_list->push_back(type);
+        pos = end + 1;
+    }
+    if (type_list->size() > 1 && type_list->size() != id_list->size()) {
+        return "Number of types does not match the number of ids";
+    }
+    type_list->resize(id_list->size(), type_list->empty() ? (rs_lambda_type_t) 0 : type_list->front());
+    return nullptr;
+}
+
+const char *RiotsensorsRESTHandler::parseCallFields(const std::string &fields, const std::string &view,
+                                                    rest_fields *selected) {
+    *selected = RS_FIELDS_ALL;
+    if (view == "value") {
+        if (!fields.empty()) {
+            return "The fields parameter cannot be combined with view=value";
+        }
+        *selected = RS_FIELDS_VALUE;
+        return nullptr;
+    }
+    if (!view.empty() && view != "full") {
+        return "Unknown view";
+    }
+    if (fields.empty()) {
+        return nullptr;
+    }
+    *selected = 0;
+    std::string::size_type pos = 0;
+    while (pos <= fields.length()) {
+        std::string::size_type end = fields.find(',', pos);
+        if (end == std::string::npos) {
+            end = fields.length();
+        }
+        std::string field = fields.substr(pos, end - pos);
+        if (field == "success") {
+            *selected |= RS_FIELD_SUCCESS;
+        } else if (field == "lambda") {
+            *selected |= RS_FIELD_LAMBDA;
+        } else if (field == "cache") {
+            *selected |= RS_FIELD_CACHE;
+        } else if (field == "result") {
+            *selected |= RS_FIELD_RESULT;
+        } else {
+            return "Unknown field";
+        }
+        pos = end + 1;
+    }
+    return nullptr;
+}
+
+rest_response_info RiotsensorsRESTHandler::handleNotification(const rs_stream_update *update, rest_format format,
+                                                              rest_fields fields) {
+    rs_registered_lambda copy{};
+    if (!copy_registered_lambda_by_id(update->id, &copy) || copy.type != update->type) {
+        return rest_response_info(Http::Code::Not_Found,
+                                  assemble_call_error_rest_id(update->id, nullptr, RS_CALL_NOTFOUND, format));
+    }
+    generic_lambda_return result = update->value;
+    return call_success_response(&copy, RS_CALL_SUCCESS, &result, rs_linux_get_registry_version(),
+                                 update->version, format, fields);
+}
+
+/**
+ * @brief Create a response from a cached uncompressed body, compressing it if it is large enough
+ *
+ * The compressed body is cached next to the uncompressed one with the same version.
+ *
+ * @param kind Kind of the response
+ * @param discriminator Distinguishes responses of the same kind
+ * @param format Format of the body
+ * @param encoding Preferred content coding
+ * @param version Version of the data the body was built from
+ * @param body Uncompressed body
+ * @return The response with status 200
+ */
+static rest_response_info encoded_response(rest_response_kind kind, uint16_t discriminator, rest_format format,
+                                           rest_encoding encoding, uint64_t version, rest_body body) {
+    if (encoding != rest_encoding::IDENTITY && body->size() >= rest_get_compress_min_bytes()) {
+        std::string compressed;
+        if (rest_compress(*body, encoding, &compressed)) {
+            rest_body compressed_body = std::make_shared<const std::string>(std::move(compressed));
+            response_cache.put(kind, discriminator, format, encoding, version, compressed_body);
+            return rest_response_info(Http::Code::Ok, std::move(compressed_body), version, 0, encoding);
+        }
+    }
+    return rest_response_info(Http::Code::Ok, std::move(body), version, 0);
+}
+
+/**
+ * @brief Create a response that is not cached from an uncompressed body, compressing it if it is large enough
+ *
+ * @param encoding Preferred content coding
+ * @param version Version of the data the body was built from
+ * @param body Uncompressed body
+ * @return The response with status 200
+ */
+static rest_response_info uncached_response(rest_encoding encoding, uint64_t version, rest_body body) {
+    if (encoding != rest_encoding::IDENTITY && body->size() >= rest_get_compress_min_bytes()) {
+        std::string compressed;
+        if (rest_compress(*body, encoding, &compressed)) {
+            return rest_response_info(Http::Code::Ok, std::make_shared<const std::string>(std::move(compressed)),
+                                      version, 0, encoding);
+        }
+    }
+    return rest_response_info(Http::Code::Ok, std::move(body), version, 0);
+}
 
-int main(int argc, char *argv[]) {
-    auto arguments = new struct riotsensors_start_opts;
-    arguments->serial = (char *) "/dev/ttyUSB0";
-    arguments->http_port = 9080;
-    arguments->coap_port = 5683;
-    argp_parse(&argp, argc, argv, 0, nullptr, arguments);
+rest_response_info RiotsensorsRESTHandler::handleList(rs_lambda_type_t type, const std::string &name,
+                                                      rest_format format, rest_encoding encoding) {
+    uint64_t version = rs_linux_get_registry_version();
+    if (!name.empty()) {
+        // the response cache only tells responses apart by type
+        spt_log_msg("web", "Listing the registered lambdas matching %s...\n", name.c_str());
+        return uncached_response(encoding, version, assemble_list_rest_for_name(name, type, format));
+    }
+    rest_body body;
+    if (encoding != rest_encoding::IDENTITY &&
+        response_cache.get(rest_response_kind::LIST, type, format, encoding, version, &body)) {
+        return rest_response_info(Http::Code::Ok, body, version, 0, encoding);
+    }
+    if (!response_cache.get(rest_response_kind::LIST, type, format, rest_encoding::IDENTITY, version, &body)) {
+        if (type == 0) {
+            spt_log_msg("web", "Listing all registered lambdas...\n");
+            body = assemble_list_rest(format);
+        } else {
+            spt_log_msg("web", "Listing all registered lambdas for type %d...\n", type);
+            body = assemble_list_rest_for_type(type, format);
+        }
+        response_cache.put(rest_response_kind::LIST, type, format, rest_encoding::IDENTITY, version, body);
+    }
+    return encoded_response(rest_response_kind::LIST, type, format, encoding, version, std::move(body));
+}
+
+rest_response_info RiotsensorsRESTHandler::handleCache(rs_lambda_type_t type, const std::string &name,
+                                                       rest_format format, rest_encoding encoding) {
+    uint64_t version = combine_versions(rs_linux_get_registry_version(), rs_linux_get_values_version());
+    if (!name.empty()) {
+        spt_log_msg("web", "Listing the registered lambdas matching %s and the cached values...\n", name.c_str());
+        return uncached_response(encoding, version, assemble_cache_rest_for_name(name, type, format));
+    }
+    rest_body body;
+    if (encoding != rest_encoding::IDENTITY &&
+        response_cache.get(rest_response_kind::SHOWCACHE, type, format, encoding, version, &body)) {
+        return rest_response_info(Http::Code::Ok, body, version, 0, encoding);
+    }
+    if (!response_cache.get(rest_response_kind::SHOWCACHE, type, format, rest_encoding::IDENTITY, version, &body)) {
+        if (type == 0) {
+            spt_log_msg("web", "Listing all registered lambdas and the cached values...\n");
+            body = assemble_cache_rest(format);
+        } else {
+            spt_log_msg("web", "Listing all registered lambdas and the cached values for type %d...\n", type);
+            body = assemble_cache_rest_for_type(type, format);
+        }
+        response_cache.put(rest_response_kind::SHOWCACHE, type, format, rest_encoding::IDENTITY, version, body);
+    }
+    return encoded_response(rest_response_kind::SHOWCACHE, type, format, encoding, version, std::move(body));
+}
+
+rest_response_info RiotsensorsRESTHandler::handleQueryById(lambda_id_t id, const rest_query_params &params,
+                                                           rest_format format) {
+    spt_log_msg("web", "Querying history of lambda by ID with ID %d and operation %d...\n", id, params.op);
+    double result = 0;
+    size_t count = 0;
+    int8_t res = query_lambda_history_by_id(id, params.op, params.from, params.to, params.quantile, &result, &count);
+    rs_registered_lambda copy{};
+    rs_registered_lambda *lambda = copy_registered_lambda_by_id(id, &copy) ? &copy : nullptr;
+    if (lambda == nullptr) {
+        // unregistered while the query was running
+        res = RS_QUERY_NOTFOUND;
+    }
+    if (res == RS_QUERY_SUCCESS) {
+        return rest_response_info(Http::Code::Ok,
+                                  assemble_query_success_rest(lambda, params.op, params.from, params.to,
+                                                              params.quantile, count, result, format));
+    }
+    return rest_response_info(Http::Code::Not_Found, assemble_query_error_rest_id(id, lambda, res, format));
+}
+
+rest_response_info RiotsensorsRESTHandler::handleQueryByName(std::string name, const rest_query_params &params,
+                                                             rest_format format) {
+    spt_log_msg("web", "Querying history of lambda by name with name %s and operation %d...\n", name.c_str(),
+                params.op);
+    double result = 0;
+    size_t count = 0;
+    int8_t res = query_lambda_history_by_name(name.c_str(), params.op, params.from, params.to, params.quantile,
+                                              &result, &count);
+    rs_registered_lambda copy{};
+    rs_registered_lambda *lambda = copy_registered_lambda_by_name(name.c_str(), &copy) ? &copy : nullptr;
+    if (lambda == nullptr) {
+        // unregistered while the query was running
+        res = RS_QUERY_NOTFOUND;
+    }
+    if (res == RS_QUERY_SUCCESS) {
+        return rest_response_info(Http::Code::Ok,
+                                  assemble_query_success_rest(lambda, params.op, params.from, params.to,
+                                                              params.quantile, count, result, format));
+    }
+    return rest_response_info(Http::Code::Not_Found, assemble_query_error_rest_name(name, lambda, res, format));
+}
 
-    if (rs_linux_start(arguments->serial) != 0) {
-        fprintf(stderr, "Could not start riotsensors on serial port %s\n", arguments->serial);
-        return 1;
+const char *RiotsensorsRESTHandler::parseQueryParams(const std::string &op, const std::string &from,
+                                                     const std::string &to, const std::string &last,
+                                                     const std::string &quantile, rest_query_params *params) {
+    if (op.empty()) {
+        return "Missing op parameter";
+    }
+    params->op = get_query_op_from_string(op.c_str());
+    if (params->op == (rs_query_op_t) -1) {
+        return "Unknown query operation";
+    }
+    uint64_t now = rs_history_now();
+    try {
+        params->from = from.empty() ? 0 : std::stoull(from);
+        params->to = to.empty() ? now : std::stoull(to);
+        if (!last.empty()) {
+            uint64_t duration = std::stoull(last);
+            params->from = duration < now ? now - duration : 0;
+        }
+        params->quantile = quantile.empty() ? 0.5 : std::stod(quantile);
+    } catch (std::logic_error &e) {
+        return "Illegal query parameter";
     }
+    if (params->from > params->to || params->quantile < 0.0 || params->quantile > 1.0) {
+        return "Illegal query parameter";
+    }
+    return nullptr;
+}
 
-    spt_log_msg("main", "Starting HTTP server on port %d...\n", arguments->http_port);
-    pthread_create(&http_thread, nullptr, startHTTPServer, arguments);
-    spt_log_msg("main", "Starting CoAP server on port %d...\n", arguments->coap_port);
-    pthread_create(&coap_thread, nullptr, startCoAPServer, arguments);
+rest_response_info RiotsensorsRESTHandler::handleEvents(uint64_t after, rest_format format) {
+    rs_trigger_event events[RS_EVENTS_BATCH];
+    size_t count = rs_linux_read_events(after, events, RS_EVENTS_BATCH, 0);
+    return rest_response_info(Http::Code::Ok,
+                              assemble_events_rest(events, count, after, rs_linux_get_dropped_events(), format));
+}
 
-    pthread_join(http_thread, nullptr);
-    pthread_join(coap_thread, nullptr);
+const char *RiotsensorsRESTHandler::parseEventParams(const std::string &after, const std::string &wait,
+                                                     uint64_t *after_seq, uint32_t *wait_ms) {
+    try {
+        *after_seq = after.empty() ? 0 : std::stoull(after);
+        unsigned long wait_value = wait.empty() ? 0 : std::stoul(wait);
+        *wait_ms = (uint32_t) (wait_value < RS_EVENTS_MAX_WAIT ? wait_value : RS_EVENTS_MAX_WAIT);
+    } catch (std::logic_error &e) {
+        return "Illegal event parameter";
+    }
+    return nullptr;
+}
 
-    rs_linux_stop();
+const char *RiotsensorsRESTHandler::parseStreamParams(const std::string &ids, const std::string &type,
+                                                      uint8_t *id_set, bool *all_ids,
+                                                      rs_lambda_type_t *lambda_type) {
+    *lambda_type = 0;
+    if (!type.empty()) {
+        *lambda_type = get_lambda_type_from_string(type.c_str());
+        if (*lambda_type == (rs_lambda_type_t) -1) {
+            return "Unknown lambda type";
+        }
+    }
+    memset(id_set, 0, (MAX_LAMBDAS + 7) / 8);
+    *all_ids = ids.empty();
+    std::string::size_type pos = 0;
+    while (!*all_ids && pos <= ids.length()) {
+        std::string::size_type end = ids.find(',', pos);
+        if (end == std::string::npos) {
+            end = ids.length();
+        }
+        std::string item = ids.substr(pos, end - pos);
+        if (item.empty() || item.find_first_not_of("0123456789") != std::string::npos || item.length() > 3 ||
+            std::stoul(item) >= MAX_LAMBDAS) {
+            return "Illegal lambda id";
+        }
+        unsigned long id = std::stoul(item);
+        id_set[id / 8] |= (uint8_t) (1 << (id % 8));
+        pos = end + 1;
+    }
+    return nullptr;
+}
 
-    delete arguments;
-}
\ No newline at end of file
+rest_response_info RiotsensorsRESTHandler::handleStats(rest_format format) {
+    return rest_response_info(Http::Code::Ok, assemble_stats_rest(format));
+}
+
+rest_response_info RiotsensorsRESTHandler::handleMetrics() {
+    return rest_response_info(Http::Code::Ok, assemble_metrics_prometheus());
+}
@@ -6,69 +6,319 @@
 
 #include <rs_server_coap.h>
 
-#include <event.h>
 #include <unused.h>
 #include <lambda_registry.h>
+#include <rs_connector.h>
+#include <rs_coap_query.h>
+#include <rs_event_loop.h>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
 
 /**
- * Check if the coap_option_t provided in q has the key name, then execute lambda and issue a continue
+ * @brief An observer of a call resource, the subscription itself is managed by libcoap
  */
-#define try_match_coap_opt_and_execute(name, q, lambda) \
-    if (match_coap_opt_and_execute(name, q, lambda)) { \
-        continue; \
-    }
+struct coap_lambda_observer {
+    /** @brief Observed resource */
+    coap_resource_t *resource;
+    /** @brief Address of the observer */
+    coap_address_t peer;
+    /** @brief Token of the observe request */
+    std::string token;
+    /** @brief ID of the observed lambda */
+    lambda_id_t id;
+    /** @brief Format of the notifications negotiated by the observe request */
+    rest_format format;
+    /** @brief Fields of the notifications selected by the observe request */
+    rest_fields fields;
+    /** @brief Time of the last notification in milliseconds since the epoch */
+    uint64_t last_notified;
+    /** @brief If a new result has not been sent because of the rate limit */
+    bool pending;
+};
 
 /**
- * @brief Check if the coap_option_t provided in q has the key name, then execute lambda
+ * @brief The lambda a /v1/lambda/<name> resource is bound to when it is added
+ */
+struct coap_lambda_resource {
+    /** @brief ID of the lambda */
+    lambda_id_t id;
+    /** @brief Registered type of the lambda */
+    rs_lambda_type_t type;
+};
+
+struct coap_worker;
+
+/**
+ * @brief A call request and its answer, shared by the CoAP thread and the thread of the connector completing the call
  *
- * @param name Name to match against
- * @param q CoAP option
- * @param l The lambda to call
+ * A call the device answers while the request handler still runs is piggybacked on the acknowledgement. Otherwise
+ * the request is acknowledged with an empty message and the answer follows in a separate response (RFC 7252, 5.2.2),
+ * so the CoAP thread keeps serving other requests while the device is busy.
  */
-template<typename Callback>
-static bool match_coap_opt_and_execute(const std::string &name, coap_opt_t *q, Callback l) {
-    std::string opt_value((char *) coap_opt_value(q), coap_opt_length(q));
+struct coap_separate_call {
+    /** @brief Worker that received the request and sends the separate response */
+    std::shared_ptr<coap_worker> worker;
+    /** @brief Called resource */
+    coap_resource_t *resource;
+    /** @brief Interface the request was received on, libcoap frees its own copy after the handler returned */
+    coap_endpoint_t local_interface;
+    /** @brief Address of the client */
+    coap_address_t peer;
+    /** @brief Token of the request */
+    std::string token;
+    /** @brief If the request was confirmable, the separate response is confirmable as well */
+    bool confirmable;
+    /** @brief Value of the Observe option of the request, negative if it has none */
+    int64_t observe;
+    /** @brief Entity tags of the request */
+    std::vector<std::string> etags;
+    /** @brief ID of the called lambda */
+    lambda_id_t id;
+    /** @brief Name of the called lambda, empty if it is called by ID */
+    std::string name;
+    /** @brief If the called resource is a lambda resource, which is removed when the lambda is unregistered */
+    bool lambda_resource;
+    /** @brief Format of the response body */
+    rest_format format;
+    /** @brief Fields of the response */
+    rest_fields fields;
+    /** @brief If the request handler still runs, guarded by the separate_lock of the worker */
+    bool in_handler;
+    /** @brief If the call completed, guarded by the separate_lock of the worker */
+    bool answered;
+    /** @brief Response of the REST handler once answered */
+    rest_response_info answer{Http::Code::Internal_Server_Error, rest_body()};
+};
 
-    std::string::size_type loc = opt_value.find('=');
-    std::string key_value;
-    if (loc != std::string::npos) {
-        key_value = opt_value.substr(0, loc);
-    } else {
-        key_value = std::string(opt_value);
+/**
+ * @brief A CoAP worker thread with its own context, socket and event loop
+ *
+ * All workers listen on the same port with SO_REUSEPORT and the kernel spreads the clients across their sockets by
+ * address, so the requests and acknowledgements of a client always reach the same worker. Only the separate response
+ * queue is accessed by other threads.
+ */
+struct coap_worker : std::enable_shared_from_this<coap_worker> {
+    /** @brief CoAP context, its socket is replaced by the SO_REUSEPORT socket of the worker */
+    coap_context_t *ctx;
+    RiotsensorsEventLoop loop;
+    /** @brief Observers of the resources of this worker */
+    std::vector<coap_lambda_observer> observers;
+    /**
+     * @brief Response with the latest result of every observed lambda in every format and field selection observers
+     * requested, sent by the notifications
+     */
+    std::map<std::tuple<lambda_id_t, rest_format, rest_fields>, rest_response_info> observed_results;
+    /** @brief Results of the observed lambdas pushed by the connector */
+    rs_stream *observed_stream;
+    /** @brief Timer of the observers delayed by the rate limit */
+    int observe_timer;
+    /** @brief Timer of the next retransmission of a confirmable message */
+    int retransmit_timer;
+    /** @brief Receive buffers of one recvmmsg() call, libcoap takes over a packet when it reads it */
+    coap_packet_t *rx_packets[RS_COAP_BATCH];
+    struct mmsghdr rx_msgs[RS_COAP_BATCH];
+    struct iovec rx_iov[RS_COAP_BATCH];
+    /** @brief Number of received datagrams and the next one libcoap reads */
+    unsigned int rx_count;
+    unsigned int rx_next;
+    /** @brief If messages sent by libcoap are queued for one sendmmsg() call */
+    bool batching;
+    unsigned char tx_buffers[RS_COAP_BATCH][COAP_MAX_PDU_SIZE];
+    coap_address_t tx_peers[RS_COAP_BATCH];
+    struct mmsghdr tx_msgs[RS_COAP_BATCH];
+    struct iovec tx_iov[RS_COAP_BATCH];
+    unsigned int tx_count;
+    /**
+     * @brief Calls completed after their request has been acknowledged, waiting for the worker to send the separate
+     * response, and the eventfd waking it up, both guarded by separate_lock
+     */
+    std::vector<std::shared_ptr<coap_separate_call>> separate_answers;
+    int separate_fd;
+    std::mutex separate_lock;
+    /** @brief Lambdas bound to the /v1/lambda/<name> resources of this worker */
+    std::unordered_map<coap_resource_t *, coap_lambda_resource> lambda_resources;
+    /** @brief Registry version the lambda resources were last synchronized with */
+    uint32_t lambda_resources_version;
+};
+
+/**
+ * Minimum number of milliseconds between two notifications of an observer
+ */
+static uint32_t observe_interval = RS_OBSERVE_DEFAULT_INTERVAL;
+
+/**
+ * Running workers and if the server is stopping, guarded by coap_workers_lock for stopCoAPServer()
+ */
+static std::vector<std::shared_ptr<coap_worker>> coap_workers;
+static bool coap_stopping = false;
+static std::mutex coap_workers_lock;
+
+/**
+ * Worker of the current thread, the handlers called by libcoap only get the context
+ */
+static thread_local coap_worker *current_worker = nullptr;
+
+/**
+ * @brief Find the query parameters of a request in one pass over its Uri-Query options
+ *
+ * @param request CoAP request
+ * @param params Parameters the handler looks for
+ * @param count Number of parameters
+ */
+static void coap_parse_query(coap_pdu_t *request, coap_query_param *params, size_t count) {
+    coap_opt_iterator_t opt_iter{};
+    coap_opt_filter_t f = {};
+    coap_opt_t *q;
+    coap_option_filter_clear(f);
+    coap_option_setb(f, COAP_OPTION_URI_QUERY);
+    coap_option_iterator_init(request, &opt_iter, f);
+    while ((q = coap_option_next(&opt_iter)) != nullptr) {
+        coap_query_match(coap_opt_value(q), coap_opt_length(q), params, count);
     }
+}
 
-    if (!strcmp(name.c_str(), key_value.c_str())) {
-        std::string arg_str = opt_value.substr(name.length() + 1);
-        l(arg_str);
-        return true;
+/**
+ * @brief Get the lambda type of a type query parameter
+ *
+ * @param param Query parameter
+ * @return Lambda type, 0 if the parameter is missing and -1 if it is illegal
+ */
+static rs_lambda_type_t coap_query_type(const coap_query_param &param) {
+    if (!param.found) {
+        return 0;
     }
+    char buf[8];
+    return param.copy(buf, sizeof(buf)) ? get_lambda_type_from_string(buf) : (rs_lambda_type_t) -1;
+}
 
-    return false;
+/**
+ * @brief Get the lambda ID of an id query parameter
+ *
+ * @param param Query parameter
+ * @return Lambda ID, -1 if it is illegal
+ */
+static lambda_id_t coap_query_id(const coap_query_param &param) {
+    unsigned long id;
+    return param.toUnsigned(&id, (lambda_id_t) -1) ? (lambda_id_t) id : (lambda_id_t) -1;
 }
 
-static rs_lambda_type_t coap_parse_type(coap_pdu_t *request) {
+/**
+ * @brief Get the entity tags of the ETag options of a request
+ *
+ * @param request CoAP request
+ * @return Encoded entity tags, empty if the request has no ETag option
+ */
+static std::vector<std::string> coap_request_etags(coap_pdu_t *request) {
+    std::vector<std::string> etags;
     coap_opt_iterator_t opt_iter{};
     coap_opt_filter_t f = {};
     coap_opt_t *q;
     coap_option_filter_clear(f);
-    coap_option_setb(f, COAP_OPTION_URI_QUERY);
+    coap_option_setb(f, COAP_OPTION_ETAG);
     coap_option_iterator_init(request, &opt_iter, f);
-    rs_lambda_type_t type = 0;
     while ((q = coap_option_next(&opt_iter)) != nullptr) {
-        auto typelambda = [&type](std::string value) -> void {
-            type = get_lambda_type_from_string(value.c_str());
-        };
-        try_match_coap_opt_and_execute("type", q, typelambda);
+        etags.emplace_back((const char *) coap_opt_value(q), coap_opt_length(q));
     }
-    return type;
+    return etags;
 }
 
-static void coap_transfer_data_from_response_info(coap_pdu_t *response, rest_response_info answer) {
-    unsigned char buf[3];
-    coap_add_option(response, COAP_OPTION_CONTENT_TYPE, coap_encode_var_bytes(buf, COAP_MEDIATYPE_APPLICATION_JSON),
-                    buf);
-    response->hdr->code = COAP_RESPONSE_CODE((unsigned int) answer.first);
-    coap_add_data(response, (unsigned int) answer.second.length(), (unsigned char *) answer.second.c_str());
+/**
+ * @brief Select the format of a response body by the Accept option, JSON if the option is missing
+ *
+ * @param request CoAP request
+ * @param response CoAP response, answered with 4.06 Not Acceptable if the requested format is not supported
+ * @param format Where to store the selected format
+ * @return If a format was selected, the response was filled otherwise
+ */
+static bool coap_negotiate_format(coap_pdu_t *request, coap_pdu_t *response, rest_format *format) {
+    static std::string not_acceptable_text = "Supported content formats are 50 (JSON) and 60 (CBOR)";
+    *format = rest_format::JSON;
+    coap_opt_iterator_t opt_iter{};
+    coap_opt_t *opt = coap_check_option(request, COAP_OPTION_ACCEPT, &opt_iter);
+    if (opt == nullptr) {
+        return true;
+    }
+    switch (coap_decode_var_bytes(coap_opt_value(opt), coap_opt_length(opt))) {
+        case RS_COAP_FORMAT_JSON:
+            return true;
+        case RS_COAP_FORMAT_CBOR:
+            *format = rest_format::CBOR;
+            return true;
+        default:
+            response->hdr->code = COAP_RESPONSE_CODE(406);
+            coap_add_data(response, (unsigned int) not_acceptable_text.length(),
+                          (unsigned char *) not_acceptable_text.c_str());
+            return false;
+    }
+}
+
+/**
+ * @brief Fill the CoAP response from a REST response, answers with 2.03 Valid if the client's copy is still valid
+ *
+ * Options have to be added in ascending order: ETag (4), Observe (6), Content-Format (12), Max-Age (14). Max-Age is
+ * always set because a missing option means 60 seconds in CoAP. Rejected calls are answered with 5.03 Service
+ * Unavailable and Max-Age set to the seconds after which the client may retry.
+ *
+ * @param etags Entity tags of the request (see coap_request_etags()), empty for notifications
+ * @param response CoAP response to send
+ * @param answer Response of the REST handler
+ * @param format Format of the response body
+ * @param observe Value of the Observe option, negative to omit it
+ */
+static void coap_transfer_data_from_response_info(const std::vector<std::string> &etags, coap_pdu_t *response,
+                                                  const rest_response_info &answer, rest_format format,
+                                                  int64_t observe = -1) {
+    unsigned char buf[4];
+    unsigned char etag[8];
+    unsigned int etag_length = 0;
+    bool valid = false;
+    if (answer.etag != 0 && answer.code == Http::Code::Ok) {
+        // both representations are built from the same data version, but must not validate each other
+        uint64_t tag = format == rest_format::CBOR ? answer.etag ^ (1ULL << 63) : answer.etag;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            auto byte = (unsigned char) (tag >> shift);
+            if (etag_length > 0 || byte != 0) {
+                etag[etag_length++] = byte;
+            }
+        }
+        for (const std::string &requested : etags) {
+            valid = valid || (requested.length() == etag_length && memcmp(requested.data(), etag, etag_length) == 0);
+        }
+        coap_add_option(response, COAP_OPTION_ETAG, etag_length, etag);
+    }
+    if (observe >= 0) {
+        coap_add_option(response, COAP_OPTION_OBSERVE, coap_encode_var_bytes(buf, (unsigned int) observe), buf);
+    }
+    if (!valid) {
+        coap_add_option(response, COAP_OPTION_CONTENT_TYPE,
+                        coap_encode_var_bytes(buf, rest_format_coap_content_format(format)), buf);
+    }
+    unsigned int max_age = answer.max_age > 0 ? (unsigned int) answer.max_age : 0;
+    coap_add_option(response, COAP_OPTION_MAXAGE, coap_encode_var_bytes(buf, max_age), buf);
+    if (valid) {
+        response->hdr->code = COAP_RESPONSE_CODE(203);
+        return;
+    }
+    // CoAP has no 4.29, an overloaded server answers with 5.03 and the seconds to wait in Max-Age
+    unsigned int code = answer.code == Http::Code::Too_Many_Requests ? 503 : (unsigned int) answer.code;
+    response->hdr->code = COAP_RESPONSE_CODE(code);
+    coap_add_data(response, (unsigned int) answer.body->size(), (const unsigned char *) answer.body->data());
+}
+
+static void coap_answer_with_text(coap_pdu_t *response, unsigned int code, const char *text) {
+    response->hdr->code = COAP_RESPONSE_CODE(code);
+    coap_add_data(response, (unsigned int) strlen(text), (unsigned char *) text);
 }
 
 static void coap_answer_with_unknown_type(coap_pdu_t *response) {
@@ -78,40 +328,633 @@ static void coap_answer_with_unknown_type(coap_pdu_t *response) {
                   (unsigned char *) unknown_type_text.c_str());
 }
 
+/**
+ * @brief Parse the type and name selection of a list request
+ *
+ * @param request CoAP request
+ * @param response CoAP response, answered with an error if a parameter is illegal
+ * @param type Where to store the lambda type, 0 for all types
+ * @param name Where to store the name pattern, empty for all lambdas
+ * @return If the parameters are valid
+ */
+static bool coap_parse_selection(coap_pdu_t *request, coap_pdu_t *response, rs_lambda_type_t *type,
+                                 std::string *name) {
+    coap_query_param params[] = {coap_query_param("type"), coap_query_param("name")};
+    coap_parse_query(request, params, 2);
+    *type = coap_query_type(params[0]);
+    if (*type == (rs_lambda_type_t) -1) {
+        coap_answer_with_unknown_type(response);
+        return false;
+    }
+    *name = params[1].str();
+    const char *error = name->empty() ? nullptr : RiotsensorsRESTHandler::parseNamePattern(*name);
+    if (error != nullptr) {
+        coap_answer_with_text(response, 400, error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Find the observer entry of a subscription
+ *
+ * @param w Worker
+ * @param resource Observed resource
+ * @param peer Address of the observer
+ * @param token Token of the observe request
+ * @return Iterator to the entry or w->observers.end()
+ */
+static std::vector<coap_lambda_observer>::iterator coap_find_lambda_observer(coap_worker *w,
+                                                                           coap_resource_t *resource,
+                                                                           const coap_address_t *peer,
+                                                                           const str *token) {
+    std::string token_value((const char *) token->s, token->length);
+    for (auto it = w->observers.begin(); it != w->observers.end(); ++it) {
+        if (it->resource == resource && it->token == token_value && coap_address_equals(&it->peer, peer)) {
+            return it;
+        }
+    }
+    return w->observers.end();
+}
+
+/**
+ * @brief Subscribe the stream of a worker only to the results of its observed lambdas
+ *
+ * @param w Worker
+ */
+static void coap_update_observed_stream(coap_worker *w) {
+    uint8_t ids[(MAX_LAMBDAS + 7) / 8] = {0};
+    for (const coap_lambda_observer &o : w->observers) {
+        ids[o.id / 8] |= (uint8_t) (1 << (o.id % 8));
+    }
+    rs_linux_update_stream(w->observed_stream, ids, 0);
+}
+
+/**
+ * @brief Register or deregister an observer of a call resource as requested by the Observe option (RFC 7641)
+ *
+ * Called once the call is answered, which may be after the request has been acknowledged.
+ *
+ * @param w Worker that received the request
+ * @param call Call request
+ * @param answer Response of the REST handler
+ * @return Value of the Observe option of the response, negative if the client is not observing
+ */
+static int64_t coap_handle_observe(coap_worker *w, const coap_separate_call &call, const rest_response_info &answer) {
+    if (call.observe < 0 || w->observed_stream == nullptr) {
+        return -1;
+    }
+    if (call.lambda_resource) {
+        auto bound = w->lambda_resources.find(call.resource);
+        if (bound == w->lambda_resources.end() || bound->second.id != call.id) {
+            // the lambda has been unregistered and its resource removed while the call was pending
+            return -1;
+        }
+    }
+    lambda_id_t id = call.id;
+    rs_registered_lambda lambda{};
+    if (!call.name.empty()) {
+        if (!copy_registered_lambda_by_name(call.name.c_str(), &lambda)) {
+            return -1;
+        }
+        id = lambda.id;
+    }
+    coap_address_t peer = call.peer;
+    str token = {call.token.length(), (unsigned char *) call.token.data()};
+    auto existing = coap_find_lambda_observer(w, call.resource, &peer, &token);
+    if (call.observe != 0 || answer.code != Http::Code::Ok) {
+        // deregistration, or the lambda cannot be observed
+        if (existing != w->observers.end()) {
+            w->observers.erase(existing);
+            coap_update_observed_stream(w);
+        }
+        coap_delete_observer(call.resource, &peer, &token);
+        return -1;
+    }
+    if (existing != w->observers.end()) {
+        // a re-registration only refreshes the subscription
+        existing->id = id;
+        existing->format = call.format;
+        existing->fields = call.fields;
+        coap_update_observed_stream(w);
+        return w->ctx->observe;
+    }
+    coap_subscription_t *subscription = coap_add_observer(call.resource, &call.local_interface, &peer, &token);
+    if (subscription == nullptr) {
+        return -1;
+    }
+    subscription->non = !call.confirmable;
+    coap_lambda_observer o{};
+    o.resource = call.resource;
+    o.peer = peer;
+    o.token = call.token;
+    o.id = id;
+    o.format = call.format;
+    o.fields = call.fields;
+    o.last_notified = rs_history_now();
+    o.pending = false;
+    w->observers.push_back(o);
+    coap_update_observed_stream(w);
+    return w->ctx->observe;
+}
+
+/**
+ * @brief Fill a notification for an observer with the latest result of the observed lambda
+ *
+ * @param w Worker sending the notification
+ * @param resource Observed resource
+ * @param peer CoAP peer endpoint
+ * @param token CoAP token
+ * @param response CoAP notification to send
+ */
+static void coap_fill_notification(coap_worker *w, coap_resource_t *resource, coap_address_t *peer, str *token,
+                                   coap_pdu_t *response) {
+    auto o = coap_find_lambda_observer(w, resource, peer, token);
+    if (o == w->observers.end()) {
+        response->hdr->code = COAP_RESPONSE_CODE(404);
+        return;
+    }
+    auto result = w->observed_results.find(std::make_tuple(o->id, o->format, o->fields));
+    if (result == w->observed_results.end()) {
+        response->hdr->code = COAP_RESPONSE_CODE(404);
+        return;
+    }
+    coap_transfer_data_from_response_info(std::vector<std::string>(), response, result->second, o->format,
+                                          w->ctx->observe);
+}
+
+/**
+ * @brief Send the messages queued while handling a batch with one sendmmsg() call
+ *
+ * @param w Worker
+ */
+static void coap_worker_flush(coap_worker *w) {
+    unsigned int sent = 0;
+    while (sent < w->tx_count) {
+        int r = sendmmsg(w->ctx->sockfd, &w->tx_msgs[sent], w->tx_count - sent, 0);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // like a lost datagram, confirmable messages are retransmitted
+            break;
+        }
+        sent += (unsigned int) r;
+    }
+    w->tx_count = 0;
+}
+
+/**
+ * @brief Run a handler that may send messages and send them at once afterwards
+ *
+ * @param w Worker
+ * @param handler Handler calling libcoap
+ */
+template<typename Handler>
+static void coap_worker_batch(coap_worker *w, Handler handler) {
+    w->batching = true;
+    handler();
+    w->batching = false;
+    coap_worker_flush(w);
+}
+
+/**
+ * @brief Sending function of the CoAP contexts, queues the message while a batch is handled
+ *
+ * @param ctx CoAP context
+ * @param local_interface Interface to send from, all workers send from their own socket
+ * @param dst Address of the receiver
+ * @param data Message
+ * @param datalen Length of the message
+ * @return Number of bytes sent or queued, -1 on failure
+ */
+static ssize_t coap_worker_network_send(coap_context_t *ctx, const coap_endpoint_t *local_interface,
+                                        const coap_address_t *dst, unsigned char *data, size_t datalen) {
+    UNUSED(local_interface);
+    coap_worker *w = current_worker;
+    if (w == nullptr || !w->batching || datalen > COAP_MAX_PDU_SIZE) {
+        return sendto(ctx->sockfd, data, datalen, 0, &dst->addr.sa, dst->size);
+    }
+    if (w->tx_count == RS_COAP_BATCH) {
+        coap_worker_flush(w);
+    }
+    unsigned int i = w->tx_count++;
+    memcpy(w->tx_buffers[i], data, datalen);
+    w->tx_peers[i] = *dst;
+    w->tx_iov[i].iov_base = w->tx_buffers[i];
+    w->tx_iov[i].iov_len = datalen;
+    memset(&w->tx_msgs[i], 0, sizeof(w->tx_msgs[i]));
+    w->tx_msgs[i].msg_hdr.msg_name = &w->tx_peers[i].addr.sa;
+    w->tx_msgs[i].msg_hdr.msg_namelen = dst->size;
+    w->tx_msgs[i].msg_hdr.msg_iov = &w->tx_iov[i];
+    w->tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    return (ssize_t) datalen;
+}
+
+/**
+ * @brief Reading function of the CoAP contexts, hands out the next datagram of the last recvmmsg() call
+ *
+ * @param ep Endpoint of the context
+ * @param packet Where to store the packet, freed by libcoap
+ * @return Length of the datagram, -1 if the batch is exhausted
+ */
+static ssize_t coap_worker_network_read(coap_endpoint_t *ep, coap_packet_t **packet) {
+    coap_worker *w = current_worker;
+    *packet = nullptr;
+    if (w == nullptr || w->rx_next >= w->rx_count) {
+        return -1;
+    }
+    unsigned int i = w->rx_next++;
+    coap_packet_t *p = w->rx_packets[i];
+    w->rx_packets[i] = nullptr;
+    p->src.size = w->rx_msgs[i].msg_hdr.msg_namelen;
+    p->dst = ep->addr;
+    p->interface = ep;
+    p->ifindex = 0;
+    p->length = w->rx_msgs[i].msg_len;
+    *packet = p;
+    return (ssize_t) p->length;
+}
+
+/**
+ * @brief Add the resource of a lambda, bound to its ID and type
+ *
+ * @param w Worker
+ * @param lambda Registered lambda
+ */
+static void coap_add_lambda_resource(coap_worker *w, const rs_registered_lambda &lambda) {
+    size_t name_length = strnlen(lambda.name, sizeof(lambda.name));
+    if (name_length == 0) {
+        return;
+    }
+    size_t length = sizeof(RS_COAP_LAMBDA_PATH) - 1 + name_length;
+    // released by libcoap together with the resource
+    auto uri = (unsigned char *) malloc(length);
+    if (uri == nullptr) {
+        return;
+    }
+    memcpy(uri, RS_COAP_LAMBDA_PATH, sizeof(RS_COAP_LAMBDA_PATH) - 1);
+    memcpy(uri + sizeof(RS_COAP_LAMBDA_PATH) - 1, lambda.name, name_length);
+    coap_resource_t *resource = coap_resource_init(uri, length, COAP_RESOURCE_FLAGS_RELEASE_URI);
+    if (resource == nullptr) {
+        free(uri);
+        return;
+    }
+    resource->observable = 1;
+    coap_register_handler(resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleLambda);
+    // lets clients discover the lambdas in /.well-known/core (RFC 6690)
+    coap_add_attr(resource, (const unsigned char *) "rt", 2, (const unsigned char *) RS_COAP_LAMBDA_RT,
+                  sizeof(RS_COAP_LAMBDA_RT) - 1, 0);
+    coap_add_resource(w->ctx, resource);
+    w->lambda_resources[resource] = coap_lambda_resource{lambda.id, lambda.type};
+}
+
+/**
+ * @brief Remove the resource of an unregistered lambda together with its observers
+ *
+ * @param w Worker
+ * @param resource Lambda resource
+ */
+static void coap_remove_lambda_resource(coap_worker *w, coap_resource_t *resource) {
+    size_t observers = w->observers.size();
+    w->observers.erase(std::remove_if(w->observers.begin(), w->observers.end(),
+                                      [resource](const coap_lambda_observer &o) { return o.resource == resource; }),
+                       w->observers.end());
+    if (w->observers.size() != observers) {
+        coap_update_observed_stream(w);
+    }
+    w->lambda_resources.erase(resource);
+    // also frees the subscriptions
+    coap_delete_resource(w->ctx, resource->key);
+}
+
+/**
+ * @brief Add a resource for every newly registered lambda and remove the resources of unregistered lambdas
+ *
+ * @param w Worker
+ * @param version Registry version read before the registry
+ */
+static void coap_sync_lambda_resources(coap_worker *w, uint32_t version) {
+    w->lambda_resources_version = version;
+    std::vector<rs_registered_lambda> lambdas;
+    rs_linux_lock_registry();
+    for (lambda_id_t i = 0; i < get_number_of_registered_lambdas(); i++) {
+        rs_registered_lambda *lambda = get_registered_lambda_by_id(i);
+        if (lambda != nullptr) {
+            lambdas.push_back(*lambda);
+        }
+    }
+    rs_linux_unlock_registry();
+    // IDs are not reused, so a lambda registered under the same ID is still the same lambda
+    bool registered[MAX_LAMBDAS] = {false};
+    for (const rs_registered_lambda &lambda : lambdas) {
+        registered[lambda.id] = true;
+    }
+    bool bound[MAX_LAMBDAS] = {false};
+    std::vector<coap_resource_t *> stale;
+    for (const auto &resource : w->lambda_resources) {
+        if (registered[resource.second.id]) {
+            bound[resource.second.id] = true;
+        } else {
+            stale.push_back(resource.first);
+        }
+    }
+    for (coap_resource_t *resource : stale) {
+        coap_remove_lambda_resource(w, resource);
+    }
+    for (const rs_registered_lambda &lambda : lambdas) {
+        if (!bound[lambda.id]) {
+            coap_add_lambda_resource(w, lambda);
+        }
+    }
+}
+
+/**
+ * @brief Drain the socket of a worker with recvmmsg() and send the responses of each batch with sendmmsg()
+ *
+ * The datagrams are received into packets libcoap reads through coap_worker_network_read() and frees, so a datagram
+ * is not copied before it is parsed.
+ *
+ * @param w Worker
+ */
+static void coap_worker_read(coap_worker *w) {
+    for (;;) {
+        for (unsigned int i = 0; i < RS_COAP_BATCH; i++) {
+            if (w->rx_packets[i] == nullptr) {
+                w->rx_packets[i] = (coap_packet_t *) malloc(sizeof(coap_packet_t) + COAP_MAX_PDU_SIZE);
+                if (w->rx_packets[i] == nullptr) {
+                    return;
+                }
+            }
+            coap_packet_t *p = w->rx_packets[i];
+            memset(p, 0, sizeof(coap_packet_t));
+            w->rx_iov[i].iov_base = p->payload;
+            w->rx_iov[i].iov_len = COAP_MAX_PDU_SIZE;
+            memset(&w->rx_msgs[i], 0, sizeof(w->rx_msgs[i]));
+            w->rx_msgs[i].msg_hdr.msg_name = &p->src.addr.sa;
+            w->rx_msgs[i].msg_hdr.msg_namelen = sizeof(p->src.addr);
+            w->rx_msgs[i].msg_hdr.msg_iov = &w->rx_iov[i];
+            w->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int count = recvmmsg(w->ctx->sockfd, w->rx_msgs, RS_COAP_BATCH, MSG_DONTWAIT, nullptr);
+        if (count <= 0) {
+            return;
+        }
+        w->rx_count = (unsigned int) count;
+        w->rx_next = 0;
+        uint32_t version = rs_linux_get_registry_version();
+        if (version != w->lambda_resources_version) {
+            coap_sync_lambda_resources(w, version);
+        }
+        coap_worker_batch(w, [w]() {
+            while (w->rx_next < w->rx_count) {
+                coap_read(w->ctx);
+            }
+        });
+        w->rx_count = 0;
+        if (count < RS_COAP_BATCH) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Retransmit the confirmable messages whose acknowledgement timed out and arm the timer for the next one
+ *
+ * libcoap keeps unacknowledged messages in its send queue but leaves the retransmission to the event loop.
+ *
+ * @param w Worker
+ */
+static void coap_schedule_retransmissions(coap_worker *w) {
+    coap_context_t *ctx = w->ctx;
+    coap_tick_t now;
+    coap_ticks(&now);
+    coap_queue_t *next;
+    while ((next = coap_peek_next(ctx)) != nullptr && next->t <= now - ctx->sendqueue_basetime) {
+        coap_retransmit(ctx, coap_pop_next(ctx));
+    }
+    uint32_t delay = 0;
+    if (next != nullptr) {
+        coap_tick_t ticks = next->t - (now - ctx->sendqueue_basetime);
+        delay = std::max<uint32_t>((uint32_t) ((uint64_t) ticks * 1000 / COAP_TICKS_PER_SECOND), 1);
+    }
+    w->loop.armTimer(w->retransmit_timer, delay);
+}
+
+/**
+ * @brief Notify the observers with a new result the rate limit allows and schedule the others
+ *
+ * Observers that got a notification less than observe_interval milliseconds ago are notified later with the
+ * latest result at that time.
+ *
+ * @param w Worker
+ */
+static void coap_notify_observers(coap_worker *w) {
+    uint64_t now = rs_history_now();
+    uint64_t next = 0;
+    bool removed = false;
+    for (auto it = w->observers.begin(); it != w->observers.end();) {
+        str token = {it->token.length(), (unsigned char *) &it->token[0]};
+        coap_subscription_t *subscription = coap_find_observer(it->resource, &it->peer, &token);
+        if (subscription == nullptr) {
+            // removed by libcoap after a reset or too many failed notifications
+            it = w->observers.erase(it);
+            removed = true;
+            continue;
+        }
+        if (it->pending && now - it->last_notified >= observe_interval) {
+            subscription->dirty = 1;
+            it->resource->partiallydirty = 1;
+            it->pending = false;
+            it->last_notified = now;
+        } else if (it->pending && (next == 0 || it->last_notified + observe_interval < next)) {
+            next = it->last_notified + observe_interval;
+        }
+        ++it;
+    }
+    if (removed) {
+        coap_update_observed_stream(w);
+    }
+    // disarmed if no observer waits for the rate limit
+    w->loop.armTimer(w->observe_timer, next == 0 ? 0 : (uint32_t) std::max<uint64_t>(next - now, 1));
+    coap_worker_batch(w, [w]() { coap_check_notify(w->ctx); });
+    // confirmable notifications are retransmitted until acknowledged
+    coap_schedule_retransmissions(w);
+}
+
+/**
+ * @brief Take new results of observed lambdas from the connector and notify the observers
+ *
+ * Called by the event loop as soon as the connector queued a result, so notifications leave without polling delay.
+ *
+ * @param w Worker
+ */
+static void coap_handle_observed_results(coap_worker *w) {
+    rs_stream_clear_fd(w->observed_stream);
+    rs_stream_update updates[RS_STREAM_BATCH];
+    size_t count;
+    while ((count = rs_stream_read(w->observed_stream, updates, RS_STREAM_BATCH, 0)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            lambda_id_t id = updates[i].id;
+            auto first = w->observed_results.lower_bound(std::make_tuple(id, rest_format::JSON, (rest_fields) 0));
+            auto last = w->observed_results.upper_bound(std::make_tuple(id, rest_format::CBOR, (rest_fields) 0xff));
+            w->observed_results.erase(first, last);
+            for (coap_lambda_observer &o : w->observers) {
+                if (o.id != id) {
+                    continue;
+                }
+                o.pending = true;
+                auto key = std::make_tuple(id, o.format, o.fields);
+                if (w->observed_results.find(key) == w->observed_results.end()) {
+                    w->observed_results.emplace(key, RiotsensorsRESTHandler::handleNotification(&updates[i],
+                                                                                                 o.format, o.fields));
+                }
+            }
+            rs_stream_update_free(&updates[i]);
+        }
+    }
+    coap_notify_observers(w);
+}
+
+/**
+ * @brief Create the state of a call request
+ *
+ * @param w Worker that received the request
+ * @param resource Called resource
+ * @param local_interface CoAP local interface
+ * @param peer CoAP peer endpoint
+ * @param request CoAP request
+ * @param token CoAP token
+ * @param format Format of the response body
+ * @param fields Fields of the response
+ * @return Call state, in_handler is set
+ */
+static std::shared_ptr<coap_separate_call> coap_new_call(coap_worker *w, coap_resource_t *resource,
+                                                         const coap_endpoint_t *local_interface,
+                                                         const coap_address_t *peer, coap_pdu_t *request,
+                                                         const str *token, rest_format format, rest_fields fields) {
+    auto call = std::make_shared<coap_separate_call>();
+    call->worker = w->shared_from_this();
+    call->resource = resource;
+    call->local_interface = *local_interface;
+    call->peer = *peer;
+    call->token = std::string((const char *) token->s, token->length);
+    call->confirmable = request->hdr->type == COAP_MESSAGE_CON;
+    coap_opt_iterator_t opt_iter{};
+    coap_opt_t *opt = coap_check_option(request, COAP_OPTION_OBSERVE, &opt_iter);
+    call->observe = opt == nullptr ? -1 : coap_decode_var_bytes(coap_opt_value(opt), coap_opt_length(opt));
+    call->etags = coap_request_etags(request);
+    call->id = 0;
+    call->lambda_resource = false;
+    call->format = format;
+    call->fields = fields;
+    call->in_handler = true;
+    call->answered = false;
+    return call;
+}
+
+/**
+ * @brief Create the receiver of the answer of a call, queues the answer for a separate response once the request
+ * handler returned
+ *
+ * @param call Call state
+ * @return Receiver passed to the REST handler
+ */
+static rest_call_done coap_call_done(std::shared_ptr<coap_separate_call> call) {
+    return [call](const rest_response_info &answer) {
+        coap_worker *w = call->worker.get();
+        std::lock_guard<std::mutex> guard(w->separate_lock);
+        call->answer = answer;
+        call->answered = true;
+        if (!call->in_handler && w->separate_fd >= 0) {
+            w->separate_answers.push_back(call);
+            uint64_t one = 1;
+            ssize_t written = write(w->separate_fd, &one, sizeof(one));
+            UNUSED(written);
+        }
+    };
+}
+
+/**
+ * @brief Piggyback the answer of a call on the response or turn the response into an empty acknowledgement
+ *
+ * @param response CoAP response libcoap sends after the handler returned
+ * @param call Call state
+ */
+static void coap_answer_call(coap_pdu_t *response, const std::shared_ptr<coap_separate_call> &call) {
+    coap_worker *w = call->worker.get();
+    {
+        std::lock_guard<std::mutex> guard(w->separate_lock);
+        call->in_handler = false;
+        if (!call->answered) {
+            // an empty ACK stops the retransmissions of the client, libcoap sends nothing for code 0 and NON
+            unsigned char type = response->hdr->type;
+            unsigned short id = response->hdr->id;
+            coap_pdu_clear(response, response->max_size);
+            response->hdr->type = type;
+            response->hdr->id = id;
+            return;
+        }
+    }
+    int64_t observe = coap_handle_observe(w, *call, call->answer);
+    coap_transfer_data_from_response_info(call->etags, response, call->answer, call->format, observe);
+}
+
+/**
+ * @brief Send the separate responses of the calls completed after their request has been acknowledged
+ *
+ * @param w Worker
+ */
+static void coap_send_separate_answers(coap_worker *w) {
+    coap_context_t *ctx = w->ctx;
+    std::vector<std::shared_ptr<coap_separate_call>> answers;
+    {
+        std::lock_guard<std::mutex> guard(w->separate_lock);
+        uint64_t count;
+        ssize_t r = read(w->separate_fd, &count, sizeof(count));
+        UNUSED(r);
+        answers.swap(w->separate_answers);
+    }
+    coap_worker_batch(w, [w, ctx, &answers]() {
+        for (const std::shared_ptr<coap_separate_call> &call : answers) {
+            coap_pdu_t *pdu = coap_pdu_init(call->confirmable ? COAP_MESSAGE_CON : COAP_MESSAGE_NON, 0,
+                                            coap_new_message_id(ctx), COAP_MAX_PDU_SIZE);
+            if (pdu == nullptr) {
+                continue;
+            }
+            coap_add_token(pdu, call->token.length(), (const unsigned char *) call->token.data());
+            int64_t observe = coap_handle_observe(w, *call, call->answer);
+            coap_transfer_data_from_response_info(call->etags, pdu, call->answer, call->format, observe);
+            if (!call->confirmable) {
+                coap_send(ctx, &call->local_interface, &call->peer, pdu);
+                coap_delete_pdu(pdu);
+            } else if (coap_send_confirmed(ctx, &call->local_interface, &call->peer, pdu) == COAP_INVALID_TID) {
+                coap_delete_pdu(pdu);
+            }
+        }
+    });
+    coap_schedule_retransmissions(w);
+}
+
 void RiotsensorsCoAPProvider::handleCallById(coap_context_t *ctx, struct coap_resource_t *resource,
                                              const coap_endpoint_t *local_interface, coap_address_t *peer,
                                              coap_pdu_t *request, str *token, coap_pdu_t *response) {
     UNUSED(ctx);
-    UNUSED(resource);
-    UNUSED(local_interface);
-    UNUSED(peer);
-    UNUSED(token);
-    coap_opt_iterator_t opt_iter{};
-    coap_opt_filter_t f = {};
-    coap_opt_t *q;
-    coap_option_filter_clear(f);
-    coap_option_setb(f, COAP_OPTION_URI_QUERY);
-    coap_option_iterator_init(request, &opt_iter, f);
-    bool type_found = false;
-    bool id_found = false;
-    rs_lambda_type_t type = 0;
-    lambda_id_t id = 0;
-    while ((q = coap_option_next(&opt_iter)) != nullptr) {
-        auto typelambda = [&type, &type_found](std::string value) -> void {
-            type = get_lambda_type_from_string(value.c_str());
-            type_found = true;
-        };
-        try_match_coap_opt_and_execute("type", q, typelambda)
-        auto idlambda = [&id, &id_found](std::string value) -> void {
-            try {
-                id = (lambda_id_t) std::stoi(value);
-            } catch (std::invalid_argument &e) {
-                id = (lambda_id_t) -1;
-            }
-            id_found = true;
-        };
-        try_match_coap_opt_and_execute("id", q, idlambda)
+    if (request == nullptr) {
+        coap_fill_notification(current_worker, resource, peer, token, response);
+        return;
     }
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
+        return;
+    }
+    coap_query_param params[] = {coap_query_param("type"), coap_query_param("id"), coap_query_param("fields"),
+                                 coap_query_param("view")};
+    coap_parse_query(request, params, 4);
+    bool type_found = params[0].found;
+    bool id_found = params[1].found;
+    rs_lambda_type_t type = coap_query_type(params[0]);
+    lambda_id_t id = coap_query_id(params[1]);
     if (!id_found) {
         static std::string missing_id_text = "Missing id query parameter";
         response->hdr->code = COAP_RESPONSE_CODE(400);
@@ -140,40 +983,37 @@ void RiotsensorsCoAPProvider::handleCallById(coap_context_t *ctx, struct coap_re
                       (unsigned char *) missing_type_text.c_str());
         return;
     }
-    rest_response_info answer = RiotsensorsRESTHandler::handleCallById(type, id);
-    coap_transfer_data_from_response_info(response, answer);
+    rest_fields fields;
+    const char *error = RiotsensorsRESTHandler::parseCallFields(params[2].str(), params[3].str(), &fields);
+    if (error != nullptr) {
+        coap_answer_with_text(response, 400, error);
+        return;
+    }
+    auto call = coap_new_call(current_worker, resource, local_interface, peer, request, token, format, fields);
+    call->id = id;
+    RiotsensorsRESTHandler::handleCallByIdAsync(type, id, format, fields, coap_call_done(call));
+    coap_answer_call(response, call);
 }
 
 void RiotsensorsCoAPProvider::handleCallByName(coap_context_t *ctx, struct coap_resource_t *resource,
                                                const coap_endpoint_t *local_interface, coap_address_t *peer,
                                                coap_pdu_t *request, str *token, coap_pdu_t *response) {
     UNUSED(ctx);
-    UNUSED(resource);
-    UNUSED(local_interface);
-    UNUSED(peer);
-    UNUSED(token);
-    coap_opt_iterator_t opt_iter{};
-    coap_opt_filter_t f = {};
-    coap_opt_t *q;
-    coap_option_filter_clear(f);
-    coap_option_setb(f, COAP_OPTION_URI_QUERY);
-    coap_option_iterator_init(request, &opt_iter, f);
-    bool type_found = false;
-    bool name_found = false;
-    rs_lambda_type_t type = 0;
-    std::string name;
-    while ((q = coap_option_next(&opt_iter)) != nullptr) {
-        auto typelambda = [&type, &type_found](std::string value) -> void {
-            type = get_lambda_type_from_string(value.c_str());
-            type_found = true;
-        };
-        try_match_coap_opt_and_execute("type", q, typelambda)
-        auto namelambda = [&name, &name_found](std::string value) -> void {
-            name = value;
-            name_found = true;
-        };
-        try_match_coap_opt_and_execute("name", q, namelambda)
+    if (request == nullptr) {
+        coap_fill_notification(current_worker, resource, peer, token, response);
+        return;
     }
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
+        return;
+    }
+    coap_query_param params[] = {coap_query_param("type"), coap_query_param("name"), coap_query_param("fields"),
+                                 coap_query_param("view")};
+    coap_parse_query(request, params, 4);
+    bool type_found = params[0].found;
+    bool name_found = params[1].found;
+    rs_lambda_type_t type = coap_query_type(params[0]);
+    std::string name = params[1].str();
     if (!name_found) {
         static std::string missing_name_text = "Missing name query parameter";
         response->hdr->code = COAP_RESPONSE_CODE(400);
@@ -202,8 +1042,75 @@ void RiotsensorsCoAPProvider::handleCallByName(coap_context_t *ctx, struct coap_
                       (unsigned char *) missing_type_text.c_str());
         return;
     }
-    rest_response_info answer = RiotsensorsRESTHandler::handleCallByName(type, name);
-    coap_transfer_data_from_response_info(response, answer);
+    rest_fields fields;
+    const char *error = RiotsensorsRESTHandler::parseCallFields(params[2].str(), params[3].str(), &fields);
+    if (error != nullptr) {
+        coap_answer_with_text(response, 400, error);
+        return;
+    }
+    auto call = coap_new_call(current_worker, resource, local_interface, peer, request, token, format, fields);
+    call->name = name;
+    RiotsensorsRESTHandler::handleCallByNameAsync(type, name, format, fields, coap_call_done(call));
+    coap_answer_call(response, call);
+}
+
+void RiotsensorsCoAPProvider::handleLambda(coap_context_t *ctx, struct coap_resource_t *resource,
+                                           const coap_endpoint_t *local_interface, coap_address_t *peer,
+                                           coap_pdu_t *request, str *token, coap_pdu_t *response) {
+    UNUSED(ctx);
+    if (request == nullptr) {
+        coap_fill_notification(current_worker, resource, peer, token, response);
+        return;
+    }
+    auto bound = current_worker->lambda_resources.find(resource);
+    if (bound == current_worker->lambda_resources.end()) {
+        coap_answer_with_text(response, 404, "Unknown lambda resource");
+        return;
+    }
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
+        return;
+    }
+    coap_query_param params[] = {coap_query_param("fields"), coap_query_param("view")};
+    coap_parse_query(request, params, 2);
+    rest_fields fields;
+    const char *error = RiotsensorsRESTHandler::parseCallFields(params[0].str(), params[1].str(), &fields);
+    if (error != nullptr) {
+        coap_answer_with_text(response, 400, error);
+        return;
+    }
+    coap_lambda_resource lambda = bound->second;
+    auto call = coap_new_call(current_worker, resource, local_interface, peer, request, token, format, fields);
+    call->id = lambda.id;
+    call->lambda_resource = true;
+    RiotsensorsRESTHandler::handleCallByIdAsync(lambda.type, lambda.id, format, fields, coap_call_done(call));
+    coap_answer_call(response, call);
+}
+
+void RiotsensorsCoAPProvider::handleCallMulti(coap_context_t *ctx, struct coap_resource_t *resource,
+                                              const coap_endpoint_t *local_interface, coap_address_t *peer,
+                                              coap_pdu_t *request, str *token, coap_pdu_t *response) {
+    UNUSED(ctx);
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
+        return;
+    }
+    coap_query_param params[] = {coap_query_param("ids"), coap_query_param("types"), coap_query_param("name")};
+    coap_parse_query(request, params, 3);
+    std::vector<lambda_id_t> id_list;
+    std::vector<rs_lambda_type_t> type_list;
+    const char *error = RiotsensorsRESTHandler::parseMultiParams(params[0].str(), params[1].str(), params[2].str(),
+                                                               &id_list, &type_list);
+    if (error != nullptr) {
+        coap_answer_with_text(response, 400, error);
+        return;
+    }
+    auto call = coap_new_call(current_worker, resource, local_interface, peer, request, token, format,
+                              RS_FIELDS_ALL);
+    // the combined resource cannot be observed
+    call->observe = -1;
+    RiotsensorsRESTHandler::handleCallMultiAsync(id_list, type_list, format, coap_call_done(call));
+    coap_answer_call(response, call);
 }
 
 void RiotsensorsCoAPProvider::handleList(coap_context_t *ctx, struct coap_resource_t *resource,
@@ -214,13 +1121,17 @@ void RiotsensorsCoAPProvider::handleList(coap_context_t *ctx, struct coap_resour
     UNUSED(local_interface);
     UNUSED(peer);
     UNUSED(token);
-    rs_lambda_type_t type = coap_parse_type(request);
-    if (type == (rs_lambda_type_t) -1) {
-        coap_answer_with_unknown_type(response);
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
         return;
     }
-    rest_response_info answer = RiotsensorsRESTHandler::handleList(type);
-    coap_transfer_data_from_response_info(response, answer);
+    rs_lambda_type_t type;
+    std::string name;
+    if (!coap_parse_selection(request, response, &type, &name)) {
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleList(type, name, format);
+    coap_transfer_data_from_response_info(coap_request_etags(request), response, answer, format);
 }
 
 void RiotsensorsCoAPProvider::handleCache(coap_context_t *ctx, struct coap_resource_t *resource,
@@ -231,13 +1142,140 @@ void RiotsensorsCoAPProvider::handleCache(coap_context_t *ctx, struct coap_resou
     UNUSED(local_interface);
     UNUSED(peer);
     UNUSED(token);
-    rs_lambda_type_t type = coap_parse_type(request);
-    if (type == (rs_lambda_type_t) -1) {
-        coap_answer_with_unknown_type(response);
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
+        return;
+    }
+    rs_lambda_type_t type;
+    std::string name;
+    if (!coap_parse_selection(request, response, &type, &name)) {
         return;
     }
-    rest_response_info answer = RiotsensorsRESTHandler::handleCache(type);
-    coap_transfer_data_from_response_info(response, answer);
+    rest_response_info answer = RiotsensorsRESTHandler::handleCache(type, name, format);
+    coap_transfer_data_from_response_info(coap_request_etags(request), response, answer, format);
+}
+
+/**
+ * @brief Parse the query parameters of a range query request, except for the lambda identification
+ *
+ * @param params Parsed op, from, to, last and q parameters
+ * @param query Where to store the parameters
+ * @return Error message of an illegal parameter, nullptr if the parameters are valid
+ */
+static const char *coap_parse_range_query(const coap_query_param *params, rest_query_params *query) {
+    return RiotsensorsRESTHandler::parseQueryParams(params[0].str(), params[1].str(), params[2].str(),
+                                                   params[3].str(), params[4].str(), query);
+}
+
+void RiotsensorsCoAPProvider::handleQueryById(coap_context_t *ctx, struct coap_resource_t *resource,
+                                              const coap_endpoint_t *local_interface, coap_address_t *peer,
+                                              coap_pdu_t *request, str *token, coap_pdu_t *response) {
+    UNUSED(ctx);
+    UNUSED(resource);
+    UNUSED(local_interface);
+    UNUSED(peer);
+    UNUSED(token);
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
+        return;
+    }
+    coap_query_param params[] = {coap_query_param("op"), coap_query_param("from"), coap_query_param("to"),
+                                 coap_query_param("last"), coap_query_param("q"), coap_query_param("id")};
+    coap_parse_query(request, params, 6);
+    bool id_found = params[5].found;
+    lambda_id_t id = coap_query_id(params[5]);
+    if (!id_found) {
+        coap_answer_with_text(response, 400, "Missing id query parameter");
+        return;
+    }
+    if (id == (lambda_id_t) -1) {
+        coap_answer_with_text(response, 400, "Illegal id parameter");
+        return;
+    }
+    rest_query_params query{};
+    const char *error = coap_parse_range_query(params, &query);
+    if (error != nullptr) {
+        coap_answer_with_text(response, 400, error);
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleQueryById(id, query, format);
+    coap_transfer_data_from_response_info(coap_request_etags(request), response, answer, format);
+}
+
+void RiotsensorsCoAPProvider::handleQueryByName(coap_context_t *ctx, struct coap_resource_t *resource,
+                                                const coap_endpoint_t *local_interface, coap_address_t *peer,
+                                                coap_pdu_t *request, str *token, coap_pdu_t *response) {
+    UNUSED(ctx);
+    UNUSED(resource);
+    UNUSED(local_interface);
+    UNUSED(peer);
+    UNUSED(token);
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
+        return;
+    }
+    coap_query_param params[] = {coap_query_param("op"), coap_query_param("from"), coap_query_param("to"),
+                                 coap_query_param("last"), coap_query_param("q"), coap_query_param("name")};
+    coap_parse_query(request, params, 6);
+    bool name_found = params[5].found;
+    std::string name = params[5].str();
+    if (!name_found) {
+        coap_answer_with_text(response, 400, "Missing name query parameter");
+        return;
+    }
+    if (name.length() == 0) {
+        coap_answer_with_text(response, 400, "Illegal name parameter");
+        return;
+    }
+    rest_query_params query{};
+    const char *error = coap_parse_range_query(params, &query);
+    if (error != nullptr) {
+        coap_answer_with_text(response, 400, error);
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleQueryByName(name, query, format);
+    coap_transfer_data_from_response_info(coap_request_etags(request), response, answer, format);
+}
+
+void RiotsensorsCoAPProvider::handleEvents(coap_context_t *ctx, struct coap_resource_t *resource,
+                                           const coap_endpoint_t *local_interface, coap_address_t *peer,
+                                           coap_pdu_t *request, str *token, coap_pdu_t *response) {
+    UNUSED(ctx);
+    UNUSED(resource);
+    UNUSED(local_interface);
+    UNUSED(peer);
+    UNUSED(token);
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
+        return;
+    }
+    coap_query_param after("after");
+    coap_parse_query(request, &after, 1);
+    uint64_t after_seq;
+    uint32_t wait_ms;
+    const char *error = RiotsensorsRESTHandler::parseEventParams(after.str(), "", &after_seq, &wait_ms);
+    if (error != nullptr) {
+        coap_answer_with_text(response, 400, error);
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleEvents(after_seq, format);
+    coap_transfer_data_from_response_info(coap_request_etags(request), response, answer, format);
+}
+
+void RiotsensorsCoAPProvider::handleStats(coap_context_t *ctx, struct coap_resource_t *resource,
+                                          const coap_endpoint_t *local_interface, coap_address_t *peer,
+                                          coap_pdu_t *request, str *token, coap_pdu_t *response) {
+    UNUSED(ctx);
+    UNUSED(resource);
+    UNUSED(local_interface);
+    UNUSED(peer);
+    UNUSED(token);
+    rest_format format;
+    if (!coap_negotiate_format(request, response, &format)) {
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleStats(format);
+    coap_transfer_data_from_response_info(coap_request_etags(request), response, answer, format);
 }
 
 void RiotsensorsCoAPProvider::handleKill(coap_context_t *ctx, struct coap_resource_t *resource,
@@ -255,60 +1293,211 @@ void RiotsensorsCoAPProvider::handleKill(coap_context_t *ctx, struct coap_resour
                   (unsigned char *) kill_text.c_str());
 }
 
-void handle_read_event(int fd, short what, void *ctx) {
-    UNUSED(fd);
-    UNUSED(what);
-    coap_read((coap_context_t *) ctx);
+void stopCoAPServer() {
+    std::lock_guard<std::mutex> guard(coap_workers_lock);
+    // workers still starting stop right away
+    coap_stopping = true;
+    for (const std::shared_ptr<coap_worker> &w : coap_workers) {
+        w->loop.stop();
+    }
 }
 
-void *startCoAPServer(void *thread_ctx) {
-    auto arguments = (struct riotsensors_start_opts *) thread_ctx;
-
-    coap_context_t *ctx;
-    coap_address_t serv_addr{};
+/**
+ * @brief Add the REST resources to a CoAP context
+ *
+ * @param ctx CoAP context
+ */
+static void coap_add_resources(coap_context_t *ctx) {
     coap_resource_t *callbyid_resource;
     coap_resource_t *callbyname_resource;
+    coap_resource_t *callmulti_resource;
     coap_resource_t *handlelist_resource;
     coap_resource_t *handlecache_resource;
+    coap_resource_t *querybyid_resource;
+    coap_resource_t *querybyname_resource;
+    coap_resource_t *events_resource;
+    coap_resource_t *stats_resource;
     coap_resource_t *kill_resource;
 
-    /* Prepare the CoAP server socket */
-    coap_address_init(&serv_addr);
-    serv_addr.addr.sin.sin_family = AF_INET;
-    serv_addr.addr.sin.sin_addr.s_addr = INADDR_ANY;
-    serv_addr.addr.sin.sin_port = htons(arguments->coap_port); //default port
-    ctx = coap_new_context(&serv_addr);
-    if (ctx == nullptr) {
-        exit(EXIT_FAILURE);
-    }
-
     /* Initialize the resources */
     callbyid_resource = coap_resource_init((unsigned char *) "v1/call/id", 10, 0);
     callbyname_resource = coap_resource_init((unsigned char *) "v1/call/name", 12, 0);
+    callmulti_resource = coap_resource_init((unsigned char *) "v1/call/multi", 13, 0);
+    callbyid_resource->observable = 1;
+    callbyname_resource->observable = 1;
     handlelist_resource = coap_resource_init((unsigned char *) "v1/list", 7, 0);
     handlecache_resource = coap_resource_init((unsigned char *) "v1/showcache", 12, 0);
+    querybyid_resource = coap_resource_init((unsigned char *) "v1/query/id", 11, 0);
+    querybyname_resource = coap_resource_init((unsigned char *) "v1/query/name", 13, 0);
+    events_resource = coap_resource_init((unsigned char *) "v1/events", 9, 0);
+    stats_resource = coap_resource_init((unsigned char *) "v1/stats", 8, 0);
     kill_resource = coap_resource_init((unsigned char *) "v1/kill", 7, 0);
 
     /* Register handler */
     coap_register_handler(callbyid_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleCallById);
     coap_register_handler(callbyname_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleCallByName);
+    coap_register_handler(callmulti_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleCallMulti);
     coap_register_handler(handlelist_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleList);
     coap_register_handler(handlecache_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleCache);
+    coap_register_handler(querybyid_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleQueryById);
+    coap_register_handler(querybyname_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleQueryByName);
+    coap_register_handler(events_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleEvents);
+    coap_register_handler(stats_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleStats);
     coap_register_handler(kill_resource, COAP_REQUEST_GET, RiotsensorsCoAPProvider::handleKill);
 
     /* Add resources */
     coap_add_resource(ctx, callbyid_resource);
     coap_add_resource(ctx, callbyname_resource);
+    coap_add_resource(ctx, callmulti_resource);
     coap_add_resource(ctx, handlelist_resource);
     coap_add_resource(ctx, handlecache_resource);
+    coap_add_resource(ctx, querybyid_resource);
+    coap_add_resource(ctx, querybyname_resource);
+    coap_add_resource(ctx, events_resource);
+    coap_add_resource(ctx, stats_resource);
     coap_add_resource(ctx, kill_resource);
+}
 
-    struct event_base *ev_base = event_base_new();
-    struct event *ev_cmd = event_new(ev_base, ctx->sockfd, EV_READ | EV_PERSIST,
-                                     handle_read_event, ctx);
-    event_add(ev_cmd, nullptr);
-    event_base_dispatch(ev_base);
-    event_base_free(ev_base);
-    event_free(ev_cmd);
+/**
+ * @brief Replace the socket of a CoAP context by one bound to the server port with SO_REUSEPORT
+ *
+ * libcoap binds the socket of a context itself without SO_REUSEPORT, so the context is created on an ephemeral port
+ * and its descriptor then refers to the shared port.
+ *
+ * @param ctx CoAP context
+ * @param port Server port
+ * @return If the socket could be bound
+ */
+static bool coap_bind_worker_socket(coap_context_t *ctx, uint16_t port) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    int on = 1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0 ||
+        bind(fd, (const sockaddr *) &addr, sizeof(addr)) < 0 || dup2(fd, ctx->sockfd) < 0) {
+        close(fd);
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+/**
+ * @brief Run a CoAP worker until stopCoAPServer() is called
+ *
+ * @param arguments Start options
+ */
+static void coap_run_worker(const riotsensors_start_opts *arguments) {
+    auto w = std::make_shared<coap_worker>();
+    coap_address_t serv_addr{};
+
+    /* Prepare the CoAP server socket */
+    coap_address_init(&serv_addr);
+    serv_addr.addr.sin.sin_family = AF_INET;
+    serv_addr.addr.sin.sin_addr.s_addr = INADDR_ANY;
+    serv_addr.addr.sin.sin_port = 0;
+    coap_context_t *ctx = coap_new_context(&serv_addr);
+    if (ctx == nullptr || !coap_bind_worker_socket(ctx, arguments->coap_port)) {
+        fprintf(stderr, "Could not bind the CoAP server to port %d\n", arguments->coap_port);
+        exit(EXIT_FAILURE);
+    }
+    ctx->network_read = coap_worker_network_read;
+    ctx->network_send = coap_worker_network_send;
+    coap_add_resources(ctx);
+    w->ctx = ctx;
+    coap_sync_lambda_resources(w.get(), rs_linux_get_registry_version());
+    w->observed_stream = nullptr;
+    w->rx_count = 0;
+    w->rx_next = 0;
+    w->batching = false;
+    w->tx_count = 0;
+    current_worker = w.get();
+
+    coap_worker *worker = w.get();
+    if (!w->loop.valid() || !w->loop.add(ctx->sockfd, [worker]() { coap_worker_read(worker); })) {
+        fprintf(stderr, "Could not create the CoAP event loop\n");
+        coap_free_context(ctx);
+        current_worker = nullptr;
+        return;
+    }
+    // nothing is subscribed until the first observer registers
+    uint8_t no_ids[(MAX_LAMBDAS + 7) / 8] = {0};
+    w->observed_stream = rs_linux_open_stream(no_ids, 0);
+    w->observe_timer = w->loop.addTimer([worker]() { coap_notify_observers(worker); });
+    w->retransmit_timer = w->loop.addTimer([worker]() { coap_schedule_retransmissions(worker); });
+    w->separate_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (w->retransmit_timer < 0 || w->separate_fd < 0 ||
+        !w->loop.add(w->separate_fd, [worker]() { coap_send_separate_answers(worker); })) {
+        // without them separate responses and their retransmissions would be lost
+        fprintf(stderr, "Could not create the CoAP separate response queue\n");
+        exit(EXIT_FAILURE);
+    }
+    if (w->observed_stream == nullptr || w->observe_timer < 0 ||
+        !w->loop.add(rs_stream_fd(w->observed_stream), [worker]() { coap_handle_observed_results(worker); })) {
+        fprintf(stderr, "Could not open the result stream, CoAP resources cannot be observed\n");
+    }
+    {
+        std::lock_guard<std::mutex> guard(coap_workers_lock);
+        coap_workers.push_back(w);
+        if (coap_stopping) {
+            w->loop.stop();
+        }
+    }
+
+    w->loop.run();
+    {
+        std::lock_guard<std::mutex> guard(coap_workers_lock);
+        coap_workers.erase(std::find(coap_workers.begin(), coap_workers.end(), w));
+    }
+    {
+        // calls still pending keep the worker alive and are completed by the connector without a response
+        std::lock_guard<std::mutex> guard(w->separate_lock);
+        if (w->separate_fd >= 0) {
+            w->loop.remove(w->separate_fd);
+            close(w->separate_fd);
+            w->separate_fd = -1;
+        }
+        w->separate_answers.clear();
+    }
+    if (w->observed_stream != nullptr) {
+        w->loop.remove(rs_stream_fd(w->observed_stream));
+        rs_linux_close_stream(w->observed_stream);
+        w->observed_stream = nullptr;
+    }
+    w->observers.clear();
+    w->observed_results.clear();
+    w->lambda_resources.clear();
+    for (coap_packet_t *&packet : w->rx_packets) {
+        free(packet);
+        packet = nullptr;
+    }
+    w->loop.remove(ctx->sockfd);
+    coap_free_context(ctx);
+    w->ctx = nullptr;
+    current_worker = nullptr;
+}
+
+void *startCoAPServer(void *thread_ctx) {
+    auto arguments = (struct riotsensors_start_opts *) thread_ctx;
+    observe_interval = arguments->observe_interval;
+    {
+        std::lock_guard<std::mutex> guard(coap_workers_lock);
+        coap_stopping = false;
+    }
+    unsigned int count = std::max(arguments->coap_threads, 1u);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < count; i++) {
+        workers.emplace_back(coap_run_worker, arguments);
+    }
+    coap_run_worker(arguments);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
     return nullptr;
 }
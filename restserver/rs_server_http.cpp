@@ -6,31 +6,657 @@
 
 #include <rs_server_http.h>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <rs_event_loop.h>
 #include <rs_rest.h>
 #include <spt_logger.h>
+#include <unused.h>
 
 using namespace Pistache;
 
+/**
+ * @brief Check if an If-None-Match header value matches an entity tag (weak comparison)
+ *
+ * @param header Value of the If-None-Match header, a comma separated list of entity tags or *
+ * @param etag Formatted entity tag of the current response
+ * @return If the client already has the current representation
+ */
+static bool http_etag_matches(const std::string &header, const std::string &etag) {
+    // weak comparison ignores the W/ prefix on both sides
+    std::string opaque = etag.compare(0, 2, "W/") == 0 ? etag.substr(2) : etag;
+    std::string::size_type pos = 0;
+    while (pos < header.length()) {
+        std::string::size_type end = header.find(',', pos);
+        if (end == std::string::npos) {
+            end = header.length();
+        }
+        std::string::size_type first = header.find_first_not_of(" \t", pos);
+        std::string::size_type last = header.find_last_not_of(" \t", end - 1);
+        if (first != std::string::npos && first < end && last >= first) {
+            std::string candidate = header.substr(first, last - first + 1);
+            if (candidate == "*") {
+                return true;
+            }
+            if (candidate.compare(0, 2, "W/") == 0) {
+                candidate = candidate.substr(2);
+            }
+            if (candidate == opaque) {
+                return true;
+            }
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief Get the quality a client assigned to a media type in an Accept header
+ *
+ * The most specific matching media range decides, so an explicit application/cbor outweighs a wildcard.
+ *
+ * @param accept Value of the Accept header
+ * @param type Media type (eg. application/json)
+ * @return Quality in [0, 1], -1 if no media range matches
+ */
+static double http_accept_quality(const std::string &accept, const std::string &type) {
+    std::string main_type = type.substr(0, type.find('/'));
+    double quality = -1;
+    int specificity = -1;
+    std::string::size_type pos = 0;
+    while (pos < accept.length()) {
+        std::string::size_type end = accept.find(',', pos);
+        if (end == std::string::npos) {
+            end = accept.length();
+        }
+        std::string item = accept.substr(pos, end - pos);
+        pos = end + 1;
+        std::string::size_type params = item.find(';');
+        std::string range = item.substr(0, params);
+        range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+        std::transform(range.begin(), range.end(), range.begin(), ::tolower);
+        int match;
+        if (range == type) {
+            match = 2;
+        } else if (range == main_type + "/*") {
+            match = 1;
+        } else if (range == "*/*") {
+            match = 0;
+        } else {
+            continue;
+        }
+        double q = 1;
+        while (params != std::string::npos) {
+            std::string::size_type next = item.find(';', params + 1);
+            std::string param = item.substr(params + 1, next == std::string::npos ? std::string::npos
+                                                                                  : next - params - 1);
+            param.erase(std::remove_if(param.begin(), param.end(), ::isspace), param.end());
+            if (param.compare(0, 2, "q=") == 0 || param.compare(0, 2, "Q=") == 0) {
+                q = strtod(param.c_str() + 2, nullptr);
+            }
+            params = next;
+        }
+        if (match > specificity) {
+            specificity = match;
+            quality = q;
+        }
+    }
+    return quality;
+}
+
+/**
+ * @brief Select the format of a response body by the Accept header, JSON is preferred on equal quality
+ *
+ * @param request Received request
+ * @param response Response to send, gets the content type of the selected format or 406 if none is acceptable
+ * @param format Where to store the selected format
+ * @return If a format was selected, the response was sent otherwise
+ */
+static bool http_negotiate_format(const Rest::Request &request, Http::ResponseWriter &response,
+                                  rest_format *format) {
+    *format = rest_format::JSON;
+    auto accept = request.headers().tryGetRaw("Accept");
+    if (!accept.isEmpty() && !accept.get().value().empty()) {
+        const std::string &value = accept.get().value();
+        double json = http_accept_quality(value, rest_format_media_type(rest_format::JSON));
+        double cbor = http_accept_quality(value, rest_format_media_type(rest_format::CBOR));
+        if (json <= 0 && cbor <= 0) {
+            response.send(Http::Code::Not_Acceptable, "Supported media types are application/json and "
+                                                      "application/cbor\n");
+            return false;
+        }
+        if (cbor > json) {
+            *format = rest_format::CBOR;
+        }
+    }
+    response.setMime(Http::Mime::MediaType::fromString(rest_format_media_type(*format)));
+    return true;
+}
+
+/**
+ * @brief Get the quality a client assigned to a content coding in an Accept-Encoding header
+ *
+ * @param accept Value of the Accept-Encoding header
+ * @param coding Name of the content coding (eg. gzip)
+ * @return Quality in [0, 1], -1 if the coding is neither listed nor covered by *
+ */
+static double http_encoding_quality(const std::string &accept, const std::string &coding) {
+    double quality = -1;
+    bool exact = false;
+    std::string::size_type pos = 0;
+    while (pos < accept.length()) {
+        std::string::size_type end = accept.find(',', pos);
+        if (end == std::string::npos) {
+            end = accept.length();
+        }
+        std::string item = accept.substr(pos, end - pos);
+        pos = end + 1;
+        std::string::size_type params = item.find(';');
+        std::string name = item.substr(0, params);
+        name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        bool match = name == coding;
+        if (!match && (name != "*" || exact)) {
+            continue;
+        }
+        double q = 1;
+        if (params != std::string::npos) {
+            std::string param = item.substr(params + 1);
+            param.erase(std::remove_if(param.begin(), param.end(), ::isspace), param.end());
+            if (param.compare(0, 2, "q=") == 0 || param.compare(0, 2, "Q=") == 0) {
+                q = strtod(param.c_str() + 2, nullptr);
+            }
+        }
+        quality = q;
+        exact = match;
+    }
+    return quality;
+}
+
+/**
+ * @brief Select the content coding of a response body by the Accept-Encoding header, gzip is preferred on equal
+ * quality
+ *
+ * @param request Received request
+ * @return Preferred content coding, IDENTITY if the client accepts no compression
+ */
+static rest_encoding http_negotiate_encoding(const Rest::Request &request) {
+    auto accept = request.headers().tryGetRaw("Accept-Encoding");
+    if (accept.isEmpty()) {
+        return rest_encoding::IDENTITY;
+    }
+    const std::string &value = accept.get().value();
+    double gzip = http_encoding_quality(value, rest_encoding_name(rest_encoding::GZIP));
+    double deflate = http_encoding_quality(value, rest_encoding_name(rest_encoding::DEFLATE));
+    if (gzip <= 0 && deflate <= 0) {
+        return rest_encoding::IDENTITY;
+    }
+    return gzip >= deflate ? rest_encoding::GZIP : rest_encoding::DEFLATE;
+}
+
+/**
+ * @brief Get the If-None-Match header of a request
+ *
+ * @param request Received request
+ * @return Value of the header, empty if it is missing
+ */
+static std::string http_if_none_match(const Rest::Request &request) {
+    auto if_none_match = request.headers().tryGetRaw("If-None-Match");
+    return if_none_match.isEmpty() ? std::string() : if_none_match.get().value();
+}
+
+/**
+ * @brief Send a REST response including its caching headers, answers with 304 if the client's copy is still valid
+ *
+ * @param if_none_match If-None-Match header of the request, empty if it is missing
+ * @param response Response to send
+ * @param answer Response of the REST handler
+ * @param format Format of the response body
+ * @param encodable If the body was selected by the Accept-Encoding header as well
+ */
+static void http_send_answer(const std::string &if_none_match, Http::ResponseWriter &response,
+                             const rest_response_info &answer, rest_format format, bool encodable = false) {
+    response.headers().add<VaryHeader>(encodable ? "Accept, Accept-Encoding" : "Accept");
+    if (answer.code == Http::Code::Too_Many_Requests) {
+        response.headers().add<RetryAfterHeader>((uint32_t) answer.max_age);
+        response.headers().add<Http::Header::CacheControl>(Http::CacheDirective(Http::CacheDirective::NoStore));
+    } else if (answer.max_age >= 0) {
+        response.headers().add<Http::Header::CacheControl>(
+                Http::CacheDirective(Http::CacheDirective::MaxAge, std::chrono::seconds(answer.max_age)));
+    } else {
+        response.headers().add<Http::Header::CacheControl>(Http::CacheDirective(Http::CacheDirective::NoStore));
+    }
+    if (answer.etag != 0 && answer.code == Http::Code::Ok) {
+        // both representations are built from the same data version, but must not validate each other
+        char etag[32];
+        snprintf(etag, sizeof(etag), format == rest_format::CBOR ? "W/\"%llx-cbor\"" : "W/\"%llx\"",
+                 (unsigned long long) answer.etag);
+        response.headers().add<ETagHeader>(etag);
+        if (!if_none_match.empty() && http_etag_matches(if_none_match, etag)) {
+            response.send(Http::Code::Not_Modified);
+            return;
+        }
+    }
+    switch (answer.encoding) {
+        case rest_encoding::GZIP:
+            response.headers().add<Http::Header::ContentEncoding>(Http::Header::Encoding::Gzip);
+            break;
+        case rest_encoding::DEFLATE:
+            response.headers().add<Http::Header::ContentEncoding>(Http::Header::Encoding::Deflate);
+            break;
+        default:
+            break;
+    }
+    // written straight from the shared body, which may be owned by the response cache
+    response.send(answer.code, answer.body->data(), answer.body->size());
+}
+
+/**
+ * @brief Send a REST response including its caching headers, answers with 304 if the client's copy is still valid
+ *
+ * @param request Received request
+ * @param response Response to send
+ * @param answer Response of the REST handler
+ * @param format Format of the response body
+ * @param encodable If the body was selected by the Accept-Encoding header as well
+ */
+static void http_send_answer(const Rest::Request &request, Http::ResponseWriter &response,
+                             const rest_response_info &answer, rest_format format, bool encodable = false) {
+    http_send_answer(http_if_none_match(request), response, answer, format, encodable);
+}
+
+/**
+ * @brief Create a completion handler sending the response of an asynchronous call
+ *
+ * The response writer is moved out of the reactor's handler, so the reactor serves other connections while the
+ * call waits for the device. Pistache queues the write to the reactor of the connection, so the response may be
+ * sent from any thread.
+ *
+ * @param request Received request
+ * @param response Response to send
+ * @param format Format of the response body
+ * @return Completion handler
+ */
+static rest_call_done http_async_answer(const Rest::Request &request, Http::ResponseWriter response,
+                                        rest_format format) {
+    auto writer = std::make_shared<Http::ResponseWriter>(std::move(response));
+    std::string if_none_match = http_if_none_match(request);
+    return [writer, if_none_match, format](const rest_response_info &answer) {
+        http_send_answer(if_none_match, *writer, answer, format);
+    };
+}
+
+/**
+ * @brief Client waiting for fired trigger events (see RiotsensorsHTTPProvider::handleEvents())
+ */
+struct http_event_waiter {
+    std::shared_ptr<Http::ResponseStream> stream;
+    /** @brief Sequence number of the last event sent */
+    uint64_t after;
+    /** @brief Time the response ends */
+    std::chrono::steady_clock::time_point deadline;
+};
+
+/**
+ * @brief Client receiving stored results as Server-Sent Events (see RiotsensorsHTTPProvider::handleStream())
+ */
+struct http_result_stream : std::enable_shared_from_this<http_result_stream> {
+    std::shared_ptr<Http::ResponseStream> stream;
+    /** @brief Queue of the results not yet sent, owned by the stream */
+    rs_stream *results;
+    /** @brief Time the response ends */
+    std::chrono::steady_clock::time_point deadline;
+    /** @brief Time a keepalive comment is due if nothing else was sent until then */
+    std::chrono::steady_clock::time_point keepalive;
+    /** @brief If the stream is waiting to be closed by the push loop */
+    bool closing;
+};
+
+/**
+ * @brief Event loop thread serving the responses that stay open, so they do not occupy a reactor thread
+ *
+ * The handlers hand their response streams over and return. Pistache queues every write to the reactor of the
+ * connection, so the loop writes to the streams from its own thread.
+ */
+struct http_push_loop {
+    RiotsensorsEventLoop loop;
+    /** @brief eventfd signalled when a response is handed over or a stream has to be closed */
+    int handover_fd;
+    /** @brief Guards new_waiters and new_streams */
+    std::mutex handover_lock;
+    /** @brief Responses handed over and not yet taken by the loop */
+    std::vector<http_event_waiter> new_waiters;
+    std::vector<std::shared_ptr<http_result_stream>> new_streams;
+    /** @brief Responses served by the loop, only accessed by its thread */
+    std::list<http_event_waiter> waiters;
+    std::list<std::shared_ptr<http_result_stream>> streams;
+    /** @brief Streams to be closed by the next run of http_take_handovers() */
+    std::vector<std::shared_ptr<http_result_stream>> closed;
+    /** @brief Timer ending the responses and sending the keepalives that are due first */
+    int deadline_timer;
+};
+
+/**
+ * @brief Send the events a client has not seen yet
+ *
+ * @param waiter Waiting client
+ * @return If the response can still be written to
+ */
+static bool http_write_events(http_event_waiter &waiter) {
+    rs_trigger_event events[RS_EVENTS_BATCH];
+    try {
+        size_t count;
+        bool written = false;
+        do {
+            count = rs_linux_read_events(waiter.after, events, RS_EVENTS_BATCH, 0);
+            for (size_t i = 0; i < count; i++) {
+                std::string line = assemble_event_rest(&events[i]);
+                line += '\n';
+                waiter.stream->write(line.c_str(), (std::streamsize) line.length());
+                waiter.after = events[i].seq;
+                written = true;
+            }
+        } while (count == RS_EVENTS_BATCH);
+        if (written) {
+            waiter.stream->flush();
+        }
+        return true;
+    } catch (std::exception &e) {
+        spt_log_msg("web", "Event stream closed: %s\n", e.what());
+        return false;
+    }
+}
+
+/**
+ * @brief End the response of a waiting client
+ *
+ * @param waiter Waiting client
+ */
+static void http_end_events(http_event_waiter &waiter) {
+    try {
+        waiter.stream->ends();
+    } catch (std::exception &e) {
+        spt_log_msg("web", "Event stream closed: %s\n", e.what());
+    }
+}
+
+/**
+ * @brief Send data on a result stream and postpone its keepalive
+ *
+ * @param s Result stream
+ * @param data Server-Sent Events
+ * @return If the response can still be written to
+ */
+static bool http_write_stream(http_result_stream *s, const std::string &data) {
+    try {
+        s->stream->write(data.c_str(), (std::streamsize) data.length());
+        s->stream->flush();
+    } catch (std::exception &e) {
+        spt_log_msg("web", "Result stream closed: %s\n", e.what());
+        return false;
+    }
+    s->keepalive = std::chrono::steady_clock::now() + std::chrono::milliseconds(RS_STREAM_KEEPALIVE);
+    return true;
+}
+
+/**
+ * @brief Make the push loop end and close a result stream, the handler of its descriptor must not remove it itself
+ *
+ * @param push Push loop
+ * @param s Result stream
+ */
+static void http_close_stream(http_push_loop *push, http_result_stream *s) {
+    if (s->closing) {
+        return;
+    }
+    s->closing = true;
+    push->closed.push_back(s->shared_from_this());
+    uint64_t one = 1;
+    ssize_t written = write(push->handover_fd, &one, sizeof(one));
+    (void) written;
+}
+
+/**
+ * @brief Arm the deadline timer for the earliest deadline or keepalive of the open responses
+ *
+ * @param push Push loop
+ */
+static void http_arm_deadline(http_push_loop *push) {
+    auto now = std::chrono::steady_clock::now();
+    auto earliest = std::chrono::steady_clock::time_point::max();
+    for (const http_event_waiter &waiter : push->waiters) {
+        earliest = std::min(earliest, waiter.deadline);
+    }
+    for (const std::shared_ptr<http_result_stream> &s : push->streams) {
+        if (!s->closing) {
+            earliest = std::min(earliest, std::min(s->deadline, s->keepalive));
+        }
+    }
+    if (earliest == std::chrono::steady_clock::time_point::max()) {
+        push->loop.armTimer(push->deadline_timer, 0);
+        return;
+    }
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(earliest - now);
+    // a delay of 0 would disarm the timer
+    push->loop.armTimer(push->deadline_timer, (uint32_t) std::max<long long>(delay.count() + 1, 1));
+}
+
+/**
+ * @brief End the responses whose deadline passed and send the keepalives that are due
+ *
+ * @param push Push loop
+ */
+static void http_expire_responses(http_push_loop *push) {
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = push->waiters.begin(); it != push->waiters.end();) {
+        if (it->deadline <= now) {
+            http_end_events(*it);
+            it = push->waiters.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const std::shared_ptr<http_result_stream> &s : push->streams) {
+        if (s->closing) {
+            continue;
+        }
+        if (s->deadline <= now) {
+            // EventSource clients reconnect on their own
+            http_close_stream(push, s.get());
+        } else if (s->keepalive <= now && !http_write_stream(s.get(), ": keepalive\n\n")) {
+            http_close_stream(push, s.get());
+        }
+    }
+    http_arm_deadline(push);
+}
+
+/**
+ * @brief Forward newly fired events to all waiting clients
+ *
+ * @param push Push loop
+ */
+static void http_forward_events(http_push_loop *push) {
+    // reset before reading, an event fired meanwhile signals the descriptor again
+    rs_linux_clear_events_fd();
+    for (auto it = push->waiters.begin(); it != push->waiters.end();) {
+        if (http_write_events(*it)) {
+            ++it;
+        } else {
+            it = push->waiters.erase(it);
+        }
+    }
+    http_arm_deadline(push);
+}
+
+/**
+ * @brief Send the queued results of a result stream
+ *
+ * @param push Push loop
+ * @param s Result stream
+ */
+static void http_forward_results(http_push_loop *push, http_result_stream *s) {
+    if (s->closing) {
+        return;
+    }
+    rs_stream_clear_fd(s->results);
+    rs_stream_update updates[RS_STREAM_BATCH];
+    size_t count;
+    std::string events;
+    while ((count = rs_stream_read(s->results, updates, RS_STREAM_BATCH, 0)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            events += "event: result\ndata: ";
+            events += assemble_stream_update_rest(&updates[i]);
+            events += "\n\n";
+            rs_stream_update_free(&updates[i]);
+        }
+    }
+    if ((!events.empty() && !http_write_stream(s, events)) || rs_stream_closed(s->results)) {
+        http_close_stream(push, s);
+    }
+    http_arm_deadline(push);
+}
+
+/**
+ * @brief Take the responses handed over by the handlers and close the streams that ended
+ *
+ * @param push Push loop
+ */
+static void http_take_handovers(http_push_loop *push) {
+    std::vector<http_event_waiter> waiters;
+    std::vector<std::shared_ptr<http_result_stream>> streams;
+    {
+        std::lock_guard<std::mutex> guard(push->handover_lock);
+        uint64_t count;
+        ssize_t r = read(push->handover_fd, &count, sizeof(count));
+        (void) r;
+        waiters.swap(push->new_waiters);
+        streams.swap(push->new_streams);
+    }
+    // events fired before are sent right away
+    auto now = std::chrono::steady_clock::now();
+    for (http_event_waiter &waiter : waiters) {
+        if (!http_write_events(waiter)) {
+            continue;
+        }
+        if (waiter.deadline <= now) {
+            http_end_events(waiter);
+        } else {
+            push->waiters.push_back(std::move(waiter));
+        }
+    }
+    for (const std::shared_ptr<http_result_stream> &s : streams) {
+        push->streams.push_back(s);
+        http_result_stream *stream = s.get();
+        // EventSource clients reconnect after this many milliseconds once the stream ends
+        if (!push->loop.add(rs_stream_fd(s->results), [push, stream]() { http_forward_results(push, stream); }) ||
+            !http_write_stream(stream, "retry: 1000\n\n")) {
+            http_close_stream(push, stream);
+        }
+    }
+    std::vector<std::shared_ptr<http_result_stream>> closed;
+    closed.swap(push->closed);
+    for (const std::shared_ptr<http_result_stream> &s : closed) {
+        push->loop.remove(rs_stream_fd(s->results));
+        try {
+            s->stream->ends();
+        } catch (std::exception &e) {
+            spt_log_msg("web", "Result stream closed: %s\n", e.what());
+        }
+        rs_linux_close_stream(s->results);
+        s->results = nullptr;
+        push->streams.remove(s);
+    }
+    http_arm_deadline(push);
+}
+
+/**
+ * @brief Hand a long poll of events over to the push loop, may be called from any thread
+ *
+ * @param push Push loop
+ * @param waiter Waiting client
+ */
+static void http_hand_over(http_push_loop *push, http_event_waiter waiter) {
+    std::lock_guard<std::mutex> guard(push->handover_lock);
+    push->new_waiters.push_back(std::move(waiter));
+    uint64_t one = 1;
+    ssize_t written = write(push->handover_fd, &one, sizeof(one));
+    (void) written;
+}
+
+/**
+ * @brief Hand a result stream over to the push loop, may be called from any thread
+ *
+ * @param push Push loop
+ * @param s Result stream
+ */
+static void http_hand_over(http_push_loop *push, std::shared_ptr<http_result_stream> s) {
+    std::lock_guard<std::mutex> guard(push->handover_lock);
+    push->new_streams.push_back(std::move(s));
+    uint64_t one = 1;
+    ssize_t written = write(push->handover_fd, &one, sizeof(one));
+    (void) written;
+}
+
+/**
+ * @brief Set up the descriptors and timers of the push loop before its thread is started
+ *
+ * @param push Push loop
+ * @return If the loop can serve responses
+ */
+static bool http_init_push_loop(http_push_loop *push) {
+    push->handover_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    push->deadline_timer = push->loop.addTimer([push]() { http_expire_responses(push); });
+    return push->handover_fd >= 0 && push->deadline_timer >= 0 &&
+           push->loop.add(push->handover_fd, [push]() { http_take_handovers(push); }) &&
+           push->loop.add(rs_linux_events_fd(), [push]() { http_forward_events(push); });
+}
+
 void RiotsensorsHTTPProvider::setServer(Http::Endpoint *server) {
     this->server = server;
 }
 
+void RiotsensorsHTTPProvider::setPushLoop(http_push_loop *push) {
+    this->push = push;
+}
+
 void RiotsensorsHTTPProvider::handleCallById(const Rest::Request &request, Http::ResponseWriter response) {
     std::string str_type = request.param(":type").as<std::string>();
     rs_lambda_type_t type = get_lambda_type_from_string(str_type.c_str());
     if (type == (rs_lambda_type_t) -1) {
         response.send(Http::Code::Bad_Request, "Unknown lambda type\n");
+        return;
     }
     auto int_id = request.param(":id").as<int>();
     if (int_id < 0) {
         response.send(Http::Code::Bad_Request, "Bad lambda id\n");
+        return;
     }
     auto id = (lambda_id_t) int_id;
-    auto m1 = MIME(Application, Json);
-    response.setMime(m1);
-    rest_response_info answer = RiotsensorsRESTHandler::handleCallById(type, id);
-    response.send(answer.first, answer.second);
+    auto query = request.query();
+    rest_fields fields;
+    const char *error = RiotsensorsRESTHandler::parseCallFields(query.get("fields").getOrElse(""),
+                                                                query.get("view").getOrElse(""), &fields);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
+    rest_format format;
+    if (!http_negotiate_format(request, response, &format)) {
+        return;
+    }
+    RiotsensorsRESTHandler::handleCallByIdAsync(type, id, format, fields,
+                                                http_async_answer(request, std::move(response), format));
 }
 
 void RiotsensorsHTTPProvider::handleCallByName(const Rest::Request &request, Http::ResponseWriter response) {
@@ -38,12 +664,67 @@ void RiotsensorsHTTPProvider::handleCallByName(const Rest::Request &request, Htt
     rs_lambda_type_t type = get_lambda_type_from_string(str_type.c_str());
     if (type == (rs_lambda_type_t) -1) {
         response.send(Http::Code::Bad_Request, "Unknown lambda type\n");
+        return;
     }
     std::string name = request.param(":name").as<std::string>();
-    auto m1 = MIME(Application, Json);
-    response.setMime(m1);
-    rest_response_info answer = RiotsensorsRESTHandler::handleCallByName(type, name);
-    response.send(answer.first, answer.second);
+    auto query = request.query();
+    rest_fields fields;
+    const char *error = RiotsensorsRESTHandler::parseCallFields(query.get("fields").getOrElse(""),
+                                                                query.get("view").getOrElse(""), &fields);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
+    rest_format format;
+    if (!http_negotiate_format(request, response, &format)) {
+        return;
+    }
+    RiotsensorsRESTHandler::handleCallByNameAsync(type, name, format, fields,
+                                                  http_async_answer(request, std::move(response), format));
+}
+
+void RiotsensorsHTTPProvider::handleLambda(const Rest::Request &request, Http::ResponseWriter response) {
+    std::string name = request.param(":name").as<std::string>();
+    auto query = request.query();
+    rest_fields fields;
+    const char *error = RiotsensorsRESTHandler::parseCallFields(query.get("fields").getOrElse(""),
+                                                                query.get("view").getOrElse(""), &fields);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
+    rest_format format;
+    if (!http_negotiate_format(request, response, &format)) {
+        return;
+    }
+    rs_registered_lambda lambda{};
+    if (!copy_registered_lambda_by_name(name.c_str(), &lambda)) {
+        // answered with the usual error of an unknown lambda
+        RiotsensorsRESTHandler::handleCallByNameAsync(0, name, format, fields,
+                                                      http_async_answer(request, std::move(response), format));
+        return;
+    }
+    RiotsensorsRESTHandler::handleCallByIdAsync(lambda.type, lambda.id, format, fields,
+                                                http_async_answer(request, std::move(response), format));
+}
+
+void RiotsensorsHTTPProvider::handleCallMulti(const Rest::Request &request, Http::ResponseWriter response) {
+    auto query = request.query();
+    std::vector<lambda_id_t> ids;
+    std::vector<rs_lambda_type_t> types;
+    const char *error = RiotsensorsRESTHandler::parseMultiParams(query.get("ids").getOrElse(""),
+                                                                 query.get("types").getOrElse(""),
+                                                                 query.get("name").getOrElse(""), &ids, &types);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
+    rest_format format;
+    if (!http_negotiate_format(request, response, &format)) {
+        return;
+    }
+    RiotsensorsRESTHandler::handleCallMultiAsync(ids, types, format,
+                                                 http_async_answer(request, std::move(response), format));
 }
 
 void RiotsensorsHTTPProvider::handleList(const Rest::Request &request, Http::ResponseWriter response) {
@@ -56,10 +737,19 @@ void RiotsensorsHTTPProvider::handleList(const Rest::Request &request, Http::Res
             return;
         }
     }
-    auto m1 = MIME(Application, Json);
-    response.setMime(m1);
-    rest_response_info answer = RiotsensorsRESTHandler::handleList(type);
-    response.send(answer.first, answer.second);
+    std::string name = request.query().get("name").getOrElse("");
+    const char *error = name.empty() ? nullptr : RiotsensorsRESTHandler::parseNamePattern(name);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
+    rest_format format;
+    if (!http_negotiate_format(request, response, &format)) {
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleList(type, name, format,
+                                                                  http_negotiate_encoding(request));
+    http_send_answer(request, response, answer, format, true);
 }
 
 void RiotsensorsHTTPProvider::handleCache(const Rest::Request &request, Http::ResponseWriter response) {
@@ -72,10 +762,136 @@ void RiotsensorsHTTPProvider::handleCache(const Rest::Request &request, Http::Re
             return;
         }
     }
+    std::string name = request.query().get("name").getOrElse("");
+    const char *error = name.empty() ? nullptr : RiotsensorsRESTHandler::parseNamePattern(name);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
+    rest_format format;
+    if (!http_negotiate_format(request, response, &format)) {
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleCache(type, name, format,
+                                                                  http_negotiate_encoding(request));
+    http_send_answer(request, response, answer, format, true);
+}
+
+/**
+ * @brief Parse the query parameters of a range query request
+ *
+ * @param request Received request
+ * @param params Where to store the parsed parameters
+ * @return nullptr on success, an error text otherwise
+ */
+static const char *http_parse_query_params(const Rest::Request &request, rest_query_params *params) {
+    auto query = request.query();
+    return RiotsensorsRESTHandler::parseQueryParams(query.get("op").getOrElse(""), query.get("from").getOrElse(""),
+                                                    query.get("to").getOrElse(""), query.get("last").getOrElse(""),
+                                                    query.get("q").getOrElse(""), params);
+}
+
+void RiotsensorsHTTPProvider::handleQueryById(const Rest::Request &request, Http::ResponseWriter response) {
+    auto int_id = request.param(":id").as<int>();
+    if (int_id < 0) {
+        response.send(Http::Code::Bad_Request, "Bad lambda id\n");
+        return;
+    }
+    rest_query_params params{};
+    const char *error = http_parse_query_params(request, &params);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
+    rest_format format;
+    if (!http_negotiate_format(request, response, &format)) {
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleQueryById((lambda_id_t) int_id, params, format);
+    http_send_answer(request, response, answer, format);
+}
+
+void RiotsensorsHTTPProvider::handleQueryByName(const Rest::Request &request, Http::ResponseWriter response) {
+    std::string name = request.param(":name").as<std::string>();
+    rest_query_params params{};
+    const char *error = http_parse_query_params(request, &params);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
+    rest_format format;
+    if (!http_negotiate_format(request, response, &format)) {
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleQueryByName(name, params, format);
+    http_send_answer(request, response, answer, format);
+}
+
+void RiotsensorsHTTPProvider::handleEvents(const Rest::Request &request, Http::ResponseWriter response) {
+    auto query = request.query();
+    uint64_t after;
+    uint32_t wait_ms;
+    const char *error = RiotsensorsRESTHandler::parseEventParams(query.get("after").getOrElse(""),
+                                                                 query.get("wait").getOrElse(""), &after, &wait_ms);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
     auto m1 = MIME(Application, Json);
     response.setMime(m1);
-    rest_response_info answer = RiotsensorsRESTHandler::handleCache(type);
-    response.send(answer.first, answer.second);
+    response.headers().add<Http::Header::CacheControl>(Http::CacheDirective(Http::CacheDirective::NoStore));
+    http_event_waiter waiter;
+    waiter.stream = std::make_shared<Http::ResponseStream>(response.stream(Http::Code::Ok));
+    waiter.after = after;
+    waiter.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(wait_ms);
+    http_hand_over(push, std::move(waiter));
+}
+
+void RiotsensorsHTTPProvider::handleStream(const Rest::Request &request, Http::ResponseWriter response) {
+    auto query = request.query();
+    uint8_t ids[(MAX_LAMBDAS + 7) / 8];
+    bool all_ids;
+    rs_lambda_type_t type;
+    const char *error = RiotsensorsRESTHandler::parseStreamParams(query.get("ids").getOrElse(""),
+                                                                  query.get("type").getOrElse(""), ids, &all_ids,
+                                                                  &type);
+    if (error != nullptr) {
+        response.send(Http::Code::Bad_Request, std::string(error) + "\n");
+        return;
+    }
+    rs_stream *results = rs_linux_open_stream(all_ids ? nullptr : ids, type);
+    if (results == nullptr) {
+        response.send(Http::Code::Service_Unavailable, "Too many open streams\n");
+        return;
+    }
+    spt_log_msg("web", "Streaming results to a client...\n");
+    // Pistache has no constant for the event stream subtype
+    response.setMime(Http::Mime::MediaType::fromString("text/event-stream"));
+    response.headers().add<Http::Header::CacheControl>(Http::CacheDirective(Http::CacheDirective::NoCache));
+    auto s = std::make_shared<http_result_stream>();
+    s->stream = std::make_shared<Http::ResponseStream>(response.stream(Http::Code::Ok));
+    s->results = results;
+    s->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RS_STREAM_MAX_DURATION);
+    s->keepalive = s->deadline;
+    s->closing = false;
+    http_hand_over(push, s);
+}
+
+void RiotsensorsHTTPProvider::handleStats(const Rest::Request &request, Http::ResponseWriter response) {
+    rest_format format;
+    if (!http_negotiate_format(request, response, &format)) {
+        return;
+    }
+    rest_response_info answer = RiotsensorsRESTHandler::handleStats(format);
+    http_send_answer(request, response, answer, format);
+}
+
+void RiotsensorsHTTPProvider::handleMetrics(const Rest::Request &request, Http::ResponseWriter response) {
+    UNUSED(request);
+    rest_response_info answer = RiotsensorsRESTHandler::handleMetrics();
+    response.setMime(Http::Mime::MediaType::fromString(RS_PROMETHEUS_MEDIA_TYPE));
+    response.headers().add<Http::Header::CacheControl>(Http::CacheDirective(Http::CacheDirective::NoStore));
+    response.send(answer.code, answer.body->data(), answer.body->size());
 }
 
 void RiotsensorsHTTPProvider::handleKill(const Rest::Request &request, Http::ResponseWriter response) {
@@ -95,21 +911,57 @@ void *startHTTPServer(void *thread_ctx) {
                       Rest::Routes::bind(&RiotsensorsHTTPProvider::handleCallById, &provider));
     Rest::Routes::Get(router, "/v1/call/name/:type/:name",
                       Rest::Routes::bind(&RiotsensorsHTTPProvider::handleCallByName, &provider));
+    Rest::Routes::Get(router, "/v1/lambda/:name",
+                      Rest::Routes::bind(&RiotsensorsHTTPProvider::handleLambda, &provider));
+    Rest::Routes::Get(router, "/v1/call/multi",
+                      Rest::Routes::bind(&RiotsensorsHTTPProvider::handleCallMulti, &provider));
     Rest::Routes::Get(router, "/v1/list", Rest::Routes::bind(&RiotsensorsHTTPProvider::handleList, &provider));
     Rest::Routes::Get(router, "/v1/showcache", Rest::Routes::bind(&RiotsensorsHTTPProvider::handleCache, &provider));
+    Rest::Routes::Get(router, "/v1/query/id/:id",
+                      Rest::Routes::bind(&RiotsensorsHTTPProvider::handleQueryById, &provider));
+    Rest::Routes::Get(router, "/v1/query/name/:name",
+                      Rest::Routes::bind(&RiotsensorsHTTPProvider::handleQueryByName, &provider));
+    Rest::Routes::Get(router, "/v1/events", Rest::Routes::bind(&RiotsensorsHTTPProvider::handleEvents, &provider));
+    Rest::Routes::Get(router, "/v1/stream", Rest::Routes::bind(&RiotsensorsHTTPProvider::handleStream, &provider));
+    Rest::Routes::Get(router, "/v1/stats", Rest::Routes::bind(&RiotsensorsHTTPProvider::handleStats, &provider));
+    Rest::Routes::Get(router, "/v1/metrics",
+                      Rest::Routes::bind(&RiotsensorsHTTPProvider::handleMetrics, &provider));
     Rest::Routes::Get(router, "/v1/kill", Rest::Routes::bind(&RiotsensorsHTTPProvider::handleKill, &provider));
 
     Address addr(Ipv4::any(), Port(arguments->http_port));
     auto opts = Http::Endpoint::options();
-    opts.threads(1);
+    opts.threads((int) arguments->http_threads);
     opts.flags(Tcp::Options::InstallSignalHandler);
 
+    http_push_loop push;
+    if (!push.loop.valid() || !http_init_push_loop(&push)) {
+        fprintf(stderr, "Could not create the event loop of the HTTP server\n");
+        exit(EXIT_FAILURE);
+    }
+    std::thread push_thread([&push]() { push.loop.run(); });
+
     Http::Endpoint server(addr);
     server.init(opts);
     server.setHandler(router.handler());
     provider.setServer(&server);
+    provider.setPushLoop(&push);
 
     server.serve();
 
     server.shutdown();
+    push.loop.stop();
+    push_thread.join();
+    // the responses still open are dropped with the connections of the endpoint
+    push.waiters.clear();
+    push.new_waiters.clear();
+    push.closed.clear();
+    for (const std::shared_ptr<http_result_stream> &s : push.streams) {
+        rs_linux_close_stream(s->results);
+    }
+    for (const std::shared_ptr<http_result_stream> &s : push.new_streams) {
+        rs_linux_close_stream(s->results);
+    }
+    push.streams.clear();
+    push.new_streams.clear();
+    close(push.handover_fd);
 }
@@ -0,0 +1,638 @@
+/*
+ *  riotsensors - RIOT-OS module for sensor data transfers
+ *
+ *  Copyright (C) 2017 Patrick Grosse <patrick.grosse@uni-muenster.de>
+ */
+
+#include <rs_server_unix.h>
+
+#include <unused.h>
+#include <lambda_registry.h>
+#include <rs_connector.h>
+#include <rs_event_loop.h>
+#include <rs_rest.h>
+#include <spt_logger.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+/** @brief Maximum number of bytes read from a connection at once */
+#define RS_UNIX_READ_SIZE 16384
+
+struct unix_server;
+
+/**
+ * @brief Answer of a request, the answers of a connection are sent in the order of the requests
+ */
+struct unix_answer {
+    /** @brief If the answer is complete, guarded by the answer_lock of the server */
+    bool ready;
+    /** @brief Answer without the length prefix, complete once ready */
+    std::string packet;
+};
+
+/**
+ * @brief A connected client, only accessed by the server thread except for the answers of its calls
+ */
+struct unix_connection : std::enable_shared_from_this<unix_connection> {
+    /** @brief Server of the connection, kept alive by calls still pending after the server stopped */
+    std::shared_ptr<unix_server> server;
+    int fd;
+    /** @brief Received bytes not forming a complete request yet */
+    std::string input;
+    /** @brief Answers of the requests in the order of the requests, the first ones may be ready to be sent */
+    std::deque<std::shared_ptr<unix_answer>> answers;
+    /** @brief Framed answers and the number of their bytes already sent */
+    std::string output;
+    size_t sent;
+    /** @brief If the connection is watched for being readable and writable */
+    bool reading;
+    bool writing;
+    /** @brief If the client shut down its side, the connection is closed once all answers are sent */
+    bool eof;
+    /** @brief If the connection is waiting to be closed by the server thread */
+    bool closing;
+};
+
+/**
+ * @brief The server thread with its listening socket and event loop
+ */
+struct unix_server {
+    RiotsensorsEventLoop loop;
+    int listen_fd;
+    /** @brief Connections by their descriptor */
+    std::unordered_map<int, std::shared_ptr<unix_connection>> connections;
+    /** @brief Connections to be closed by the next run of unix_handle_answers() */
+    std::vector<std::shared_ptr<unix_connection>> closed;
+    /**
+     * @brief Connections with answers completed by other threads and the eventfd waking up the server thread, both
+     * guarded by answer_lock
+     */
+    std::vector<std::shared_ptr<unix_connection>> answered;
+    int answer_fd;
+    std::mutex answer_lock;
+};
+
+/**
+ * @brief A call waiting for the connector
+ */
+struct unix_call {
+    std::shared_ptr<unix_connection> connection;
+    std::shared_ptr<unix_answer> answer;
+    /** @brief ID of the lambda, only used if it is called by ID */
+    lambda_id_t id;
+    /** @brief Name of the lambda, empty if it is called by ID */
+    std::string name;
+    /** @brief Expected type, the type of the result if the call succeeds */
+    rs_lambda_type_t type;
+};
+
+/**
+ * Running server and if the server is stopping, guarded by unix_server_lock for stopUnixServer()
+ */
+static std::shared_ptr<unix_server> unix_running;
+static bool unix_stopping = false;
+static std::mutex unix_server_lock;
+
+/**
+ * If the current thread is the server thread, the connector completes a call on it only while it is made
+ */
+static thread_local bool unix_server_thread = false;
+
+/**
+ * @brief Copy a lambda name into the name field of a packet
+ *
+ * @param dst Name field of MAX_LAMBDA_NAME_LENGTH characters
+ * @param src Name, NUL-terminated or MAX_LAMBDA_NAME_LENGTH characters long
+ */
+static void unix_copy_name(char *dst, const char *src) {
+    size_t length = strnlen(src, MAX_LAMBDA_NAME_LENGTH);
+    memcpy(dst, src, length);
+    memset(dst + length, 0, MAX_LAMBDA_NAME_LENGTH - length);
+}
+
+/**
+ * @brief Fill the common part of a result packet
+ *
+ * @param pkt Result packet
+ * @param ptype RS_PACKET_RESULT_* type
+ * @param id ID of the lambda
+ * @param name Name of the lambda
+ */
+static void unix_result_base(rs_packet_lambda_result_t *pkt, rs_packet_type_t ptype, lambda_id_t id,
+                             const char *name) {
+    pkt->base.ptype = ptype;
+    pkt->lambda_id = id;
+    unix_copy_name(pkt->name, name);
+}
+
+/**
+ * @brief Append the result packet of a call to an answer
+ *
+ * @param packet Answer
+ * @param id ID of the lambda
+ * @param name Name of the lambda
+ * @param type Type of the lambda
+ * @param res A RS_CALL_* constant
+ * @param result Result of the call if res is RS_CALL_SUCCESS, RS_CALL_CACHE or RS_CALL_CACHE_TIMEOUT
+ */
+static void unix_append_result(std::string *packet, lambda_id_t id, const char *name, rs_lambda_type_t type,
+                               int8_t res, const generic_lambda_return *result) {
+    bool has_result = res == RS_CALL_SUCCESS || res == RS_CALL_CACHE || res == RS_CALL_CACHE_TIMEOUT;
+    if (has_result && type == RS_LAMBDA_INT) {
+        rs_packet_lambda_result_int_t pkt{};
+        unix_result_base(&pkt.result_base, RS_PACKET_RESULT_INT, id, name);
+        pkt.result = result->ret_i;
+        hton_rs_packet_lambda_result_int_t(&pkt);
+        packet->append((const char *) &pkt, sizeof(pkt));
+    } else if (has_result && type == RS_LAMBDA_DOUBLE) {
+        rs_packet_lambda_result_double_t pkt{};
+        unix_result_base(&pkt.result_base, RS_PACKET_RESULT_DOUBLE, id, name);
+        pkt.result = result->ret_d;
+        hton_rs_packet_lambda_result_double_t(&pkt);
+        packet->append((const char *) &pkt, sizeof(pkt));
+    } else if (has_result && type == RS_LAMBDA_STRING) {
+        // the length includes the terminating NUL like the packets of the device
+        const char *value = result->ret_s != nullptr ? result->ret_s : "";
+        size_t length = std::min(strlen(value) + 1, (size_t) UINT16_MAX);
+        rs_packet_lambda_result_string_t pkt{};
+        unix_result_base(&pkt.result_base, RS_PACKET_RESULT_STRING, id, name);
+        pkt.result_length = (uint16_t) length;
+        hton_rs_packet_lambda_result_string_t(&pkt);
+        packet->append((const char *) &pkt, sizeof(pkt) - sizeof(pkt.result));
+        packet->append(value, length - 1);
+        *packet += '\0';
+    } else {
+        rs_packet_lambda_result_error_t pkt{};
+        unix_result_base(&pkt.result_base, RS_PACKET_RESULT_ERROR, id, name);
+        pkt.error_code = has_result ? (int8_t) RS_CALL_WRONGTYPE : res;
+        hton_rs_packet_lambda_result_error_t(&pkt);
+        packet->append((const char *) &pkt, sizeof(pkt));
+    }
+}
+
+/**
+ * @brief Answer a RS_UNIX_PACKET_LIST or RS_UNIX_PACKET_CACHE request
+ *
+ * @param ptype Type of the request
+ * @param type Type of the selected lambdas, 0 for all types
+ * @param pattern Name pattern of the selected lambdas, empty for all lambdas
+ * @param packet Where to store the answer
+ * @return If the request is valid
+ */
+static bool unix_select(rs_packet_type_t ptype, rs_lambda_type_t type, const std::string &pattern,
+                        std::string *packet) {
+    if (type > RS_LAMBDA_STRING ||
+        (!pattern.empty() && RiotsensorsRESTHandler::parseNamePattern(pattern) != nullptr)) {
+        return false;
+    }
+    rs_unix_packet_selection_t header{};
+    header.base.ptype = ptype;
+    packet->assign(sizeof(header), '\0');
+    uint16_t count = 0;
+    std::vector<lambda_id_t> ids;
+    rs_linux_lock_registry();
+    if (pattern.empty()) {
+        for (lambda_id_t i = 0; i < get_number_of_registered_lambdas(); i++) {
+            ids.push_back(i);
+        }
+    } else {
+        select_lambdas_by_name(pattern, &ids);
+    }
+    for (lambda_id_t id : ids) {
+        rs_registered_lambda *lambda = get_registered_lambda_by_id(id);
+        if (lambda == nullptr || (type != 0 && lambda->type != type)) {
+            continue;
+        }
+        count++;
+        if (ptype == RS_UNIX_PACKET_LIST) {
+            rs_unix_list_entry_t entry{};
+            entry.lambda_id = lambda->id;
+            entry.lambda.base.ptype = RS_PACKET_REGISTERED;
+            unix_copy_name(entry.lambda.name, lambda->name);
+            entry.lambda.ltype = lambda->type;
+            entry.lambda.cache = lambda->cache;
+            hton_rs_packet_registered_t(&entry.lambda);
+            packet->append((const char *) &entry, sizeof(entry));
+        } else {
+            auto arg = (rs_linux_registered_lambda *) lambda->arg.obj;
+            unix_append_result(packet, lambda->id, lambda->name, lambda->type,
+                               arg->data_cached ? (int8_t) RS_CALL_CACHE : (int8_t) RS_CALL_CACHE_EMPTY, &arg->ret);
+        }
+    }
+    rs_linux_unlock_registry();
+    header.count = htons(count);
+    memcpy(&(*packet)[0], &header, sizeof(header));
+    return true;
+}
+
+/**
+ * @brief Complete the answer of a call (rs_call_callback)
+ */
+static void unix_complete_call(int8_t res, generic_lambda_return *result, uint32_t version, void *ctx) {
+    UNUSED(version);
+    std::unique_ptr<unix_call> call((unix_call *) ctx);
+    rs_registered_lambda copy{};
+    bool found = call->name.empty() ? copy_registered_lambda_by_id(call->id, &copy)
+                                    : copy_registered_lambda_by_name(call->name.c_str(), &copy);
+    std::string packet;
+    unix_append_result(&packet, found ? copy.id : call->id, found ? copy.name : call->name.c_str(), call->type, res,
+                       result);
+    if ((res == RS_CALL_SUCCESS || res == RS_CALL_CACHE || res == RS_CALL_CACHE_TIMEOUT) &&
+        call->type == RS_LAMBDA_STRING) {
+        free(result->ret_s);
+    }
+    unix_server *s = call->connection->server.get();
+    std::lock_guard<std::mutex> guard(s->answer_lock);
+    call->answer->packet.swap(packet);
+    call->answer->ready = true;
+    if (unix_server_thread || s->answer_fd < 0) {
+        // completed inline and sent once the received requests are handled, or the server stopped
+        return;
+    }
+    bool wake = s->answered.empty();
+    s->answered.push_back(call->connection);
+    if (wake) {
+        uint64_t one = 1;
+        ssize_t written = write(s->answer_fd, &one, sizeof(one));
+        UNUSED(written);
+    }
+}
+
+/**
+ * @brief Call a lambda, the answer is completed by unix_complete_call()
+ *
+ * @param c Connection
+ * @param answer Answer of the request
+ * @param id ID of the lambda, only used if name is empty
+ * @param name Name of the lambda, empty to call it by ID
+ * @param type Expected type
+ */
+static void unix_call_lambda(unix_connection *c, const std::shared_ptr<unix_answer> &answer, lambda_id_t id,
+                             std::string name, rs_lambda_type_t type) {
+    auto call = new unix_call{c->shared_from_this(), answer, id, std::move(name), type};
+    if (call->name.empty()) {
+        call_lambda_by_id_async(id, type, unix_complete_call, call);
+    } else {
+        call_lambda_by_name_async(call->name.c_str(), type, unix_complete_call, call);
+    }
+}
+
+/**
+ * @brief Handle a request, its answer is queued behind the answers of the earlier requests
+ *
+ * @param c Connection
+ * @param frame Request without the length prefix
+ * @param length Length of the request
+ */
+static void unix_handle_request(unix_connection *c, const char *frame, size_t length) {
+    auto answer = std::make_shared<unix_answer>();
+    answer->ready = false;
+    c->answers.push_back(answer);
+    rs_packet_type_t ptype = length > 0 ? (rs_packet_type_t) frame[0] : (rs_packet_type_t) 0;
+    if (ptype == RS_PACKET_CALL_BY_ID && length == sizeof(rs_packet_call_by_id_t)) {
+        rs_packet_call_by_id_t pkt;
+        memcpy(&pkt, frame, sizeof(pkt));
+        ntoh_rs_packet_call_by_id_t(&pkt);
+        unix_call_lambda(c, answer, pkt.lambda_id, std::string(), pkt.expected_type);
+        return;
+    }
+    if (ptype == RS_PACKET_CALL_BY_NAME && length == sizeof(rs_packet_call_by_name_t)) {
+        rs_packet_call_by_name_t pkt;
+        memcpy(&pkt, frame, sizeof(pkt));
+        ntoh_rs_packet_call_by_name_t(&pkt);
+        std::string name(pkt.name, strnlen(pkt.name, sizeof(pkt.name)));
+        if (!name.empty()) {
+            unix_call_lambda(c, answer, 0, name, pkt.expected_type);
+            return;
+        }
+    } else if ((ptype == RS_UNIX_PACKET_LIST || ptype == RS_UNIX_PACKET_CACHE) &&
+               length >= sizeof(rs_unix_packet_select_t)) {
+        rs_unix_packet_select_t pkt;
+        memcpy(&pkt, frame, sizeof(pkt));
+        std::string pattern(frame + sizeof(pkt), length - sizeof(pkt));
+        if (unix_select(ptype, pkt.type, pattern, &answer->packet)) {
+            answer->ready = true;
+            return;
+        }
+    }
+    answer->packet.clear();
+    unix_append_result(&answer->packet, 0, "", 0, RS_UNIX_INVALID_REQUEST, nullptr);
+    answer->ready = true;
+}
+
+/**
+ * @brief Check if a connection has so many unsent answers that no further requests are read
+ *
+ * @param c Connection
+ * @return If the connection is backlogged
+ */
+static bool unix_backlogged(const unix_connection *c) {
+    return c->answers.size() >= RS_UNIX_MAX_PIPELINE || c->output.length() - c->sent >= RS_UNIX_MAX_BACKLOG;
+}
+
+/**
+ * @brief Make the server thread close a connection, the handlers of a descriptor must not remove it themselves
+ *
+ * @param c Connection
+ */
+static void unix_close(unix_connection *c) {
+    if (c->closing) {
+        return;
+    }
+    c->closing = true;
+    unix_server *s = c->server.get();
+    s->closed.push_back(c->shared_from_this());
+    uint64_t one = 1;
+    ssize_t written = write(s->answer_fd, &one, sizeof(one));
+    UNUSED(written);
+}
+
+/**
+ * @brief Handle the complete requests received on a connection unless it is backlogged
+ *
+ * @param c Connection
+ * @return Number of handled requests
+ */
+static size_t unix_handle_requests(unix_connection *c) {
+    size_t pos = 0;
+    size_t handled = 0;
+    while (!unix_backlogged(c) && c->input.length() - pos >= sizeof(uint32_t)) {
+        uint32_t length;
+        memcpy(&length, c->input.data() + pos, sizeof(length));
+        length = ntohl(length);
+        if (length > RS_UNIX_MAX_FRAME) {
+            spt_log_msg("unix", "Closing connection sending a frame of %u bytes\n", length);
+            unix_close(c);
+            return handled;
+        }
+        if (c->input.length() - pos - sizeof(length) < length) {
+            break;
+        }
+        unix_handle_request(c, c->input.data() + pos + sizeof(length), length);
+        pos += sizeof(length) + length;
+        handled++;
+    }
+    c->input.erase(0, pos);
+    return handled;
+}
+
+/**
+ * @brief Send the answers of a connection that are ready, stopping at the first one that is not
+ *
+ * @param c Connection
+ */
+static void unix_send(unix_connection *c) {
+    {
+        std::lock_guard<std::mutex> guard(c->server->answer_lock);
+        while (!c->answers.empty() && c->answers.front()->ready) {
+            const std::string &packet = c->answers.front()->packet;
+            uint32_t length = htonl((uint32_t) packet.length());
+            c->output.append((const char *) &length, sizeof(length));
+            c->output += packet;
+            c->answers.pop_front();
+        }
+    }
+    while (c->sent < c->output.length()) {
+        ssize_t written = send(c->fd, c->output.data() + c->sent, c->output.length() - c->sent,
+                               MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (written <= 0) {
+            unix_close(c);
+            return;
+        }
+        c->sent += (size_t) written;
+    }
+    if (c->sent == c->output.length()) {
+        c->output.clear();
+        c->sent = 0;
+    }
+}
+
+/**
+ * @brief Handle the received requests and send the ready answers until neither makes progress, then watch the
+ * connection for the events it waits for
+ *
+ * @param c Connection
+ */
+static void unix_serve(unix_connection *c) {
+    if (c->closing) {
+        return;
+    }
+    // sent answers may make room for further requests of a backlogged connection
+    do {
+        unix_send(c);
+    } while (!c->closing && unix_handle_requests(c) > 0);
+    if (c->closing) {
+        return;
+    }
+    if (c->eof && c->answers.empty() && c->output.empty()) {
+        unix_close(c);
+        return;
+    }
+    bool reading = !c->eof && !unix_backlogged(c);
+    bool writing = !c->output.empty();
+    if (reading == c->reading && writing == c->writing) {
+        return;
+    }
+    RiotsensorsEventLoop::handler on_writable = nullptr;
+    if (writing) {
+        on_writable = [c]() { unix_serve(c); };
+    }
+    if (c->server->loop.modify(c->fd, reading, on_writable)) {
+        c->reading = reading;
+        c->writing = writing;
+    }
+}
+
+/**
+ * @brief Read the requests of a connection
+ *
+ * @param c Connection
+ */
+static void unix_read(unix_connection *c) {
+    if (c->closing) {
+        return;
+    }
+    if (c->eof) {
+        // not watched for being readable anymore, the client hung up while answers were pending
+        unix_close(c);
+        return;
+    }
+    char buf[RS_UNIX_READ_SIZE];
+    ssize_t length = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (length > 0) {
+        c->input.append(buf, (size_t) length);
+    } else if (length == 0) {
+        c->eof = true;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        unix_close(c);
+        return;
+    }
+    unix_serve(c);
+}
+
+/**
+ * @brief Send the answers completed by other threads and close the connections waiting for it
+ *
+ * @param s Server
+ */
+static void unix_handle_answers(unix_server *s) {
+    std::vector<std::shared_ptr<unix_connection>> answered;
+    {
+        std::lock_guard<std::mutex> guard(s->answer_lock);
+        uint64_t count;
+        ssize_t r = read(s->answer_fd, &count, sizeof(count));
+        UNUSED(r);
+        answered.swap(s->answered);
+    }
+    for (const std::shared_ptr<unix_connection> &c : answered) {
+        if (!c->closing) {
+            unix_serve(c.get());
+        }
+    }
+    std::vector<std::shared_ptr<unix_connection>> closed;
+    closed.swap(s->closed);
+    for (const std::shared_ptr<unix_connection> &c : closed) {
+        s->loop.remove(c->fd);
+        s->connections.erase(c->fd);
+        close(c->fd);
+        c->fd = -1;
+    }
+}
+
+/**
+ * @brief Accept the waiting clients
+ *
+ * @param self Server, shared with its connections
+ */
+static void unix_accept(const std::shared_ptr<unix_server> &self) {
+    unix_server *s = self.get();
+    int fd;
+    while ((fd = accept4(s->listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        auto c = std::make_shared<unix_connection>();
+        c->server = self;
+        c->fd = fd;
+        c->sent = 0;
+        c->reading = true;
+        c->writing = false;
+        c->eof = false;
+        c->closing = false;
+        unix_connection *conn = c.get();
+        if (!s->loop.add(fd, [conn]() { unix_read(conn); })) {
+            close(fd);
+            continue;
+        }
+        s->connections[fd] = c;
+    }
+}
+
+/**
+ * @brief Create the listening socket
+ *
+ * @param path Path of the socket, a socket file left by an earlier run is replaced
+ * @return The socket, -1 on failure
+ */
+static int unix_listen(const char *path) {
+    struct sockaddr_un addr{};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    struct stat st{};
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (bind(fd, (const struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void stopUnixServer() {
+    std::lock_guard<std::mutex> guard(unix_server_lock);
+    // a server still starting stops right away
+    unix_stopping = true;
+    if (unix_running) {
+        unix_running->loop.stop();
+    }
+}
+
+void *startUnixServer(void *thread_ctx) {
+    auto arguments = (struct riotsensors_start_opts *) thread_ctx;
+    {
+        std::lock_guard<std::mutex> guard(unix_server_lock);
+        unix_stopping = false;
+    }
+    auto s = std::make_shared<unix_server>();
+    s->listen_fd = unix_listen(arguments->unix_path);
+    if (s->listen_fd < 0) {
+        fprintf(stderr, "Could not bind the binary server to %s\n", arguments->unix_path);
+        exit(EXIT_FAILURE);
+    }
+    s->answer_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    unix_server *server = s.get();
+    std::shared_ptr<unix_server> self = s;
+    if (!s->loop.valid() || s->answer_fd < 0 || !s->loop.add(s->listen_fd, [self]() { unix_accept(self); }) ||
+        !s->loop.add(s->answer_fd, [server]() { unix_handle_answers(server); })) {
+        fprintf(stderr, "Could not create the event loop of the binary server\n");
+        exit(EXIT_FAILURE);
+    }
+    {
+        std::lock_guard<std::mutex> guard(unix_server_lock);
+        unix_running = s;
+        if (unix_stopping) {
+            s->loop.stop();
+        }
+    }
+    unix_server_thread = true;
+
+    s->loop.run();
+    {
+        std::lock_guard<std::mutex> guard(unix_server_lock);
+        unix_running.reset();
+    }
+    unix_server_thread = false;
+    {
+        // calls still pending keep the server alive and are completed by the connector without an answer
+        std::lock_guard<std::mutex> guard(s->answer_lock);
+        s->loop.remove(s->answer_fd);
+        close(s->answer_fd);
+        s->answer_fd = -1;
+        s->answered.clear();
+    }
+    for (auto &connection : s->connections) {
+        s->loop.remove(connection.first);
+        close(connection.first);
+        connection.second->fd = -1;
+        connection.second->closing = true;
+    }
+    s->connections.clear();
+    s->closed.clear();
+    s->loop.remove(s->listen_fd);
+    close(s->listen_fd);
+    unlink(arguments->unix_path);
+    return nullptr;
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <rs_coap_query.h>
+
+/**
+ * @brief Match a NUL-terminated option
+ */
+static bool match(const char *option, coap_query_param *params, size_t count) {
+    return coap_query_match((const uint8_t *) option, strlen(option), params, count);
+}
+
+TEST(rs_coap_query, match) {
+    coap_query_param params[] = {coap_query_param("type"), coap_query_param("name"), coap_query_param("q")};
+    ASSERT_TRUE(match("name=temp", params, 3));
+    ASSERT_FALSE(params[0].found);
+    ASSERT_TRUE(params[1].found);
+    ASSERT_EQ(params[1].str(), "temp");
+    ASSERT_EQ(params[1].length, 4u);
+    // keys only match as a whole
+    ASSERT_FALSE(match("types=1", params, 3));
+    ASSERT_FALSE(match("typ=1", params, 3));
+    ASSERT_FALSE(match("quantile=0.5", params, 3));
+    ASSERT_FALSE(params[0].found);
+    ASSERT_FALSE(params[2].found);
+    // the value is split at the first '='
+    ASSERT_TRUE(match("q=a=b", params, 3));
+    ASSERT_EQ(params[2].str(), "a=b");
+    // an option without '=' has an empty value, an empty value is found as well
+    ASSERT_TRUE(match("type", params, 3));
+    ASSERT_TRUE(params[0].found);
+    ASSERT_EQ(params[0].length, 0u);
+    ASSERT_EQ(params[0].str(), "");
+    // a repeated key overwrites the earlier value
+    ASSERT_TRUE(match("name=", params, 3));
+    ASSERT_TRUE(params[1].found);
+    ASSERT_EQ(params[1].str(), "");
+    ASSERT_TRUE(match("name=hum", params, 3));
+    ASSERT_EQ(params[1].str(), "hum");
+    ASSERT_FALSE(match("", params, 3));
+}
+
+TEST(rs_coap_query, match_not_terminated) {
+    // option values are not NUL-terminated in the request
+    const char request[] = "type=1name=temp";
+    coap_query_param params[] = {coap_query_param("type"), coap_query_param("name")};
+    ASSERT_TRUE(coap_query_match((const uint8_t *) request, 6, params, 2));
+    ASSERT_TRUE(coap_query_match((const uint8_t *) request + 6, 9, params, 2));
+    ASSERT_EQ(params[0].str(), "1");
+    ASSERT_EQ(params[1].str(), "temp");
+    coap_query_param name("name");
+    ASSERT_FALSE(coap_query_match((const uint8_t *) request + 6, 3, &name, 1));
+}
+
+TEST(rs_coap_query, values) {
+    coap_query_param id("id");
+    unsigned long number = 0;
+    char buf[4];
+    ASSERT_FALSE(id.toUnsigned(&number, 255));
+    ASSERT_EQ(id.str(), "");
+    ASSERT_TRUE(match("id=42", &id, 1));
+    ASSERT_TRUE(id.toUnsigned(&number, 255));
+    ASSERT_EQ(number, 42u);
+    ASSERT_TRUE(id.copy(buf, sizeof(buf)));
+    ASSERT_STREQ(buf, "42");
+    ASSERT_TRUE(match("id=255", &id, 1));
+    ASSERT_TRUE(id.toUnsigned(&number, 255));
+    ASSERT_EQ(number, 255u);
+    ASSERT_FALSE(id.copy(buf, 3));
+    ASSERT_TRUE(match("id=256", &id, 1));
+    ASSERT_FALSE(id.toUnsigned(&number, 255));
+    ASSERT_TRUE(match("id=99999999999999999999999", &id, 1));
+    ASSERT_FALSE(id.toUnsigned(&number, 255));
+    ASSERT_TRUE(match("id=-1", &id, 1));
+    ASSERT_FALSE(id.toUnsigned(&number, 255));
+    ASSERT_TRUE(match("id=4x", &id, 1));
+    ASSERT_FALSE(id.toUnsigned(&number, 255));
+    ASSERT_TRUE(match("id=", &id, 1));
+    ASSERT_FALSE(id.toUnsigned(&number, 255));
+    ASSERT_EQ(number, 255u);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <rs_event_loop.h>
+
+TEST(rs_event_loop, readable_descriptors) {
+    RiotsensorsEventLoop loop;
+    ASSERT_TRUE(loop.valid());
+    int fd = eventfd(0, EFD_NONBLOCK);
+    int calls = 0;
+    ASSERT_TRUE(loop.add(fd, [&]() {
+        uint64_t value;
+        ASSERT_EQ(read(fd, &value, sizeof(value)), (ssize_t) sizeof(value));
+        ASSERT_EQ(value, 3u);
+        calls++;
+        loop.stop();
+    }));
+    ASSERT_FALSE(loop.add(-1, []() {}));
+    uint64_t three = 3;
+    ASSERT_EQ(write(fd, &three, sizeof(three)), (ssize_t) sizeof(three));
+    loop.run();
+    ASSERT_EQ(calls, 1);
+    loop.remove(fd);
+    close(fd);
+}
+
+TEST(rs_event_loop, writable_descriptors) {
+    RiotsensorsEventLoop loop;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    char buf[4096] = {0};
+    while (write(fds[0], buf, sizeof(buf)) > 0) {
+    }
+    int reads = 0;
+    int writes = 0;
+    ASSERT_TRUE(loop.add(fds[0], [&]() { reads++; }));
+    ASSERT_FALSE(loop.modify(fds[1], true, nullptr));
+    ASSERT_TRUE(loop.modify(fds[0], false, [&]() {
+        writes++;
+        ASSERT_TRUE(loop.modify(fds[0], true, nullptr));
+        loop.stop();
+    }));
+    // the full socket becomes writable once the peer read
+    while (read(fds[1], buf, sizeof(buf)) > 0) {
+    }
+    loop.run();
+    ASSERT_EQ(writes, 1);
+    ASSERT_EQ(reads, 0);
+    // watched for being readable again, the writable handler is not called anymore
+    ASSERT_EQ(write(fds[1], buf, 1), 1);
+    std::thread stopper([&loop]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        loop.stop();
+    });
+    loop.run();
+    stopper.join();
+    ASSERT_EQ(writes, 1);
+    ASSERT_GE(reads, 1);
+    loop.remove(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(rs_event_loop, timers) {
+    RiotsensorsEventLoop loop;
+    int calls = 0;
+    int timer = -1;
+    timer = loop.addTimer([&]() {
+        if (++calls == 3) {
+            loop.armTimer(timer, 0);
+            loop.stop();
+        }
+    });
+    ASSERT_GE(timer, 0);
+    auto start = std::chrono::steady_clock::now();
+    loop.armTimer(timer, 20, 5);
+    loop.run();
+    ASSERT_EQ(calls, 3);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(30));
+}
+
+TEST(rs_event_loop, stop_from_other_thread) {
+    RiotsensorsEventLoop loop;
+    std::thread stopper([&loop]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        loop.stop();
+    });
+    auto start = std::chrono::steady_clock::now();
+    loop.run();
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(4));
+    stopper.join();
+    // a stop before run() is not lost
+    loop.stop();
+    loop.run();
+}
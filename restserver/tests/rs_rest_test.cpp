@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <rs_rest.h>
+
+/**
+ * @brief Register a double lambda with a cached result
+ */
+static rs_registered_lambda *register_double(const char *name) {
+    auto arg = (rs_linux_registered_lambda *) calloc(1, sizeof(rs_linux_registered_lambda));
+    arg->data_cached = true;
+    arg->ret.ret_d = 21.5;
+    lambda_arg larg;
+    larg.obj = arg;
+    lambda_id_t id = lambda_registry_register(name, RS_LAMBDA_DOUBLE, RS_CACHE_CALL_ONCE, larg);
+    return get_registered_lambda_by_id(id);
+}
+
+TEST(rs_rest, call_fields) {
+    init_lambda_registry();
+    rs_registered_lambda *lambda = register_double("temp");
+    auto arg = (rs_linux_registered_lambda *) lambda->arg.obj;
+    ASSERT_EQ(*assemble_call_success_rest(lambda, true, false, &arg->ret, rest_format::JSON, RS_FIELDS_VALUE),
+              "21.5");
+    ASSERT_EQ(*assemble_call_success_rest(lambda, true, false, &arg->ret, rest_format::JSON, RS_FIELD_RESULT),
+              "{\"result\":21.5}");
+    ASSERT_EQ(*assemble_call_success_rest(lambda, true, true, &arg->ret, rest_format::JSON,
+                                          RS_FIELD_CACHE | RS_FIELD_RESULT),
+              "{\"cache\":{\"retrieved\":true,\"timeout\":true},\"result\":21.5}");
+    // CBOR float 21.5 without an enclosing map
+    ASSERT_EQ(*assemble_call_success_rest(lambda, true, false, &arg->ret, rest_format::CBOR, RS_FIELDS_VALUE),
+              std::string("\xfa\x41\xac\x00\x00", 5));
+    free(arg);
+    free_lambda_registry();
+}
+
+TEST(rs_rest, call_lambda_fragment) {
+    init_lambda_registry();
+    rs_registered_lambda *lambda = register_double("temp");
+    auto arg = (rs_linux_registered_lambda *) lambda->arg.obj;
+    const rest_format formats[] = {rest_format::JSON, rest_format::CBOR};
+    for (rest_format format : formats) {
+        rest_body fragment = assemble_lambda_properties_rest(lambda, format);
+        ASSERT_EQ(*assemble_call_success_rest(lambda, false, false, &arg->ret, format, RS_FIELDS_ALL,
+                                              fragment.get()),
+                  *assemble_call_success_rest(lambda, false, false, &arg->ret, format));
+        ASSERT_EQ(*assemble_call_success_rest(lambda, false, false, &arg->ret, format, RS_FIELD_LAMBDA,
+                                              fragment.get()),
+                  *assemble_call_success_rest(lambda, false, false, &arg->ret, format, RS_FIELD_LAMBDA));
+    }
+    free(arg);
+    free_lambda_registry();
+}
+
+TEST(rs_rest, select_by_name) {
+    init_lambda_registry();
+    rs_registered_lambda *lambdas[] = {register_double("tempA2"), register_double("humA1"), register_double("tempA1")};
+    std::vector<lambda_id_t> ids;
+    select_lambdas_by_name("temp*", &ids);
+    ASSERT_EQ(ids, std::vector<lambda_id_t>({lambdas[2]->id, lambdas[0]->id}));
+    select_lambdas_by_name("humA1", &ids);
+    ASSERT_EQ(ids, std::vector<lambda_id_t>({lambdas[1]->id}));
+    select_lambdas_by_name("hum", &ids);
+    ASSERT_TRUE(ids.empty());
+    select_lambdas_by_name("*", &ids);
+    ASSERT_EQ(ids.size(), 3u);
+
+    std::string list = *assemble_list_rest_for_name("temp*", 0, rest_format::JSON);
+    ASSERT_NE(list.find("\"tempA1\""), std::string::npos);
+    ASSERT_NE(list.find("\"tempA2\""), std::string::npos);
+    ASSERT_EQ(list.find("\"humA1\""), std::string::npos);
+    ASSERT_NE(list.find("\"count\":2"), std::string::npos);
+    ASSERT_NE(assemble_list_rest_for_name("temp*", RS_LAMBDA_INT, rest_format::JSON)->find("\"count\":0"),
+              std::string::npos);
+    std::string cache = *assemble_cache_rest_for_name("hum*", RS_LAMBDA_DOUBLE, rest_format::JSON);
+    ASSERT_NE(cache.find("\"humA1\""), std::string::npos);
+    ASSERT_NE(cache.find("\"cache-content\""), std::string::npos);
+    ASSERT_NE(cache.find("\"count\":1"), std::string::npos);
+    for (rs_registered_lambda *lambda : lambdas) {
+        free(lambda->arg.obj);
+    }
+    free_lambda_registry();
+}
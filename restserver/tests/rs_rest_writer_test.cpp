@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <rs_rest_writer.h>
+#include <rs_response_cache.h>
+#include <rs_server.h>
+
+/**
+ * Number of allocations of the current thread, counted by the replaced global operator new
+ */
+static thread_local size_t allocations = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+/**
+ * @brief Write a response shaped like the list of registered lambdas
+ */
+static void write_list(RestWriter *writer, unsigned int lambdas) {
+    writer->StartObject();
+    writer->Key("lambdas");
+    writer->StartArray();
+    for (unsigned int i = 0; i < lambdas; i++) {
+        writer->StartObject();
+        writer->Key("id");
+        writer->Uint(i);
+        writer->Key("name");
+        writer->String("temperature");
+        writer->Key("value");
+        writer->Double(21.5 + i);
+        writer->Key("cached");
+        writer->Bool(i % 2 == 0);
+        writer->EndObject();
+    }
+    writer->EndArray();
+    writer->Key("count");
+    writer->Uint64(lambdas);
+    writer->EndObject();
+}
+
+TEST(rs_rest_writer, formats) {
+    {
+        RestWriter writer(rest_format::JSON);
+        writer.StartObject();
+        writer.Key("id");
+        writer.Int(-1);
+        writer.Key("ok");
+        writer.Bool(true);
+        writer.EndObject();
+        ASSERT_EQ(writer.body(), "{\"id\":-1,\"ok\":true}");
+    }
+    {
+        RestWriter writer(rest_format::CBOR);
+        writer.StartObject();
+        writer.Key("id");
+        writer.Int(-1);
+        writer.Key("ok");
+        writer.Bool(true);
+        writer.EndObject();
+        ASSERT_EQ(writer.body(), std::string("\xbf\x62id\x20\x62ok\xf5\xff"));
+        ASSERT_EQ(*writer.share(), writer.body());
+    }
+}
+
+TEST(rs_rest_writer, raw_value) {
+    const rest_format formats[] = {rest_format::JSON, rest_format::CBOR};
+    for (rest_format format : formats) {
+        std::string fragment;
+        {
+            RestWriter writer(format);
+            writer.StartObject();
+            writer.Key("id");
+            writer.Uint(3);
+            writer.EndObject();
+            fragment = writer.str();
+        }
+        std::string expected;
+        {
+            RestWriter writer(format);
+            writer.StartObject();
+            writer.Key("lambda");
+            writer.StartObject();
+            writer.Key("id");
+            writer.Uint(3);
+            writer.EndObject();
+            writer.Key("result");
+            writer.Int(1);
+            writer.EndObject();
+            expected = writer.str();
+        }
+        RestWriter writer(format);
+        writer.StartObject();
+        writer.Key("lambda");
+        writer.RawValue(fragment);
+        writer.Key("result");
+        writer.Int(1);
+        writer.EndObject();
+        ASSERT_EQ(writer.body(), expected);
+    }
+}
+
+TEST(rs_rest_writer, reused_buffers) {
+    std::string first;
+    {
+        RestWriter writer(rest_format::JSON);
+        write_list(&writer, 3);
+        first = writer.str();
+    }
+    // a reused buffer starts empty
+    RestWriter writer(rest_format::JSON);
+    write_list(&writer, 3);
+    ASSERT_EQ(writer.body(), first);
+    {
+        // a writer created while another one is alive gets buffers of its own
+        RestWriter nested(rest_format::CBOR);
+        nested.Null();
+        ASSERT_EQ(nested.body(), std::string("\xf6"));
+    }
+    ASSERT_EQ(writer.body(), first);
+}
+
+TEST(rs_rest_writer, no_allocations) {
+    const rest_format formats[] = {rest_format::JSON, rest_format::CBOR};
+    for (rest_format format : formats) {
+        // the first responses grow the buffers of this thread
+        for (int i = 0; i < 3; i++) {
+            RestWriter writer(format);
+            write_list(&writer, 64);
+        }
+        size_t before = allocations;
+        size_t bytes = 0;
+        for (int i = 0; i < 1000; i++) {
+            RestWriter writer(format);
+            write_list(&writer, 64);
+            bytes += writer.body().size();
+        }
+        ASSERT_EQ(allocations - before, 0u);
+        ASSERT_GT(bytes, 0u);
+    }
+}
+
+TEST(rs_response_cache, hit_without_allocations) {
+    RiotsensorsResponseCache cache;
+    {
+        RestWriter writer(rest_format::JSON);
+        write_list(&writer, 16);
+        cache.put(rest_response_kind::LIST, 0, rest_format::JSON, rest_encoding::IDENTITY, 7, writer.share());
+    }
+    rest_body body;
+    ASSERT_FALSE(cache.get(rest_response_kind::LIST, 0, rest_format::JSON, rest_encoding::IDENTITY, 8, &body));
+    ASSERT_FALSE(cache.get(rest_response_kind::LIST, 0, rest_format::CBOR, rest_encoding::IDENTITY, 7, &body));
+    size_t before = allocations;
+    for (int i = 0; i < 1000; i++) {
+        body.reset();
+        ASSERT_TRUE(cache.get(rest_response_kind::LIST, 0, rest_format::JSON, rest_encoding::IDENTITY, 7, &body));
+    }
+    ASSERT_EQ(allocations - before, 0u);
+    RestWriter writer(rest_format::JSON);
+    write_list(&writer, 16);
+    ASSERT_EQ(*body, writer.body());
+    cache.clear();
+    // the response being sent keeps the body alive
+    ASSERT_EQ(*body, writer.body());
+}
+
+TEST(rs_response_cache, list_hit_without_allocations) {
+    init_lambda_registry();
+    RiotsensorsRESTHandler::reclaimResponses(SIZE_MAX);
+    rs_linux_registered_lambda connector{};
+    lambda_arg arg;
+    arg.obj = &connector;
+    lambda_registry_register("temp", RS_LAMBDA_DOUBLE, RS_CACHE_CALL_ONCE, arg);
+    lambda_registry_register("hum", RS_LAMBDA_INT, RS_CACHE_ONLY, arg);
+    const std::string all;
+    const rest_format formats[] = {rest_format::JSON, rest_format::CBOR};
+    for (rest_format format : formats) {
+        // the first request serializes the list and caches it
+        rest_response_info first = RiotsensorsRESTHandler::handleList(0, all, format);
+        ASSERT_EQ(first.code, Http::Code::Ok);
+        size_t before = allocations;
+        for (int i = 0; i < 1000; i++) {
+            rest_response_info answer = RiotsensorsRESTHandler::handleList(0, all, format);
+            ASSERT_EQ(answer.body, first.body);
+        }
+        ASSERT_EQ(allocations - before, 0u);
+    }
+    RiotsensorsRESTHandler::reclaimResponses(SIZE_MAX);
+    free_lambda_registry();
+}
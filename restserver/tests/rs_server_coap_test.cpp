@@ -0,0 +1,350 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <lambda_registry.h>
+#include <rs_connector.h>
+#include <rs_server_coap.h>
+
+#define TEST_COAP_PORT 56831
+
+/**
+ * Query parameter selecting the type of the test lambdas
+ */
+static const std::string int_type = "type=" + std::to_string(RS_LAMBDA_INT);
+
+/**
+ * @brief A CoAP client on its own UDP socket
+ */
+class CoapTestClient {
+public:
+    CoapTestClient() {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        memset(&server, 0, sizeof(server));
+        server.sin_family = AF_INET;
+        server.sin_port = htons(TEST_COAP_PORT);
+        server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    ~CoapTestClient() {
+        close(fd);
+    }
+
+    /**
+     * @brief Send a GET request
+     *
+     * @param type CoAP message type, 0 for CON and 1 for NON
+     * @param id Message ID
+     * @param token Token
+     * @param path Segments of the URI path
+     * @param queries Query parameters in the form key=value
+     */
+    void get(uint8_t type, uint16_t id, const std::string &token, const std::vector<std::string> &path,
+             const std::vector<std::string> &queries = {}) {
+        std::string pdu;
+        pdu += (char) (0x40 | (type << 4) | token.length());
+        pdu += (char) 0x01;
+        pdu += (char) (id >> 8);
+        pdu += (char) id;
+        pdu += token;
+        unsigned int last = 0;
+        for (const std::string &segment : path) {
+            add_option(&pdu, &last, 11, segment);
+        }
+        for (const std::string &query : queries) {
+            add_option(&pdu, &last, 15, query);
+        }
+        send(pdu);
+    }
+
+    /**
+     * @brief Acknowledge a confirmable message of the server
+     *
+     * @param id Message ID
+     */
+    void ack(uint16_t id) {
+        std::string pdu;
+        pdu += (char) 0x60;
+        pdu += (char) 0x00;
+        pdu += (char) (id >> 8);
+        pdu += (char) id;
+        send(pdu);
+    }
+
+    /**
+     * @brief Wait for a message of the server
+     *
+     * @param timeout_ms Milliseconds to wait
+     * @return The message, empty if none arrived
+     */
+    std::string receive(int timeout_ms) {
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, timeout_ms) <= 0) {
+            return std::string();
+        }
+        char buf[1500];
+        ssize_t length = recv(fd, buf, sizeof(buf), 0);
+        return length > 0 ? std::string(buf, (size_t) length) : std::string();
+    }
+
+private:
+    int fd;
+    sockaddr_in server;
+
+    void send(const std::string &pdu) {
+        sendto(fd, pdu.data(), pdu.length(), 0, (const sockaddr *) &server, sizeof(server));
+    }
+
+    static void add_option(std::string *pdu, unsigned int *last, unsigned int number, const std::string &value) {
+        unsigned int delta = number - *last;
+        *last = number;
+        if (value.length() < 13) {
+            *pdu += (char) ((delta << 4) | value.length());
+        } else {
+            *pdu += (char) ((delta << 4) | 13);
+            *pdu += (char) (value.length() - 13);
+        }
+        *pdu += value;
+    }
+};
+
+static uint8_t coap_type(const std::string &pdu) {
+    return (uint8_t) ((pdu[0] >> 4) & 0x03);
+}
+
+static uint8_t coap_code(const std::string &pdu) {
+    return (uint8_t) pdu[1];
+}
+
+static uint16_t coap_id(const std::string &pdu) {
+    return (uint16_t) (((uint8_t) pdu[2] << 8) | (uint8_t) pdu[3]);
+}
+
+static std::string coap_token(const std::string &pdu) {
+    return pdu.substr(4, (size_t) (pdu[0] & 0x0f));
+}
+
+static std::string coap_payload(const std::string &pdu) {
+    std::string::size_type marker = pdu.find((char) 0xff, 4 + (size_t) (pdu[0] & 0x0f));
+    return marker == std::string::npos ? std::string() : pdu.substr(marker + 1);
+}
+
+static void register_test_lambda(struct spt_context *sptctx, const char *name, rs_cache_type_t cache) {
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = cache;
+    a.ltype = RS_LAMBDA_INT;
+    strncpy(a.name, name, sizeof(a.name));
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(sptctx, &pkt);
+}
+
+static void answer_test_lambda(struct spt_context *sptctx, lambda_id_t id, rs_int_t value) {
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r.result_base.lambda_id = id;
+    r.result = value;
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &r;
+    pkt.len = sizeof(r);
+    handle_received_packet(sptctx, &pkt);
+}
+
+static void unregister_test_lambda(struct spt_context *sptctx, lambda_id_t device_id) {
+    rs_packet_unregistered_t u;
+    u.base.ptype = RS_PACKET_UNREGISTERED;
+    u.lambda_id = device_id;
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &u;
+    pkt.len = sizeof(u);
+    handle_received_packet(sptctx, &pkt);
+}
+
+TEST(rs_server_coap, separate_responses) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    register_test_lambda(&sptctx, "slow", RS_CACHE_NO_CACHE);
+    register_test_lambda(&sptctx, "cached", RS_CACHE_ONLY);
+    lambda_id_t slow = get_registered_lambda_by_name("slow")->id;
+    lambda_id_t cached_id = get_registered_lambda_by_name("cached")->id;
+    answer_test_lambda(&sptctx, cached_id, 5);
+
+    riotsensors_start_opts opts{};
+    opts.coap_port = TEST_COAP_PORT;
+    opts.observe_interval = RS_OBSERVE_DEFAULT_INTERVAL;
+    std::thread server(startCoAPServer, &opts);
+
+    // wait until the server answers
+    CoapTestClient probe;
+    std::string answer;
+    for (uint16_t i = 0; i < 20 && answer.empty(); i++) {
+        probe.get(0, (uint16_t) (0x0100 + i), "p", {"v1", "stats"});
+        answer = probe.receive(100);
+    }
+    ASSERT_FALSE(answer.empty());
+
+    // calls the device has to answer are acknowledged right away
+    CoapTestClient by_name, by_id;
+    by_name.get(0, 0x1001, "n1", {"v1", "call", "name"}, {int_type, "name=slow"});
+    answer = by_name.receive(500);
+    ASSERT_EQ(answer.length(), 4u);
+    ASSERT_EQ(coap_type(answer), 2);
+    ASSERT_EQ(coap_code(answer), 0);
+    ASSERT_EQ(coap_id(answer), 0x1001);
+    by_id.get(0, 0x2001, "i1", {"v1", "call", "id"}, {int_type, "id=" + std::to_string(slow)});
+    answer = by_id.receive(500);
+    ASSERT_EQ(answer.length(), 4u);
+    ASSERT_EQ(coap_id(answer), 0x2001);
+    CoapTestClient multi;
+    multi.get(0, 0x5001, "m1", {"v1", "call", "multi"},
+              {"ids=" + std::to_string(cached_id) + "," + std::to_string(slow)});
+    answer = multi.receive(500);
+    ASSERT_EQ(answer.length(), 4u);
+    ASSERT_EQ(coap_id(answer), 0x5001);
+
+    // other requests are served while the calls are pending, answered calls are piggybacked
+    CoapTestClient cached;
+    cached.get(0, 0x3001, "c1", {"v1", "call", "name"}, {int_type, "name=cached"});
+    answer = cached.receive(500);
+    ASSERT_FALSE(answer.empty());
+    ASSERT_EQ(coap_type(answer), 2);
+    ASSERT_EQ(coap_code(answer), 0x45);
+    ASSERT_EQ(coap_id(answer), 0x3001);
+    ASSERT_EQ(coap_token(answer), "c1");
+    ASSERT_NE(coap_payload(answer).find("5"), std::string::npos);
+    CoapTestClient non;
+    non.get(1, 0x4001, "l1", {"v1", "list"});
+    answer = non.receive(500);
+    ASSERT_FALSE(answer.empty());
+    ASSERT_EQ(coap_type(answer), 1);
+    ASSERT_EQ(coap_code(answer), 0x45);
+
+    // one result answers both calls with a confirmable separate response
+    answer_test_lambda(&sptctx, slow, 17);
+    std::string separate = by_name.receive(1000);
+    ASSERT_FALSE(separate.empty());
+    ASSERT_EQ(coap_type(separate), 0);
+    ASSERT_EQ(coap_code(separate), 0x45);
+    ASSERT_EQ(coap_token(separate), "n1");
+    ASSERT_NE(coap_payload(separate).find("17"), std::string::npos);
+    by_name.ack(coap_id(separate));
+    std::string unacknowledged = by_id.receive(1000);
+    ASSERT_FALSE(unacknowledged.empty());
+    ASSERT_EQ(coap_type(unacknowledged), 0);
+    ASSERT_EQ(coap_token(unacknowledged), "i1");
+    std::string combined = multi.receive(1000);
+    ASSERT_FALSE(combined.empty());
+    ASSERT_EQ(coap_code(combined), 0x45);
+    ASSERT_EQ(coap_token(combined), "m1");
+    ASSERT_NE(coap_payload(combined).find("5"), std::string::npos);
+    ASSERT_NE(coap_payload(combined).find("17"), std::string::npos);
+    multi.ack(coap_id(combined));
+
+    // the response that has not been acknowledged is retransmitted, the acknowledged one is not
+    std::string retransmitted = by_id.receive(5000);
+    ASSERT_EQ(retransmitted, unacknowledged);
+    by_id.ack(coap_id(retransmitted));
+    ASSERT_TRUE(by_name.receive(3500).empty());
+
+    stopCoAPServer();
+    server.join();
+    free_lambda_registry();
+}
+
+TEST(rs_server_coap, reuseport_workers) {
+    riotsensors_start_opts opts{};
+    opts.coap_port = TEST_COAP_PORT;
+    opts.coap_threads = 4;
+    opts.observe_interval = RS_OBSERVE_DEFAULT_INTERVAL;
+    std::thread server(startCoAPServer, &opts);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // clients are spread across the workers, every one of them is answered by the worker owning its address
+    std::vector<std::unique_ptr<CoapTestClient>> clients;
+    for (int i = 0; i < 16; i++) {
+        clients.emplace_back(new CoapTestClient());
+        for (uint16_t id = 0; id < 8; id++) {
+            clients.back()->get(1, (uint16_t) (i << 8 | id), "w", {"v1", "stats"});
+        }
+    }
+    for (const std::unique_ptr<CoapTestClient> &client : clients) {
+        for (int answers = 0; answers < 8; answers++) {
+            std::string answer = client->receive(1000);
+            ASSERT_FALSE(answer.empty());
+            ASSERT_EQ(coap_code(answer), 0x45);
+        }
+    }
+
+    stopCoAPServer();
+    server.join();
+}
+
+TEST(rs_server_coap, lambda_resources) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    register_test_lambda(&sptctx, "temp", RS_CACHE_ONLY);
+    answer_test_lambda(&sptctx, get_registered_lambda_by_name("temp")->id, 21);
+
+    riotsensors_start_opts opts{};
+    opts.coap_port = TEST_COAP_PORT;
+    opts.observe_interval = RS_OBSERVE_DEFAULT_INTERVAL;
+    std::thread server(startCoAPServer, &opts);
+
+    // lambdas registered before the start have a resource, called without query parameters
+    CoapTestClient client;
+    std::string answer;
+    for (uint16_t i = 0; i < 20 && answer.empty(); i++) {
+        client.get(0, (uint16_t) (0x0100 + i), "t", {"v1", "lambda", "temp"}, {"view=value"});
+        answer = client.receive(100);
+    }
+    ASSERT_FALSE(answer.empty());
+    ASSERT_EQ(coap_code(answer), 0x45);
+    ASSERT_EQ(coap_payload(answer), "21");
+
+    // a lambda registered while the server runs gets a resource listed for discovery
+    register_test_lambda(&sptctx, "hum", RS_CACHE_ONLY);
+    answer_test_lambda(&sptctx, get_registered_lambda_by_name("hum")->id, 40);
+    client.get(0, 0x0201, "h", {"v1", "lambda", "hum"}, {"view=value"});
+    answer = client.receive(500);
+    ASSERT_EQ(coap_code(answer), 0x45);
+    ASSERT_EQ(coap_payload(answer), "40");
+    client.get(0, 0x0202, "w", {".well-known", "core"});
+    answer = client.receive(500);
+    ASSERT_EQ(coap_code(answer), 0x45);
+    ASSERT_NE(coap_payload(answer).find("</v1/lambda/temp>"), std::string::npos);
+    ASSERT_NE(coap_payload(answer).find("</v1/lambda/hum>"), std::string::npos);
+    ASSERT_NE(coap_payload(answer).find("rt=" RS_COAP_LAMBDA_RT), std::string::npos);
+
+    // lambdas are listed by a prefix of their name
+    client.get(0, 0x0205, "l", {"v1", "list"}, {"name=te*"});
+    answer = client.receive(500);
+    ASSERT_EQ(coap_code(answer), 0x45);
+    ASSERT_NE(coap_payload(answer).find("\"temp\""), std::string::npos);
+    ASSERT_EQ(coap_payload(answer).find("\"hum\""), std::string::npos);
+
+    // the resource of an unregistered lambda is removed
+    unregister_test_lambda(&sptctx, 0);
+    client.get(0, 0x0203, "t", {"v1", "lambda", "temp"});
+    answer = client.receive(500);
+    ASSERT_EQ(coap_code(answer), 0x84);
+    client.get(0, 0x0204, "w", {".well-known", "core"});
+    answer = client.receive(500);
+    ASSERT_EQ(coap_payload(answer).find("</v1/lambda/temp>"), std::string::npos);
+    ASSERT_NE(coap_payload(answer).find("</v1/lambda/hum>"), std::string::npos);
+
+    stopCoAPServer();
+    server.join();
+    free_lambda_registry();
+}
@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <lambda_registry.h>
+#include <rs_connector.h>
+#include <rs_server_unix.h>
+
+#define TEST_UNIX_PATH "/tmp/riotsensors_test.sock"
+
+/**
+ * @brief Connect to the test server, waiting for it to start
+ *
+ * @return The socket, -1 if the server did not start
+ */
+static int connect_test_client() {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, TEST_UNIX_PATH);
+    for (int i = 0; i < 20; i++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, (const sockaddr *) &addr, sizeof(addr)) == 0) {
+            return fd;
+        }
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return -1;
+}
+
+static std::string frame(const void *packet, size_t length) {
+    uint32_t prefix = htonl((uint32_t) length);
+    return std::string((const char *) &prefix, sizeof(prefix)) + std::string((const char *) packet, length);
+}
+
+static std::string call_by_id_frame(lambda_id_t id) {
+    rs_packet_call_by_id_t pkt{};
+    pkt.base.ptype = RS_PACKET_CALL_BY_ID;
+    pkt.lambda_id = id;
+    pkt.expected_type = RS_LAMBDA_INT;
+    return frame(&pkt, sizeof(pkt));
+}
+
+static std::string call_by_name_frame(const char *name) {
+    rs_packet_call_by_name_t pkt{};
+    pkt.base.ptype = RS_PACKET_CALL_BY_NAME;
+    strncpy(pkt.name, name, sizeof(pkt.name));
+    pkt.expected_type = RS_LAMBDA_INT;
+    return frame(&pkt, sizeof(pkt));
+}
+
+static std::string select_frame(rs_packet_type_t ptype, const std::string &pattern) {
+    rs_unix_packet_select_t pkt{};
+    pkt.base.ptype = ptype;
+    pkt.type = 0;
+    return frame((std::string((const char *) &pkt, sizeof(pkt)) + pattern).data(), sizeof(pkt) + pattern.length());
+}
+
+/**
+ * @brief Read a number of bytes
+ *
+ * @return If all bytes arrived before the timeout
+ */
+static bool receive_exactly(int fd, char *buf, size_t length, int timeout_ms) {
+    size_t received = 0;
+    while (received < length) {
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, timeout_ms) <= 0) {
+            return false;
+        }
+        ssize_t r = recv(fd, buf + received, length - received, 0);
+        if (r <= 0) {
+            return false;
+        }
+        received += (size_t) r;
+    }
+    return true;
+}
+
+/**
+ * @brief Receive an answer
+ *
+ * @return The answer without the length prefix, empty if none arrived
+ */
+static std::string receive_frame(int fd, int timeout_ms) {
+    uint32_t length;
+    if (!receive_exactly(fd, (char *) &length, sizeof(length), timeout_ms)) {
+        return std::string();
+    }
+    std::string packet(ntohl(length), '\0');
+    if (!receive_exactly(fd, &packet[0], packet.length(), timeout_ms)) {
+        return std::string();
+    }
+    return packet;
+}
+
+static rs_int_t int_result(const std::string &packet) {
+    rs_packet_lambda_result_int_t pkt;
+    memcpy(&pkt, packet.data(), sizeof(pkt));
+    ntoh_rs_packet_lambda_result_int_t(&pkt);
+    return pkt.result;
+}
+
+static int8_t error_code(const std::string &packet) {
+    rs_packet_lambda_result_error_t pkt;
+    memcpy(&pkt, packet.data(), sizeof(pkt));
+    return pkt.error_code;
+}
+
+static uint16_t selection_count(const std::string &packet) {
+    rs_unix_packet_selection_t pkt;
+    memcpy(&pkt, packet.data(), sizeof(pkt));
+    return ntohs(pkt.count);
+}
+
+static void register_test_lambda(struct spt_context *sptctx, const char *name, rs_cache_type_t cache) {
+    rs_packet_registered_t a;
+    a.base.ptype = RS_PACKET_REGISTERED;
+    a.cache = cache;
+    a.ltype = RS_LAMBDA_INT;
+    strncpy(a.name, name, sizeof(a.name));
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &a;
+    pkt.len = sizeof(a);
+    handle_received_packet(sptctx, &pkt);
+}
+
+static void answer_test_lambda(struct spt_context *sptctx, lambda_id_t id, rs_int_t value) {
+    rs_packet_lambda_result_int_t r;
+    r.result_base.base.ptype = RS_PACKET_RESULT_INT;
+    r.result_base.lambda_id = id;
+    r.result = value;
+    struct serial_data_packet pkt;
+    pkt.data = (uint8_t *) &r;
+    pkt.len = sizeof(r);
+    handle_received_packet(sptctx, &pkt);
+}
+
+TEST(rs_server_unix, pipelined_requests) {
+    struct spt_context sptctx;
+    sptctx.log_in_line = false;
+    init_lambda_registry();
+    register_test_lambda(&sptctx, "slow", RS_CACHE_NO_CACHE);
+    register_test_lambda(&sptctx, "cached", RS_CACHE_ONLY);
+    register_test_lambda(&sptctx, "temp", RS_CACHE_ONLY);
+    lambda_id_t slow = get_registered_lambda_by_name("slow")->id;
+    answer_test_lambda(&sptctx, get_registered_lambda_by_name("cached")->id, 5);
+    answer_test_lambda(&sptctx, get_registered_lambda_by_name("temp")->id, 21);
+
+    riotsensors_start_opts opts{};
+    opts.unix_path = (char *) TEST_UNIX_PATH;
+    std::thread server(startUnixServer, &opts);
+    int fd = connect_test_client();
+    ASSERT_GE(fd, 0);
+
+    // all requests are sent at once, the answers keep their order behind the call the device has to answer
+    uint32_t too_short = htonl(0);
+    std::string requests = call_by_id_frame(slow) + call_by_name_frame("cached") +
+                           select_frame(RS_UNIX_PACKET_LIST, "") + select_frame(RS_UNIX_PACKET_CACHE, "te*") +
+                           std::string((const char *) &too_short, sizeof(too_short)) + call_by_name_frame("none");
+    ASSERT_EQ(send(fd, requests.data(), requests.length(), 0), (ssize_t) requests.length());
+    ASSERT_TRUE(receive_frame(fd, 300).empty());
+    answer_test_lambda(&sptctx, slow, 17);
+
+    std::string answer = receive_frame(fd, 1000);
+    ASSERT_EQ(answer[0], RS_PACKET_RESULT_INT);
+    ASSERT_EQ(int_result(answer), 17);
+    ASSERT_EQ(std::string(answer.data() + 2), "slow");
+    answer = receive_frame(fd, 1000);
+    ASSERT_EQ(answer[0], RS_PACKET_RESULT_INT);
+    ASSERT_EQ(int_result(answer), 5);
+    answer = receive_frame(fd, 1000);
+    ASSERT_EQ(answer[0], RS_UNIX_PACKET_LIST);
+    ASSERT_EQ(selection_count(answer), 3);
+    ASSERT_EQ(answer.length(), sizeof(rs_unix_packet_selection_t) + 3 * sizeof(rs_unix_list_entry_t));
+    rs_unix_list_entry_t entry;
+    memcpy(&entry, answer.data() + sizeof(rs_unix_packet_selection_t) + sizeof(entry), sizeof(entry));
+    ASSERT_EQ(std::string(entry.lambda.name), "cached");
+    ASSERT_EQ(entry.lambda.cache, RS_CACHE_ONLY);
+    answer = receive_frame(fd, 1000);
+    ASSERT_EQ(answer[0], RS_UNIX_PACKET_CACHE);
+    ASSERT_EQ(selection_count(answer), 1);
+    std::string cached = answer.substr(sizeof(rs_unix_packet_selection_t));
+    ASSERT_EQ(cached[0], RS_PACKET_RESULT_INT);
+    ASSERT_EQ(int_result(cached), 21);
+    answer = receive_frame(fd, 1000);
+    ASSERT_EQ(answer[0], RS_PACKET_RESULT_ERROR);
+    ASSERT_EQ(error_code(answer), RS_UNIX_INVALID_REQUEST);
+    answer = receive_frame(fd, 1000);
+    ASSERT_EQ(answer[0], RS_PACKET_RESULT_ERROR);
+    ASSERT_EQ(error_code(answer), RS_CALL_NOTFOUND);
+
+    // a client shutting down its side still gets the pending answers before the connection is closed
+    std::string request = call_by_id_frame(slow);
+    ASSERT_EQ(send(fd, request.data(), request.length(), 0), (ssize_t) request.length());
+    shutdown(fd, SHUT_WR);
+    ASSERT_TRUE(receive_frame(fd, 300).empty());
+    answer_test_lambda(&sptctx, slow, 18);
+    answer = receive_frame(fd, 1000);
+    ASSERT_EQ(int_result(answer), 18);
+    char end;
+    ASSERT_EQ(recv(fd, &end, 1, 0), 0);
+    close(fd);
+
+    // a frame longer than allowed closes the connection
+    fd = connect_test_client();
+    ASSERT_GE(fd, 0);
+    uint32_t too_long = htonl(RS_UNIX_MAX_FRAME + 1);
+    ASSERT_EQ(send(fd, &too_long, sizeof(too_long), 0), (ssize_t) sizeof(too_long));
+    pollfd p = {fd, POLLIN, 0};
+    ASSERT_EQ(poll(&p, 1, 1000), 1);
+    ASSERT_EQ(recv(fd, &end, 1, 0), 0);
+    close(fd);
+
+    stopUnixServer();
+    server.join();
+    ASSERT_NE(access(TEST_UNIX_PATH, F_OK), 0);
+    free_lambda_registry();
+}